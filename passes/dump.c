@@ -51,6 +51,8 @@ struct dump {
 	const char *file;
 	int file_fd;
 
+	struct wldbg_pass_interest interests[2];
+
 	struct {
 		uint64_t in_msg;
 		uint64_t out_msg;
@@ -90,13 +92,17 @@ dump_message(struct wldbg_message *message, struct dump *dump)
 	if (options & DECODE)
 		options |= SEPARATE;
 
-	if (options & HUMAN)
-		wldbg_message_print(message);
+	/* the raw data go with the human-readable output, so do not
+	 * print them for messages that were collapsed into a run */
+	if ((options & HUMAN) && !wldbg_message_print(message))
+		return;
 
 	if (!(options & RAW))
 		return;
 
-	printf("%s: ", message->from == CLIENT ? "CLIENT" : "SERVER");
+	/* print it next to the human-readable output */
+	wldbg_message_printf(message, "%s: ",
+			     message->from == CLIENT ? "CLIENT" : "SERVER");
 
 	for (i = 0; i < message->size / sizeof(uint32_t) ; ++i) {
 		if (options & SEPARATE) {
@@ -104,11 +110,14 @@ dump_message(struct wldbg_message *message, struct dump *dump)
 				size = data[i + 1] >> 16;
 
 				if (options & DECODE) {
-					printf("\n id: %u opcode: %u size: %lu:\n\t",
+					wldbg_message_printf(message,
+						"\n id: %u opcode: %u size: %zu:\n\t",
 						data[i], data[i + 1] & 0xffff,
 						size);
 				} else {
-					printf("\n | %2lu | ", size);
+					wldbg_message_printf(message,
+							     "\n | %2zu | ",
+							     size);
 				}
 			}
 
@@ -116,12 +125,12 @@ dump_message(struct wldbg_message *message, struct dump *dump)
 		}
 
 		if (options & DECIMAL)
-			printf("%d ", data[i]);
+			wldbg_message_printf(message, "%d ", data[i]);
 		else
-			printf("%08x ", data[i]);
+			wldbg_message_printf(message, "%08x ", data[i]);
 	}
 
-	putchar('\n');
+	wldbg_message_printf(message, "\n");
 }
 
 static int
@@ -190,7 +199,7 @@ dump_init(struct wldbg *wldbg, struct wldbg_pass *pass, int argc, const char *ar
 {
 	int i;
 	uint64_t flags = 0;
-	struct dump *dump = malloc(sizeof *dump);
+	struct dump *dump = calloc(1, sizeof *dump);
 	if (!dump)
 		return -1;
 
@@ -245,6 +254,17 @@ dump_init(struct wldbg *wldbg, struct wldbg_pass *pass, int argc, const char *ar
 	dump->options = flags;
 	pass->user_data = dump;
 
+	/* we need all messages for statistics */
+	if (!(flags & STATS)) {
+		if (flags & CLIENTONLY && !(flags & SERVERONLY))
+			dump->interests[0].direction = WLDBG_FROM_CLIENT;
+		else if (flags & SERVERONLY && !(flags & CLIENTONLY))
+			dump->interests[0].direction = WLDBG_FROM_SERVER;
+
+		if (dump->interests[0].direction)
+			pass->interests = dump->interests;
+	}
+
 	return 0;
 }
 
@@ -277,5 +297,5 @@ struct wldbg_pass wldbg_pass = {
 	.client_pass = dump_out,
 	.help = print_help,
 	.description = "Dump data going through the wire",
-	0
+	.flags = WLDBG_PASS_READ_ONLY
 };
@@ -126,5 +126,7 @@ struct wldbg_pass wldbg_pass = {
 	.server_pass = example_in,
 	.client_pass = example_out,
 	.help = example_help,
-	.description = "Example wldbg pass"
+	.description = "Example wldbg pass",
+	/* we do not modify messages */
+	.flags = WLDBG_PASS_READ_ONLY
 };
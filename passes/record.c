@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+
+#include "wayland/wayland-util.h"
+
+#include "wldbg.h"
+#include "wldbg-pass.h"
+#include "wldbg-parse-message.h"
+#include "wldbg-trace.h"
+
+struct record {
+	const char *file;
+	int fd;
+	struct wldbg_trace_writer *writer;
+	/* writing failed, we do not record anymore */
+	int failed;
+};
+
+static unsigned int
+count_fds(const struct wl_message *message)
+{
+	const char *s;
+	unsigned int count = 0;
+
+	for (s = message->signature; *s; ++s)
+		if (*s == 'h')
+			++count;
+
+	return count;
+}
+
+static void
+record_one(struct record *record, struct wldbg_message *message)
+{
+	struct wldbg_trace_record rec;
+	struct wldbg_resolved_message rm;
+	const char *interface = NULL;
+	uint32_t opcode = 0;
+
+	memset(&rec, 0, sizeof rec);
+	rec.time = message->received;
+	rec.connection = wldbg_message_get_connection_id(message);
+	rec.from = message->from;
+	rec.data = message->data;
+	rec.size = message->size;
+
+	if (wldbg_resolve_message(message, &rm)) {
+		interface = rm.wl_interface->name;
+		rec.fd_count = count_fds(rm.wl_message);
+	}
+
+	if (message->size >= 2 * sizeof(uint32_t))
+		opcode = ((uint32_t *) message->data)[1] & 0xffff;
+
+	if (wldbg_trace_writer_add(record->writer, &rec,
+				   interface, opcode) < 0) {
+		fprintf(stderr, "Recording into '%s' failed, "
+			"not recording anymore\n", record->file);
+		record->failed = 1;
+	}
+}
+
+static int
+record_message(void *user_data, struct wldbg_message *message)
+{
+	struct record *record = user_data;
+	struct wldbg_message one;
+	uint32_t *p, size;
+	size_t offset;
+
+	if (record->failed)
+		return PASS_NEXT;
+
+	if (message->size < 2 * sizeof(uint32_t)
+	    || ((uint32_t *) message->data)[1] >> 16 == message->size) {
+		record_one(record, message);
+		return PASS_NEXT;
+	}
+
+	/* wldbg passes whole buffers, record the messages one by one */
+	for (offset = 0; offset < message->size && !record->failed;
+	     offset += size) {
+		p = (uint32_t *) ((char *) message->data + offset);
+		size = p[1] >> 16;
+		if (size < 2 * sizeof(uint32_t)
+		    || size > message->size - offset)
+			size = message->size - offset;
+
+		one = *message;
+		one.data = p;
+		one.size = size;
+
+		record_one(record, &one);
+	}
+
+	return PASS_NEXT;
+}
+
+static void
+print_help(void *user_data)
+{
+	(void) user_data;
+
+	printf(" --- Record messages into a file --- \n"
+	       "\n"
+	       "Usage: wldbg record [--raw] FILE\n"
+	       "\n"
+	       "Write every message with the time when it was received,\n"
+	       "the connection and the direction into FILE.\n"
+	       "The file must not exist.\n"
+	       "\n"
+	       "  --raw    do not compress the messages\n");
+}
+
+static int
+record_init(struct wldbg *wldbg, struct wldbg_pass *pass,
+	    int argc, const char *argv[])
+{
+	struct record *record;
+	uint32_t flags = WLDBG_TRACE_COMPRESS;
+
+	if (argc == 3 && strcmp(argv[1], "--raw") == 0) {
+		flags = 0;
+		--argc;
+		++argv;
+	}
+
+	if (argc != 2 || strcmp(argv[1], "help") == 0) {
+		print_help(NULL);
+		if (argc == 2) {
+			wldbg_exit(wldbg);
+			return 0;
+		}
+
+		return -1;
+	}
+
+	record = calloc(1, sizeof *record);
+	if (!record)
+		return -1;
+
+	record->file = argv[1];
+	record->fd = open(record->file,
+			  O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (record->fd == -1) {
+		perror("Opening file for recording");
+		free(record);
+		return -1;
+	}
+
+	record->writer = wldbg_trace_writer_create(record->fd, flags);
+	if (!record->writer) {
+		perror("Writing into file for recording");
+		close(record->fd);
+		free(record);
+		return -1;
+	}
+
+	pass->user_data = record;
+
+	return 0;
+}
+
+static void
+record_destroy(void *data)
+{
+	struct record *record = data;
+
+	if (!record)
+		return;
+
+	if (wldbg_trace_writer_finish(record->writer) < 0 && !record->failed)
+		fprintf(stderr, "Recording into '%s' failed\n", record->file);
+
+	close(record->fd);
+	free(record);
+}
+
+struct wldbg_pass wldbg_pass = {
+	.init = record_init,
+	.destroy = record_destroy,
+	.server_pass = record_message,
+	.client_pass = record_message,
+	.help = print_help,
+	.description = "Record messages into a file for replaying or analysis",
+	.flags = WLDBG_PASS_READ_ONLY
+};
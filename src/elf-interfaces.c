@@ -0,0 +1,775 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <link.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "wldbg-private.h"
+#include "wldbg-interfaces.h"
+#include "elf-interfaces.h"
+#include "wldbg-message-layout.h"
+#include "wldbg-hash.h"
+#include "wldbg-printers.h"
+
+/* limits for what we consider a sane wl_interface */
+#define MAX_MESSAGES 4096
+#define MAX_STRING 256
+
+#if __ELF_NATIVE_CLASS == 64
+#define ELF_NATIVE_CLASS ELFCLASS64
+#define ELF_ST_TYPE ELF64_ST_TYPE
+#else
+#define ELF_NATIVE_CLASS ELFCLASS32
+#define ELF_ST_TYPE ELF32_ST_TYPE
+#endif
+
+struct discovered_interface {
+	struct wl_interface interface;
+	/* where the interface and its messages
+	 * are in the client's memory */
+	uintptr_t remote;
+	uintptr_t methods;
+	uintptr_t events;
+
+	struct additional_interface item;
+};
+
+struct remote_entry {
+	uintptr_t remote;
+	/* NULL if there is no interface at the address */
+	const struct wl_interface *local;
+};
+
+struct elf_interfaces {
+	pid_t pid;
+
+	/* open addressing hash table that maps addresses
+	 * in the client to the interfaces we have here */
+	struct remote_entry *map;
+	unsigned int map_size;
+	unsigned int map_num;
+
+	/* struct mapped_object, objects we scanned already */
+	struct wl_array objects;
+	/* hash of /proc/pid/maps from the last scan */
+	uint64_t maps_hash;
+
+	/* struct discovered_interface *, waiting for the messages */
+	struct wl_array pending;
+	/* struct discovered_interface *, all interfaces we copied */
+	struct wl_array copies;
+	/* everything we allocated for the interfaces */
+	struct wl_array allocations;
+
+	/* we can not read the client's memory */
+	int failed;
+};
+
+struct mapped_object {
+	char *path;
+	uintptr_t start;
+};
+
+static void *
+set_alloc(struct elf_interfaces *set, size_t size)
+{
+	void **p, *mem;
+
+	p = wl_array_add(&set->allocations, sizeof *p);
+	if (!p)
+		return NULL;
+
+	mem = calloc(1, size);
+	if (!mem) {
+		set->allocations.size -= sizeof *p;
+		return NULL;
+	}
+
+	*p = mem;
+	return mem;
+}
+
+static char *
+set_strdup(struct elf_interfaces *set, const char *str)
+{
+	char *s = set_alloc(set, strlen(str) + 1);
+
+	if (s)
+		strcpy(s, str);
+
+	return s;
+}
+
+/*
+ * Reading the client's memory
+ */
+
+static int
+remote_read(struct elf_interfaces *set, uintptr_t addr,
+	    void *buf, size_t len)
+{
+	struct iovec local = { buf, len };
+	struct iovec remote = { (void *) addr, len };
+
+	if (set->failed)
+		return -1;
+
+	if (process_vm_readv(set->pid, &local, 1,
+			     &remote, 1, 0) != (ssize_t) len) {
+		/* we are not allowed to read the memory
+		 * or the process is gone, give up */
+		if (errno == EPERM || errno == ESRCH) {
+			fprintf(stderr, "Can not read interfaces from "
+				"process %d: %s\n", set->pid, strerror(errno));
+			set->failed = 1;
+		}
+
+		return -1;
+	}
+
+	return 0;
+}
+
+/* read the string by pages, so that we do not fail reading
+ * a short string at the end of a mapping */
+static int
+remote_read_string(struct elf_interfaces *set, uintptr_t addr,
+		   char *buf, size_t size)
+{
+	static size_t page_size;
+	size_t len = 0, chunk;
+
+	if (!page_size)
+		page_size = sysconf(_SC_PAGESIZE);
+
+	while (len < size) {
+		chunk = page_size - ((addr + len) & (page_size - 1));
+		if (chunk > size - len)
+			chunk = size - len;
+
+		if (remote_read(set, addr + len, buf + len, chunk) < 0)
+			return -1;
+
+		if (memchr(buf + len, '\0', chunk))
+			return 0;
+
+		len += chunk;
+	}
+
+	/* too long */
+	return -1;
+}
+
+/*
+ * Remote address -> local interface map
+ */
+
+static inline unsigned int
+remote_hash(uintptr_t remote, unsigned int size)
+{
+	return ((remote >> 3) * 2654435761u) & (size - 1);
+}
+
+static struct remote_entry *
+map_find(struct elf_interfaces *set, uintptr_t remote)
+{
+	struct remote_entry *e;
+	unsigned int h;
+
+	if (!set->map_size)
+		return NULL;
+
+	h = remote_hash(remote, set->map_size);
+	while ((e = &set->map[h])->remote) {
+		if (e->remote == remote)
+			return e;
+
+		h = (h + 1) & (set->map_size - 1);
+	}
+
+	return NULL;
+}
+
+static int
+map_insert(struct elf_interfaces *set, uintptr_t remote,
+	   const struct wl_interface *local)
+{
+	struct remote_entry *map, *e;
+	unsigned int size, i, h;
+
+	if (2 * (set->map_num + 1) > set->map_size) {
+		size = set->map_size ? 2 * set->map_size : 256;
+		map = calloc(size, sizeof *map);
+		if (!map)
+			return -1;
+
+		for (i = 0; i < set->map_size; ++i) {
+			e = &set->map[i];
+			if (!e->remote)
+				continue;
+
+			h = remote_hash(e->remote, size);
+			while (map[h].remote)
+				h = (h + 1) & (size - 1);
+
+			map[h] = *e;
+		}
+
+		free(set->map);
+		set->map = map;
+		set->map_size = size;
+	}
+
+	h = remote_hash(remote, set->map_size);
+	while (set->map[h].remote)
+		h = (h + 1) & (set->map_size - 1);
+
+	set->map[h].remote = remote;
+	set->map[h].local = local;
+	++set->map_num;
+
+	return 0;
+}
+
+/*
+ * Copying the interfaces
+ */
+
+static int
+valid_name(const char *name)
+{
+	if (!*name)
+		return 0;
+
+	for (; *name; ++name)
+		if (!(*name == '_' || (*name >= 'a' && *name <= 'z')
+		      || (*name >= 'A' && *name <= 'Z')
+		      || (*name >= '0' && *name <= '9')))
+			return 0;
+
+	return 1;
+}
+
+/* read the interface at the address. If copy is not set and we
+ * have an interface with the same name in the registry, use that
+ * one instead of copying it */
+static const struct wl_interface *
+read_interface(struct elf_interfaces *set, uintptr_t remote, int copy)
+{
+	struct discovered_interface *di, **pending, **copy_item;
+	const struct wl_interface *local = NULL;
+	struct wl_interface intf;
+	struct remote_entry *e;
+	char name[MAX_STRING];
+
+	e = map_find(set, remote);
+	if (e)
+		return e->local;
+
+	if (remote_read(set, remote, &intf, sizeof intf) < 0
+	    || remote_read_string(set, (uintptr_t) intf.name,
+				  name, sizeof name) < 0
+	    || !valid_name(name)
+	    || intf.version <= 0
+	    || intf.method_count < 0 || intf.method_count > MAX_MESSAGES
+	    || intf.event_count < 0 || intf.event_count > MAX_MESSAGES)
+		goto out;
+
+	if (!copy) {
+		local = wldbg_interfaces_lookup(name);
+		if (local)
+			goto out;
+	}
+
+	di = set_alloc(set, sizeof *di);
+	pending = wl_array_add(&set->pending, sizeof *pending);
+	if (!di || !pending)
+		goto out;
+
+	copy_item = wl_array_add(&set->copies, sizeof *copy_item);
+	di->interface.name = set_strdup(set, name);
+	if (!copy_item || !di->interface.name) {
+		set->pending.size -= sizeof *pending;
+		if (copy_item)
+			set->copies.size -= sizeof *copy_item;
+		goto out;
+	}
+
+	di->interface.version = intf.version;
+	di->interface.method_count = intf.method_count;
+	di->interface.event_count = intf.event_count;
+	di->remote = remote;
+	di->methods = (uintptr_t) intf.methods;
+	di->events = (uintptr_t) intf.events;
+	di->item.interface = &di->interface;
+
+	/* the messages are read later, when we know
+	 * about all the interfaces */
+	*pending = di;
+	*copy_item = di;
+	local = &di->interface;
+
+out:
+	/* remember also the failures, so that
+	 * we do not try to read them again */
+	map_insert(set, remote, local);
+	return local;
+}
+
+/* number of types that the message has for the signature */
+static int
+signature_types(const char *signature)
+{
+	int n = 0;
+
+	for (; *signature; ++signature)
+		if (strchr("iufsonah", *signature))
+			++n;
+
+	return n;
+}
+
+static struct wl_message *
+read_messages(struct elf_interfaces *set, uintptr_t remote, int count)
+{
+	struct wl_message *messages, *msg;
+	const struct wl_interface **types;
+	char str[MAX_STRING];
+	int i, j, n;
+
+	if (count == 0)
+		return NULL;
+
+	messages = set_alloc(set, count * sizeof *messages);
+	if (!messages)
+		return NULL;
+
+	/* these still point to the client's memory */
+	if (remote_read(set, remote, messages,
+			count * sizeof *messages) < 0)
+		return NULL;
+
+	for (i = 0; i < count; ++i) {
+		msg = &messages[i];
+
+		if (remote_read_string(set, (uintptr_t) msg->name,
+				       str, sizeof str) < 0
+		    || !(msg->name = set_strdup(set, str)))
+			return NULL;
+
+		if (remote_read_string(set, (uintptr_t) msg->signature,
+				       str, sizeof str) < 0
+		    || !(msg->signature = set_strdup(set, str)))
+			return NULL;
+
+		/* at least one entry, resolving expects types */
+		n = signature_types(msg->signature);
+		types = set_alloc(set, (n ? n : 1) * sizeof *types);
+		if (!types)
+			return NULL;
+
+		if (n && msg->types
+		    && remote_read(set, (uintptr_t) msg->types,
+				   types, n * sizeof *types) < 0)
+			return NULL;
+
+		for (j = 0; j < n; ++j)
+			if (types[j])
+				types[j] = read_interface(set,
+						(uintptr_t) types[j], 0);
+
+		msg->types = types;
+	}
+
+	return messages;
+}
+
+static int
+read_pending(struct elf_interfaces *set, struct wl_list *interfaces)
+{
+	struct discovered_interface *di;
+	int n = 0;
+
+	/* reading messages may add more pending interfaces */
+	while (set->pending.size > 0) {
+		set->pending.size -= sizeof di;
+		memcpy(&di, (char *) set->pending.data + set->pending.size,
+		       sizeof di);
+
+		di->interface.methods = read_messages(set, di->methods,
+						      di->interface.method_count);
+		di->interface.events = read_messages(set, di->events,
+						     di->interface.event_count);
+
+		/* do not use the interface if we failed reading it,
+		 * other interfaces can point to it though, so keep
+		 * it allocated, just without messages */
+		if ((di->interface.method_count && !di->interface.methods)
+		    || (di->interface.event_count && !di->interface.events)) {
+			di->interface.method_count = 0;
+			di->interface.event_count = 0;
+			continue;
+		}
+
+		wl_list_insert(interfaces->prev, &di->item.link);
+		++n;
+	}
+
+	return n;
+}
+
+/*
+ * Scanning ELF objects
+ */
+
+static int
+is_interface_symbol(const ElfW(Sym) *sym, const char *strtab,
+		    size_t strtab_size)
+{
+	const char *name;
+	size_t len;
+
+	if (ELF_ST_TYPE(sym->st_info) != STT_OBJECT
+	    || sym->st_shndx == SHN_UNDEF
+	    || sym->st_size != sizeof(struct wl_interface)
+	    || sym->st_name >= strtab_size)
+		return 0;
+
+	name = strtab + sym->st_name;
+	len = strnlen(name, strtab_size - sym->st_name);
+
+	return len > 10 && len < strtab_size - sym->st_name
+		&& strcmp(name + len - 10, "_interface") == 0;
+}
+
+static void
+scan_symbols(struct elf_interfaces *set, const char *data, size_t size,
+	     const ElfW(Shdr) *symtab, const ElfW(Shdr) *strtab,
+	     uintptr_t bias)
+{
+	const ElfW(Sym) *syms;
+	size_t i, num;
+
+	if (symtab->sh_offset > size
+	    || symtab->sh_size > size - symtab->sh_offset
+	    || symtab->sh_entsize != sizeof(ElfW(Sym))
+	    || strtab->sh_offset > size
+	    || strtab->sh_size > size - strtab->sh_offset)
+		return;
+
+	syms = (const ElfW(Sym) *) (data + symtab->sh_offset);
+	num = symtab->sh_size / sizeof *syms;
+
+	for (i = 0; i < num && !set->failed; ++i)
+		if (is_interface_symbol(&syms[i], data + strtab->sh_offset,
+					strtab->sh_size))
+			read_interface(set, bias + syms[i].st_value, 1);
+}
+
+/* start is where the beginning of the file is mapped */
+static void
+scan_object(struct elf_interfaces *set, const char *path, uintptr_t start)
+{
+	const ElfW(Ehdr) *ehdr;
+	const ElfW(Phdr) *phdr;
+	const ElfW(Shdr) *shdr;
+	uintptr_t bias = 0, vaddr = UINTPTR_MAX;
+	struct stat st;
+	char *data, root_path[PATH_MAX];
+	int fd, i;
+
+	/* the client can be in a different mount namespace */
+	snprintf(root_path, sizeof root_path, "/proc/%d/root%s",
+		 set->pid, path);
+	fd = open(root_path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof *ehdr) {
+		close(fd);
+		return;
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return;
+
+	/* only objects of our class, wl_interface
+	 * would have different layout anyway */
+	ehdr = (const ElfW(Ehdr) *) data;
+	if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0
+	    || ehdr->e_ident[EI_CLASS] != ELF_NATIVE_CLASS
+	    || ehdr->e_phentsize != sizeof *phdr
+	    || ehdr->e_shentsize != sizeof *shdr
+	    || ehdr->e_phoff > (size_t) st.st_size
+	    || ehdr->e_phnum > (st.st_size - ehdr->e_phoff) / sizeof *phdr
+	    || ehdr->e_shoff > (size_t) st.st_size
+	    || ehdr->e_shnum > (st.st_size - ehdr->e_shoff) / sizeof *shdr)
+		goto out;
+
+	/* the lowest segment is mapped at start */
+	phdr = (const ElfW(Phdr) *) (data + ehdr->e_phoff);
+	for (i = 0; i < ehdr->e_phnum; ++i)
+		if (phdr[i].p_type == PT_LOAD && phdr[i].p_vaddr < vaddr)
+			vaddr = phdr[i].p_vaddr;
+
+	if (vaddr == UINTPTR_MAX)
+		goto out;
+
+	bias = start - (vaddr & ~((uintptr_t) sysconf(_SC_PAGESIZE) - 1));
+
+	/* both .symtab and .dynsym, the duplicates are in the map */
+	shdr = (const ElfW(Shdr) *) (data + ehdr->e_shoff);
+	for (i = 0; i < ehdr->e_shnum; ++i) {
+		if ((shdr[i].sh_type == SHT_SYMTAB
+		     || shdr[i].sh_type == SHT_DYNSYM)
+		    && shdr[i].sh_link < ehdr->e_shnum)
+			scan_symbols(set, data, st.st_size, &shdr[i],
+				     &shdr[shdr[i].sh_link], bias);
+	}
+
+out:
+	munmap(data, st.st_size);
+}
+
+static int
+object_scanned(struct elf_interfaces *set, const char *path, uintptr_t start)
+{
+	struct mapped_object *obj;
+
+	wl_array_for_each(obj, &set->objects)
+		if (obj->start == start && strcmp(obj->path, path) == 0)
+			return 1;
+
+	obj = wl_array_add(&set->objects, sizeof *obj);
+	if (!obj)
+		return 1;
+
+	obj->path = strdup(path);
+	if (!obj->path) {
+		set->objects.size -= sizeof *obj;
+		return 1;
+	}
+
+	obj->start = start;
+	return 0;
+}
+
+static int
+skip_object(const char *path)
+{
+	const char *name = strrchr(path, '/');
+
+	name = name ? name + 1 : path;
+
+	/* libwayland has the same interfaces as we do */
+	return strncmp(name, "libwayland-", 11) == 0;
+}
+
+static inline uint64_t
+maps_hash(const char *maps, size_t len)
+{
+	return wldbg_fnv64(WLDBG_FNV64_BASIS, maps, len);
+}
+
+static char *
+read_maps(pid_t pid, size_t *len)
+{
+	char path[64];
+	char *maps;
+	size_t size;
+	FILE *f, *out;
+	int c;
+
+	snprintf(path, sizeof path, "/proc/%d/maps", pid);
+	f = fopen(path, "r");
+	if (!f)
+		return NULL;
+
+	out = open_memstream(&maps, &size);
+	if (!out) {
+		fclose(f);
+		return NULL;
+	}
+
+	while ((c = getc_unlocked(f)) != EOF)
+		putc_unlocked(c, out);
+
+	fclose(f);
+	if (fclose(out) != 0)
+		return NULL;
+
+	*len = size;
+	return maps;
+}
+
+static int
+scan_process(struct elf_interfaces *set)
+{
+	unsigned long start, end, offset, inode;
+	char perms[8], *maps, *line, *next, *path;
+	uint64_t hash;
+	size_t len;
+	int pos;
+
+	maps = read_maps(set->pid, &len);
+	if (!maps)
+		return -1;
+
+	/* nothing was loaded or unloaded */
+	hash = maps_hash(maps, len);
+	if (hash == set->maps_hash) {
+		free(maps);
+		return 0;
+	}
+
+	set->maps_hash = hash;
+
+	for (line = maps; line && *line && !set->failed; line = next) {
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+
+		if (sscanf(line, "%lx-%lx %7s %lx %*s %lu %n", &start, &end,
+			   perms, &offset, &inode, &pos) != 5)
+			continue;
+
+		/* we want the beginning of file-backed mappings */
+		path = line + pos;
+		if (inode == 0 || offset != 0 || path[0] != '/'
+		    || strstr(path, " (deleted)")
+		    || skip_object(path)
+		    || object_scanned(set, path, start))
+			continue;
+
+		scan_object(set, path, start);
+	}
+
+	free(maps);
+
+	return 1;
+}
+
+static struct elf_interfaces *
+create_set(pid_t pid)
+{
+	struct elf_interfaces *set;
+
+	set = calloc(1, sizeof *set);
+	if (!set)
+		return NULL;
+
+	set->pid = pid;
+	wl_array_init(&set->objects);
+	wl_array_init(&set->pending);
+	wl_array_init(&set->copies);
+	wl_array_init(&set->allocations);
+
+	return set;
+}
+
+int
+elf_interfaces_discover(struct resolved_objects *ro, pid_t pid)
+{
+	struct elf_interfaces *set = ro->elf_interfaces;
+	int ret;
+
+	if (pid <= 0)
+		return 0;
+
+	if (!set) {
+		set = create_set(pid);
+		if (!set) {
+			fprintf(stderr, "Out of memory\n");
+			return -1;
+		}
+
+		ro->elf_interfaces = set;
+	}
+
+	if (set->failed)
+		return -1;
+
+	ret = scan_process(set);
+	if (ret < 0)
+		set->failed = 1;
+	if (ret <= 0)
+		return ret;
+
+	ret = read_pending(set, &ro->additional_interfaces);
+
+	return set->failed ? -1 : ret;
+}
+
+void
+elf_interfaces_destroy(struct elf_interfaces *set, struct wldbg *wldbg)
+{
+	struct discovered_interface **di;
+	struct mapped_object *obj;
+	void **p;
+
+	if (!set)
+		return;
+
+	/* the copies may be in the registry, in the pass table and in
+	 * the caches of layouts and printers, do not leave there
+	 * dangling pointers */
+	wl_array_for_each(di, &set->copies) {
+		wldbg_interfaces_forget(&(*di)->interface);
+		if (wldbg)
+			wldbg_passes_forget(wldbg, &(*di)->interface);
+		wldbg_printers_forget(&(*di)->interface);
+		wldbg_message_layout_forget((*di)->interface.methods,
+					    (*di)->interface.method_count);
+		wldbg_message_layout_forget((*di)->interface.events,
+					    (*di)->interface.event_count);
+	}
+
+	wl_array_for_each(p, &set->allocations)
+		free(*p);
+	wl_array_for_each(obj, &set->objects)
+		free(obj->path);
+
+	wl_array_release(&set->allocations);
+	wl_array_release(&set->objects);
+	wl_array_release(&set->pending);
+	wl_array_release(&set->copies);
+	free(set->map);
+	free(set);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WLDBG_ELF_INTERFACES_H_
+#define _WLDBG_ELF_INTERFACES_H_
+
+#include <sys/types.h>
+
+struct wldbg;
+struct resolved_objects;
+struct elf_interfaces;
+
+/*
+ * Discovery of the interfaces that the client has compiled in.
+ * We go through the objects mapped in the client's process, look for
+ * *_interface symbols in their symbol tables and copy the wl_interface
+ * structures from the client's memory. This way we can resolve
+ * the objects from private protocols that we have no XML for.
+ */
+
+/* find interfaces in process pid and add those that we did not see
+ * yet to ro->additional_interfaces. Nothing is done when the mapped
+ * objects did not change since the last call.
+ * Returns number of new interfaces or -1 on error */
+int
+elf_interfaces_discover(struct resolved_objects *ro, pid_t pid);
+
+/* free the copied interfaces. The pass table of wldbg (if it is not NULL)
+ * and the caches that are keyed by the interfaces forget them */
+void
+elf_interfaces_destroy(struct elf_interfaces *set, struct wldbg *wldbg);
+
+#endif /* _WLDBG_ELF_INTERFACES_H_ */
@@ -26,6 +26,7 @@
 #define _GNU_SOURCE
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 
 #include "wldbg-private.h"
@@ -52,9 +53,84 @@ is_prefix_of(const char *what, const char *src)
 	return 1;
 }
 
+/* options without a value, they can be given by any unambiguous prefix */
+static const char *flag_options[] = {
+	"help",
+	"interactive",
+	"server-mode",
+	"pass-whole-buffer",
+	"edge-triggered",
+	"coalesce-writes",
+	"collapse",
+	"objinfo",
+	NULL
+};
+
+/* return 1 if arg is a prefix of more than one option
+ * and it is not the whole name of one of them */
+static int
+is_ambiguous(const char *arg)
+{
+	const char **opt;
+	int matches = 0;
+
+	for (opt = flag_options; *opt; ++opt) {
+		if (strcmp(arg, *opt) == 0)
+			return 0;
+
+		if (is_prefix_of(arg, *opt))
+			++matches;
+	}
+
+	return matches > 1;
+}
+
+/* if arg is NAME=VALUE and NAME is a prefix of opt, return VALUE */
+static const char *
+get_opt_value(const char *arg, const char *opt)
+{
+	const char *eq = strchr(arg, '=');
+
+	if (!eq || eq == arg)
+		return NULL;
+
+	if ((size_t) (eq - arg) > strlen(opt)
+	    || strncmp(arg, opt, eq - arg) != 0)
+		return NULL;
+
+	return eq + 1;
+}
+
+/* parse size with optional K or M suffix */
+static int
+parse_size(const char *str, size_t *size)
+{
+	char *end;
+	unsigned long val;
+
+	val = strtoul(str, &end, 10);
+	if (end == str)
+		return -1;
+
+	if (*end == 'k' || *end == 'K') {
+		val *= 1024;
+		++end;
+	} else if (*end == 'm' || *end == 'M') {
+		val *= 1024 * 1024;
+		++end;
+	}
+
+	if (*end != '\0' || val == 0)
+		return -1;
+
+	*size = val;
+	return 0;
+}
+
 static int
 set_opt(const char *arg, struct wldbg_options *opts)
 {
+	const char *val;
 	int match = 0;
 
 	if (*arg == '\0') {
@@ -62,6 +138,11 @@ set_opt(const char *arg, struct wldbg_options *opts)
 		return 0;
 	}
 
+	if (is_ambiguous(arg)) {
+		fprintf(stderr, "Error: ambiguous option '%s'\n", arg);
+		return 0;
+	}
+
 	if (is_prefix_of(arg, "help")) {
 		return 0;
 	} else if (is_prefix_of(arg, "interactive")) {
@@ -76,10 +157,40 @@ set_opt(const char *arg, struct wldbg_options *opts)
 		dbg("Command line option: pass-whole-buffer\n");
 		opts->pass_whole_buffer = 1;
 		match = 1;
+	} else if (is_prefix_of(arg, "edge-triggered")) {
+		dbg("Command line option: edge-triggered\n");
+		opts->edge_triggered = 1;
+		match = 1;
+	} else if (is_prefix_of(arg, "coalesce-writes")) {
+		dbg("Command line option: coalesce-writes\n");
+		opts->coalesce_writes = 1;
+		match = 1;
+	} else if (is_prefix_of(arg, "collapse")) {
+		dbg("Command line option: collapse\n");
+		opts->collapse_runs = 1;
+		match = 1;
 	} else if (is_prefix_of(arg, "objinfo")) {
 		dbg("Command line option: objinfo\n");
 		opts->objinfo = 1;
 		match = 1;
+	} else if ((val = get_opt_value(arg, "buffer-size"))) {
+		dbg("Command line option: buffer-size=%s\n", val);
+		if (parse_size(val, &opts->buffer_size) < 0) {
+			fprintf(stderr, "Error: invalid buffer size '%s'\n", val);
+			return 0;
+		}
+		match = 1;
+	} else if ((val = get_opt_value(arg, "max-buffer-size"))) {
+		dbg("Command line option: max-buffer-size=%s\n", val);
+		if (parse_size(val, &opts->max_buffer_size) < 0) {
+			fprintf(stderr, "Error: invalid buffer size '%s'\n", val);
+			return 0;
+		}
+		match = 1;
+	} else if ((val = get_opt_value(arg, "protocols"))) {
+		dbg("Command line option: protocols=%s\n", val);
+		opts->protocols = val;
+		match = 1;
 	}
 
 	if (!match) {
@@ -111,6 +222,13 @@ int get_opts(int argc, char *argv[], struct wldbg_options *opts)
 				continue;
 			}
 
+			/* -c is short for coalesce-writes, as a prefix
+			 * it would be ambiguous with collapse */
+			if (argv[n][1] == 'c' && argv[n][2] == 0) {
+				set_opt("coalesce-writes", opts);
+				continue;
+			}
+
 			if (!set_opt(argv[n] + 1, opts))
 				return -1;
 		} else
@@ -26,17 +26,35 @@
 #ifndef _WLDBG_GETOPT_H_
 #define _WLDBG_GETOPT_H_
 
+#include <stddef.h>
+
 struct wldbg_options {
 	unsigned int interactive       : 1;
 	unsigned int objinfo           : 1;
 	unsigned int server_mode       : 1;
 	unsigned int pass_whole_buffer : 1;
+	unsigned int edge_triggered    : 1;
+	unsigned int coalesce_writes   : 1;
+	unsigned int collapse_runs     : 1;
+
+	/* initial and maximal size of connection buffers,
+	 * 0 means default */
+	size_t buffer_size;
+	size_t max_buffer_size;
+
+	/* colon-separated list of protocol files
+	 * and directories given by the user */
+	const char *protocols;
 
 	/* parsed path to the program and
 	 * its arguments */
 	char *path;
 	int argc;
 	char **argv;
+
+	/* arguments of 'wldbg replay', starting with "replay" */
+	int replay_argc;
+	char **replay_argv;
 };
 
 int get_opts(int argc, char *argv[], struct wldbg_options *opts);
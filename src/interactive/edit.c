@@ -29,6 +29,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <assert.h>
+#include <sys/stat.h>
 
 #include "wayland/wayland-private.h"
 
@@ -74,10 +75,16 @@ store_message_to_tmpfile(struct wldbg_message *message)
 	return file;
 }
 
+/* the edited message can be bigger than the original one, so we can
+ * not read it back in place of the original message */
+static char *edited_data;
+
 static int
 read_message_from_tmpfile(char *file, struct wldbg_message *message)
 {
 	int fd, ret;
+	struct stat st;
+	char *data;
 	assert(file);
 
 	fd = open(file, O_RDONLY);
@@ -86,17 +93,31 @@ read_message_from_tmpfile(char *file, struct wldbg_message *message)
 		return -1;
 	}
 
-	/* XXX do not use hard-coded numbers... */
-	/* size of the buffer is 4096 atm */
-	ret = read(fd, message->data, 4096);
+	if (fstat(fd, &st) < 0) {
+		perror("Getting size of tmp file");
+		close(fd);
+		return -1;
+	}
+
+	data = realloc(edited_data, st.st_size > 0 ? st.st_size : 1);
+	if (!data) {
+		fprintf(stderr, "No memory\n");
+		close(fd);
+		return -1;
+	}
+
+	edited_data = data;
+
+	ret = read(fd, data, st.st_size);
 	if (ret < 0) {
 		perror("Reading tmp file\n");
 		close(fd);
 		return -1;
 	}
 
-	assert(ret <= 4096);
+	message->data = data;
 	message->size = ret;
+	wldbg_message_invalidate(message);
 
 	close(fd);
 	return 0;
@@ -184,6 +205,8 @@ cmd_edit(struct wldbg_interactive *wldbgi,
 	}
 
 	printf("message edited to: ");
+	/* do not let it collapse with the messages before */
+	wldbg_collapse_flush(message->connection);
 	wldbg_message_print(message);
 
 	free(cmd);
@@ -24,6 +24,8 @@
  */
 
 #include <stdio.h>
+#include <ctype.h>
+#include <inttypes.h>
 
 #include "wayland/wayland-private.h"
 
@@ -96,10 +98,40 @@ print_filters(struct wldbg_interactive *wldbgi)
 	}
 }
 
+static void
+print_latency(uint64_t *histogram, const char *direction)
+{
+	int i;
+	uint64_t total = 0;
+
+	for (i = 0; i < WLDBG_LATENCY_BUCKETS; ++i)
+		total += histogram[i];
+
+	printf("Latency added to messages from %s (%" PRIu64 " messages):\n",
+	       direction, total);
+	if (total == 0)
+		return;
+
+	for (i = 0; i < WLDBG_LATENCY_BUCKETS; ++i) {
+		if (histogram[i] == 0)
+			continue;
+
+		if (i == WLDBG_LATENCY_BUCKETS - 1)
+			printf("\t>= %8lu us: ", 1UL << (i - 1));
+		else
+			printf("\t <  %8lu us: ", 1UL << i);
+
+		printf("%" PRIu64 " (%.1f%%)\n", histogram[i],
+		       100.0 * histogram[i] / total);
+	}
+}
+
 static void
 info_wldbg(struct wldbg_interactive *wldbgi)
 {
 	struct wldbg *wldbg = wldbgi->wldbg;
+	struct wldbg_connection *conn;
+	size_t queued = 0;
 
 	printf("\n-- Wldbg -- \n");
 
@@ -111,12 +143,45 @@ info_wldbg(struct wldbg_interactive *wldbgi)
 	       "\trunning           : %u\n"
 	       "\terror             : %u\n"
 	       "\texit              : %u\n"
-	       "\tserver_mode       : %u\n",
+	       "\tserver_mode       : %u\n"
+	       "\tedge_triggered    : %u\n"
+	       "\tcoalesce_writes   : %u\n",
 	       wldbg->flags.pass_whole_buffer,
 	       wldbg->flags.running,
 	       wldbg->flags.error,
 	       wldbg->flags.exit,
-	       wldbg->flags.server_mode);
+	       wldbg->flags.server_mode,
+	       wldbg->flags.edge_triggered,
+	       wldbg->flags.coalesce_writes);
+
+	printf("Forwarded messages: %" PRIu64 "\n",
+	       wldbg->statistics.messages);
+	printf("Connection flushes: %" PRIu64 " (saved %" PRIu64
+	       " by coalescing)\n",
+	       wldbg->statistics.flushes,
+	       wldbg->statistics.messages > wldbg->statistics.flushes ?
+			wldbg->statistics.messages - wldbg->statistics.flushes : 0);
+	printf("Connection buffers: %zu bytes (can grow up to %zu)\n",
+	       wldbg->connection_buffers.size,
+	       wldbg->connection_buffers.max_size);
+
+	wl_list_for_each(conn, &wldbg->connections, link) {
+		queued += wl_connection_pending_output(conn->server.connection);
+		if (conn->client.connection)
+			queued += wl_connection_pending_output(conn->client.connection);
+	}
+
+	printf("Queued output: %zu bytes (max %" PRIu64 ", "
+	       "watermarks %zu/%zu)\n",
+	       queued, wldbg->statistics.max_queued,
+	       wldbg->connection_buffers.high_watermark,
+	       wldbg->connection_buffers.low_watermark);
+	printf("Reading stalled: %" PRIu64 " times, %.3f ms in total\n",
+	       wldbg->statistics.stalls,
+	       wldbg->statistics.stall_time / 1000000.0);
+
+	print_latency(wldbg->statistics.latency[CLIENT], "client");
+	print_latency(wldbg->statistics.latency[SERVER], "server");
 
 	if (!wldbg->flags.server_mode)
 		return;
@@ -175,6 +240,7 @@ cmd_info_help(int oneline)
 	       "\n"
 	       "objects (o)\n"
 	       "objects (o) ID\n"
+	       "objects (o) INTERFACE\n"
 	       "message (m)\n"
 	       "breakpoints (b)\n"
 	       "filters (f)\n"
@@ -185,14 +251,34 @@ cmd_info_help(int oneline)
 void
 print_object_info(struct wldbg_message *msg, char *buf);
 
+static void
+print_interface_objects(struct wldbg_message *message, char *name)
+{
+	const uint32_t *ids;
+	unsigned int count, i;
+
+	ids = wldbg_message_get_objects(message,
+					remove_newline(name), &count);
+	if (!count) {
+		printf("No objects of interface '%s'\n", name);
+		return;
+	}
+
+	for (i = 0; i < count; ++i)
+		print_object(ids[i], wldbg_message_get_object(message, ids[i]),
+			     NULL);
+}
+
 static void
 print_objects_info(struct wldbg_message *message, char *buf)
 {
 	char *id = skip_ws(buf);
-	if (*id)
+	if (!*id)
+		print_objects(message);
+	else if (isdigit(*id) || strncmp(id, "all", 3) == 0)
 		print_object_info(message, id);
 	else
-		print_objects(message);
+		print_interface_objects(message, id);
 }
 
 int
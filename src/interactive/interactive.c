@@ -157,6 +157,10 @@ filter_match(struct wl_list *filters, struct wldbg_message *message)
 static void
 process_message(struct wldbg_interactive *wldbgi, struct wldbg_message *message)
 {
+	/* show the message that we stop at, not a summary of a run */
+	if (wldbgi->stop)
+		wldbg_collapse_flush(message->connection);
+
 	/* print message's description
 	 * This is default behaviour. XXX add possibility to
 	 * turn it off */
@@ -171,6 +175,10 @@ process_message(struct wldbg_interactive *wldbgi, struct wldbg_message *message)
 				"server" : "client");
 		/* reset flag */
 		wldbgi->stop = 0;
+
+		/* do not hold back messages that were processed
+		 * before this one while we're waiting for the user */
+		wldbg_connection_flush(message->connection);
 		query_user(wldbgi, message);
 	}
 }
@@ -284,6 +292,7 @@ handle_sigint(int fd, void *data)
 	size_t len;
 	struct signalfd_siginfo si;
 	struct wldbg_interactive *wldbgi = data;
+	struct wldbg_connection *conn;
 
 	len = read(fd, &si, sizeof si);
 	if (len != sizeof si) {
@@ -293,6 +302,9 @@ handle_sigint(int fd, void *data)
 
 	vdbg("Wldbgi: Got interrupt (SIGINT)\n");
 
+	wl_list_for_each(conn, &wldbgi->wldbg->connections, link)
+		wldbg_collapse_flush(conn);
+
 	putchar('\n');
 	query_user(wldbgi, &wldbgi->wldbg->message);
 
@@ -325,6 +337,7 @@ interactive_init(struct wldbg *wldbg)
 
 	/* insert always at the end */
 	wl_list_insert(wldbg->passes.prev, &pass->link);
+	wldbg_passes_changed(wldbg);
 
 	pass->wldbg_pass.init = NULL;
 	/* XXX ! */
@@ -163,23 +163,16 @@ print_objinfo(struct wldbg_objects_info *oi, struct wldbg_object_info *info)
 }
 
 static void
-print_all_objinfo(struct wldbg_objects_info *oi)
+print_one_objinfo(struct wldbg_object *obj, void *data)
 {
+	if (obj->info)
+		print_objinfo(data, obj->info);
+}
 
-	unsigned int i;
-	struct wldbg_object_info *info;
-
-	for (i = 0; i < oi->client_objects.count; ++i) {
-		info = wldbg_ids_map_get(&oi->client_objects, i);
-		if (info)
-			print_objinfo(oi, info);
-	}
-
-	for (i = 0; i < oi->server_objects.count; ++i) {
-		info = wldbg_ids_map_get(&oi->server_objects, i);
-		if (info)
-			print_objinfo(oi, info);
-	}
+static void
+print_all_objinfo(struct wldbg_objects_info *oi)
+{
+	wldbg_object_table_for_each(oi->table, print_one_objinfo, oi);
 }
 
 void
@@ -162,8 +162,11 @@ cmd_send(struct wldbg_interactive *wldbgi,
 	send_message.data = buffer;
 	send_message.size = size;
 	send_message.from = where == CLIENT ? SERVER : CLIENT;
+	wldbg_message_invalidate(&send_message);
 
 	printf("resolved as: ");
+	/* do not let it collapse with the messages before */
+	wldbg_collapse_flush(send_message.connection);
 	wldbg_message_print(&send_message);
 
 	printf("Send this message? [y/n] ");
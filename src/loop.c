@@ -17,14 +17,21 @@ wldbg_error(struct wldbg *wldbg)
 	wldbg->flags.error = 1;
 }
 
+uint32_t
+wldbg_message_get_connection_id(struct wldbg_message *msg)
+{
+	return msg->connection->id;
+}
+
 /**
- * Monitor filedescriptor for incoming events and
- * call set-up callbacks
+ * Monitor filedescriptor for given epoll events and
+ * call set-up callbacks. Use EPOLLET in events if the
+ * dispatch function reads the fd until EAGAIN
  */
 struct wldbg_fd_callback *
-wldbg_monitor_fd(struct wldbg *wldbg, int fd,
-		 int (*dispatch)(int fd, void *data),
-		 void *data)
+wldbg_monitor_fd_events(struct wldbg *wldbg, int fd, uint32_t events,
+			int (*dispatch)(int fd, void *data),
+			void *data)
 {
 	struct epoll_event ev;
 	struct wldbg_fd_callback *cb;
@@ -33,7 +40,7 @@ wldbg_monitor_fd(struct wldbg *wldbg, int fd,
 	if (!cb)
 		return NULL;
 
-	ev.events = EPOLLIN;
+	ev.events = events;
 	ev.data.ptr = cb;
 	if (epoll_ctl(wldbg->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
 		perror("Failed adding fd to epoll");
@@ -50,6 +57,37 @@ wldbg_monitor_fd(struct wldbg *wldbg, int fd,
 	return cb;
 }
 
+/**
+ * Monitor filedescriptor for incoming events and
+ * call set-up callbacks
+ */
+struct wldbg_fd_callback *
+wldbg_monitor_fd(struct wldbg *wldbg, int fd,
+		 int (*dispatch)(int fd, void *data),
+		 void *data)
+{
+	return wldbg_monitor_fd_events(wldbg, fd, EPOLLIN, dispatch, data);
+}
+
+/**
+ * Change the events that the filedescriptor is monitored for
+ */
+int
+wldbg_modify_fd_events(struct wldbg *wldbg, struct wldbg_fd_callback *cb,
+		       uint32_t events)
+{
+	struct epoll_event ev;
+
+	ev.events = events;
+	ev.data.ptr = cb;
+	if (epoll_ctl(wldbg->epoll_fd, EPOLL_CTL_MOD, cb->fd, &ev) == -1) {
+		perror("Failed modifying fd in epoll");
+		return -1;
+	}
+
+	return 0;
+}
+
 /**
  * Stop monitoring filedescriptor and its callback
  */
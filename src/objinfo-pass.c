@@ -43,6 +43,7 @@
 #include "passes.h"
 #include "util.h"
 #include "resolve.h"
+#include "wldbg-interfaces.h"
 
 void
 handle_shm_pool_message(struct wldbg_objects_info *oi,
@@ -73,38 +74,94 @@ void
 handle_wl_seat_message(struct wldbg_objects_info *oi,
 		       struct wldbg_resolved_message *rm, int from);
 
+typedef void (*objinfo_handler)(struct wldbg_objects_info *oi,
+				struct wldbg_resolved_message *rm, int from);
+
+static const struct {
+	const char *interface;
+	objinfo_handler handler;
+} objinfo_handlers[] = {
+	{ "wl_surface", handle_wl_surface_message },
+	{ "xdg_surface", handle_xdg_surface_message },
+	{ "wl_buffer", handle_wl_buffer_message },
+	{ "wl_compositor", handle_wl_compositor_message },
+	{ "wl_shm_pool", handle_shm_pool_message },
+	{ "xdg_shell", handle_xdg_shell_message },
+	{ "wl_registry", handle_wl_registry_message },
+	{ "wl_seat", handle_wl_seat_message },
+};
+
+#define HANDLERS_NUM (sizeof objinfo_handlers / sizeof *objinfo_handlers)
+
+/* handlers indexed by the interface index from the registry */
+static objinfo_handler *handlers;
+static unsigned int handlers_size;
+
+static struct wldbg_pass_interest objinfo_interests[HANDLERS_NUM + 1];
+
 static int
 gather_info(void *user_data, struct wldbg_message *message)
 {
 	(void) user_data;
 	struct wldbg_objects_info *oinf = message->connection->objects_info;
 	struct wldbg_resolved_message rm;
+	unsigned int index;
 
 	if (!wldbg_resolve_message(message, &rm)) {
 		fprintf(stderr, "Failed resolving message, loosing info\n");
 		return PASS_NEXT;
 	}
 
-	if (strcmp(rm.wl_interface->name, "wl_surface") == 0)
-		handle_wl_surface_message(oinf, &rm, message->from);
-	else if (strcmp(rm.wl_interface->name, "xdg_surface") == 0)
-		handle_xdg_surface_message(oinf, &rm, message->from);
-	else if (strcmp(rm.wl_interface->name, "wl_buffer") == 0)
-		handle_wl_buffer_message(oinf, &rm, message->from);
-	else if (strcmp(rm.wl_interface->name, "wl_compositor") == 0)
-		handle_wl_compositor_message(oinf, &rm, message->from);
-	else if (strcmp(rm.wl_interface->name, "wl_shm_pool") == 0)
-		handle_shm_pool_message(oinf, &rm, message->from);
-	else if (strcmp(rm.wl_interface->name, "xdg_shell") == 0)
-		handle_xdg_shell_message(oinf, &rm, message->from);
-	else if (strcmp(rm.wl_interface->name, "wl_registry") == 0)
-		handle_wl_registry_message(oinf, &rm, message->from);
-	else if (strcmp(rm.wl_interface->name, "wl_seat") == 0)
-		handle_wl_seat_message(oinf, &rm, message->from);
+	/* resolving the message found the index too */
+	index = wldbg_message_get_interface_index(message);
+	if (index < handlers_size && handlers[index])
+		handlers[index](oinf, &rm, message->from);
 
 	return PASS_NEXT;
 }
 
+static int
+create_handlers(void)
+{
+	unsigned int i, index[HANDLERS_NUM];
+
+	handlers_size = 0;
+	for (i = 0; i < HANDLERS_NUM; ++i) {
+		index[i] = wldbg_interfaces_name_index(
+				objinfo_handlers[i].interface);
+		if (index[i] >= handlers_size)
+			handlers_size = index[i] + 1;
+
+		objinfo_interests[i].direction = WLDBG_FROM_BOTH;
+		objinfo_interests[i].interface = objinfo_handlers[i].interface;
+		objinfo_interests[i].opcode = WLDBG_ANY_OPCODE;
+	}
+
+	handlers = calloc(handlers_size, sizeof *handlers);
+	if (!handlers) {
+		handlers_size = 0;
+		return -1;
+	}
+
+	for (i = 0; i < HANDLERS_NUM; ++i)
+		handlers[index[i]] = objinfo_handlers[i].handler;
+
+	/* index 0 is no interface */
+	handlers[0] = NULL;
+
+	return 0;
+}
+
+static void
+objinfo_destroy(void *data)
+{
+	(void) data;
+
+	free(handlers);
+	handlers = NULL;
+	handlers_size = 0;
+}
+
 static struct pass *
 create_objinfo_pass(void)
 {
@@ -114,12 +171,19 @@ create_objinfo_pass(void)
 	if (!pass)
 		return NULL;
 
+	if (create_handlers() < 0) {
+		dealloc_pass(pass);
+		return NULL;
+	}
+
 	pass->wldbg_pass.init = NULL;
-	pass->wldbg_pass.destroy = NULL;
+	pass->wldbg_pass.destroy = objinfo_destroy;
 	pass->wldbg_pass.server_pass = gather_info;
 	pass->wldbg_pass.client_pass = gather_info;
 	pass->wldbg_pass.description
 		= "Gather additional information about objects";
+	pass->wldbg_pass.flags = WLDBG_PASS_READ_ONLY;
+	pass->wldbg_pass.interests = objinfo_interests;
 
 	return pass;
 }
@@ -135,6 +199,7 @@ wldbg_add_objinfo_pass(struct wldbg *wldbg)
 		return -1;
 
 	wl_list_insert(wldbg->passes.next, &pass->link);
+	wldbg_passes_changed(wldbg);
 	wldbg->gathering_info = 1;
 
 	return 0;
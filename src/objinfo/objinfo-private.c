@@ -27,33 +27,22 @@
 
 #include "wldbg.h"
 #include "wldbg-private.h"
-#include "wldbg-ids-map.h"
+#include "wldbg-object-table.h"
 #include "wldbg-objects-info.h"
 
-/* for WL_SERVER_ID_START */
-#include "wayland/wayland-private.h"
-
 #include "objinfo-private.h"
 
 void
 objects_info_put(struct wldbg_objects_info *oi,
 		 uint32_t id, struct wldbg_object_info *info)
 {
-	if (id >= WL_SERVER_ID_START)
-		wldbg_ids_map_insert(&oi->server_objects,
-				     id - WL_SERVER_ID_START, info);
-	else
-		wldbg_ids_map_insert(&oi->client_objects, id, info);
+	wldbg_object_table_set_info(oi->table, id, info);
 }
 
 void *
 objects_info_get(struct wldbg_objects_info *oi, uint32_t id)
 {
-	if (id >= WL_SERVER_ID_START)
-		return wldbg_ids_map_get(&oi->server_objects,
-					 id - WL_SERVER_ID_START);
-	else
-		return wldbg_ids_map_get(&oi->client_objects, id);
+	return wldbg_object_table_get_info(oi->table, id);
 }
 
 void
@@ -25,16 +25,13 @@
 
 #include <stdlib.h>
 
-/* for WL_SERVER_ID_START */
-#include "wayland/wayland-private.h"
-
 #include "wldbg.h"
 #include "wldbg-private.h"
-#include "wldbg-ids-map.h"
+#include "wldbg-object-table.h"
 
 
 struct wldbg_objects_info *
-create_objects_info(void)
+create_objects_info(struct wldbg_object_table *table)
 {
 	struct wldbg_objects_info *oi = malloc(sizeof *oi);
 	if (!oi) {
@@ -42,57 +39,40 @@ create_objects_info(void)
 		return NULL;
 	}
 
-	wldbg_ids_map_init(&oi->client_objects);
-	wldbg_ids_map_init(&oi->server_objects);
+	oi->table = table;
 
 	return oi;
 }
 
-void
-destroy_objects_info(struct wldbg_objects_info *oi)
+static void
+destroy_info(struct wldbg_object *obj, void *data)
 {
-	unsigned int i;
-	struct wldbg_object_info *info;
+	struct wldbg_object_info *info = obj->info;
 
-	if (!oi)
-		return;
+	(void) data;
 
-	for (i = 0; i < oi->client_objects.count; ++i) {
-		info = wldbg_ids_map_get(&oi->client_objects, i);
-		if (!info)
-			continue;
-
-		if (info->destroy)
-			info->destroy(info->info);
-		free(info);
-	}
+	if (!info)
+		return;
 
-	for (i = 0; i < oi->server_objects.count; ++i) {
-		info = wldbg_ids_map_get(&oi->server_objects, i);
-		if (!info)
-			continue;
+	if (info->destroy)
+		info->destroy(info->info);
+	free(info);
+}
 
-		if (info->destroy)
-			info->destroy(info->info);
-		free(info);
-	}
+void
+destroy_objects_info(struct wldbg_objects_info *oi)
+{
+	if (!oi)
+		return;
 
-	wldbg_ids_map_release(&oi->client_objects);
-	wldbg_ids_map_release(&oi->server_objects);
+	/* we can not remove the infos from the table while
+	 * iterating over it, the table is released right after
+	 * us together with the connection */
+	wldbg_object_table_for_each(oi->table, destroy_info, NULL);
 
 	free(oi);
 }
 
-static void *
-wldbg_objects_info_get(struct wldbg_objects_info *oi, uint32_t id)
-{
-	if (id >= WL_SERVER_ID_START)
-		return wldbg_ids_map_get(&oi->server_objects,
-					 id - WL_SERVER_ID_START);
-	else
-		return wldbg_ids_map_get(&oi->client_objects, id);
-}
-
 struct wldbg_object_info *
 wldbg_message_get_object_info(struct wldbg_message *msg, uint32_t id)
 {
@@ -100,5 +80,5 @@ wldbg_message_get_object_info(struct wldbg_message *msg, uint32_t id)
 	if (!oi)
 		return NULL;
 
-	return wldbg_objects_info_get(oi, id);
+	return wldbg_object_table_get_info(oi->table, id);
 }
@@ -31,9 +31,10 @@
 struct wldbg_objects_info;
 struct wldbg_object_info;
 struct wldbg_message;
+struct wldbg_object_table;
 
 struct wldbg_objects_info *
-create_objects_info(void);
+create_objects_info(struct wldbg_object_table *table);
 
 void
 destroy_objects_info(struct wldbg_objects_info *oi);
@@ -26,13 +26,15 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
-#include <ctype.h>
+#include <string.h>
 
 #include "resolve.h"
 #include "util.h"
 
 #include "wldbg-private.h"
 #include "wldbg-parse-message.h"
+#include "wldbg-message-layout.h"
+#include "wldbg-interfaces.h"
 
 int
 wldbg_parse_message(struct wldbg_message *msg, struct wldbg_parsed_message *out)
@@ -63,8 +65,9 @@ is_valid_interface(const struct wl_interface *intf)
 	return 1;
 }
 
-int wldbg_resolve_message(struct wldbg_message *msg,
-			  struct wldbg_resolved_message *out)
+static int
+resolve_message(struct wldbg_message *msg,
+		struct wldbg_resolved_message *out)
 {
 	const struct wl_interface *interface;
 
@@ -102,69 +105,94 @@ int wldbg_resolve_message(struct wldbg_message *msg,
 	if (!out->wl_message || !out->wl_message->signature)
 		return 0;
 
+	out->layout = wldbg_message_layout_get(out->wl_message);
+
 	return 1;
 }
 
-static const char *
-signature_get_type(const char *sig, unsigned int *nullable)
+void
+wldbg_message_invalidate(struct wldbg_message *msg)
+{
+	if (msg->connection)
+		msg->connection->decoded.valid = 0;
+}
+
+static struct wldbg_decoded_message *
+decode_message(struct wldbg_message *msg)
 {
-	assert(sig);
+	struct wldbg_decoded_message *d;
 
-	*nullable = 0;
-	while(*sig && (*sig == '?' || isdigit(*sig))) {
-		if (*sig == '?')
-			*nullable = 1;
-		++sig;
+	assert(msg->connection && "Message has no connection set");
+	d = &msg->connection->decoded;
+
+	/* the connection keeps only the last message */
+	if (d->data != msg->data || d->size != msg->size
+	    || d->from != (int) msg->from) {
+		d->valid = 0;
+		d->data = msg->data;
+		d->size = msg->size;
+		d->from = msg->from;
 	}
 
-	return sig;
+	if (d->valid & WLDBG_DECODED_MESSAGE)
+		return d;
+
+	d->resolved = resolve_message(msg, &d->message);
+	d->interface_index = d->resolved ?
+		wldbg_interfaces_index(d->message.wl_interface) : 0;
+	d->valid |= WLDBG_DECODED_MESSAGE;
+
+	return d;
 }
 
-static uint32_t *
-get_data_ptr(struct wldbg_resolved_message *msg)
+int wldbg_resolve_message(struct wldbg_message *msg,
+			  struct wldbg_resolved_message *out)
 {
-	/* If this is a string or array that is empty,
-	 * set it to NULL, otherwise make it pointing
-	 * to the data */
-	if ((*msg->signature_position == 'a'
-	     || *msg->signature_position == 's')) {
-		/* msg->data_position points to the size of the
-		 * array/string, so here we check if the size of
-		 * array/string is 0 */
-		if (*msg->data_position == 0)
-			return NULL;
-		else
-			/* skip size argument and point
-			 * to the data itself */
-			return msg->data_position + 1;
-	} else {
-		/* if this is not a string or array, just
-		 * point to the data */
-		return msg->data_position;
-	}
+	struct wldbg_decoded_message *d = decode_message(msg);
 
-	assert(0 && "Should not be reached");
+	/* the iterator in the cached message is never used */
+	*out = d->message;
+	return d->resolved;
 }
 
-static void
-initialize_iterator(struct wldbg_resolved_message *msg)
+unsigned int
+wldbg_message_get_interface_index(struct wldbg_message *msg)
 {
-	const char *sig = signature_get_type(msg->wl_message->signature,
-					     &msg->cur_arg.nullable);
+	return decode_message(msg)->interface_index;
+}
 
-	msg->signature_position = sig;
-	msg->data_position = msg->base.data;
+const struct wldbg_resolved_arg *
+wldbg_message_get_arguments(struct wldbg_message *msg, unsigned int *count)
+{
+	struct wldbg_decoded_message *d = decode_message(msg);
+	struct wldbg_resolved_message rm;
+	struct wldbg_resolved_arg *arg;
 
-	msg->cur_arg.type = *sig;
-	msg->cur_arg.data = get_data_ptr(msg);
+	if (!d->resolved) {
+		*count = 0;
+		return NULL;
+	}
+
+	if (!(d->valid & WLDBG_DECODED_ARGUMENTS)) {
+		rm = d->message;
+		d->args_count = 0;
+		/* the layout has at most WLDBG_MESSAGE_MAX_ARGS arguments,
+		 * the check is only a safety net */
+		while (d->args_count < WLDBG_MESSAGE_MAX_ARGS
+		       && (arg = wldbg_resolved_message_next_argument(&rm)))
+			d->args[d->args_count++] = *arg;
+
+		d->valid |= WLDBG_DECODED_ARGUMENTS;
+	}
 
-	assert(!*sig || *sig == 'a' || *sig == 's' || msg->cur_arg.data);
+	*count = d->args_count;
+	return d->args;
 }
 
 void
 wldbg_resolved_message_reset_iterator(struct wldbg_resolved_message *msg)
 {
-	msg->signature_position = NULL;
+	msg->arg_index = 0;
 	msg->data_position = NULL;
 	memset(&msg->cur_arg, 0,
 	       sizeof(struct wldbg_resolved_arg));
@@ -173,66 +201,42 @@ wldbg_resolved_message_reset_iterator(struct wldbg_resolved_message *msg)
 struct wldbg_resolved_arg *
 wldbg_resolved_message_next_argument(struct wldbg_resolved_message *msg)
 {
-	size_t size, off = 0;
-	char type;
-
-	/* first iteration */
-	if (msg->signature_position == NULL) {
-		initialize_iterator(msg);
-		/* message has no arguments? */
-		if (msg->cur_arg.type == 0)
-			return NULL;
+	const struct wldbg_message_layout *layout;
+	unsigned int i = msg->arg_index;
+	uint32_t bit = 1u << i;
 
-		return &msg->cur_arg;
-	}
+	/* someone filled the message by hand */
+	if (!msg->layout)
+		msg->layout = wldbg_message_layout_get(msg->wl_message);
 
-	/* need to store type before getting next argument,
-	 * so that we know where to shift in data */
-	type = *msg->signature_position;
-
-	/* calling next_argument on iterator that reached
-	 * the end */
-	if (type == 0)
+	layout = msg->layout;
+	if (!layout || i >= layout->arg_count)
 		return NULL;
 
-	/* set new type and position in signature */
-	msg->signature_position
-		= signature_get_type(msg->signature_position + 1,
-				     &msg->cur_arg.nullable);
-	msg->cur_arg.type = *msg->signature_position;
+	/* find data of the argument, in the case of
+	 * string or array skip the previous one's size and data */
+	if (i == 0)
+		msg->data_position = msg->base.data;
+	else if (layout->variable & (bit >> 1))
+		msg->data_position
+			+= 1 + DIV_ROUNDUP(*msg->data_position,
+					   sizeof(uint32_t));
+	else
+		++msg->data_position;
 
-	if (msg->cur_arg.type == 0)
-		return NULL;
+	msg->cur_arg.type = layout->args[i].type;
+	msg->cur_arg.nullable = !!(layout->nullable & bit);
 
-	/* find data of next argument */
-	switch (type) {
-	case 'u':
-	case 'i':
-	case 'f':
-	case 'o':
-	case 'n':
-	case 'h':
-		++msg->data_position;
-		break;
-	case 's':
-	case 'a':
-		/* msg->data_position now points to
-		 * size argument of previous string/array */
-		size = *msg->data_position;
-		if (size == 0) {
-			++msg->data_position;
-		} else {
-			off = DIV_ROUNDUP(size, sizeof(uint32_t));
-			msg->data_position += (off + 1);
-		}
-		break;
-	default:
-		fprintf(stderr, "Warning: unhandled type: %d (%c)\n", type, type);
-	}
+	/* If this is a string or array that is empty,
+	 * set it to NULL, otherwise make it pointing
+	 * to the data */
+	if (layout->variable & bit)
+		msg->cur_arg.data = *msg->data_position
+				    ? msg->data_position + 1 : NULL;
+	else
+		msg->cur_arg.data = msg->data_position;
 
-	/* ok, we now have pointer to the data of
-	 * the current argument, so set it in the iterator */
-	msg->cur_arg.data = get_data_ptr(msg);
+	++msg->arg_index;
 
 	return &msg->cur_arg;
 }
@@ -248,53 +252,56 @@ wldbg_resolved_message_get_name(struct wldbg_resolved_message *msg,
 	return buff;
 }
 
-size_t
-wldbg_get_message_name(struct wldbg_message *message, char *buf, size_t maxsize)
+static size_t
+format_message_name(struct wldbg_decoded_message *d, char *buf,
+		    size_t maxsize)
 {
-	struct wldbg_parsed_message pm;
-	const struct wl_interface *interface;
-	const struct wl_message *wl_message = NULL;
+	const struct wldbg_resolved_message *rm = &d->message;
 	int ret;
-	size_t written;
 
-	wldbg_parse_message(message, &pm);
-	interface = wldbg_message_get_object(message, pm.id);
-
-	if (is_valid_interface(interface)) {
-		if (message->from == SERVER)
-			wl_message = &interface->events[pm.opcode];
-		else
-			wl_message = &interface->methods[pm.opcode];
-
-		/* put the interface name into the buffer */
-		ret = snprintf(buf, maxsize, "%s", interface->name);
-	} else
-		ret = snprintf(buf, maxsize, "unknown");
+	/* the interface is set also when the opcode is wrong */
+	if (rm->wl_interface && rm->wl_message)
+		ret = snprintf(buf, maxsize, "%s@%d.%s",
+			       rm->wl_interface->name, rm->base.id,
+			       rm->wl_message->name);
+	else if (rm->wl_interface)
+		ret = snprintf(buf, maxsize, "%s@%d.%u",
+			       rm->wl_interface->name, rm->base.id,
+			       rm->base.opcode);
+	else
+		ret = snprintf(buf, maxsize, "unknown@%d.%u",
+			       rm->base.id, rm->base.opcode);
 
 	if (ret < 0)
 		return 0;
-	if (ret >= (int) maxsize)
-		return ret;
 
-	written = ret;
+	/* how many characters we wrote or how many
+	 * characters we'd wrote in the case of overflow */
+	return ret;
+}
 
-	/* create name of the message we got */
-	if (wl_message) {
-		ret = snprintf(buf + ret, maxsize - written,
-			       "@%d.%s", pm.id, wl_message->name);
+size_t
+wldbg_get_message_name(struct wldbg_message *message, char *buf, size_t maxsize)
+{
+	struct wldbg_decoded_message *d = decode_message(message);
 
-	} else {
-		ret = snprintf(buf + ret, maxsize - written,
-			       "@%d.%d", pm.id, pm.opcode);
+	if (!(d->valid & WLDBG_DECODED_NAME)) {
+		d->name_len = format_message_name(d, d->name, sizeof d->name);
+		d->valid |= WLDBG_DECODED_NAME;
 	}
 
-	if (ret < 0)
-		return written;
+	/* too long for the cache */
+	if (d->name_len >= sizeof d->name)
+		return format_message_name(d, buf, maxsize);
 
-	written += ret;
+	if (maxsize > 0) {
+		if (d->name_len < maxsize) {
+			memcpy(buf, d->name, d->name_len + 1);
+		} else {
+			memcpy(buf, d->name, maxsize - 1);
+			buf[maxsize - 1] = '\0';
+		}
+	}
 
-	// return how many characters we wrote or how
-	// many characters we'd wrote in the case of overflow
-	return written;
+	return d->name_len;
 }
-
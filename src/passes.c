@@ -37,6 +37,7 @@
 #include "util.h"
 #include "wldbg-pass.h"
 #include "getopt.h"
+#include "wldbg-hash.h"
 
 /* hardcoded passes */
 extern struct wldbg_pass wldbg_pass_list;
@@ -122,7 +123,7 @@ dealloc_pass(struct pass *pass)
 struct pass *
 alloc_pass(const char *name)
 {
-	struct pass *pass = malloc(sizeof *pass);
+	struct pass *pass = calloc(1, sizeof *pass);
 	if (!pass)
 		return NULL;
 
@@ -326,6 +327,7 @@ load_passes(struct wldbg *wldbg, struct wldbg_options *opts,
 
 				++pass_created;
 				wl_list_insert(wldbg->passes.next, &pass->link);
+				wldbg_passes_changed(wldbg);
 				dbg("Pass '%s' loaded\n", argv[argc - rest]);
 			} else {
 				dbg("Loading pass '%s' failed\n",
@@ -339,3 +341,279 @@ load_passes(struct wldbg *wldbg, struct wldbg_options *opts,
 	dbg("Loaded %d passes\n", pass_created);
 	return pass_created;
 }
+
+/*
+ * Table of passes that are run for a message. For every interface
+ * there are NULL-terminated lists of passes for each of its messages
+ * in both directions, so that we do not call passes that are not
+ * interested in the message at all. The lists for an interface
+ * are created when we see the first message for it.
+ */
+struct interface_passes {
+	/* number of messages per direction */
+	int count[2];
+	/* lists of passes, indexed by direction and opcode */
+	struct pass ***messages[2];
+};
+
+struct pass_table {
+	/* all passes are read-only */
+	int read_only;
+	/* lists of passes for messages to unknown objects */
+	struct pass **any[2];
+	/* lists of passes that want at least some messages,
+	 * used when passing whole buffers */
+	struct pass **all[2];
+	int passes_num;
+
+	/* interface_passes, keyed by interface */
+	struct wldbg_pointer_map interfaces;
+};
+
+static int
+pass_interested(struct wldbg_pass *wp, int from,
+		const struct wl_interface *intf, int opcode)
+{
+	const struct wldbg_pass_interest *in;
+	unsigned int direction = 1 << from;
+
+	if (!wp->interests)
+		return 1;
+
+	for (in = wp->interests; in->direction; ++in) {
+		if (!(in->direction & direction))
+			continue;
+
+		if (!in->interface)
+			return 1;
+
+		/* intf == NULL and WLDBG_ANY_OPCODE means
+		 * any message from the direction */
+		if (!intf) {
+			if (opcode == WLDBG_ANY_OPCODE)
+				return 1;
+
+			continue;
+		}
+
+		if (strcmp(in->interface, intf->name) == 0
+		    && (in->opcode == WLDBG_ANY_OPCODE || in->opcode == opcode))
+			return 1;
+	}
+
+	return 0;
+}
+
+static struct pass **
+fill_pass_list(struct pass **list, struct wldbg *wldbg, int from,
+	       const struct wl_interface *intf, int opcode)
+{
+	struct pass *pass;
+
+	wl_list_for_each(pass, &wldbg->passes, link) {
+		if (pass_interested(&pass->wldbg_pass, from, intf, opcode))
+			*list++ = pass;
+	}
+
+	*list++ = NULL;
+
+	return list;
+}
+
+static struct pass_table *
+create_pass_table(struct wldbg *wldbg)
+{
+	struct pass_table *table;
+	struct pass **list;
+	struct pass *pass;
+	int from;
+
+	table = calloc(1, sizeof *table);
+	if (!table)
+		return NULL;
+
+	wldbg_pointer_map_init(&table->interfaces);
+
+	table->read_only = 1;
+	wl_list_for_each(pass, &wldbg->passes, link) {
+		if (!(pass->wldbg_pass.flags & WLDBG_PASS_READ_ONLY))
+			table->read_only = 0;
+
+		++table->passes_num;
+	}
+
+	list = malloc(4 * (table->passes_num + 1) * sizeof *list);
+	if (!list) {
+		free(table);
+		return NULL;
+	}
+
+	for (from = SERVER; from <= CLIENT; ++from) {
+		/* NULL interface means that we do not know the interface,
+		 * so only passes that want any message match */
+		table->any[from] = list;
+		list = fill_pass_list(list, wldbg, from, NULL, 0);
+		table->all[from] = list;
+		list = fill_pass_list(list, wldbg, from, NULL,
+				      WLDBG_ANY_OPCODE);
+	}
+
+	return table;
+}
+
+static void
+destroy_pass_table(struct pass_table *table)
+{
+	wldbg_pointer_map_release(&table->interfaces, free);
+	/* the lists are allocated in one chunk */
+	free(table->any[SERVER]);
+	free(table);
+}
+
+static struct interface_passes *
+create_interface_passes(struct wldbg *wldbg, int passes_num,
+			const struct wl_interface *intf)
+{
+	struct interface_passes *ip;
+	struct pass ***messages;
+	struct pass **list;
+	int from, opcode, count;
+
+	count = intf->event_count + intf->method_count;
+	ip = malloc(sizeof *ip + count * sizeof *messages
+		    + count * (passes_num + 1) * sizeof *list);
+	if (!ip)
+		return NULL;
+
+	ip->count[SERVER] = intf->event_count;
+	ip->count[CLIENT] = intf->method_count;
+
+	messages = (struct pass ***) (ip + 1);
+	list = (struct pass **) (messages + count);
+
+	for (from = SERVER; from <= CLIENT; ++from) {
+		ip->messages[from] = messages;
+		for (opcode = 0; opcode < ip->count[from]; ++opcode) {
+			messages[opcode] = list;
+			list = fill_pass_list(list, wldbg, from, intf, opcode);
+		}
+
+		messages += ip->count[from];
+	}
+
+	return ip;
+}
+
+static struct interface_passes *
+get_interface_passes(struct wldbg *wldbg, struct pass_table *table,
+		     const struct wl_interface *intf)
+{
+	struct interface_passes *ip;
+
+	ip = wldbg_pointer_map_get(&table->interfaces, intf);
+	if (ip)
+		return ip;
+
+	ip = create_interface_passes(wldbg, table->passes_num, intf);
+	if (!ip)
+		return NULL;
+
+	if (wldbg_pointer_map_insert(&table->interfaces, intf, ip) < 0) {
+		free(ip);
+		return NULL;
+	}
+
+	return ip;
+}
+
+static struct pass_table *
+get_pass_table(struct wldbg *wldbg)
+{
+	if (wldbg->flags.passes_changed) {
+		wldbg_destroy_pass_table(wldbg);
+		wldbg->flags.passes_changed = 0;
+	}
+
+	if (!wldbg->pass_table)
+		wldbg->pass_table = create_pass_table(wldbg);
+
+	return wldbg->pass_table;
+}
+
+/**
+ * Must be called whenever a pass is added or removed. Passes can
+ * be changed while the table is in use (from interactive mode),
+ * so the table is created again when it is needed next time.
+ */
+void
+wldbg_passes_changed(struct wldbg *wldbg)
+{
+	wldbg->flags.passes_changed = 1;
+}
+
+/**
+ * The interface is going to be freed, remove its passes from the table,
+ * so that another interface allocated at the same address does not
+ * get them.
+ */
+void
+wldbg_passes_forget(struct wldbg *wldbg, const struct wl_interface *intf)
+{
+	if (wldbg->pass_table)
+		free(wldbg_pointer_map_remove(&wldbg->pass_table->interfaces,
+					      intf));
+}
+
+void
+wldbg_destroy_pass_table(struct wldbg *wldbg)
+{
+	if (wldbg->pass_table)
+		destroy_pass_table(wldbg->pass_table);
+
+	wldbg->pass_table = NULL;
+}
+
+int
+wldbg_passes_read_only(struct wldbg *wldbg)
+{
+	struct pass_table *table = get_pass_table(wldbg);
+
+	return table ? table->read_only : 0;
+}
+
+/**
+ * Get NULL-terminated list of passes that should be run
+ * for the message. Returns NULL when out of memory.
+ */
+struct pass **
+wldbg_message_passes(struct wldbg_message *message)
+{
+	struct wldbg *wldbg = message->connection->wldbg;
+	struct pass_table *table;
+	struct interface_passes *ip;
+	const struct wl_interface *intf;
+	uint32_t *data = message->data;
+	int opcode;
+
+	table = get_pass_table(wldbg);
+	if (!table)
+		return NULL;
+
+	if (wldbg->flags.pass_whole_buffer)
+		return table->all[message->from];
+
+	intf = wldbg_message_get_object(message, data[0]);
+	if (!intf)
+		return table->any[message->from];
+
+	ip = get_interface_passes(wldbg, table, intf);
+	if (!ip)
+		return NULL;
+
+	/* unknown interfaces have no messages */
+	opcode = data[1] & 0xffff;
+	if (opcode >= ip->count[message->from])
+		return table->any[message->from];
+
+	return ip->messages[message->from][opcode];
+}
@@ -23,6 +23,7 @@
  * SOFTWARE.
  */
 
+#include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -32,7 +33,6 @@
 
 #include <linux/input.h>
 #include <wayland-client-protocol.h>
-#include <wayland-version.h>
 
 #include "wldbg.h"
 #include "wayland/wayland-util.h"
@@ -41,21 +41,19 @@
 #include "wldbg-private.h"
 #include "wldbg-parse-message.h"
 #include "resolve.h"
+#include "wldbg-interfaces.h"
+#include "wldbg-printers.h"
+#include "wldbg-writer.h"
 #include "util.h"
 
-/* is wayland version greater or equal to given version? */
-#define WAYLAND_VERSION_GE(maj, min, mic)\
-    (((WAYLAND_VERSION_MAJOR > (maj))) ||\
-     ((WAYLAND_VERSION_MAJOR == (maj)) &&\
-      (WAYLAND_VERSION_MINOR > (min))) ||\
-     ((WAYLAND_VERSION_MAJOR == (maj)) &&\
-      (WAYLAND_VERSION_MINOR == (min)) &&\
-      (WAYLAND_VERSION_MICRO >= (mic))))
+/* hand the output of a connection over to the writer
+ * when it grows over this size */
+#define OUTPUT_CHUNK_SIZE (64 * 1024)
 
 static void
-print_key(uint32_t p)
+print_key(struct wldbg_output *out, uint32_t p)
 {
-#define CASE(k) case KEY_##k: printf("'%s'", #k); break;
+#define CASE(k) case KEY_##k: wldbg_output_printf(out, "'%s'", #k); break;
 
 	switch (p) {
 		CASE(RESERVED)
@@ -299,7 +297,7 @@ print_key(uint32_t p)
 		CASE(UWB)
 
 		CASE(UNKNOWN)
-		default: printf("%u", p);
+		default: wldbg_output_printf(out, "%u", p);
 	}
 
 #undef CASE
@@ -318,160 +316,46 @@ static const char *MODIFIERS[] =
 };
 
 static void
-print_modifiers(uint32_t p)
+print_modifiers(struct wldbg_output *out, uint32_t p)
 {
 	unsigned int i, printed = 0;
 	for (i = 0; i < (8 * sizeof p); ++i) {
 		if (p & (1U << i)) {
 			if (i < (sizeof MODIFIERS / sizeof *MODIFIERS))
-				printf("%s%s", printed++ ? "|" : "", MODIFIERS[i]);
+				wldbg_output_printf(out, "%s%s",
+						    printed++ ? "|" : "",
+						    MODIFIERS[i]);
 			else
-				printf("%s0x%x", printed++ ? "|" : "", 1U << i);
+				wldbg_output_printf(out, "%s0x%x",
+						    printed++ ? "|" : "",
+						    1U << i);
 		}
 	}
 }
 
 static int
-print_wl_keyboard_message(const struct wl_interface *wl_interface,
-			  const struct wl_message *wl_message, int pos, uint32_t p)
+print_key_arg(struct wldbg_output *out, const struct wldbg_resolved_arg *arg,
+	      const void *data)
 {
-	if (strcmp(wl_interface->name, "wl_keyboard") != 0)
-		return 0;
-
-	if (strcmp(wl_message->name, "modifiers") == 0) {
-		/* pos == 2 is serial, pos == 6 is group (layout) */
-		if (pos == 2 || pos == 6 || p == 0)
-			return 0;
-
-		print_modifiers(p);
-		return 1;
-	} else if (strcmp(wl_message->name, "key") == 0) {
-		/* state */
-		if (pos == 5) {
-			printf("%s", p == 1 ? "press" : "release");
-			return 1;
-		/* key */
-		} else if (pos == 4) {
-			print_key(p);
-			return 1;
-		}
-	}
+	(void) data;
 
-	return 0;
+	print_key(out, *arg->data);
+	return 1;
 }
 
 static int
-print_wl_seat_message(const struct wl_interface *wl_interface,
-		      const struct wl_message *wl_message, uint32_t p)
-{
-	int n = 0;
-	if (strcmp(wl_interface->name, "wl_seat") != 0)
-		return 0;
-
-	if (strcmp(wl_message->name, "capabilities") == 0) {
-		if (p & WL_SEAT_CAPABILITY_KEYBOARD) {
-			printf("keyboard");
-			n = 1;
-		}
-
-		if (p & WL_SEAT_CAPABILITY_POINTER) {
-			printf("%spointer", n ? " | " : "");
-			n = 1;
-		}
-
-		if (p & WL_SEAT_CAPABILITY_TOUCH) {
-			printf("%stouch", n ? " | " : "");
-			n = 1;
-		}
-
-		if (!n)
-			printf("none");
-
-		return 1;
-	}
-
-	return 0;
-}
-
-/* The actions were introduced in 1.9.91 */
-#if WAYLAND_VERSION_GE(1, 9, 91)
-static void
-print_actions(uint32_t act)
+print_modifiers_arg(struct wldbg_output *out,
+		    const struct wldbg_resolved_arg *arg, const void *data)
 {
-	if (act == WL_DATA_DEVICE_MANAGER_DND_ACTION_NONE) {
-		printf("none");
-		return;
-	}
-
-	int n = 0;
-	if (act & WL_DATA_DEVICE_MANAGER_DND_ACTION_COPY) {
-		printf("copy");
-		n = 1;
-	}
-
-	if (act & WL_DATA_DEVICE_MANAGER_DND_ACTION_MOVE) {
-		printf("%smove", n ? "|" : "");
-		n = 1;
-	}
+	(void) data;
 
-	if (act & WL_DATA_DEVICE_MANAGER_DND_ACTION_ASK) {
-		printf("%sask", n ? "|" : "");
-	}
-}
-
-static int
-print_wl_data_source_message(const struct wl_interface *wl_interface,
-			     const struct wl_message *wl_message,
-			     int pos, uint32_t p)
-{
-	if (strcmp(wl_interface->name, "wl_data_source") != 0)
+	if (*arg->data == 0)
 		return 0;
 
-	if (strcmp(wl_message->name, "action") == 0) {
-		assert(pos == 0 && "action event has only one argument");
-
-		print_actions(p);
-		return 1;
-	} else if (strcmp(wl_message->name, "set_actions") == 0) {
-		assert(pos == 0 && "set_actions has only one argument");
-
-		print_actions(p);
-		return 1;
-	}
-
-	return 0;
+	print_modifiers(out, *arg->data);
+	return 1;
 }
 
-static int
-print_wl_data_offer_message(const struct wl_interface *wl_interface,
-			    const struct wl_message *wl_message,
-			    int pos, uint32_t p)
-{
-	if (strcmp(wl_interface->name, "wl_data_offer") != 0)
-		return 0;
-
-	if (strcmp(wl_message->name, "action") == 0) {
-		assert(pos == 0 && "action event has only one argument");
-
-		print_actions(p);
-		return 1;
-	} else if (strcmp(wl_message->name, "set_actions") == 0) {
-		assert(pos <= 1 && "set_actions has max two arguments");
-
-		print_actions(p);
-		return 1;
-	} else if (strcmp(wl_message->name, "source_actions") == 0) {
-		assert(pos == 0 && "this event has only one argument");
-
-		print_actions(p);
-		return 1;
-	}
-
-	return 0;
-}
-#endif /* WAYLAND_VERSION >= 1.9.91 */
-
-
 /* we have whole xdg-surface hardcoded now...
  * FIXME */
 #ifndef XDG_SURFACE_STATE_ENUM
@@ -484,147 +368,216 @@ enum xdg_surface_state {
 };
 #endif /* XDG_SURFACE_STATE_ENUM */
 
+/* the array of states in xdg_surface.configure */
 static int
-print_xdg_surface_message(const struct wl_interface *wl_interface,
-			  const struct wl_message *wl_message, int pos,
-			  uint32_t *data, size_t len)
+print_xdg_surface_states(struct wldbg_output *out,
+			 const struct wldbg_resolved_arg *arg,
+			 const void *data)
 {
-	int n;
-	uint32_t i;
+	int n = 0;
+	size_t i, len;
 
-	if (strcmp(wl_interface->name, "xdg_surface") != 0)
-		return 0;
+	(void) data;
 
-	if (pos == 2 && strcmp(wl_message->name, "configure") == 0) {
-		/* print human readable configure states */
-		n = 0;
-		for (i = 0; i < len; ++i) {
+	if (!arg->data)
+		return 0;
 
-			switch(data[i]) {
-			case XDG_SURFACE_STATE_MAXIMIZED:
-				printf("%smaximized", n++ ? "|" : "");
-				break;
-			case XDG_SURFACE_STATE_FULLSCREEN:
-				printf("%sfullscreen", n++ ? "|" : "");
-				break;
-			case XDG_SURFACE_STATE_RESIZING:
-				printf("%sresizing", n++ ? "|" : "");
-				break;
-			case XDG_SURFACE_STATE_ACTIVATED:
-				printf("%sactivated", n++ ? "|" : "");
-				break;
-			default:
-				printf("%sunknown", n++ ? "|" : "");
-			}
+	len = DIV_ROUNDUP(*(arg->data - 1), sizeof(uint32_t));
+	/* print human readable configure states */
+	for (i = 0; i < len; ++i) {
+		switch(arg->data[i]) {
+		case XDG_SURFACE_STATE_MAXIMIZED:
+			wldbg_output_printf(out, "%smaximized", n++ ? "|" : "");
+			break;
+		case XDG_SURFACE_STATE_FULLSCREEN:
+			wldbg_output_printf(out, "%sfullscreen", n++ ? "|" : "");
+			break;
+		case XDG_SURFACE_STATE_RESIZING:
+			wldbg_output_printf(out, "%sresizing", n++ ? "|" : "");
+			break;
+		case XDG_SURFACE_STATE_ACTIVATED:
+			wldbg_output_printf(out, "%sactivated", n++ ? "|" : "");
+			break;
+		default:
+			wldbg_output_printf(out, "%sunknown", n++ ? "|" : "");
 		}
+	}
 
-		if (n == 0)
-			printf("none");
+	if (n == 0)
+		wldbg_output_printf(out, "none");
 
-		return 1;
+	return 1;
+}
+
+/* enums for the case that we do not have the XML files
+ * of the wayland protocol, see protocols.h */
+static const struct wldbg_enum_entry seat_capability_entries[] = {
+	{ "pointer", 1 },
+	{ "keyboard", 2 },
+	{ "touch", 4 },
+};
+
+static const struct wldbg_enum seat_capability = {
+	"capability", 1, 3, seat_capability_entries
+};
+
+static const struct wldbg_enum_entry key_state_entries[] = {
+	{ "released", 0 },
+	{ "pressed", 1 },
+};
+
+static const struct wldbg_enum key_state = {
+	"key_state", 0, 2, key_state_entries
+};
+
+static const struct wldbg_enum_entry dnd_action_entries[] = {
+	{ "none", 0 },
+	{ "copy", 1 },
+	{ "move", 2 },
+	{ "ask", 4 },
+};
+
+static const struct wldbg_enum dnd_action = {
+	"dnd_action", 1, 4, dnd_action_entries
+};
+
+static const struct {
+	const char *interface;
+	const char *message;
+	int from;
+	unsigned int arg;
+	wldbg_arg_printer print;
+	const struct wldbg_enum *enumeration;
+} builtin_printers[] = {
+	{ "wl_keyboard", "key", SERVER, 2, print_key_arg, NULL },
+	{ "wl_keyboard", "key", SERVER, 3, NULL, &key_state },
+	/* serial and group are just numbers */
+	{ "wl_keyboard", "modifiers", SERVER, 1, print_modifiers_arg, NULL },
+	{ "wl_keyboard", "modifiers", SERVER, 2, print_modifiers_arg, NULL },
+	{ "wl_keyboard", "modifiers", SERVER, 3, print_modifiers_arg, NULL },
+	{ "wl_seat", "capabilities", SERVER, 0, NULL, &seat_capability },
+	{ "wl_data_source", "action", SERVER, 0, NULL, &dnd_action },
+	{ "wl_data_source", "set_actions", CLIENT, 0, NULL, &dnd_action },
+	{ "wl_data_offer", "action", SERVER, 0, NULL, &dnd_action },
+	{ "wl_data_offer", "source_actions", SERVER, 0, NULL, &dnd_action },
+	{ "wl_data_offer", "set_actions", CLIENT, 0, NULL, &dnd_action },
+	{ "wl_data_offer", "set_actions", CLIENT, 1, NULL, &dnd_action },
+	{ "xdg_surface", "configure", SERVER, 2,
+	  print_xdg_surface_states, NULL },
+};
+
+int
+wldbg_printers_add_builtin(void)
+{
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < sizeof builtin_printers / sizeof *builtin_printers;
+	     ++i) {
+		if (builtin_printers[i].enumeration)
+			ret = wldbg_printers_add_enum(
+					builtin_printers[i].interface,
+					builtin_printers[i].message,
+					builtin_printers[i].from,
+					builtin_printers[i].arg,
+					builtin_printers[i].enumeration,
+					WLDBG_PRINTER_BUILTIN);
+		else
+			ret = wldbg_printers_add(
+					builtin_printers[i].interface,
+					builtin_printers[i].message,
+					builtin_printers[i].from,
+					builtin_printers[i].arg,
+					builtin_printers[i].print, NULL,
+					WLDBG_PRINTER_BUILTIN);
+
+		if (ret < 0)
+			return -1;
 	}
 
 	return 0;
 }
 
 static void
-print_array(uint32_t *p, size_t len, size_t howmany)
+print_array(struct wldbg_output *out, uint32_t *p, size_t len,
+	    size_t howmany)
 {
 	size_t j;
 
 	if (len == 0)
-		printf("(nil)");
+		wldbg_output_printf(out, "(nil)");
 	else {
-		putchar('[');
+		wldbg_output_putc(out, '[');
 
 		/* print max first howmany elements from array */
 		for (j = 0; j < howmany && j < len; ++j) {
 			if (j > 0)
-				putchar(' ');
+				wldbg_output_putc(out, ' ');
 
-			printf("%04x", *(p + j));
+			wldbg_output_printf(out, "%04x", *(p + j));
 		}
 
 		if (len > j)
-			printf(" ...");
+			wldbg_output_printf(out, " ...");
 
-		putchar(']');
+		wldbg_output_putc(out, ']');
 	}
 }
 
 static inline void
-print_id(uint32_t id)
+print_id(struct wldbg_output *out, uint32_t id)
 {
 	if (id >= WL_SERVER_ID_START)
-		printf("SRV%d", id - WL_SERVER_ID_START);
+		wldbg_output_printf(out, "SRV%d", id - WL_SERVER_ID_START);
 	else
-		printf("%d", id);
+		wldbg_output_printf(out, "%d", id);
 }
 
 static void
-print_arg(struct wldbg_resolved_arg *arg, struct wldbg_resolved_message *rm,
-	  uint32_t pos, struct wldbg_message *message)
+print_arg(struct wldbg_output *out, const struct wldbg_resolved_arg *arg,
+	  struct wldbg_resolved_message *rm, uint32_t pos,
+	  struct wldbg_message *message)
 {
 	const struct wl_interface *obj;
 	size_t len;
 
 	switch (arg->type) {
 	case 'u':
-		/* FIXME: do this more efficient. We're also
-		 * comparing strings in these functions */
-		if (print_wl_keyboard_message(rm->wl_interface,
-					      rm->wl_message, pos + 2,
-					      *arg->data))
-			break;
-
-		if (print_wl_seat_message(rm->wl_interface,
-					  rm->wl_message, *arg->data))
-			break;
-
-#if WAYLAND_VERSION_GE(1, 9, 91)
-		if (print_wl_data_source_message(rm->wl_interface,
-						 rm->wl_message, pos,
-						 *arg->data))
-			break;
-
-		if (print_wl_data_offer_message(rm->wl_interface,
-						rm->wl_message, pos,
-						*arg->data))
-			break;
-#endif /* WAYLAND_VERSION >= 1.9.91 */
-
-		/* nothing worked? Then it is just a number */
-		printf("%u", *arg->data);
+		wldbg_output_printf(out, "%u", *arg->data);
 		break;
 	case 'i':
-		printf("%d", (int32_t) *arg->data);
+		wldbg_output_printf(out, "%d", (int32_t) *arg->data);
 		break;
 	case 'f':
-		printf("%f", wl_fixed_to_double(*arg->data));
+		wldbg_output_printf(out, "%f", wl_fixed_to_double(*arg->data));
 		break;
 	case 's':
 		if (arg->data)
-			printf("%u:\"%s\"", *(arg->data - 1),
+			wldbg_output_printf(out, "%u:\"%s\"", *(arg->data - 1),
 			       (const char *) (arg->data));
 		else
-			printf("0:\"\"");
+			wldbg_output_printf(out, "0:\"\"");
 		break;
 	case 'o':
 		obj = wldbg_message_get_object(message, *arg->data);
+		/* deleted objects are not in the map anymore */
+		if (!obj && *arg->data != 0)
+			obj = &free_entry;
+
 		if (obj) {
-			printf("%s@", obj->name);
-			print_id(*arg->data);
+			wldbg_output_printf(out, "%s@", obj->name);
+			print_id(out, *arg->data);
 		} else
-			printf("nil");
+			wldbg_output_printf(out, "nil");
 		break;
 	case 'n':
-		printf("new id %s@", rm->wl_message->types[pos] ?
+		wldbg_output_printf(out, "new id %s@", rm->wl_message->types[pos] ?
 			rm->wl_message->types[pos]->name : "[unknown]");
 
 		if (*arg->data != 0)
-			print_id(*arg->data);
+			print_id(out, *arg->data);
 		else
-			printf("nil");
+			wldbg_output_printf(out, "nil");
 		break;
 	case 'a':
 		if (arg->data)
@@ -632,50 +585,53 @@ print_arg(struct wldbg_resolved_arg *arg, struct wldbg_resolved_message *rm,
 		else
 			len = 0;
 
-		if (len && print_xdg_surface_message(rm->wl_interface,
-						     rm->wl_message, pos,
-						     arg->data, len))
-			break;
-
-		printf("array:");
-		print_array(arg->data, len, 8);
+		wldbg_output_printf(out, "array:");
+		print_array(out, arg->data, len, 8);
 		break;
 	case 'h':
-		printf("fd");
+		wldbg_output_printf(out, "fd");
 		break;
 	}
 }
 
-void
-wldbg_message_print(struct wldbg_message *message)
+static void
+print_prefix(struct wldbg_output *out, struct wldbg_connection *conn,
+	     int from)
 {
-	int is_buggy = 0;
-	uint32_t pos;
-	struct wldbg_connection *conn = message->connection;
-	struct wldbg_resolved_message rm;
-	struct wldbg_resolved_arg *arg;
-
 	if (conn->wldbg->flags.server_mode) {
 		if (conn->client.program)
-			printf("[%-*s |%-5d] ",
-			       conn->wldbg->server_mode.client_name_width,
-			       conn->client.program,
-			       conn->client.pid);
+			wldbg_output_printf(out, "[%-*s |%-5d] ",
+				conn->wldbg->server_mode.client_name_width,
+				conn->client.program,
+				conn->client.pid);
 		else
-			printf("[? |%-5d] ", conn->client.pid);
+			wldbg_output_printf(out, "[? |%-5d] ", conn->client.pid);
 	}
 
-	printf("%c: ", message->from == SERVER ? 'S' : 'C');
+	wldbg_output_printf(out, "%c: ", from == SERVER ? 'S' : 'C');
+}
+
+/* print the message without the prefix */
+static void
+print_body(struct wldbg_output *out, struct wldbg_message *message)
+{
+	int is_buggy = 0;
+	uint32_t pos;
+	struct wldbg_resolved_message rm;
+	const struct wldbg_resolved_arg *args;
+	const struct wldbg_arg_format *formats;
+	unsigned int count;
 
 	if (!wldbg_resolve_message(message, &rm)) {
 		if (!wldbg_parse_message(message, &rm.base)) {
-			printf("_failed_parsing_message_\n");
+			wldbg_output_printf(out, "_failed_parsing_message_\n");
 			return;
 		}
 
-		printf("unknown@");
-		print_id(rm.base.id);
-		printf(".[opcode %u][size %uB]\n", rm.base.opcode, rm.base.size);
+		wldbg_output_printf(out, "unknown@");
+		print_id(out, rm.base.id);
+		wldbg_output_printf(out, ".[opcode %u][size %uB]\n",
+				    rm.base.opcode, rm.base.size);
 		return;
 	}
 
@@ -687,41 +643,260 @@ wldbg_message_print(struct wldbg_message *message)
 			is_buggy = 1;
 	}
 
-	printf("%s@", rm.wl_interface->name);
-	print_id(rm.base.id);
-	putchar('.');
+	wldbg_output_printf(out, "%s@", rm.wl_interface->name);
+	print_id(out, rm.base.id);
+	wldbg_output_putc(out, '.');
 
 	/* catch buggy events/requests. We don't want them to make
 	 * wldbg crash. This means probably protocol versions mismatch */
 	if (is_buggy) {
-		printf("_buggy %s_",
-			message->from == SERVER ? "event" : "request");
-		printf("[opcode %u][size %uB]\n", rm.base.opcode, rm.base.size);
+		wldbg_output_printf(out, "_buggy %s_",
+				    message->from == SERVER
+				    ? "event" : "request");
+		wldbg_output_printf(out, "[opcode %u][size %uB]\n",
+				    rm.base.opcode, rm.base.size);
 		return;
 	} else {
-		printf("%s(", rm.wl_message->name);
+		wldbg_output_printf(out, "%s(", rm.wl_message->name);
 	}
 
+	/* the interface index is cached since we resolved it above */
+	formats = wldbg_printers_get(wldbg_message_get_interface_index(message),
+				     rm.wl_interface, message->from,
+				     rm.base.opcode);
 
-	pos = 0;
-	while((arg = wldbg_resolved_message_next_argument(&rm))) {
+	args = wldbg_message_get_arguments(message, &count);
+	for (pos = 0; pos < count; ++pos) {
 		if (pos > 0)
-			printf(", ");
-
-		/* currently we can have up to WL_CLOSURE_MAX_ARGS,
-		 * but if that changes we must update wayland-private.h */
-		if (pos >= WL_CLOSURE_MAX_ARGS) {
-			/* be kind to user... for now */
-			fprintf(stderr, "Probably wrong %s, too much arguments\n",
-				message->from == SERVER ? "event" : "request");
-			fflush(stdout);
-			break;
+			wldbg_output_printf(out, ", ");
+
+		if (formats && formats[pos].print
+		    && formats[pos].print(out, &args[pos],
+				       formats[pos].data))
+			continue;
+
+		print_arg(out, &args[pos], &rm, pos, message);
+	}
+
+	wldbg_output_printf(out, ")\n");
+}
+
+static void
+print_message(struct wldbg_output *out, struct wldbg_message *message)
+{
+	print_prefix(out, message->connection, message->from);
+	print_body(out, message);
+}
+
+static void
+get_collapse_key(struct wldbg_message *message, struct wldbg_collapse_key *k)
+{
+	struct wldbg_resolved_message rm;
+
+	memset(k, 0, sizeof *k);
+
+	/* the opcode is checked when resolving */
+	if (!wldbg_resolve_message(message, &rm))
+		return;
+
+	k->key = (uint64_t) wldbg_message_get_interface_index(message) << 32
+		 | (uint64_t) message->from << 16 | rm.base.opcode;
+	k->interface = rm.wl_interface->name;
+	k->message = rm.wl_message->name;
+}
+
+/* if the message continues a cycle of messages that we printed twice
+ * in a row, return the length of the cycle, otherwise return 0 */
+static unsigned int
+find_cycle(struct wldbg_collapse *c, uint64_t key)
+{
+	const struct wldbg_collapse_key *h = c->history;
+	unsigned int n = c->history_count, period, i;
+
+	for (period = 1; period <= WLDBG_COLLAPSE_MAX_PERIOD
+			 && 2 * period <= n; ++period) {
+		if (h[n - period].key != key)
+			continue;
+
+		for (i = 0; i < period; ++i)
+			if (h[n - period + i].key != h[n - 2 * period + i].key)
+				break;
+
+		if (i == period)
+			return period;
+	}
+
+	return 0;
+}
+
+static void
+push_history(struct wldbg_collapse *c, const struct wldbg_collapse_key *k)
+{
+	/* runs can not go over messages that we do not know */
+	if (k->key == 0) {
+		c->history_count = 0;
+		return;
+	}
+
+	if (c->history_count == ARRAY_LENGTH(c->history)) {
+		memmove(c->history, c->history + 1,
+			(c->history_count - 1) * sizeof *c->history);
+		--c->history_count;
+	}
+
+	c->history[c->history_count++] = *k;
+}
+
+static void
+collapse_message(struct wldbg_collapse *c, struct wldbg_message *message)
+{
+	struct wldbg_output *out;
+
+	/* keep the arguments of the messages that start the cycle */
+	if (c->position == 0) {
+		out = c->count == 0 ? &c->first : &c->last;
+		out->size = 0;
+		print_body(out, message);
+		if (out->size > 0 && out->data[out->size - 1] == '\n')
+			--out->size;
+	}
+
+	if (c->count == 0)
+		c->first_received = message->received;
+	c->last_received = message->received;
+
+	++c->count;
+	c->position = (c->position + 1) % c->period;
+}
+
+/* print the summary of the run, the history is kept */
+static void
+end_run(struct wldbg_connection *conn)
+{
+	struct wldbg_collapse *c = &conn->collapse;
+	struct wldbg_output *out = &conn->output;
+	const struct wldbg_collapse_key *cycle;
+	unsigned int i;
+
+	if (c->period == 0)
+		return;
+
+	cycle = &c->history[c->history_count - c->period];
+
+	print_prefix(out, conn, (cycle[0].key >> 16) & 1);
+	wldbg_output_printf(out, "... %llu more of (",
+			    (unsigned long long) c->count);
+	for (i = 0; i < c->period; ++i)
+		wldbg_output_printf(out, "%s%s.%s", i > 0 ? ", " : "",
+				    cycle[i].interface, cycle[i].message);
+
+	wldbg_output_printf(out, ") in %.3f ms, first: %.*s",
+			    (c->last_received - c->first_received) / 1e6,
+			    (int) c->first.size, c->first.data);
+	if (c->last.size > 0)
+		wldbg_output_printf(out, ", last: %.*s",
+				    (int) c->last.size, c->last.data);
+	wldbg_output_putc(out, '\n');
+
+	c->period = 0;
+	c->position = 0;
+	c->count = 0;
+	c->last.size = 0;
+}
+
+/* print the output right away if we do not have the writer (in the
+ * interactive mode), otherwise hand it over to the writer when it is
+ * big enough. The rest is handed over by wldbg_output_flush() after
+ * the messages that were read together are processed */
+static void
+output_written(struct wldbg_connection *conn)
+{
+	struct wldbg *wldbg = conn->wldbg;
+
+	if (!wldbg->writer) {
+		fwrite(conn->output.data, 1, conn->output.size, stdout);
+		conn->output.size = 0;
+	} else if (conn->output.size >= OUTPUT_CHUNK_SIZE) {
+		wldbg_writer_write(wldbg->writer, &conn->output);
+	}
+}
+
+void
+wldbg_output_flush(struct wldbg_connection *conn)
+{
+	if (conn->wldbg->writer)
+		wldbg_writer_write(conn->wldbg->writer, &conn->output);
+}
+
+void
+wldbg_collapse_flush(struct wldbg_connection *conn)
+{
+	if (conn->collapse.period) {
+		end_run(conn);
+		output_written(conn);
+	}
+
+	conn->collapse.history_count = 0;
+}
+
+void
+wldbg_collapse_release(struct wldbg_connection *conn)
+{
+	wldbg_output_release(&conn->collapse.first);
+	wldbg_output_release(&conn->collapse.last);
+}
+
+/* return 1 if the message was collapsed into a run */
+static int
+collapse(struct wldbg_connection *conn, struct wldbg_message *message)
+{
+	struct wldbg_collapse *c = &conn->collapse;
+	struct wldbg_collapse_key k;
+	uint64_t expected;
+
+	get_collapse_key(message, &k);
+
+	if (c->period) {
+		expected = c->history[c->history_count - c->period
+				      + c->position].key;
+		if (k.key != 0 && k.key == expected) {
+			collapse_message(c, message);
+			return 1;
 		}
 
-		print_arg(arg, &rm, pos, message);
-		++pos;
+		end_run(conn);
+	} else if (k.key != 0 && (c->period = find_cycle(c, k.key))) {
+		collapse_message(c, message);
+		return 1;
 	}
 
-	printf(")\n");
+	push_history(c, &k);
+	return 0;
+}
+
+int
+wldbg_message_print(struct wldbg_message *message)
+{
+	struct wldbg_connection *conn = message->connection;
+
+	if (conn->wldbg->flags.collapse_runs && collapse(conn, message))
+		return 0;
+
+	print_message(&conn->output, message);
+	output_written(conn);
+
+	return 1;
 }
 
+void
+wldbg_message_printf(struct wldbg_message *message, const char *fmt, ...)
+{
+	struct wldbg_connection *conn = message->connection;
+	va_list ap;
+
+	va_start(ap, fmt);
+	wldbg_output_vprintf(&conn->output, fmt, ap);
+	va_end(ap);
+
+	output_written(conn);
+}
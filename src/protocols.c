@@ -0,0 +1,1458 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <expat.h>
+
+#include "wayland/wayland-util.h"
+
+#include "wldbg.h"
+#include "protocols.h"
+#include "wldbg-interfaces.h"
+#include "wldbg-hash.h"
+#include "wldbg-printers.h"
+
+/* how deep we descend into directories */
+#define MAX_DEPTH 8
+
+#define ALIGN(n) (((n) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+/*
+ * Parsing XML
+ */
+
+struct protocol_arg {
+	/* character from the signature */
+	char type;
+	int nullable;
+	/* only for objects and new ids */
+	char *interface;
+	/* only for integers, "name" or "interface.name" */
+	char *enumeration;
+};
+
+struct protocol_message {
+	char *name;
+	int since;
+	struct wl_array args;
+};
+
+struct protocol_interface {
+	char *name;
+	int version;
+	/* the file the interface comes from, references
+	 * to interfaces from the same file take precedence */
+	unsigned int file;
+	struct wl_array methods;
+	struct wl_array events;
+	struct wl_array enums;
+
+	/* index of the first enum in all enums of the image */
+	size_t first_enum;
+};
+
+struct protocol_entry {
+	char *name;
+	uint32_t value;
+};
+
+struct protocol_enum {
+	char *name;
+	int bitfield;
+	struct wl_array entries;
+};
+
+struct parser {
+	XML_Parser xml;
+	const char *path;
+	unsigned int file;
+
+	struct wl_array *interfaces;
+	struct protocol_interface *interface;
+	struct protocol_message *message;
+	struct protocol_enum *enumeration;
+
+	int error;
+};
+
+static const struct {
+	const char *name;
+	char type;
+} arg_types[] = {
+	{ "int", 'i' },
+	{ "uint", 'u' },
+	{ "fixed", 'f' },
+	{ "string", 's' },
+	{ "object", 'o' },
+	{ "new_id", 'n' },
+	{ "array", 'a' },
+	{ "fd", 'h' },
+	{ NULL, 0 }
+};
+
+static char
+arg_type(const char *name)
+{
+	int i;
+
+	if (!name)
+		return 0;
+
+	for (i = 0; arg_types[i].name; ++i)
+		if (strcmp(arg_types[i].name, name) == 0)
+			return arg_types[i].type;
+
+	return 0;
+}
+
+static const char *
+get_attribute(const char **atts, const char *name)
+{
+	for (; *atts; atts += 2)
+		if (strcmp(atts[0], name) == 0)
+			return atts[1];
+
+	return NULL;
+}
+
+static void
+parse_error(struct parser *parser, const char *msg)
+{
+	fprintf(stderr, "%s:%lu: %s\n", parser->path,
+		XML_GetCurrentLineNumber(parser->xml), msg);
+
+	parser->error = 1;
+	XML_StopParser(parser->xml, XML_FALSE);
+}
+
+static void
+start_interface(struct parser *parser, const char **atts)
+{
+	struct protocol_interface *intf;
+	const char *name, *version;
+
+	name = get_attribute(atts, "name");
+	version = get_attribute(atts, "version");
+	if (!name || !version) {
+		parse_error(parser, "interface needs a name and a version");
+		return;
+	}
+
+	intf = wl_array_add(parser->interfaces, sizeof *intf);
+	if (!intf) {
+		parse_error(parser, "out of memory");
+		return;
+	}
+
+	memset(intf, 0, sizeof *intf);
+	wl_array_init(&intf->methods);
+	wl_array_init(&intf->events);
+	wl_array_init(&intf->enums);
+	intf->file = parser->file;
+	intf->version = atoi(version);
+
+	intf->name = strdup(name);
+	if (!intf->name)
+		parse_error(parser, "out of memory");
+
+	parser->interface = intf;
+}
+
+static void
+start_message(struct parser *parser, struct wl_array *messages,
+	      const char **atts)
+{
+	struct protocol_message *msg;
+	const char *name, *since;
+
+	name = get_attribute(atts, "name");
+	if (!name) {
+		parse_error(parser, "message needs a name");
+		return;
+	}
+
+	msg = wl_array_add(messages, sizeof *msg);
+	if (!msg) {
+		parse_error(parser, "out of memory");
+		return;
+	}
+
+	memset(msg, 0, sizeof *msg);
+	wl_array_init(&msg->args);
+
+	since = get_attribute(atts, "since");
+	msg->since = since ? atoi(since) : 1;
+
+	msg->name = strdup(name);
+	if (!msg->name)
+		parse_error(parser, "out of memory");
+
+	parser->message = msg;
+}
+
+static void
+start_arg(struct parser *parser, const char **atts)
+{
+	struct protocol_arg *arg;
+	const char *interface, *allow_null, *enumeration;
+	char type;
+
+	type = arg_type(get_attribute(atts, "type"));
+	if (!type) {
+		parse_error(parser, "argument with unknown type");
+		return;
+	}
+
+	arg = wl_array_add(&parser->message->args, sizeof *arg);
+	if (!arg) {
+		parse_error(parser, "out of memory");
+		return;
+	}
+
+	memset(arg, 0, sizeof *arg);
+	arg->type = type;
+
+	allow_null = get_attribute(atts, "allow-null");
+	arg->nullable = allow_null && strcmp(allow_null, "true") == 0;
+
+	interface = get_attribute(atts, "interface");
+	if (interface && (type == 'o' || type == 'n')) {
+		arg->interface = strdup(interface);
+		if (!arg->interface)
+			parse_error(parser, "out of memory");
+	}
+
+	enumeration = get_attribute(atts, "enum");
+	if (enumeration && (type == 'u' || type == 'i')) {
+		arg->enumeration = strdup(enumeration);
+		if (!arg->enumeration)
+			parse_error(parser, "out of memory");
+	}
+}
+
+static void
+start_enum(struct parser *parser, const char **atts)
+{
+	struct protocol_enum *en;
+	const char *name, *bitfield;
+
+	name = get_attribute(atts, "name");
+	if (!name) {
+		parse_error(parser, "enum needs a name");
+		return;
+	}
+
+	en = wl_array_add(&parser->interface->enums, sizeof *en);
+	if (!en) {
+		parse_error(parser, "out of memory");
+		return;
+	}
+
+	memset(en, 0, sizeof *en);
+	wl_array_init(&en->entries);
+
+	bitfield = get_attribute(atts, "bitfield");
+	en->bitfield = bitfield && strcmp(bitfield, "true") == 0;
+
+	en->name = strdup(name);
+	if (!en->name)
+		parse_error(parser, "out of memory");
+
+	parser->enumeration = en;
+}
+
+static void
+start_entry(struct parser *parser, const char **atts)
+{
+	struct protocol_entry *entry;
+	const char *name, *value;
+
+	name = get_attribute(atts, "name");
+	value = get_attribute(atts, "value");
+	if (!name || !value) {
+		parse_error(parser, "entry needs a name and a value");
+		return;
+	}
+
+	entry = wl_array_add(&parser->enumeration->entries, sizeof *entry);
+	if (!entry) {
+		parse_error(parser, "out of memory");
+		return;
+	}
+
+	/* the values are decimal or hexadecimal */
+	entry->value = strtoul(value, NULL, 0);
+	entry->name = strdup(name);
+	if (!entry->name)
+		parse_error(parser, "out of memory");
+}
+
+static void
+start_element(void *data, const char *element, const char **atts)
+{
+	struct parser *parser = data;
+
+	if (strcmp(element, "interface") == 0) {
+		start_interface(parser, atts);
+	} else if (strcmp(element, "request") == 0
+		   || strcmp(element, "event") == 0) {
+		if (!parser->interface) {
+			parse_error(parser, "message outside of interface");
+			return;
+		}
+
+		start_message(parser, element[0] == 'r'
+				? &parser->interface->methods
+				: &parser->interface->events, atts);
+	} else if (strcmp(element, "arg") == 0) {
+		if (!parser->message) {
+			parse_error(parser, "argument outside of message");
+			return;
+		}
+
+		start_arg(parser, atts);
+	} else if (strcmp(element, "enum") == 0) {
+		if (!parser->interface) {
+			parse_error(parser, "enum outside of interface");
+			return;
+		}
+
+		start_enum(parser, atts);
+	} else if (strcmp(element, "entry") == 0) {
+		if (!parser->enumeration) {
+			parse_error(parser, "entry outside of enum");
+			return;
+		}
+
+		start_entry(parser, atts);
+	}
+
+	/* we do not need descriptions and others */
+}
+
+static void
+end_element(void *data, const char *element)
+{
+	struct parser *parser = data;
+
+	if (strcmp(element, "interface") == 0)
+		parser->interface = NULL;
+	else if (strcmp(element, "request") == 0
+		 || strcmp(element, "event") == 0)
+		parser->message = NULL;
+	else if (strcmp(element, "enum") == 0)
+		parser->enumeration = NULL;
+}
+
+static void
+free_messages(struct wl_array *messages)
+{
+	struct protocol_message *msg;
+	struct protocol_arg *arg;
+
+	wl_array_for_each(msg, messages) {
+		wl_array_for_each(arg, &msg->args) {
+			free(arg->interface);
+			free(arg->enumeration);
+		}
+
+		wl_array_release(&msg->args);
+		free(msg->name);
+	}
+
+	wl_array_release(messages);
+}
+
+static void
+free_enums(struct wl_array *enums)
+{
+	struct protocol_enum *en;
+	struct protocol_entry *entry;
+
+	wl_array_for_each(en, enums) {
+		wl_array_for_each(entry, &en->entries)
+			free(entry->name);
+
+		wl_array_release(&en->entries);
+		free(en->name);
+	}
+
+	wl_array_release(enums);
+}
+
+/* free interfaces that start at the offset in the array */
+static void
+free_interfaces(struct wl_array *interfaces, size_t offset)
+{
+	struct protocol_interface *intf;
+
+	for (intf = (void *) ((char *) interfaces->data + offset);
+	     (char *) intf < (char *) interfaces->data + interfaces->size;
+	     ++intf) {
+		free_messages(&intf->methods);
+		free_messages(&intf->events);
+		free_enums(&intf->enums);
+		free(intf->name);
+	}
+
+	interfaces->size = offset;
+}
+
+static int
+parse_file(const char *path, unsigned int file, struct wl_array *interfaces)
+{
+	struct parser parser;
+	size_t offset = interfaces->size;
+	char buf[4096];
+	size_t len;
+	int done;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "Failed opening '%s': %s\n",
+			path, strerror(errno));
+		return -1;
+	}
+
+	memset(&parser, 0, sizeof parser);
+	parser.path = path;
+	parser.file = file;
+	parser.interfaces = interfaces;
+
+	parser.xml = XML_ParserCreate(NULL);
+	if (!parser.xml) {
+		fprintf(stderr, "Out of memory\n");
+		fclose(f);
+		return -1;
+	}
+
+	XML_SetUserData(parser.xml, &parser);
+	XML_SetElementHandler(parser.xml, start_element, end_element);
+
+	do {
+		len = fread(buf, 1, sizeof buf, f);
+		if (ferror(f)) {
+			fprintf(stderr, "Failed reading '%s'\n", path);
+			parser.error = 1;
+			break;
+		}
+
+		done = feof(f);
+		if (XML_Parse(parser.xml, buf, len, done) == XML_STATUS_ERROR) {
+			/* if we stopped the parser, we reported it already */
+			if (!parser.error)
+				fprintf(stderr, "%s:%lu: %s\n", path,
+					XML_GetCurrentLineNumber(parser.xml),
+					XML_ErrorString(
+						XML_GetErrorCode(parser.xml)));
+			parser.error = 1;
+			break;
+		}
+	} while (!done);
+
+	XML_ParserFree(parser.xml);
+	fclose(f);
+
+	/* do not keep a half of the protocol */
+	if (parser.error) {
+		free_interfaces(interfaces, offset);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Looking for the XML files
+ */
+
+static inline void
+fingerprint_add(uint64_t *fingerprint, const void *data, size_t len)
+{
+	*fingerprint = wldbg_fnv64(*fingerprint, data, len);
+}
+
+static int
+has_xml_suffix(const char *path)
+{
+	size_t len = strlen(path);
+
+	return len > 4 && strcmp(path + len - 4, ".xml") == 0;
+}
+
+static int
+add_file(struct wl_array *files, uint64_t *fingerprint,
+	 const char *path, const struct stat *st)
+{
+	char **p;
+
+	p = wl_array_add(files, sizeof *p);
+	if (!p)
+		return -1;
+
+	*p = strdup(path);
+	if (!*p) {
+		files->size -= sizeof *p;
+		return -1;
+	}
+
+	/* when any of the files is changed, added or removed,
+	 * the fingerprint changes and we rebuild the cache */
+	fingerprint_add(fingerprint, path, strlen(path) + 1);
+	fingerprint_add(fingerprint, &st->st_size, sizeof st->st_size);
+	fingerprint_add(fingerprint, &st->st_mtim.tv_sec,
+			sizeof st->st_mtim.tv_sec);
+	fingerprint_add(fingerprint, &st->st_mtim.tv_nsec,
+			sizeof st->st_mtim.tv_nsec);
+
+	return 0;
+}
+
+/* type is d_type of the directory entry, so that
+ * we do not need to stat directories */
+static int
+collect_files(struct wl_array *files, uint64_t *fingerprint,
+	      const char *path, unsigned char type, int depth)
+{
+	struct dirent **entries, *entry;
+	struct stat st;
+	char *sub;
+	int n, i, ret = 0;
+
+	if (type == DT_DIR)
+		goto directory;
+
+	if (stat(path, &st) < 0) {
+		/* it is fine if some of the directories is not there */
+		if (errno != ENOENT)
+			fprintf(stderr, "Failed accessing '%s': %s\n",
+				path, strerror(errno));
+		return 0;
+	}
+
+	/* files given by the user are loaded whatever the name is,
+	 * but from directories we take only the XML files */
+	if (S_ISREG(st.st_mode)) {
+		if (depth > 0 && !has_xml_suffix(path))
+			return 0;
+
+		return add_file(files, fingerprint, path, &st);
+	}
+
+	if (!S_ISDIR(st.st_mode))
+		return 0;
+
+directory:
+	if (depth >= MAX_DEPTH)
+		return 0;
+
+	/* sort the entries, so that the order in which
+	 * we register the interfaces is always the same */
+	n = scandir(path, &entries, NULL, alphasort);
+	if (n < 0) {
+		fprintf(stderr, "Failed reading directory '%s': %s\n",
+			path, strerror(errno));
+		return 0;
+	}
+
+	for (i = 0; i < n; ++i) {
+		entry = entries[i];
+
+		if (ret == 0 && entry->d_name[0] != '.'
+		    && !(entry->d_type == DT_REG
+			 && !has_xml_suffix(entry->d_name))) {
+			if (asprintf(&sub, "%s/%s", path, entry->d_name) < 0) {
+				ret = -1;
+			} else {
+				ret = collect_files(files, fingerprint, sub,
+						    entry->d_type, depth + 1);
+				free(sub);
+			}
+		}
+
+		free(entry);
+	}
+
+	free(entries);
+
+	return ret;
+}
+
+/*
+ * The cache
+ *
+ * The cache file is an image of the wl_interface tables in the native
+ * layout: a header, wl_interface array, wl_message arrays, types arrays,
+ * relocations and strings. After the types, there are enums with their
+ * entries and the list of arguments that are enums, so that we can
+ * print the names of values instead of numbers (see wldbg-printers.h).
+ * The pointers in the image are offsets from
+ * the beginning of the image and every pointer has its relocation.
+ * Loading the cache is just mapping it privately and adding the
+ * address of the mapping to the pointers.
+ */
+
+#define CACHE_MAGIC "WLDBGPC"
+#define CACHE_VERSION 2
+
+struct cache_header {
+	char magic[8];
+	/* the image is in the native byte order and layout,
+	 * so check that it was created by the same build */
+	uint32_t version;
+	uint16_t pointer_size;
+	uint16_t interface_size;
+	uint16_t message_size;
+	uint16_t reloc_size;
+	uint16_t enum_size;
+	uint16_t enum_arg_size;
+
+	uint32_t size;
+	uint32_t interfaces;
+	uint32_t interface_count;
+	uint32_t relocs;
+	uint32_t reloc_count;
+	uint32_t enum_args;
+	uint32_t enum_arg_count;
+
+	uint64_t fingerprint;
+};
+
+/* argument of a message that has values from an enum */
+struct cache_enum_arg {
+	const struct wl_interface *interface;
+	const struct wl_message *message;
+	const struct wldbg_enum *enumeration;
+	/* SERVER for events, CLIENT for requests */
+	uint32_t from;
+	/* index of the argument in the signature */
+	uint32_t arg;
+};
+
+enum reloc_type {
+	/* the pointer is an offset in the image */
+	RELOC_OFFSET,
+	/* the pointer is an offset of the name of interface that
+	 * is not in the image, we look it up in the registry */
+	RELOC_INTERFACE_NAME,
+};
+
+struct cache_reloc {
+	uint32_t offset;
+	uint32_t type;
+};
+
+struct image {
+	char *data;
+	size_t size;
+
+	/* where the next string goes */
+	size_t strings;
+	struct cache_reloc *relocs;
+	uint32_t reloc_count;
+};
+
+/* the loaded image, either mapped or allocated */
+static struct {
+	char *data;
+	size_t size;
+	int mapped;
+} loaded;
+
+static size_t
+image_add_string(struct image *img, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	size_t offset = img->strings;
+
+	memcpy(img->data + offset, str, len);
+	img->strings += len;
+
+	return offset;
+}
+
+static void
+image_set_pointer(struct image *img, void *field,
+		  size_t target, enum reloc_type type)
+{
+	uintptr_t val = target;
+	struct cache_reloc *reloc;
+
+	memcpy(field, &val, sizeof val);
+
+	reloc = &img->relocs[img->reloc_count++];
+	reloc->offset = (char *) field - img->data;
+	reloc->type = type;
+}
+
+/* write signature of the message to buf (if not NULL)
+ * and return its length */
+static size_t
+message_signature(const struct protocol_message *msg, char *buf)
+{
+	const struct protocol_arg *arg;
+	char since[16];
+	size_t len = 0;
+
+#define PUT(c) do { if (buf) buf[len] = (c); ++len; } while (0)
+
+	if (msg->since > 1) {
+		snprintf(since, sizeof since, "%d", msg->since);
+		if (buf)
+			strcpy(buf, since);
+		len = strlen(since);
+	}
+
+	wl_array_for_each(arg, &msg->args) {
+		if (arg->nullable)
+			PUT('?');
+
+		/* new id without interface goes with
+		 * the interface name and version */
+		if (arg->type == 'n' && !arg->interface) {
+			PUT('s');
+			PUT('u');
+		}
+
+		PUT(arg->type);
+	}
+
+	PUT('\0');
+
+#undef PUT
+
+	return len - 1;
+}
+
+/* number of entries in types array of the message. Every message
+ * gets at least one entry, so that types is never NULL */
+static size_t
+message_types(const struct protocol_message *msg)
+{
+	const struct protocol_arg *arg;
+	size_t n = 0;
+
+	wl_array_for_each(arg, &msg->args)
+		n += (arg->type == 'n' && !arg->interface) ? 3 : 1;
+
+	return n ? n : 1;
+}
+
+static int
+find_interface(struct wl_array *interfaces, const char *name,
+	       unsigned int file)
+{
+	struct protocol_interface *intf;
+	int i = 0, found = -1;
+
+	wl_array_for_each(intf, interfaces) {
+		if (strcmp(intf->name, name) == 0) {
+			if (intf->file == file)
+				return i;
+
+			if (found < 0)
+				found = i;
+		}
+
+		++i;
+	}
+
+	return found;
+}
+
+/* return the index of the enum in all enums in the image or -1.
+ * The name is "enum" from the interface or "interface.enum" */
+static int
+find_enum(struct wl_array *interfaces, struct protocol_interface *pi,
+	  const char *name)
+{
+	struct protocol_enum *en;
+	const char *dot;
+	char *intf_name;
+	int idx, i = 0;
+
+	dot = strchr(name, '.');
+	if (dot) {
+		intf_name = strndup(name, dot - name);
+		if (!intf_name)
+			return -1;
+
+		idx = find_interface(interfaces, intf_name, pi->file);
+		free(intf_name);
+		if (idx < 0)
+			return -1;
+
+		pi = (struct protocol_interface *) interfaces->data + idx;
+		name = dot + 1;
+	}
+
+	wl_array_for_each(en, &pi->enums) {
+		if (strcmp(en->name, name) == 0)
+			return pi->first_enum + i;
+
+		++i;
+	}
+
+	return -1;
+}
+
+struct image_layout {
+	size_t interfaces;
+	size_t messages;
+	size_t types;
+	size_t enums;
+	size_t entries;
+	size_t enum_args;
+	size_t relocs;
+	size_t strings;
+	size_t size;
+};
+
+/* add the argument to the list of enum arguments if its enum exists */
+static void
+fill_enum_arg(struct image *img, struct image_layout *layout,
+	      struct wl_array *interfaces, struct protocol_interface *pi,
+	      size_t intf, size_t message, int from,
+	      const struct protocol_arg *arg, unsigned int pos)
+{
+	struct cache_enum_arg *ea;
+	int idx;
+
+	idx = find_enum(interfaces, pi, arg->enumeration);
+	if (idx < 0)
+		return;
+
+	ea = (struct cache_enum_arg *) (img->data + layout->enum_args);
+	layout->enum_args += sizeof *ea;
+
+	image_set_pointer(img, &ea->interface, intf, RELOC_OFFSET);
+	image_set_pointer(img, &ea->message, message, RELOC_OFFSET);
+	image_set_pointer(img, &ea->enumeration,
+			  layout->enums + idx * sizeof(struct wldbg_enum),
+			  RELOC_OFFSET);
+	ea->from = from;
+	ea->arg = pos;
+}
+
+static void
+fill_messages(struct image *img, struct image_layout *layout,
+	      struct wl_array *interfaces, struct protocol_interface *pi,
+	      size_t intf, int from, struct wl_array *messages)
+{
+	struct protocol_message *msg;
+	struct protocol_arg *arg;
+	struct wl_message *wm;
+	size_t types, len;
+	unsigned int pos;
+	int idx;
+
+	wl_array_for_each(msg, messages) {
+		wm = (struct wl_message *) (img->data + layout->messages);
+		layout->messages += sizeof *wm;
+
+		pos = 0;
+		wl_array_for_each(arg, &msg->args) {
+			if (arg->enumeration)
+				fill_enum_arg(img, layout, interfaces, pi, intf,
+					      (char *) wm - img->data, from,
+					      arg, pos);
+
+			/* new id without interface is "sun" */
+			pos += (arg->type == 'n' && !arg->interface) ? 3 : 1;
+		}
+
+		image_set_pointer(img, &wm->name,
+				  image_add_string(img, msg->name),
+				  RELOC_OFFSET);
+
+		len = message_signature(msg, img->data + img->strings);
+		image_set_pointer(img, &wm->signature, img->strings,
+				  RELOC_OFFSET);
+		img->strings += len + 1;
+
+		image_set_pointer(img, &wm->types, layout->types,
+				  RELOC_OFFSET);
+
+		types = layout->types;
+		layout->types += message_types(msg) * sizeof(void *);
+
+		wl_array_for_each(arg, &msg->args) {
+			if (arg->type == 'n' && !arg->interface) {
+				types += 3 * sizeof(void *);
+				continue;
+			}
+
+			if (arg->interface) {
+				idx = find_interface(interfaces,
+						     arg->interface, pi->file);
+				if (idx >= 0)
+					image_set_pointer(img,
+						img->data + types,
+						layout->interfaces + idx
+						* sizeof(struct wl_interface),
+						RELOC_OFFSET);
+				else
+					image_set_pointer(img,
+						img->data + types,
+						image_add_string(img,
+							arg->interface),
+						RELOC_INTERFACE_NAME);
+			}
+
+			types += sizeof(void *);
+		}
+	}
+}
+
+static int
+build_image(struct wl_array *interfaces, uint64_t fingerprint,
+	    struct image *img)
+{
+	struct protocol_interface *pi;
+	struct protocol_message *msg;
+	struct protocol_arg *arg;
+	struct protocol_enum *en;
+	struct protocol_entry *entry;
+	struct image_layout layout;
+	struct cache_header *header;
+	struct wl_interface *wi;
+	struct wldbg_enum *we;
+	struct wldbg_enum_entry *wee;
+	size_t intf_num = 0, msg_num = 0, types_num = 0;
+	size_t enum_num = 0, entry_num = 0, enum_arg_num = 0;
+	size_t strings = 0, relocs_num = 0;
+	struct wl_array *arrays[2];
+	int i, k;
+
+	wl_array_for_each(pi, interfaces) {
+		++intf_num;
+		strings += strlen(pi->name) + 1;
+		/* name, methods and events */
+		relocs_num += 1 + !!pi->methods.size + !!pi->events.size;
+
+		pi->first_enum = enum_num;
+		wl_array_for_each(en, &pi->enums) {
+			++enum_num;
+			strings += strlen(en->name) + 1;
+			/* name and entries */
+			relocs_num += 2;
+
+			wl_array_for_each(entry, &en->entries) {
+				++entry_num;
+				strings += strlen(entry->name) + 1;
+				++relocs_num;
+			}
+		}
+
+		arrays[0] = &pi->methods;
+		arrays[1] = &pi->events;
+		for (k = 0; k < 2; ++k) {
+			wl_array_for_each(msg, arrays[k]) {
+				++msg_num;
+				types_num += message_types(msg);
+				strings += strlen(msg->name) + 1;
+				strings += message_signature(msg, NULL) + 1;
+				/* name, signature and types */
+				relocs_num += 3;
+
+				/* the names are an upper bound, most of
+				 * the interfaces are in the image */
+				wl_array_for_each(arg, &msg->args) {
+					if (arg->interface) {
+						strings += strlen(arg->interface) + 1;
+						++relocs_num;
+					}
+
+					/* upper bound too, the enum
+					 * does not have to exist.
+					 * interface, message and enum */
+					if (arg->enumeration) {
+						++enum_arg_num;
+						relocs_num += 3;
+					}
+				}
+			}
+		}
+	}
+
+	layout.interfaces = ALIGN(sizeof(struct cache_header));
+	layout.messages = layout.interfaces
+			  + intf_num * sizeof(struct wl_interface);
+	layout.types = layout.messages + msg_num * sizeof(struct wl_message);
+	layout.enums = ALIGN(layout.types + types_num * sizeof(void *));
+	layout.entries = ALIGN(layout.enums
+			       + enum_num * sizeof(struct wldbg_enum));
+	layout.enum_args = ALIGN(layout.entries
+				 + entry_num * sizeof(struct wldbg_enum_entry));
+	layout.relocs = ALIGN(layout.enum_args
+			      + enum_arg_num * sizeof(struct cache_enum_arg));
+	layout.strings = layout.relocs + relocs_num * sizeof(struct cache_reloc);
+	layout.size = layout.strings + strings;
+
+	if (layout.size > UINT32_MAX) {
+		fprintf(stderr, "Protocols are too big\n");
+		return -1;
+	}
+
+	memset(img, 0, sizeof *img);
+	img->data = calloc(1, layout.size);
+	if (!img->data) {
+		fprintf(stderr, "Out of memory\n");
+		return -1;
+	}
+
+	img->strings = layout.strings;
+	img->relocs = (struct cache_reloc *) (img->data + layout.relocs);
+
+	header = (struct cache_header *) img->data;
+	memcpy(header->magic, CACHE_MAGIC, sizeof header->magic);
+	header->version = CACHE_VERSION;
+	header->pointer_size = sizeof(void *);
+	header->interface_size = sizeof(struct wl_interface);
+	header->message_size = sizeof(struct wl_message);
+	header->reloc_size = sizeof(struct cache_reloc);
+	header->enum_size = sizeof(struct wldbg_enum);
+	header->enum_arg_size = sizeof(struct cache_enum_arg);
+	header->enum_args = layout.enum_args;
+	header->interfaces = layout.interfaces;
+	header->interface_count = intf_num;
+	header->relocs = layout.relocs;
+	header->fingerprint = fingerprint;
+
+	/* the enums go first, the messages point to them */
+	we = (struct wldbg_enum *) (img->data + layout.enums);
+	wee = (struct wldbg_enum_entry *) (img->data + layout.entries);
+	wl_array_for_each(pi, interfaces) {
+		wl_array_for_each(en, &pi->enums) {
+			image_set_pointer(img, &we->name,
+					  image_add_string(img, en->name),
+					  RELOC_OFFSET);
+			we->bitfield = en->bitfield;
+			we->entry_count = en->entries.size / sizeof *entry;
+			image_set_pointer(img, &we->entries,
+					  (char *) wee - img->data,
+					  RELOC_OFFSET);
+
+			wl_array_for_each(entry, &en->entries) {
+				image_set_pointer(img, &wee->name,
+						  image_add_string(img,
+								   entry->name),
+						  RELOC_OFFSET);
+				wee->value = entry->value;
+				++wee;
+			}
+
+			++we;
+		}
+	}
+
+	wi = (struct wl_interface *) (img->data + layout.interfaces);
+	i = 0;
+	wl_array_for_each(pi, interfaces) {
+		image_set_pointer(img, &wi[i].name,
+				  image_add_string(img, pi->name),
+				  RELOC_OFFSET);
+		wi[i].version = pi->version;
+
+		wi[i].method_count = pi->methods.size / sizeof *msg;
+		if (wi[i].method_count)
+			image_set_pointer(img, &wi[i].methods,
+					  layout.messages, RELOC_OFFSET);
+		fill_messages(img, &layout, interfaces, pi,
+			      (char *) &wi[i] - img->data, CLIENT,
+			      &pi->methods);
+
+		wi[i].event_count = pi->events.size / sizeof *msg;
+		if (wi[i].event_count)
+			image_set_pointer(img, &wi[i].events,
+					  layout.messages, RELOC_OFFSET);
+		fill_messages(img, &layout, interfaces, pi,
+			      (char *) &wi[i] - img->data, SERVER,
+			      &pi->events);
+
+		++i;
+	}
+
+	/* strings were an upper bound */
+	img->size = img->strings;
+	header->size = img->size;
+	header->reloc_count = img->reloc_count;
+	header->enum_arg_count = (layout.enum_args - header->enum_args)
+				 / sizeof(struct cache_enum_arg);
+
+	return 0;
+}
+
+static int
+check_header(const char *data, size_t size, uint64_t fingerprint)
+{
+	const struct cache_header *header = (const void *) data;
+
+	if (size < sizeof *header
+	    || memcmp(header->magic, CACHE_MAGIC, sizeof header->magic) != 0
+	    || header->version != CACHE_VERSION
+	    || header->pointer_size != sizeof(void *)
+	    || header->interface_size != sizeof(struct wl_interface)
+	    || header->message_size != sizeof(struct wl_message)
+	    || header->reloc_size != sizeof(struct cache_reloc)
+	    || header->enum_size != sizeof(struct wldbg_enum)
+	    || header->enum_arg_size != sizeof(struct cache_enum_arg)
+	    || header->size != size
+	    || header->fingerprint != fingerprint)
+		return -1;
+
+	if (header->interfaces > size
+	    || header->interface_count
+	       > (size - header->interfaces) / sizeof(struct wl_interface)
+	    || header->relocs > size
+	    || header->reloc_count
+	       > (size - header->relocs) / sizeof(struct cache_reloc)
+	    || header->enum_args > size
+	    || header->enum_arg_count
+	       > (size - header->enum_args) / sizeof(struct cache_enum_arg))
+		return -1;
+
+	return 0;
+}
+
+static int
+relocate(char *data, size_t size)
+{
+	const struct cache_header *header = (const void *) data;
+	const struct cache_reloc *reloc;
+	uintptr_t val;
+	uint32_t i;
+
+	reloc = (const struct cache_reloc *) (data + header->relocs);
+	for (i = 0; i < header->reloc_count; ++i, ++reloc) {
+		if (reloc->offset > size - sizeof val)
+			return -1;
+
+		memcpy(&val, data + reloc->offset, sizeof val);
+		if (val >= size)
+			return -1;
+
+		switch (reloc->type) {
+		case RELOC_OFFSET:
+			val = (uintptr_t) (data + val);
+			break;
+		case RELOC_INTERFACE_NAME:
+			if (!memchr(data + val, '\0', size - val))
+				return -1;
+
+			/* NULL if we do not know it,
+			 * that is what libwayland does too */
+			val = (uintptr_t) wldbg_interfaces_lookup(data + val);
+			break;
+		default:
+			return -1;
+		}
+
+		memcpy(data + reloc->offset, &val, sizeof val);
+	}
+
+	return 0;
+}
+
+static int
+load_cache(const char *path, uint64_t fingerprint)
+{
+	struct stat st;
+	char *data;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+
+	if (fstat(fd, &st) < 0
+	    || (size_t) st.st_size < sizeof(struct cache_header)) {
+		close(fd);
+		return -1;
+	}
+
+	/* private mapping, so that we can relocate the pointers */
+	data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return -1;
+
+	if (check_header(data, st.st_size, fingerprint) < 0
+	    || relocate(data, st.st_size) < 0) {
+		munmap(data, st.st_size);
+		return -1;
+	}
+
+	loaded.data = data;
+	loaded.size = st.st_size;
+	loaded.mapped = 1;
+
+	return 0;
+}
+
+/* create the directories on the path to the file */
+static void
+create_directories(const char *path)
+{
+	char *dir, *slash;
+
+	dir = strdup(path);
+	if (!dir)
+		return;
+
+	for (slash = strchr(dir + 1, '/'); slash;
+	     slash = strchr(slash + 1, '/')) {
+		*slash = '\0';
+		mkdir(dir, 0700);
+		*slash = '/';
+	}
+
+	free(dir);
+}
+
+/* if we fail writing the cache, we just parse the XML files next
+ * time again, so the errors here are not fatal */
+static void
+write_cache(const char *path, const struct image *img)
+{
+	char *tmp;
+	size_t written = 0;
+	ssize_t ret;
+	int fd;
+
+	create_directories(path);
+
+	if (asprintf(&tmp, "%s.XXXXXX", path) < 0)
+		return;
+
+	fd = mkostemp(tmp, O_CLOEXEC);
+	if (fd < 0)
+		goto err;
+
+	while (written < img->size) {
+		ret = write(fd, img->data + written, img->size - written);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			close(fd);
+			unlink(tmp);
+			goto err;
+		}
+
+		written += ret;
+	}
+
+	close(fd);
+
+	/* rename the file in one step, so that nobody
+	 * maps a half-written cache */
+	if (rename(tmp, path) < 0) {
+		unlink(tmp);
+		goto err;
+	}
+
+	free(tmp);
+	return;
+
+err:
+	fprintf(stderr, "Failed writing protocols cache '%s': %s\n",
+		path, strerror(errno));
+	free(tmp);
+}
+
+static int
+register_interfaces(void)
+{
+	const struct cache_header *header = (const void *) loaded.data;
+	const struct wl_interface *intf;
+	const struct cache_enum_arg *ea;
+	uint32_t i;
+
+	intf = (const struct wl_interface *) (loaded.data + header->interfaces);
+	for (i = 0; i < header->interface_count; ++i)
+		wldbg_interfaces_register(&intf[i]);
+
+	/* the printers find the messages by names, so they work
+	 * also with the interfaces from libwayland that are kept
+	 * in the registry instead of ours */
+	ea = (const struct cache_enum_arg *) (loaded.data + header->enum_args);
+	for (i = 0; i < header->enum_arg_count; ++i)
+		if (wldbg_printers_add_enum(ea[i].interface->name,
+					    ea[i].message->name,
+					    ea[i].from, ea[i].arg,
+					    ea[i].enumeration,
+					    WLDBG_PRINTER_PROTOCOL) < 0)
+			fprintf(stderr, "Out of memory, printing "
+				"enums as numbers\n");
+
+	return header->interface_count;
+}
+
+static int
+load_files(struct wl_array *files, uint64_t fingerprint, const char *cache)
+{
+	struct wl_array interfaces;
+	struct image img;
+	unsigned int file = 0;
+	char **path;
+	int ret = -1;
+
+	wl_array_init(&interfaces);
+
+	/* files with errors are just skipped */
+	wl_array_for_each(path, files)
+		parse_file(*path, file++, &interfaces);
+
+	if (build_image(&interfaces, fingerprint, &img) < 0)
+		goto out;
+
+	/* write the image before we relocate it */
+	if (cache)
+		write_cache(cache, &img);
+
+	if (relocate(img.data, img.size) < 0) {
+		/* we've just created it, so this is a bug */
+		fprintf(stderr, "BUG: invalid protocols image\n");
+		free(img.data);
+		goto out;
+	}
+
+	loaded.data = img.data;
+	loaded.size = img.size;
+	loaded.mapped = 0;
+	ret = 0;
+
+out:
+	free_interfaces(&interfaces, 0);
+	wl_array_release(&interfaces);
+
+	return ret;
+}
+
+int
+wldbg_protocols_load(const char *paths, const char *cache)
+{
+	struct wl_array files;
+	uint64_t fingerprint = WLDBG_FNV64_BASIS;
+	char *dup, *path, *saveptr;
+	char **file;
+	int ret = -1;
+
+	if (loaded.data) {
+		fprintf(stderr, "Protocols are already loaded\n");
+		return -1;
+	}
+
+	dup = strdup(paths);
+	if (!dup) {
+		fprintf(stderr, "Out of memory\n");
+		return -1;
+	}
+
+	wl_array_init(&files);
+
+	for (path = strtok_r(dup, ":", &saveptr); path;
+	     path = strtok_r(NULL, ":", &saveptr)) {
+		if (collect_files(&files, &fingerprint,
+				  path, DT_UNKNOWN, 0) < 0) {
+			fprintf(stderr, "Out of memory\n");
+			goto out;
+		}
+	}
+
+	if (files.size == 0) {
+		ret = 0;
+		goto out;
+	}
+
+	if (!cache || load_cache(cache, fingerprint) < 0)
+		if (load_files(&files, fingerprint, cache) < 0)
+			goto out;
+
+	ret = register_interfaces();
+
+out:
+	wl_array_for_each(file, &files)
+		free(*file);
+	wl_array_release(&files);
+	free(dup);
+
+	return ret;
+}
+
+const char *
+wldbg_protocols_cache_path(void)
+{
+	static char path[PATH_MAX];
+	const char *dir;
+	int len;
+
+	dir = getenv("XDG_CACHE_HOME");
+	if (dir && *dir) {
+		len = snprintf(path, sizeof path, "%s/wldbg/protocols", dir);
+	} else {
+		dir = getenv("HOME");
+		if (!dir || !*dir)
+			return NULL;
+
+		len = snprintf(path, sizeof path,
+			       "%s/.cache/wldbg/protocols", dir);
+	}
+
+	if (len < 0 || (size_t) len >= sizeof path)
+		return NULL;
+
+	return path;
+}
+
+void
+wldbg_protocols_release(void)
+{
+	if (!loaded.data)
+		return;
+
+	if (loaded.mapped)
+		munmap(loaded.data, loaded.size);
+	else
+		free(loaded.data);
+
+	memset(&loaded, 0, sizeof loaded);
+}
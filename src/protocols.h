@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WLDBG_PROTOCOLS_H_
+#define _WLDBG_PROTOCOLS_H_
+
+/*
+ * Protocol descriptions loaded at runtime. We parse the XML files
+ * of the protocols, build wl_interface tables from them and add the
+ * interfaces to the registry (wldbg-interfaces.h), so that we can
+ * resolve objects from protocols that libwayland does not know.
+ *
+ * Parsing all the XML files on every start would be slow, so the
+ * tables are saved to a cache file which we just mmap next time.
+ * The cache is rebuilt whenever some of the XML files change.
+ */
+
+/* paths is a colon-separated list of XML files and directories
+ * that are searched (recursively) for *.xml files. Paths that do
+ * not exist are skipped. If cache is not NULL, it is a path to
+ * the cache file.
+ * Returns the number of loaded interfaces or -1 on error */
+int
+wldbg_protocols_load(const char *paths, const char *cache);
+
+/* default path to the cache file, NULL if we can not find out */
+const char *
+wldbg_protocols_cache_path(void);
+
+/* free the loaded tables. Interfaces must be removed
+ * from the registry before this is called */
+void
+wldbg_protocols_release(void);
+
+#endif /* _WLDBG_PROTOCOLS_H_ */
@@ -0,0 +1,1163 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Replaying of recorded sessions (see the record pass).
+ *
+ * The requests of every recorded connection are sent to the compositor
+ * through a new connection. Before sending the requests we go through
+ * the trace and find the events that the client had to wait for:
+ * wl_callback.done, the events that created objects used by later
+ * requests and the events whose values (serials, names of globals)
+ * are used by later requests. When the replay comes to such an event,
+ * it waits until the compositor sends the same event and remembers
+ * the ids and values that the compositor used instead of the recorded
+ * ones. These are then replaced in the following requests.
+ *
+ * We do not know which unsigned arguments are serials, so every
+ * unsigned argument without a printer (that is not an enum) is
+ * replaced if it has the value of an argument of such an event.
+ */
+
+#define _GNU_SOURCE
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <wayland-server-protocol.h>
+
+#include "wldbg-private.h"
+#include "wldbg-trace.h"
+#include "wldbg-printers.h"
+#include "wldbg-message-layout.h"
+#include "wayland/wayland-private.h"
+#include "resolve.h"
+#include "sockets.h"
+#include "replay.h"
+#include "util.h"
+
+/* how long we wait for an event that the client waited for */
+#define REPLAY_DEFAULT_TIMEOUT_MS 1000
+/* the most events from the compositor that we keep for matching */
+#define REPLAY_MAX_QUEUED_EVENTS 4096
+/* size of the files that we send instead of the recorded fds */
+#define REPLAY_FD_SIZE (64 * 1024 * 1024)
+/* how long we listen for errors after the last request */
+#define REPLAY_LINGER_NS (100 * 1000 * 1000ULL)
+
+#define SERVER_ID_START 0xff000000
+
+struct replay_options {
+	const char *file;
+	/* 0 means as fast as possible */
+	double speed;
+	unsigned int parallel;
+	/* replay only this connection, 0 for all */
+	uint32_t connection;
+	uint64_t timeout;
+};
+
+/* hash table uint32_t -> uint64_t */
+struct value_entry {
+	uint32_t key;
+	uint32_t used;
+	uint64_t value;
+};
+
+struct value_map {
+	struct value_entry *entries;
+	uint32_t count;
+	uint32_t size;
+};
+
+struct queued_event {
+	struct wl_list link;
+	/* the message of the event, resolved when it came */
+	const struct wl_message *message;
+	uint32_t size;
+	uint32_t data[];
+};
+
+struct replay_connection {
+	/* id of the connection in the trace */
+	uint32_t id;
+
+	/* objects of the recorded connection and of the replayed one.
+	 * The replayed one has also the socket to the compositor */
+	struct wldbg_connection recorded;
+	struct wldbg_connection live;
+	int connected;
+	/* the compositor sent an error or closed the connection */
+	int broken;
+
+	/* When preparing the replay, these map the ids and values
+	 * to the sequence numbers of the events that brought them.
+	 * When replaying, they map recorded ids of objects created
+	 * by the compositor and recorded values to the live ones */
+	struct value_map ids;
+	struct value_map values;
+
+	/* events from the compositor that were not matched yet */
+	struct wl_list events;
+	unsigned int events_count;
+
+	struct wl_list link;
+};
+
+struct replay {
+	struct replay_options *options;
+	struct wldbg_trace *trace;
+	struct wldbg_trace_cursor cursor;
+	/* number of this replay when running more in parallel */
+	unsigned int index;
+
+	/* awaited[seq] is 1 if the client waited for the event */
+	uint8_t *awaited;
+	/* values of requests, used only when preparing */
+	struct value_map request_values;
+
+	struct wl_list connections;
+	/* the request with translated ids and values */
+	uint32_t *buffer;
+	size_t buffer_size;
+
+	uint64_t requests;
+	uint64_t awaited_count;
+	uint64_t missed;
+};
+
+static uint32_t
+hash_value(uint32_t key)
+{
+	key ^= key >> 16;
+	key *= 0x45d9f3b;
+	key ^= key >> 16;
+	return key;
+}
+
+static int
+value_map_set(struct value_map *map, uint32_t key, uint64_t value)
+{
+	struct value_entry *entries, *e;
+	uint32_t size, i, j;
+
+	if (2 * (map->count + 1) > map->size) {
+		size = map->size ? map->size * 2 : 64;
+		entries = calloc(size, sizeof *entries);
+		if (!entries)
+			return -1;
+
+		for (i = 0; i < map->size; ++i) {
+			if (!map->entries[i].used)
+				continue;
+
+			j = hash_value(map->entries[i].key) & (size - 1);
+			while (entries[j].used)
+				j = (j + 1) & (size - 1);
+			entries[j] = map->entries[i];
+		}
+
+		free(map->entries);
+		map->entries = entries;
+		map->size = size;
+	}
+
+	i = hash_value(key) & (map->size - 1);
+	for (e = &map->entries[i]; e->used; e = &map->entries[i]) {
+		if (e->key == key) {
+			e->value = value;
+			return 0;
+		}
+
+		i = (i + 1) & (map->size - 1);
+	}
+
+	e->key = key;
+	e->used = 1;
+	e->value = value;
+	++map->count;
+
+	return 0;
+}
+
+static int
+value_map_get(struct value_map *map, uint32_t key, uint64_t *value)
+{
+	struct value_entry *e;
+	uint32_t i;
+
+	if (map->count == 0)
+		return 0;
+
+	i = hash_value(key) & (map->size - 1);
+	for (e = &map->entries[i]; e->used; e = &map->entries[i]) {
+		if (e->key == key) {
+			*value = e->value;
+			return 1;
+		}
+
+		i = (i + 1) & (map->size - 1);
+	}
+
+	return 0;
+}
+
+static void
+value_map_release(struct value_map *map)
+{
+	free(map->entries);
+	memset(map, 0, sizeof *map);
+}
+
+static void
+replay_connection_destroy(struct replay_connection *rc)
+{
+	struct queued_event *ev, *tmp;
+
+	wl_list_for_each_safe(ev, tmp, &rc->events, link)
+		free(ev);
+
+	destroy_resolved_objects(rc->recorded.resolved_objects);
+	wldbg_object_table_release(&rc->recorded.objects);
+	destroy_resolved_objects(rc->live.resolved_objects);
+	wldbg_object_table_release(&rc->live.objects);
+
+	if (rc->connected)
+		wl_connection_destroy(rc->live.server.connection);
+
+	value_map_release(&rc->ids);
+	value_map_release(&rc->values);
+
+	wl_list_remove(&rc->link);
+	free(rc);
+}
+
+static void
+destroy_connections(struct replay *replay)
+{
+	struct replay_connection *rc, *tmp;
+
+	wl_list_for_each_safe(rc, tmp, &replay->connections, link)
+		replay_connection_destroy(rc);
+}
+
+static struct replay_connection *
+get_connection(struct replay *replay, uint32_t id)
+{
+	struct replay_connection *rc;
+
+	wl_list_for_each(rc, &replay->connections, link)
+		if (rc->id == id)
+			return rc;
+
+	rc = calloc(1, sizeof *rc);
+	if (!rc) {
+		fprintf(stderr, "Out of memory\n");
+		return NULL;
+	}
+
+	rc->id = id;
+	wl_list_init(&rc->events);
+	wldbg_object_table_init(&rc->recorded.objects);
+	wldbg_object_table_init(&rc->live.objects);
+	wl_list_insert(replay->connections.prev, &rc->link);
+
+	rc->recorded.resolved_objects
+		= create_resolved_objects(NULL, &rc->recorded.objects);
+	rc->live.resolved_objects
+		= create_resolved_objects(NULL, &rc->live.objects);
+	if (!rc->recorded.resolved_objects || !rc->live.resolved_objects) {
+		replay_connection_destroy(rc);
+		return NULL;
+	}
+
+	return rc;
+}
+
+static void
+init_message(struct wldbg_message *message, struct wldbg_connection *conn,
+	     const void *data, size_t size, int from)
+{
+	memset(message, 0, sizeof *message);
+	message->data = (void *) data;
+	message->size = size;
+	message->from = from;
+	message->connection = conn;
+}
+
+/* unsigned arguments that can be serials or names of globals */
+static int
+is_value(const struct wldbg_resolved_arg *arg,
+	 const struct wldbg_arg_format *formats, unsigned int i)
+{
+	if (arg->type != 'u' || !arg->data || *arg->data == 0)
+		return 0;
+
+	/* enums and similar */
+	return !formats || !formats[i].print;
+}
+
+static const struct wldbg_arg_format *
+get_formats(struct wldbg_message *message)
+{
+	struct wldbg_resolved_message rm;
+
+	if (!wldbg_resolve_message(message, &rm))
+		return NULL;
+
+	return wldbg_printers_get(wldbg_message_get_interface_index(message),
+				  rm.wl_interface, message->from,
+				  rm.base.opcode);
+}
+
+/* the first pass: values that the client sends in requests */
+static int
+collect_request_values(struct replay *replay, struct replay_connection *rc,
+		       struct wldbg_message *message)
+{
+	const struct wldbg_resolved_arg *args;
+	const struct wldbg_arg_format *formats;
+	unsigned int count, i;
+
+	args = wldbg_message_get_arguments(message, &count);
+	formats = get_formats(message);
+
+	for (i = 0; i < count; ++i) {
+		if (is_value(&args[i], formats, i)
+		    && value_map_set(&replay->request_values,
+				     *args[i].data, 1) < 0)
+			return -1;
+	}
+
+	(void) rc;
+	return 0;
+}
+
+/* the second pass: remember what events brought */
+static int
+note_event(struct replay *replay, struct replay_connection *rc,
+	   struct wldbg_message *message, uint64_t seq)
+{
+	const struct wldbg_resolved_arg *args;
+	const struct wldbg_arg_format *formats;
+	struct wldbg_resolved_message rm;
+	unsigned int count, i;
+	uint64_t dummy;
+
+	if (!wldbg_resolve_message(message, &rm))
+		return 0;
+
+	/* the client waited for the callback */
+	if (strcmp(rm.wl_interface->name, "wl_callback") == 0)
+		replay->awaited[seq] = 1;
+
+	args = wldbg_message_get_arguments(message, &count);
+	formats = get_formats(message);
+
+	for (i = 0; i < count; ++i) {
+		if (args[i].type == 'n' && *args[i].data >= SERVER_ID_START) {
+			if (value_map_set(&rc->ids, *args[i].data, seq) < 0)
+				return -1;
+		} else if (is_value(&args[i], formats, i)
+			   && value_map_get(&replay->request_values,
+					    *args[i].data, &dummy)) {
+			if (value_map_set(&rc->values, *args[i].data, seq) < 0)
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void
+await_id(struct replay *replay, struct replay_connection *rc, uint32_t id)
+{
+	uint64_t seq;
+
+	if (id >= SERVER_ID_START && value_map_get(&rc->ids, id, &seq))
+		replay->awaited[seq] = 1;
+}
+
+/* the second pass: the request needs the events that
+ * created its objects and that brought its values */
+static void
+note_request(struct replay *replay, struct replay_connection *rc,
+	     struct wldbg_message *message)
+{
+	const struct wldbg_resolved_arg *args;
+	const struct wldbg_arg_format *formats;
+	unsigned int count, i;
+	uint64_t seq;
+
+	await_id(replay, rc, ((uint32_t *) message->data)[0]);
+
+	args = wldbg_message_get_arguments(message, &count);
+	formats = get_formats(message);
+
+	for (i = 0; i < count; ++i) {
+		if (args[i].type == 'o' && args[i].data)
+			await_id(replay, rc, *args[i].data);
+		else if (is_value(&args[i], formats, i)
+			 && value_map_get(&rc->values, *args[i].data, &seq))
+			replay->awaited[seq] = 1;
+	}
+}
+
+static int
+prepare_pass(struct replay *replay, int second)
+{
+	struct wldbg_trace_cursor *cursor = &replay->cursor;
+	struct wldbg_trace_record rec;
+	struct wldbg_message message;
+	struct replay_connection *rc;
+	int ret;
+
+	if (wldbg_trace_seek(cursor, replay->trace, 0) < 0)
+		return -1;
+
+	while ((ret = wldbg_trace_next(cursor, &rec)) == 1) {
+		if (replay->options->connection
+		    && rec.connection != replay->options->connection)
+			continue;
+		if (rec.size < 2 * sizeof(uint32_t)
+		    || rec.seq >= wldbg_trace_record_count(replay->trace))
+			continue;
+
+		rc = get_connection(replay, rec.connection);
+		if (!rc)
+			return -1;
+
+		init_message(&message, &rc->recorded, rec.data,
+			     rec.size, rec.from);
+
+		if (rec.from == CLIENT) {
+			if (!second)
+				ret = collect_request_values(replay, rc,
+							     &message);
+			else
+				note_request(replay, rc, &message);
+		} else if (second) {
+			ret = note_event(replay, rc, &message, rec.seq);
+		}
+
+		if (ret < 0) {
+			fprintf(stderr, "Out of memory\n");
+			return -1;
+		}
+
+		wldbg_resolve_track_objects(&message);
+	}
+
+	if (ret < 0) {
+		fprintf(stderr, "The trace '%s' is corrupted\n",
+			replay->options->file);
+		return -1;
+	}
+
+	/* start from scratch in the next pass */
+	destroy_connections(replay);
+
+	return 0;
+}
+
+static int
+prepare(struct replay *replay)
+{
+	uint64_t i, count = wldbg_trace_record_count(replay->trace);
+
+	replay->awaited = calloc(count ? count : 1, 1);
+	if (!replay->awaited) {
+		fprintf(stderr, "Out of memory\n");
+		return -1;
+	}
+
+	if (prepare_pass(replay, 0) < 0 || prepare_pass(replay, 1) < 0)
+		return -1;
+
+	value_map_release(&replay->request_values);
+
+	for (i = 0; i < count; ++i)
+		replay->awaited_count += replay->awaited[i];
+
+	return 0;
+}
+
+static int
+connect_to_compositor(struct replay *replay, struct replay_connection *rc)
+{
+	if (connect_to_wayland_server(&rc->live, NULL) < 0) {
+		fprintf(stderr, "[%u] Failed connecting to the compositor\n",
+			replay->index);
+		return -1;
+	}
+
+	rc->connected = 1;
+	return 0;
+}
+
+static void
+queue_event(struct replay_connection *rc, const uint32_t *data, uint32_t size)
+{
+	struct wldbg_message message;
+	struct wldbg_resolved_message rm;
+	struct queued_event *ev;
+
+	init_message(&message, &rc->live, data, size, SERVER);
+	if (!wldbg_resolve_message(&message, &rm))
+		return;
+
+	/* the oldest events are not going to be matched anymore */
+	if (rc->events_count == REPLAY_MAX_QUEUED_EVENTS) {
+		ev = wl_container_of(rc->events.next, ev, link);
+		wl_list_remove(&ev->link);
+		free(ev);
+		--rc->events_count;
+	}
+
+	ev = malloc(sizeof *ev + size);
+	if (!ev)
+		return;
+
+	ev->message = rm.wl_message;
+	ev->size = size;
+	memcpy(ev->data, data, size);
+
+	wl_list_insert(rc->events.prev, &ev->link);
+	++rc->events_count;
+}
+
+static void
+handle_event(struct replay *replay, struct replay_connection *rc,
+	     const uint32_t *data, uint32_t size)
+{
+	struct wldbg_message message;
+	const char *msg = "";
+
+	if (data[0] == 1 && (data[1] & 0xffff) == WL_DISPLAY_ERROR) {
+		if (size > 5 * sizeof(uint32_t) && data[4] > 0
+		    && data[4] <= size - 5 * sizeof(uint32_t))
+			msg = (const char *) (data + 5);
+
+		fprintf(stderr, "[%u] Connection %u: error %u on object %u: "
+			"%.*s\n", replay->index, rc->id, data[3], data[2],
+			(int) strnlen(msg, size - 5 * sizeof(uint32_t)), msg);
+		rc->broken = 1;
+		return;
+	}
+
+	queue_event(rc, data, size);
+
+	init_message(&message, &rc->live, data, size, SERVER);
+	wldbg_resolve_track_objects(&message);
+}
+
+static int
+read_events(struct replay *replay, struct replay_connection *rc)
+{
+	struct wl_connection *conn = rc->live.server.connection;
+	uint32_t header[2], *p, size, *data;
+	int len;
+
+	len = wl_connection_read(conn);
+	/* we never use the fds */
+	wl_connection_close_fds_in(conn, -1);
+
+	if (len == 0 || (len < 0 && errno != EAGAIN)) {
+		fprintf(stderr, "[%u] Connection %u: the compositor closed "
+			"the connection\n", replay->index, rc->id);
+		rc->broken = 1;
+		return -1;
+	}
+
+	while (len >= (int) sizeof header) {
+		p = wl_connection_get_data(conn, 0, sizeof header, header);
+		size = p[1] >> 16;
+		if (size < sizeof header) {
+			fprintf(stderr, "[%u] Connection %u: malformed event\n",
+				replay->index, rc->id);
+			rc->broken = 1;
+			return -1;
+		}
+
+		if ((int) size > len)
+			break;
+
+		if (size > replay->buffer_size) {
+			data = realloc(replay->buffer, size);
+			if (!data)
+				return -1;
+			replay->buffer = data;
+			replay->buffer_size = size;
+		}
+
+		wl_connection_copy(conn, replay->buffer, size);
+		wl_connection_consume(conn, size);
+		len -= size;
+
+		handle_event(replay, rc, replay->buffer, size);
+		if (rc->broken)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* send what is queued and read the events that came until the
+ * deadline or until something came. Returns 0 if the deadline passed */
+static int
+dispatch(struct replay *replay, uint64_t deadline)
+{
+	struct replay_connection *rc;
+	struct pollfd fds[64];
+	struct replay_connection *conns[64];
+	unsigned int n = 0, i;
+	uint64_t now = monotonic_time_ns();
+	int timeout, ret;
+
+	wl_list_for_each(rc, &replay->connections, link) {
+		if (!rc->connected || rc->broken)
+			continue;
+
+		if (wl_connection_flush(rc->live.server.connection) < 0
+		    && errno != EAGAIN) {
+			fprintf(stderr, "[%u] Connection %u: sending failed: "
+				"%s\n", replay->index, rc->id,
+				strerror(errno));
+			rc->broken = 1;
+			continue;
+		}
+
+		if (n == sizeof fds / sizeof fds[0])
+			continue;
+
+		fds[n].fd = rc->live.server.fd;
+		fds[n].events = POLLIN;
+		if (wl_connection_pending_output(rc->live.server.connection))
+			fds[n].events |= POLLOUT;
+		conns[n++] = rc;
+	}
+
+	if (deadline <= now)
+		timeout = 0;
+	else
+		timeout = DIV_ROUNDUP(deadline - now, 1000000);
+
+	ret = poll(fds, n, timeout);
+	if (ret < 0) {
+		if (errno == EINTR)
+			return 1;
+
+		perror("poll");
+		return -1;
+	}
+
+	for (i = 0; i < n; ++i) {
+		if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+			read_events(replay, conns[i]);
+	}
+
+	if (ret == 0)
+		return monotonic_time_ns() < deadline;
+
+	return 1;
+}
+
+static int
+translate_id(struct replay_connection *rc, uint32_t *id)
+{
+	uint64_t live;
+
+	if (*id < SERVER_ID_START)
+		return 1;
+
+	if (!value_map_get(&rc->ids, *id, &live))
+		return 0;
+
+	*id = live;
+	return 1;
+}
+
+static int
+same_global(struct queued_event *ev, const struct wldbg_resolved_arg *args,
+	    unsigned int count)
+{
+	const struct wldbg_message_layout *layout;
+	int off;
+
+	/* wl_registry.global(name, interface, version) */
+	layout = wldbg_message_layout_get(ev->message);
+	if (count < 2 || !args[1].data || !layout)
+		return 0;
+
+	off = wldbg_message_layout_arg_offset(layout, ev->data + 2,
+					      ev->size / 4 - 2, 1);
+	if (off < 0)
+		return 0;
+
+	return strncmp((const char *) (ev->data + 2 + off + 1),
+		       (const char *) args[1].data,
+		       (ev->size / 4 - 2 - off - 1) * 4) == 0;
+}
+
+/* find the live event for the recorded one and map
+ * the ids and values of the recorded event to the live ones */
+static int
+match_event(struct replay_connection *rc, struct wldbg_message *recorded)
+{
+	const struct wldbg_resolved_arg *args;
+	const struct wldbg_arg_format *formats;
+	const struct wldbg_message_layout *layout;
+	struct wldbg_resolved_message rm;
+	struct queued_event *ev;
+	uint32_t id = ((uint32_t *) recorded->data)[0], opcode, live;
+	unsigned int count, i;
+	int global, off;
+
+	if (!wldbg_resolve_message(recorded, &rm) || !translate_id(rc, &id))
+		return 0;
+
+	opcode = rm.base.opcode;
+	args = wldbg_message_get_arguments(recorded, &count);
+	formats = get_formats(recorded);
+
+	/* globals can come in a different order */
+	global = strcmp(rm.wl_interface->name, "wl_registry") == 0
+		 && opcode == WL_REGISTRY_GLOBAL;
+
+	wl_list_for_each(ev, &rc->events, link) {
+		if (ev->data[0] != id || (ev->data[1] & 0xffff) != opcode)
+			continue;
+		if (global && !same_global(ev, args, count))
+			continue;
+
+		layout = wldbg_message_layout_get(ev->message);
+		for (i = 0; layout && i < count; ++i) {
+			if (!args[i].data)
+				continue;
+
+			off = wldbg_message_layout_arg_offset(layout,
+							      ev->data + 2,
+							      ev->size / 4 - 2,
+							      i);
+			if (off < 0)
+				continue;
+
+			live = ev->data[2 + off];
+			if (args[i].type == 'n'
+			    && *args[i].data >= SERVER_ID_START)
+				value_map_set(&rc->ids, *args[i].data, live);
+			else if (is_value(&args[i], formats, i)
+				 && *args[i].data != live)
+				value_map_set(&rc->values, *args[i].data, live);
+		}
+
+		wl_list_remove(&ev->link);
+		--rc->events_count;
+		free(ev);
+
+		return 1;
+	}
+
+	return 0;
+}
+
+static void
+replay_event(struct replay *replay, struct replay_connection *rc,
+	     const struct wldbg_trace_record *rec)
+{
+	struct wldbg_message message;
+	uint64_t deadline;
+
+	init_message(&message, &rc->recorded, rec->data, rec->size, SERVER);
+
+	if (replay->awaited[rec->seq]) {
+		deadline = monotonic_time_ns() + replay->options->timeout;
+		while (!match_event(rc, &message)) {
+			if (rc->broken || dispatch(replay, deadline) <= 0) {
+				++replay->missed;
+				break;
+			}
+		}
+	}
+
+	wldbg_resolve_track_objects(&message);
+}
+
+static int
+create_fd(void)
+{
+	int fd;
+
+#ifdef HAVE_MEMFD_CREATE
+	fd = memfd_create("wldbg-replay", MFD_CLOEXEC);
+#else
+	char path[] = "/tmp/wldbg-replay-XXXXXX";
+
+	fd = mkostemp(path, O_CLOEXEC);
+	if (fd >= 0)
+		unlink(path);
+#endif
+	if (fd < 0)
+		return -1;
+
+	/* the file is sparse, it takes no memory */
+	if (ftruncate(fd, REPLAY_FD_SIZE) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void
+replay_request(struct replay *replay, struct replay_connection *rc,
+	       const struct wldbg_trace_record *rec)
+{
+	struct wl_connection *conn = rc->live.server.connection;
+	struct wldbg_message message;
+	const struct wldbg_resolved_arg *args;
+	const struct wldbg_arg_format *formats;
+	uint32_t *data;
+	unsigned int count, i;
+	uint64_t value;
+	size_t off;
+	int fd;
+
+	if (rec->size > replay->buffer_size) {
+		data = realloc(replay->buffer, rec->size);
+		if (!data) {
+			fprintf(stderr, "Out of memory\n");
+			return;
+		}
+		replay->buffer = data;
+		replay->buffer_size = rec->size;
+	}
+
+	data = replay->buffer;
+	memcpy(data, rec->data, rec->size);
+
+	if (!translate_id(rc, &data[0]))
+		fprintf(stderr, "[%u] Connection %u: object %u was not created "
+			"by the compositor\n", replay->index, rc->id, data[0]);
+
+	init_message(&message, &rc->recorded, rec->data, rec->size, CLIENT);
+	args = wldbg_message_get_arguments(&message, &count);
+	formats = get_formats(&message);
+
+	for (i = 0; i < count; ++i) {
+		if (!args[i].data)
+			continue;
+
+		off = args[i].data - (const uint32_t *) rec->data;
+		if (args[i].type == 'o')
+			translate_id(rc, &data[off]);
+		else if (is_value(&args[i], formats, i)
+			 && value_map_get(&rc->values, data[off], &value))
+			data[off] = value;
+	}
+
+	/* we do not have the recorded fds, send empty files instead */
+	for (i = 0; i < rec->fd_count; ++i) {
+		fd = create_fd();
+		if (fd < 0 || wl_connection_put_fd(conn, fd) < 0) {
+			fprintf(stderr, "[%u] Connection %u: failed sending "
+				"fd: %s\n", replay->index, rc->id,
+				strerror(errno));
+			if (fd >= 0)
+				close(fd);
+		}
+	}
+
+	if (wl_connection_write(conn, data, rec->size) < 0) {
+		fprintf(stderr, "[%u] Connection %u: sending failed: %s\n",
+			replay->index, rc->id, strerror(errno));
+		rc->broken = 1;
+		return;
+	}
+
+	++replay->requests;
+
+	wldbg_resolve_track_objects(&message);
+	init_message(&message, &rc->live, data, rec->size, CLIENT);
+	wldbg_resolve_track_objects(&message);
+}
+
+static int
+run_replay(struct replay *replay)
+{
+	struct replay_options *options = replay->options;
+	struct wldbg_trace_cursor *cursor = &replay->cursor;
+	struct wldbg_trace_record rec;
+	struct replay_connection *rc;
+	uint64_t start = 0, first = 0, shift = 0, target, now, deadline;
+	int ret, started = 0, failed = 0;
+
+	if (wldbg_trace_seek(cursor, replay->trace, 0) < 0)
+		return -1;
+
+	while ((ret = wldbg_trace_next(cursor, &rec)) == 1) {
+		if (options->connection && rec.connection != options->connection)
+			continue;
+		if (rec.size < 2 * sizeof(uint32_t)
+		    || rec.seq >= wldbg_trace_record_count(replay->trace))
+			continue;
+
+		rc = get_connection(replay, rec.connection);
+		if (!rc)
+			return -1;
+		if (rc->broken)
+			continue;
+
+		if (!rc->connected && connect_to_compositor(replay, rc) < 0)
+			return -1;
+
+		if (!started) {
+			start = monotonic_time_ns();
+			first = rec.time;
+			started = 1;
+		}
+
+		target = 0;
+		if (options->speed > 0) {
+			target = start + shift
+				 + (uint64_t) ((rec.time - first)
+					       / options->speed);
+
+			/* the requests go at the recorded pace */
+			while (rec.from == CLIENT
+			       && monotonic_time_ns() < target)
+				if (dispatch(replay, target) < 0)
+					return -1;
+		} else if (dispatch(replay, 0) < 0) {
+			return -1;
+		}
+
+		if (rec.from == SERVER) {
+			replay_event(replay, rc, &rec);
+
+			/* waiting for the compositor delays the rest */
+			now = monotonic_time_ns();
+			if (target && now > target)
+				shift += now - target;
+		} else {
+			replay_request(replay, rc, &rec);
+		}
+	}
+
+	if (ret < 0)
+		fprintf(stderr, "[%u] The trace is corrupted\n", replay->index);
+
+	if (!started) {
+		fprintf(stderr, "[%u] No messages to replay\n", replay->index);
+		return -1;
+	}
+
+	/* wait a bit for the errors for the last requests */
+	deadline = monotonic_time_ns() + REPLAY_LINGER_NS;
+	while (dispatch(replay, deadline) > 0)
+		;
+
+	wl_list_for_each(rc, &replay->connections, link)
+		failed += rc->broken;
+
+	printf("[%u] %" PRIu64 " requests in %.3f s, %" PRIu64 " of %" PRIu64
+	       " awaited events did not come, %d of %d connections failed\n",
+	       replay->index, replay->requests,
+	       (monotonic_time_ns() - start) / 1e9,
+	       replay->missed, replay->awaited_count,
+	       failed, wl_list_length(&replay->connections));
+	fflush(stdout);
+
+	return ret < 0 || failed ? -1 : 0;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "Usage: wldbg replay [OPTIONS] FILE\n"
+		"\n"
+		"Send the requests of the clients recorded in FILE (see the\n"
+		"record pass) to the compositor in $WAYLAND_DISPLAY.\n"
+		"\n"
+		"Options:\n"
+		"\t--speed=FACTOR\t\tsend the requests FACTOR times faster "
+		"than they were recorded\n"
+		"\t--speed=max\t\tsend the requests as fast as possible\n"
+		"\t--parallel=N\t\trun N replays at once\n"
+		"\t--connection=ID\t\treplay only the connection ID\n"
+		"\t--timeout=MS\t\twait at most MS milliseconds for events "
+		"(default %d)\n", REPLAY_DEFAULT_TIMEOUT_MS);
+}
+
+static int
+parse_options(struct replay_options *options, int argc, char *argv[])
+{
+	const char *val;
+	char *end;
+	int i;
+
+	options->speed = 1;
+	options->parallel = 1;
+	options->timeout = REPLAY_DEFAULT_TIMEOUT_MS * 1000000ULL;
+
+	for (i = 1; i < argc; ++i) {
+		if (strncmp(argv[i], "--", 2) != 0) {
+			if (options->file) {
+				usage();
+				return -1;
+			}
+			options->file = argv[i];
+			continue;
+		}
+
+		val = strchr(argv[i], '=');
+		if (!val) {
+			usage();
+			return -1;
+		}
+		++val;
+
+		errno = 0;
+		if (strncmp(argv[i], "--speed=", 8) == 0) {
+			if (strcmp(val, "max") == 0) {
+				options->speed = 0;
+				continue;
+			}
+
+			options->speed = strtod(val, &end);
+			if (options->speed < 0)
+				errno = EINVAL;
+		} else if (strncmp(argv[i], "--parallel=", 11) == 0) {
+			options->parallel = strtoul(val, &end, 10);
+			if (options->parallel == 0)
+				errno = EINVAL;
+		} else if (strncmp(argv[i], "--connection=", 13) == 0) {
+			options->connection = strtoul(val, &end, 10);
+		} else if (strncmp(argv[i], "--timeout=", 10) == 0) {
+			options->timeout = strtoull(val, &end, 10) * 1000000ULL;
+		} else {
+			usage();
+			return -1;
+		}
+
+		if (errno || end == val || *end != '\0') {
+			fprintf(stderr, "Invalid option: %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	if (!options->file) {
+		usage();
+		return -1;
+	}
+
+	return 0;
+}
+
+/* run the replays in child processes and wait for them */
+static int
+run_parallel(struct replay *replay)
+{
+	unsigned int i, failed = 0;
+	int status;
+	pid_t pid;
+
+	fflush(stdout);
+
+	for (i = 0; i < replay->options->parallel; ++i) {
+		pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			++failed;
+			break;
+		}
+
+		if (pid == 0) {
+			replay->index = i;
+			exit(run_replay(replay) < 0 ? EXIT_FAILURE
+						    : EXIT_SUCCESS);
+		}
+	}
+
+	while ((pid = wait(&status)) > 0 || errno == EINTR) {
+		if (pid > 0 && (!WIFEXITED(status)
+				|| WEXITSTATUS(status) != EXIT_SUCCESS))
+			++failed;
+	}
+
+	if (failed)
+		fprintf(stderr, "%u of %u replays failed\n",
+			failed, replay->options->parallel);
+
+	return failed ? -1 : 0;
+}
+
+int
+wldbg_replay(int argc, char *argv[])
+{
+	struct replay_options options;
+	struct replay replay;
+	int ret = -1;
+
+	memset(&options, 0, sizeof options);
+	if (parse_options(&options, argc, argv) < 0)
+		return -1;
+
+	memset(&replay, 0, sizeof replay);
+	replay.options = &options;
+	wl_list_init(&replay.connections);
+
+	replay.trace = wldbg_trace_open(options.file);
+	if (!replay.trace)
+		return -1;
+
+	if (prepare(&replay) < 0)
+		goto out;
+
+	if (options.parallel > 1)
+		ret = run_parallel(&replay);
+	else
+		ret = run_replay(&replay);
+
+out:
+	destroy_connections(&replay);
+	value_map_release(&replay.request_values);
+	free(replay.awaited);
+	free(replay.buffer);
+	wldbg_trace_cursor_release(&replay.cursor);
+	wldbg_trace_close(replay.trace);
+
+	return ret;
+}
@@ -29,76 +29,57 @@
 #include <dlfcn.h>
 #include <assert.h>
 
-/* for WL_SERVER_ID_START */
-#include "wayland/wayland-private.h"
-
 #include <wayland-server-protocol.h>
 #include <wayland-client-protocol.h>
 
 #include "wldbg.h"
-#include "wldbg-pass.h"
 #include "wldbg-private.h"
-#include "wldbg-ids-map.h"
-#include "passes.h"
+#include "wldbg-object-table.h"
 #include "util.h"
 #include "resolve.h"
+#include "wldbg-interfaces.h"
+#include "elf-interfaces.h"
+#include "wldbg-message-layout.h"
+#include "wldbg-printers.h"
 
-static struct wl_list shared_interfaces;
+/* index of wl_registry for checking bind requests */
+static unsigned int wl_registry_index;
 
 static void
 resolved_objects_put(struct resolved_objects *ro,
 		     uint32_t id, const struct wl_interface *intf)
 {
-	if (id >= WL_SERVER_ID_START)
-		wldbg_ids_map_insert(&ro->objects.server_objects,
-				     id - WL_SERVER_ID_START, (void *) intf);
-	else
-		wldbg_ids_map_insert(&ro->objects.client_objects, id, (void *) intf);
-}
+	struct wldbg_object old;
+	unsigned int index;
 
-/* this pass analyze the connection and translates object id
- * to human-readable names */
-
-struct interface
-{
-	const struct wl_interface *interface;
-	struct wl_list link;
-};
-
-static void
-add_interface(struct wl_list *intfs, struct interface *intf)
-{
-	struct interface *i;
+	/* keep the reverse index up to date */
+	if (wldbg_object_table_get(ro->table, id, &old)
+	    && (old.flags & WLDBG_OBJECT_LIVE))
+		wldbg_objects_index_remove(&ro->index, id,
+					   old.interface_index);
 
-	wl_list_for_each(i, intfs, link) {
-		if (strcmp(i->interface->name, intf->interface->name) == 0) {
-			dbg("Already got '%s' interface, discarding\n",
-				intf->interface->name);
-			free(intf);
-			return;
-		}
+	if (!intf) {
+		wldbg_object_table_delete(ro->table, id);
+		return;
 	}
 
-	dbg("Adding interface '%s'\n", intf->interface->name);
-	wl_list_insert(intfs->next, &intf->link);
-}
+	/* unknown objects are in the table without interface */
+	if (intf == &unknown_interface)
+		intf = NULL;
 
-static void
-add_shared_interface(struct interface *intf)
-{
-	add_interface(&shared_interfaces, intf);
+	index = wldbg_object_table_create(ro->table, id, intf);
+	if (wldbg_objects_index_add(&ro->index, id, index) < 0)
+		fprintf(stderr, "Out of memory, object %u is not indexed\n",
+			id);
 }
 
+/* here we keep track of the objects in the connection, so that
+ * the object ids can be translated to human-readable names */
+
 static const struct wl_interface *
-get_interface(struct resolved_objects *ro, const char *name)
+get_additional_interface(struct resolved_objects *ro, const char *name)
 {
-	struct interface *i;
-
-	wl_list_for_each(i, ro->interfaces, link) {
-		if (strcmp(i->interface->name, name) == 0) {
-			return i->interface;
-		}
-	}
+	struct additional_interface *i;
 
 	wl_list_for_each(i, &ro->additional_interfaces, link) {
 		if (strcmp(i->interface->name, name) == 0) {
@@ -106,24 +87,39 @@ get_interface(struct resolved_objects *ro, const char *name)
 		}
 	}
 
-	dbg("RESOLVE: Didn't find '%s' interface\n", name);
 	return NULL;
 }
 
-static struct interface *
-create_interface(const struct wl_interface *intf)
+/* pid is the client's process that we can look for
+ * the interface in, 0 if we should not look there */
+static const struct wl_interface *
+get_interface(struct resolved_objects *ro, pid_t pid, const char *name)
 {
-	struct interface *ret = malloc(sizeof *ret);
-	if (!ret)
-		return NULL;
+	const struct wl_interface *intf;
 
-	ret->interface = intf;
+	/* if we have the client's own interfaces,
+	 * they are the right version */
+	intf = get_additional_interface(ro, name);
+	if (intf)
+		return intf;
+
+	intf = wldbg_interfaces_lookup(name);
+	if (intf)
+		return intf;
+
+	/* the client could have loaded something new */
+	if (elf_interfaces_discover(ro, pid) > 0) {
+		intf = get_additional_interface(ro, name);
+		if (intf)
+			return intf;
+	}
 
-	return ret;
+	dbg("RESOLVE: Didn't find '%s' interface\n", name);
+	return NULL;
 }
 
-static struct interface *
-libwayland_get_interface(void *handle, const char *intf)
+static void
+libwayland_add_interface(void *handle, const char *intf)
 {
 	const struct wl_interface *interface;
 
@@ -133,68 +129,48 @@ libwayland_get_interface(void *handle, const char *intf)
 	if (!interface) {
 		dbg("Failed loading interface '%s' from libwayland: %s\n",
 			intf, dlerror());
-		return NULL;
+		return;
 	}
 
-	return create_interface(interface);
+	wldbg_interfaces_register(interface);
 }
 
 static void
 parse_libwayland(void)
 {
-	struct interface *intf;
 	void *handle;
 
 	handle = dlopen("libwayland-client.so", RTLD_NOW);
+	/* the unversioned link is only in development packages */
+	if (!handle)
+		handle = dlopen("libwayland-client.so.0", RTLD_NOW);
 	if (!handle) {
 		fprintf(stderr, "Loading pass: %s\n", dlerror());
 		return;
 	}
 
-	if ((intf = libwayland_get_interface(handle, "wl_display_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_registry_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_callback_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_compositor_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_shm_pool_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_shm_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_buffer_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_data_offer_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_data_source_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_data_device_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_data_device_manager_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_shell_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_shell_surface_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_surface_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_seat_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_pointer_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_keyboard_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_touch_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_output_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_region_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_subcompositor_interface")))
-		add_shared_interface(intf);
-	if ((intf = libwayland_get_interface(handle, "wl_subsurface_interface")))
-		add_shared_interface(intf);
+	libwayland_add_interface(handle, "wl_display_interface");
+	libwayland_add_interface(handle, "wl_registry_interface");
+	libwayland_add_interface(handle, "wl_callback_interface");
+	libwayland_add_interface(handle, "wl_compositor_interface");
+	libwayland_add_interface(handle, "wl_shm_pool_interface");
+	libwayland_add_interface(handle, "wl_shm_interface");
+	libwayland_add_interface(handle, "wl_buffer_interface");
+	libwayland_add_interface(handle, "wl_data_offer_interface");
+	libwayland_add_interface(handle, "wl_data_source_interface");
+	libwayland_add_interface(handle, "wl_data_device_interface");
+	libwayland_add_interface(handle, "wl_data_device_manager_interface");
+	libwayland_add_interface(handle, "wl_shell_interface");
+	libwayland_add_interface(handle, "wl_shell_surface_interface");
+	libwayland_add_interface(handle, "wl_surface_interface");
+	libwayland_add_interface(handle, "wl_seat_interface");
+	libwayland_add_interface(handle, "wl_pointer_interface");
+	libwayland_add_interface(handle, "wl_keyboard_interface");
+	libwayland_add_interface(handle, "wl_touch_interface");
+	libwayland_add_interface(handle, "wl_output_interface");
+	libwayland_add_interface(handle, "wl_region_interface");
+	libwayland_add_interface(handle, "wl_subcompositor_interface");
+	libwayland_add_interface(handle, "wl_subsurface_interface");
 
 	dlclose(handle);
 }
@@ -206,25 +182,9 @@ extern const struct wl_interface xdg_popup_interface;
 static void
 add_hardcoded_xdg_shell(void)
 {
-	struct interface *intf;
-
-	intf = create_interface(&xdg_shell_interface);
-	if (!intf)
-		return;
-
-	add_shared_interface(intf);
-
-	intf = create_interface(&xdg_surface_interface);
-	if (!intf)
-		return;
-
-	add_shared_interface(intf);
-
-	intf = create_interface(&xdg_popup_interface);
-	if (!intf)
-		return;
-
-	add_shared_interface(intf);
+	wldbg_interfaces_register(&xdg_shell_interface);
+	wldbg_interfaces_register(&xdg_surface_interface);
+	wldbg_interfaces_register(&xdg_popup_interface);
 }
 
 extern const struct wl_interface wl_drm_interface;
@@ -232,81 +192,50 @@ extern const struct wl_interface wl_drm_interface;
 static void
 add_hardcoded_drm_interface(void)
 {
-	struct interface *intf;
-
-	intf = create_interface(&wl_drm_interface);
-	if (!intf)
-		return;
-
-	add_shared_interface(intf);
-}
-
-static int
-wl_message_new_id_pos(const char *signature)
-{
-	int n = 0;
-
-	while (signature[n] != '\0') {
-		if (signature[n] == 'n')
-			return n;
-
-		++n;
-	}
-
-	return -1;
-}
-
-static uint32_t
-get_new_id(const char *signature, uint32_t *data)
-{
-	int n = 0, pos = 2;
-	uint32_t size;
-
-	while (signature[n] != '\0') {
-		switch(signature[n]) {
-		case 'n':
-			vdbg("Found new_id: %u\n", data[pos]);
-			return data[pos];
-		case 's':
-		case 'a':
-			size = DIV_ROUNDUP(data[pos], sizeof(uint32_t));
-			pos += size + 1;
-			break;
-		default:
-			++pos;
-		}
-
-		++n;
-	}
-
-	assert(0 && "No new id in message");
+	wldbg_interfaces_register(&wl_drm_interface);
 }
 
 static void
-get_new_ids(struct resolved_objects *ro, uint32_t *data,
+get_new_ids(struct resolved_objects *ro, pid_t pid, uint32_t *data,
 	    const struct wl_message *wl_message, const char *guess_type)
 {
-	uint32_t new_id;
+	const struct wldbg_message_layout *layout;
 	const struct wl_interface *new_intf;
-	int id_pos, pos = 0;
+	uint32_t new_id, size;
+	unsigned int n, arg;
+	int off;
+
+	layout = wldbg_message_layout_get(wl_message);
+	if (!layout || layout->new_id_count == 0)
+		return;
 
-	assert(wl_message->signature && "BUG: no wl_message->signature");
 	assert(wl_message->types && "BUG: no wl_message->types");
 
-	/* search for new_id's in loop in the case there
-	 * are more of them in a event/request */
-	while ((id_pos = wl_message_new_id_pos(
-			wl_message->signature + pos)) >= 0) {
+	size = data[1] >> 16;
+	if (size < 2 * sizeof(uint32_t))
+		return;
+
+	/* there may be more new_id's in an event/request */
+	for (n = 0; n < layout->new_id_count; ++n) {
+		arg = layout->new_ids[n];
+		off = wldbg_message_layout_arg_offset(layout, data + 2,
+						      size / sizeof(uint32_t) - 2,
+						      arg);
+		if (off < 0) {
+			fprintf(stderr, "new_id of %s is out of the message\n",
+				wl_message->name);
+			return;
+		}
 
-		new_id = get_new_id(wl_message->signature + pos, data);
-		new_intf = (void *) wl_message->types[id_pos];
+		new_id = data[2 + off];
+		new_intf = wl_message->types[arg];
 
 		/* if the type is unknown, we guessed it is
 		 * this type (usualy from bind request) */
 		if (!new_intf && guess_type){
 			dbg("RESOLVE: Guessing unknown type is '%s'\n",
 				guess_type);
-			new_intf = get_interface(ro, guess_type);
+			new_intf = get_interface(ro, pid, guess_type);
 		}
 
 		if (!new_intf)
@@ -315,29 +244,24 @@ get_new_ids(struct resolved_objects *ro, uint32_t *data,
 		resolved_objects_put(ro, new_id, new_intf);
 
 		dbg("RESOLVE: Got new id %u (%s)\n", new_id, new_intf->name);
-
-		pos = id_pos + 1;
 	}
 }
 
-static int
-resolve_in(void *user_data, struct wldbg_message *message)
+static void
+track_event(struct wldbg_message *message, uint32_t *data)
 {
 	uint32_t id, opcode;
-	uint32_t *data = message->data;
 	const struct wl_interface *intf;
 	const struct wl_message *wl_message;
 	struct resolved_objects *ro = message->connection->resolved_objects;
 
-	(void) user_data;
-
 	id = data[0];
 	opcode = data[1] & 0xffff;
 
 	intf = wldbg_message_get_object(message, id);
 	if (intf) {
 		if (intf == &unknown_interface || intf == &free_entry)
-			return PASS_NEXT;
+			return;
 
 		if (((uint32_t) intf->event_count) <= opcode) {
 			fprintf(stderr,
@@ -348,7 +272,7 @@ resolve_in(void *user_data, struct wldbg_message *message)
 			else
 				fprintf(stderr, "available opcodes: 0 - %d\n",
 					intf->event_count - 1);
-			return PASS_NEXT;
+			return;
 		}
 
 
@@ -357,27 +281,24 @@ resolve_in(void *user_data, struct wldbg_message *message)
 		/* handle delete_id event */
 		if (id == 1 /* wl_display */
 			&& opcode == WL_DISPLAY_DELETE_ID) {
-			resolved_objects_put(ro, data[2], &free_entry);
+			/* removing the id frees the memory when
+			 * the client destroys many objects */
+			resolved_objects_put(ro, data[2], NULL);
 			dbg("RESOLVE: Freed id %u\n", data[2]);
 		} else
-			get_new_ids(ro, data, wl_message, NULL);
+			get_new_ids(ro, 0, data, wl_message, NULL);
 	}
-
-	return PASS_NEXT;
 }
 
-static int
-resolve_out(void *user_data, struct wldbg_message *message)
+static void
+track_request(struct wldbg_message *message, uint32_t *data)
 {
 	uint32_t id, opcode;
-	uint32_t *data = message->data;
 	const struct wl_interface *intf;
 	const struct wl_message *wl_message;
 	const char *guess_type = NULL;
 	struct resolved_objects *ro = message->connection->resolved_objects;
 
-	(void) user_data;
-
 	id = data[0];
 	opcode = data[1] & 0xffff;
 
@@ -385,7 +306,7 @@ resolve_out(void *user_data, struct wldbg_message *message)
 	if (intf) {
 		/* unknown interface */
 		if (intf == &unknown_interface || intf == &free_entry)
-			return PASS_NEXT;
+			return;
 
 		if (((uint32_t) intf->method_count) <= opcode) {
 			fprintf(stderr,
@@ -396,7 +317,7 @@ resolve_out(void *user_data, struct wldbg_message *message)
 			else
 				fprintf(stderr, "available opcodes: 0 - %d\n",
 					intf->method_count - 1);
-			return PASS_NEXT;
+			return;
 		}
 
 		wl_message = &intf->methods[opcode];
@@ -404,18 +325,48 @@ resolve_out(void *user_data, struct wldbg_message *message)
 		/* data + 4 is the string with the name
 		 * of interface in bind request. Use it
 		 * to guess the interface of new id */
-		if (strcmp(intf->name, "wl_registry") == 0
-			&& opcode == WL_REGISTRY_BIND)
+		if (opcode == WL_REGISTRY_BIND
+			&& wldbg_interfaces_index(intf) == wl_registry_index)
 				guess_type = (const char *) (data + 4);
 
-		get_new_ids(ro, data, wl_message, guess_type);
+		get_new_ids(ro, message->connection->client.pid,
+			    data, wl_message, guess_type);
 	}
+}
+
+/**
+ * Keep track of the objects in the connection, that is all that
+ * we do for every message. Arguments of a message are decoded only
+ * when somebody asks for them using wldbg_resolve_message().
+ * The message can also be a whole buffer of messages
+ * (see wldbg_separate_messages()).
+ */
+void
+wldbg_resolve_track_objects(struct wldbg_message *message)
+{
+	uint32_t *data = message->data, size;
+	size_t rest = message->size;
+
+	if (!message->connection->resolved_objects)
+		return;
+
+	while (rest >= 2 * sizeof(uint32_t)) {
+		size = data[1] >> 16;
+		if (size < 2 * sizeof(uint32_t) || size > rest)
+			break;
+
+		if (message->from == SERVER)
+			track_event(message, data);
+		else
+			track_request(message, data);
 
-	return PASS_NEXT;
+		data += size / sizeof(uint32_t);
+		rest -= size;
+	}
 }
 
 struct resolved_objects *
-create_resolved_objects(void)
+create_resolved_objects(struct wldbg *wldbg, struct wldbg_object_table *table)
 {
 	struct resolved_objects *ro = malloc(sizeof *ro);
 	if (!ro) {
@@ -423,18 +374,18 @@ create_resolved_objects(void)
 		return NULL;
 	}
 
-	wldbg_ids_map_init(&ro->objects.client_objects);
-	wldbg_ids_map_init(&ro->objects.server_objects);
+	ro->wldbg = wldbg;
+	ro->table = table;
+	wldbg_objects_index_init(&ro->index);
 	wl_list_init(&ro->additional_interfaces);
+	ro->elf_interfaces = NULL;
 
-	/* these are shared between connection */
-	/* and contain at least libwayland interfaces */
-	assert(!wl_list_empty(&shared_interfaces));
-	ro->interfaces = &shared_interfaces;
+	/* the registry is shared between connections
+	 * and contains at least libwayland interfaces */
+	assert(wldbg_interfaces_count() > 1);
 
 	/* id 0 is always empty and 1 is always display */
-	resolved_objects_put(ro, 0, NULL);
-	resolved_objects_put(ro, 1, get_interface(ro, "wl_display"));
+	resolved_objects_put(ro, 1, get_interface(ro, 0, "wl_display"));
 
 	return ro;
 }
@@ -442,101 +393,68 @@ create_resolved_objects(void)
 void
 destroy_resolved_objects(struct resolved_objects *ro)
 {
-	struct interface *intf, *tmp;
-
 	if (!ro)
 		return;
 
-	wldbg_ids_map_release(&ro->objects.client_objects);
-	wldbg_ids_map_release(&ro->objects.server_objects);
+	/* the table belongs to the connection */
+	wldbg_objects_index_release(&ro->index);
 
-	wl_list_for_each_safe(intf, tmp, &ro->additional_interfaces, link)
-		free(intf);
+	/* additional_interfaces are in there */
+	elf_interfaces_destroy(ro->elf_interfaces, ro->wldbg);
 
 	free(ro);
 }
 
 static int
-resolve_init(struct wldbg *wldbg, struct wldbg_pass *pass,
-	     int argc, const char *argv[])
+resolve_init(void)
 {
-	(void) argc;
-	(void) argv;
-	(void) wldbg;
-	(void) pass;
-
-	wl_list_init(&shared_interfaces);
-	struct interface *i;
-	int count = 0;
-	wl_list_for_each(i, &shared_interfaces, link)
-		count++;
-
 	/* get interfaces from libwayland.so */
 	parse_libwayland();
 
-	/* this is a workaround until we have parser for binary */
+	/* for the clients whose memory we can not read */
 	add_hardcoded_xdg_shell();
 	add_hardcoded_drm_interface();
 
-	/* XXX
-	if (path_to_binary)
-		parse_binary(... bfd
+	wl_registry_index = wldbg_interfaces_name_index("wl_registry");
 
-	*/
+	/* the protocols can describe the arguments
+	 * better, then their printers are used */
+	if (wldbg_printers_add_builtin() < 0) {
+		fprintf(stderr, "Out of memory\n");
+		return -1;
+	}
+
+	/* interfaces from the client's binaries are
+	 * discovered for every connection when we
+	 * need them, see get_interface() */
 
 	dbg("Resolving objects inited\n");
 
 	return 0;
 }
 
-static void
-resolve_destroy(void *data)
-{
-	struct interface *intf, *tmp;
-
-	(void) data;
-
-	wl_list_for_each_safe(intf, tmp, &shared_interfaces, link) {
-		free(intf);
-	}
-}
-
-static struct pass *
-create_resolve_pass(void)
+void
+wldbg_resolve_destroy(struct wldbg *wldbg)
 {
-	struct pass *pass;
-
-	pass = alloc_pass("resolve");
-	if (!pass)
-		return NULL;
-
-	pass->wldbg_pass.init = resolve_init;
-	pass->wldbg_pass.destroy = resolve_destroy;
-	pass->wldbg_pass.server_pass = resolve_in;
-	pass->wldbg_pass.client_pass = resolve_out;
-	pass->wldbg_pass.description = "Assign interfaces to objects";
+	if (!wldbg->resolving_objects)
+		return;
 
-	return pass;
+	wldbg_printers_release();
+	wldbg_message_layout_release();
+	wldbg_interfaces_release();
+	wldbg->resolving_objects = 0;
 }
 
 int
-wldbg_add_resolve_pass(struct wldbg *wldbg)
+wldbg_resolve_init(struct wldbg *wldbg)
 {
-	/* do not add this pass more times */
+	/* do not init it more times */
 	if (wldbg->resolving_objects)
 		return 0;
 
-	struct pass *pass = create_resolve_pass();
-	if (!pass)
+	if (resolve_init() < 0)
 		return -1;
 
-	if (resolve_init(wldbg, &pass->wldbg_pass, 0, NULL) < 0) {
-		dealloc_pass(pass);
-		return -1;
-	}
-
-	/* insert always at the begining */
-	wl_list_insert(&wldbg->passes, &pass->link);
 	wldbg->resolving_objects = 1;
 
 	return 0;
@@ -29,15 +29,13 @@
 #include <dlfcn.h>
 #include <assert.h>
 
-/* for WL_SERVER_ID_START */
-#include "wayland/wayland-private.h"
-
 #include <wayland-server-protocol.h>
 #include <wayland-client-protocol.h>
 
 #include "wldbg.h"
 #include "wldbg-private.h"
-#include "wldbg-ids-map.h"
+#include "wldbg-interfaces.h"
+#include "wldbg-object-table.h"
 
 /* special interfaces that will be set to
  * id's that has been deleted or are unknown.
@@ -54,11 +52,14 @@ const struct wl_interface unknown_interface = {
 static const struct wl_interface *
 resolved_objects_get(struct resolved_objects *ro, uint32_t id)
 {
-	if (id >= WL_SERVER_ID_START)
-		return wldbg_ids_map_get(&ro->objects.server_objects,
-					 id - WL_SERVER_ID_START);
-	else
-		return wldbg_ids_map_get(&ro->objects.client_objects, id);
+	const struct wl_interface *intf;
+	unsigned int flags;
+
+	intf = wldbg_object_table_get_interface(ro->table, id, &flags);
+	if (!intf && (flags & WLDBG_OBJECT_LIVE))
+		return &unknown_interface;
+
+	return intf;
 }
 
 const struct wl_interface *
@@ -71,27 +72,52 @@ wldbg_message_get_object(struct wldbg_message *msg, uint32_t id)
 	return resolved_objects_get(ro, id);
 }
 
-const struct wl_interface *
-wldbg_message_get_interface(struct wldbg_message *msg, const char *name)
+const uint32_t *
+wldbg_message_get_objects(struct wldbg_message *msg, const char *name,
+			  unsigned int *count)
 {
-	unsigned int i;
-	const struct wl_interface *intf;
 	struct resolved_objects *ro = msg->connection->resolved_objects;
 
-	for (i = 0; i < ro->objects.client_objects.count; ++i) {
-		intf = wldbg_ids_map_get(&ro->objects.client_objects, i);
-		if (intf && strcmp(intf->name, name) == 0)
-			return intf;
+	if (!ro) {
+		*count = 0;
+		return NULL;
 	}
 
-	for (i = 0; i < ro->objects.server_objects.count; ++i) {
-		intf = wldbg_ids_map_get(&ro->objects.server_objects,
-					 WL_SERVER_ID_START + i);
-		if (intf && strcmp(intf->name, name) == 0)
-			return intf;
-	}
+	return wldbg_objects_index_get(&ro->index,
+				       wldbg_interfaces_name_index(name),
+				       count);
+}
 
-	return NULL;
+const struct wl_interface *
+wldbg_message_get_interface(struct wldbg_message *msg, const char *name)
+{
+	const uint32_t *ids;
+	unsigned int count;
+
+	/* take the interface of any live object */
+	ids = wldbg_message_get_objects(msg, name, &count);
+	if (!count)
+		return NULL;
+
+	return wldbg_message_get_object(msg, ids[0]);
+}
+
+struct iterate_data {
+	void (*func)(uint32_t id, const struct wl_interface *intf,
+		     void *data);
+	void *data;
+};
+
+static void
+iterate_object(struct wldbg_object *obj, void *data)
+{
+	struct iterate_data *d = data;
+
+	if (!(obj->flags & WLDBG_OBJECT_LIVE))
+		return;
+
+	d->func(obj->id, obj->interface ? obj->interface : &unknown_interface,
+		d->data);
 }
 
 static void
@@ -101,19 +127,9 @@ resolved_objects_iterate(struct resolved_objects *ro,
 				      void *data),
 			 void *data)
 {
-	unsigned int i;
-	const struct wl_interface *intf;
+	struct iterate_data d = { func, data };
 
-	for (i = 0; i < ro->objects.client_objects.count; ++i) {
-		intf = wldbg_ids_map_get(&ro->objects.client_objects, i);
-		func(i, intf, data);
-	}
-
-	for (i = 0; i < ro->objects.server_objects.count; ++i) {
-		intf = wldbg_ids_map_get(&ro->objects.server_objects,
-					 WL_SERVER_ID_START + i);
-		func( WL_SERVER_ID_START + i, intf, data);
-	}
+	wldbg_object_table_for_each(ro->table, iterate_object, &d);
 }
 
 void
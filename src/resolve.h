@@ -31,12 +31,20 @@
 struct wldbg;
 struct resolved_objects;
 struct wldbg_connection;
+struct wldbg_message;
+struct wldbg_object_table;
 
 struct resolved_objects *
 wldbg_connection_get_resolved_objects(struct wldbg_connection *connection);
 
 int
-wldbg_add_resolve_pass(struct wldbg *wldbg);
+wldbg_resolve_init(struct wldbg *wldbg);
+
+void
+wldbg_resolve_destroy(struct wldbg *wldbg);
+
+void
+wldbg_resolve_track_objects(struct wldbg_message *message);
 
 const struct wl_interface *
 resolved_objects_get(struct resolved_objects *ro, uint32_t id);
@@ -58,8 +66,9 @@ resolved_objects_interate(struct resolved_objects *ro,
 				       void *data),
 			  void *data);
 
+/* wldbg can be NULL when the objects do not belong to its connection */
 struct resolved_objects *
-create_resolved_objects(void);
+create_resolved_objects(struct wldbg *wldbg, struct wldbg_object_table *table);
 
 void
 destroy_resolved_objects(struct resolved_objects *ro);
@@ -31,6 +31,7 @@
 #include <unistd.h>
 #include <assert.h>
 #include <stdarg.h>
+#include <time.h>
 
 #include <wldbg.h>
 
@@ -184,3 +185,35 @@ remove_newline(char *str)
 
 	return str;
 }
+
+/* monotonic time in nanoseconds */
+uint64_t
+monotonic_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Compute watermarks for flow control of connection buffers that have
+ * size bytes and can grow up to max_size bytes. We stop reading from
+ * a side when the data queued for the other side reach the high
+ * watermark, but one more read of up to size bytes can come before
+ * that, so it must still fit into max_size. Returns -1 if max_size
+ * is less than twice the size, there would be no room for queueing.
+ */
+int
+buffer_watermarks(size_t size, size_t max_size,
+		  size_t *high_watermark, size_t *low_watermark)
+{
+	if (size == 0 || max_size / 2 < size)
+		return -1;
+
+	*high_watermark = max_size - size;
+	*low_watermark = max_size / 8;
+
+	return 0;
+}
@@ -27,6 +27,7 @@
 #define _WLDBG_UTIL_H_
 
 #include <stdlib.h>
+#include <stdint.h>
 
 #ifndef DIV_ROUNDUP
 #define DIV_ROUNDUP(n, a) ( ((n) + ((a) - 1)) / (a) )
@@ -64,4 +65,11 @@ strdupf(const char *fmt, ...);
 char *
 remove_newline(char *str);
 
+uint64_t
+monotonic_time_ns(void);
+
+int
+buffer_watermarks(size_t size, size_t max_size,
+		  size_t *high_watermark, size_t *low_watermark);
+
 #endif /* _WLDBG_UTIL_H_ */
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "wldbg-hash.h"
+
+static inline size_t
+pointer_hash(const void *key, size_t size)
+{
+	/* the pointers are aligned, so the low bits are zero
+	 * and we need to mix the rest into them */
+	uint32_t h = (uint32_t) ((uintptr_t) key >> 3) * 2654435761u;
+
+	return (h ^ h >> 16) & (size - 1);
+}
+
+void
+wldbg_pointer_map_init(struct wldbg_pointer_map *map)
+{
+	memset(map, 0, sizeof *map);
+}
+
+void
+wldbg_pointer_map_release(struct wldbg_pointer_map *map,
+			  void (*destroy)(void *value))
+{
+	size_t i;
+
+	if (destroy) {
+		for (i = 0; i < map->size; ++i)
+			if (map->entries[i].key)
+				destroy(map->entries[i].value);
+	}
+
+	free(map->entries);
+	wldbg_pointer_map_init(map);
+}
+
+static int
+grow(struct wldbg_pointer_map *map)
+{
+	struct wldbg_pointer_map_entry *entries, *e;
+	size_t size, i, h;
+
+	size = map->size ? 2 * map->size : 32;
+	entries = calloc(size, sizeof *entries);
+	if (!entries)
+		return -1;
+
+	for (i = 0; i < map->size; ++i) {
+		e = &map->entries[i];
+		if (!e->key)
+			continue;
+
+		h = pointer_hash(e->key, size);
+		while (entries[h].key)
+			h = (h + 1) & (size - 1);
+
+		entries[h] = *e;
+	}
+
+	free(map->entries);
+	map->entries = entries;
+	map->size = size;
+
+	return 0;
+}
+
+/* returns the slot with the key or the empty slot where it would be */
+static size_t
+find_slot(const struct wldbg_pointer_map *map, const void *key)
+{
+	size_t h = pointer_hash(key, map->size);
+
+	while (map->entries[h].key && map->entries[h].key != key)
+		h = (h + 1) & (map->size - 1);
+
+	return h;
+}
+
+void *
+wldbg_pointer_map_get(const struct wldbg_pointer_map *map, const void *key)
+{
+	if (!map->size)
+		return NULL;
+
+	return map->entries[find_slot(map, key)].value;
+}
+
+int
+wldbg_pointer_map_insert(struct wldbg_pointer_map *map,
+			 const void *key, void *value)
+{
+	size_t h;
+
+	if (map->size) {
+		h = find_slot(map, key);
+		if (map->entries[h].key) {
+			map->entries[h].value = value;
+			return 0;
+		}
+	}
+
+	/* keep the load factor under 1/2 */
+	if (2 * (map->num + 1) > map->size && grow(map) < 0)
+		return -1;
+
+	h = find_slot(map, key);
+	map->entries[h].key = key;
+	map->entries[h].value = value;
+	++map->num;
+
+	return 0;
+}
+
+void *
+wldbg_pointer_map_remove(struct wldbg_pointer_map *map, const void *key)
+{
+	struct wldbg_pointer_map_entry *e;
+	size_t i, j, k, mask = map->size - 1;
+	void *value;
+
+	if (!map->size)
+		return NULL;
+
+	i = find_slot(map, key);
+	if (!map->entries[i].key)
+		return NULL;
+
+	value = map->entries[i].value;
+	map->entries[i].key = NULL;
+	map->entries[i].value = NULL;
+	--map->num;
+
+	/* move back the entries that would not be
+	 * found with the empty slot */
+	for (j = (i + 1) & mask; (e = &map->entries[j])->key;
+	     j = (j + 1) & mask) {
+		k = pointer_hash(e->key, map->size);
+		if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+
+		map->entries[i] = *e;
+		e->key = NULL;
+		e->value = NULL;
+		i = j;
+	}
+
+	return value;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WLDBG_HASH_H_
+#define _WLDBG_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* FNV-1a. The hash of more pieces of data is computed by passing
+ * the result for the previous piece as the hash for the next one,
+ * starting with the offset basis */
+
+#define WLDBG_FNV32_BASIS	2166136261u
+#define WLDBG_FNV32_PRIME	16777619u
+#define WLDBG_FNV64_BASIS	14695981039346656037ull
+#define WLDBG_FNV64_PRIME	1099511628211ull
+
+static inline uint32_t
+wldbg_fnv32(uint32_t hash, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+
+	while (len--) {
+		hash ^= *p++;
+		hash *= WLDBG_FNV32_PRIME;
+	}
+
+	return hash;
+}
+
+static inline uint32_t
+wldbg_fnv32_str(uint32_t hash, const char *str)
+{
+	while (*str) {
+		hash ^= (unsigned char) *str++;
+		hash *= WLDBG_FNV32_PRIME;
+	}
+
+	return hash;
+}
+
+static inline uint64_t
+wldbg_fnv64(uint64_t hash, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+
+	while (len--) {
+		hash ^= *p++;
+		hash *= WLDBG_FNV64_PRIME;
+	}
+
+	return hash;
+}
+
+/* Open addressing hash table with linear probing that maps pointers
+ * (like wl_interface or wl_message) to data. NULL key is not allowed,
+ * it marks an empty slot. NULL value means that the key is not
+ * in the map, so NULL can not be inserted either */
+
+struct wldbg_pointer_map_entry {
+	const void *key;
+	void *value;
+};
+
+struct wldbg_pointer_map {
+	struct wldbg_pointer_map_entry *entries;
+	/* always a power of two (or 0) */
+	size_t size;
+	size_t num;
+};
+
+void
+wldbg_pointer_map_init(struct wldbg_pointer_map *map);
+
+/* destroy is called for every value in the map if it is not NULL */
+void
+wldbg_pointer_map_release(struct wldbg_pointer_map *map,
+			  void (*destroy)(void *value));
+
+void *
+wldbg_pointer_map_get(const struct wldbg_pointer_map *map, const void *key);
+
+/* replaces the value if the key is already in the map.
+ * Returns -1 when out of memory */
+int
+wldbg_pointer_map_insert(struct wldbg_pointer_map *map,
+			 const void *key, void *value);
+
+/* returns the removed value or NULL if the key was not in the map */
+void *
+wldbg_pointer_map_remove(struct wldbg_pointer_map *map, const void *key);
+
+#endif /* _WLDBG_HASH_H_ */
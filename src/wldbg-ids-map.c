@@ -26,7 +26,6 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <assert.h>
 
 #include "wldbg.h"
 #include "wldbg-pass.h"
@@ -36,50 +35,160 @@ void
 wldbg_ids_map_init(struct wldbg_ids_map *map)
 {
 	map->count = 0;
-	wl_array_init(&map->data);
+	map->pages = NULL;
+	map->pages_count = 0;
 }
 
 void
 wldbg_ids_map_release(struct wldbg_ids_map *map)
 {
-	map->count = 0;
-	wl_array_release(&map->data);
+	uint32_t i;
+
+	for (i = 0; i < map->pages_count; ++i)
+		free(map->pages[i]);
+
+	free(map->pages);
+	wldbg_ids_map_init(map);
+}
+
+static void
+out_of_memory(void)
+{
+	/* this function is supposed to always succeed,
+	 * so in this case we cannot do nothing better
+	 * than abort(). We can't pass this slicently */
+	fprintf(stderr, "Out of memory");
+	abort();
+}
+
+/* resize the table of pages, so that it has
+ * place for pages_count pages */
+static void
+resize_pages(struct wldbg_ids_map *map, uint32_t pages_count)
+{
+	struct wldbg_ids_map_page **pages;
+
+	pages = realloc(map->pages, pages_count * sizeof *pages);
+	if (!pages) {
+		/* shrinking is not that important */
+		if (pages_count < map->pages_count)
+			return;
+
+		out_of_memory();
+	}
+
+	if (pages_count > map->pages_count)
+		memset(pages + map->pages_count, 0,
+		       (pages_count - map->pages_count) * sizeof *pages);
+
+	map->pages = pages;
+	map->pages_count = pages_count;
+}
+
+static struct wldbg_ids_map_page *
+get_page(struct wldbg_ids_map *map, uint32_t n)
+{
+	uint32_t pages_count;
+
+	if (n >= map->pages_count) {
+		pages_count = map->pages_count ? map->pages_count : 4;
+		while (pages_count <= n)
+			pages_count *= 2;
+
+		resize_pages(map, pages_count);
+	}
+
+	if (!map->pages[n]) {
+		map->pages[n] = calloc(1, sizeof *map->pages[n]);
+		if (!map->pages[n])
+			out_of_memory();
+	}
+
+	return map->pages[n];
+}
+
+/* the highest id was removed, find the new one and
+ * give back the memory that we do not need */
+static void
+shrink(struct wldbg_ids_map *map)
+{
+	struct wldbg_ids_map_page *page;
+	uint32_t n, i;
+
+	n = (map->count - 1) >> WLDBG_IDS_MAP_PAGE_SHIFT;
+	for (;;) {
+		page = map->pages[n];
+		if (page) {
+			for (i = WLDBG_IDS_MAP_PAGE_SIZE; i > 0; --i)
+				if (page->entries[i - 1])
+					break;
+
+			if (i > 0) {
+				map->count = (n << WLDBG_IDS_MAP_PAGE_SHIFT) + i;
+				break;
+			}
+		}
+
+		if (n == 0) {
+			map->count = 0;
+			break;
+		}
+
+		--n;
+	}
+
+	n = (map->count + WLDBG_IDS_MAP_PAGE_SIZE - 1)
+		>> WLDBG_IDS_MAP_PAGE_SHIFT;
+	if (map->pages_count > 4 && n < map->pages_count / 4)
+		resize_pages(map, map->pages_count / 2);
 }
 
 void
 wldbg_ids_map_insert(struct wldbg_ids_map *map, uint32_t id,
 		     void *data)
 {
+	struct wldbg_ids_map_page *page;
+	uint32_t n = id >> WLDBG_IDS_MAP_PAGE_SHIFT;
 	void **p;
-	size_t size;
-
-	if (id >= map->count) {
-		size = (id - map->count + 1) * sizeof(void *);
-		p = wl_array_add(&map->data, size);
-		if (!p) {
-			/* this function is supposed to always succeed,
-			 * so in this case we cannot do nothing better
-			 * than abort(). We can't pass this slicently */
-			fprintf(stderr, "Out of memory");
-			abort();
-		}
 
-		/* set newly allocated memory to 0s */
-		memset(p, 0, size);
+	if (!data) {
+		wldbg_ids_map_remove(map, id);
+		return;
 	}
 
-	p = ((void **) map->data.data) + id;
-	assert(p);
+	page = get_page(map, n);
+	p = &page->entries[id & (WLDBG_IDS_MAP_PAGE_SIZE - 1)];
+	if (!*p)
+		++page->used;
 
-	map->count = map->data.size / sizeof(void *);
 	*p = data;
+
+	if (id >= map->count)
+		map->count = id + 1;
 }
 
-void *
-wldbg_ids_map_get(struct wldbg_ids_map *map, uint32_t id)
+void
+wldbg_ids_map_remove(struct wldbg_ids_map *map, uint32_t id)
 {
-	if (id < map->count)
-		return ((void **) map->data.data)[id];
+	struct wldbg_ids_map_page *page;
+	uint32_t n = id >> WLDBG_IDS_MAP_PAGE_SHIFT;
+	void **p;
+
+	if (id >= map->count || !(page = map->pages[n]))
+		return;
+
+	p = &page->entries[id & (WLDBG_IDS_MAP_PAGE_SIZE - 1)];
+	if (!*p)
+		return;
+
+	*p = NULL;
+
+	/* nothing left in the page */
+	if (--page->used == 0) {
+		free(page);
+		map->pages[n] = NULL;
+	}
 
-	return NULL;
+	if (id == map->count - 1)
+		shrink(map);
 }
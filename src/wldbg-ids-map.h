@@ -29,10 +29,29 @@
 #include "wayland/wayland-util.h"
 
 /* we need just something like dynamic array. Wl_map is pain in the ass
- * for our purpose - belive me, I tried it ;) */
+ * for our purpose - belive me, I tried it ;)
+ * The array is split into pages that are allocated when an id
+ * from the page is inserted and freed when all ids in the page are
+ * removed, so that we do not copy the whole array when it grows
+ * and the memory is returned when clients destroy their objects.
+ * NULL value means that the id is not in the map */
+
+#define WLDBG_IDS_MAP_PAGE_SHIFT	8
+#define WLDBG_IDS_MAP_PAGE_SIZE		(1 << WLDBG_IDS_MAP_PAGE_SHIFT)
+
+struct wldbg_ids_map_page {
+	/* number of non-NULL entries */
+	unsigned int used;
+	void *entries[WLDBG_IDS_MAP_PAGE_SIZE];
+};
+
 struct wldbg_ids_map {
+	/* the highest id in the map + 1 */
 	uint32_t count;
-	struct wl_array data;
+
+	/* NULL for pages without entries */
+	struct wldbg_ids_map_page **pages;
+	uint32_t pages_count;
 };
 
 void
@@ -44,7 +63,23 @@ wldbg_ids_map_release(struct wldbg_ids_map *map);
 void
 wldbg_ids_map_insert(struct wldbg_ids_map *map, uint32_t id, void *data);
 
-void *
-wldbg_ids_map_get(struct wldbg_ids_map *map, uint32_t id);
+/* the same as inserting NULL */
+void
+wldbg_ids_map_remove(struct wldbg_ids_map *map, uint32_t id);
+
+static inline void *
+wldbg_ids_map_get(struct wldbg_ids_map *map, uint32_t id)
+{
+	struct wldbg_ids_map_page *page;
+
+	if (id >= map->count)
+		return NULL;
+
+	page = map->pages[id >> WLDBG_IDS_MAP_PAGE_SHIFT];
+	if (!page)
+		return NULL;
+
+	return page->entries[id & (WLDBG_IDS_MAP_PAGE_SIZE - 1)];
+}
 
 #endif /* _WLDBG_IDS_MAP_H_ */
@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "wayland/wayland-util.h"
+
+#include "wldbg-interfaces.h"
+#include "wldbg-hash.h"
+
+struct interface_entry {
+	char *name;
+	uint32_t hash;
+	/* NULL if we know only the name */
+	const struct wl_interface *interface;
+};
+
+static struct {
+	/* entries[0] is not used, index 0 means no interface */
+	struct interface_entry *entries;
+	unsigned int count;
+	unsigned int size;
+
+	/* open addressing hash table of indices to entries (0 is
+	 * an empty slot), keyed by the name */
+	unsigned int *names;
+	unsigned int names_size;
+	/* maps every wl_interface that we have seen
+	 * to the index of its name */
+	struct wldbg_pointer_map pointers;
+} registry;
+
+static inline uint32_t
+name_hash(const char *name)
+{
+	return wldbg_fnv32_str(WLDBG_FNV32_BASIS, name);
+}
+
+static int
+grow_names(void)
+{
+	unsigned int *names, size, i, h;
+
+	size = registry.names_size ? 2 * registry.names_size : 64;
+	names = calloc(size, sizeof *names);
+	if (!names)
+		return -1;
+
+	for (i = 1; i < registry.count; ++i) {
+		h = registry.entries[i].hash & (size - 1);
+		while (names[h])
+			h = (h + 1) & (size - 1);
+
+		names[h] = i;
+	}
+
+	free(registry.names);
+	registry.names = names;
+	registry.names_size = size;
+
+	return 0;
+}
+
+static unsigned int
+find_name(const char *name, uint32_t hash)
+{
+	unsigned int h, i;
+
+	if (!registry.names_size)
+		return 0;
+
+	h = hash & (registry.names_size - 1);
+	while ((i = registry.names[h])) {
+		if (registry.entries[i].hash == hash
+		    && strcmp(registry.entries[i].name, name) == 0)
+			return i;
+
+		h = (h + 1) & (registry.names_size - 1);
+	}
+
+	return 0;
+}
+
+static unsigned int
+add_name(const char *name, uint32_t hash)
+{
+	struct interface_entry *entries, *e;
+	unsigned int size, h;
+
+	/* keep the load factor under 1/2 */
+	if (2 * (registry.count + 1) > registry.names_size
+	    && grow_names() < 0)
+		goto err;
+
+	if (registry.count + 1 > registry.size) {
+		size = registry.size ? 2 * registry.size : 64;
+		entries = realloc(registry.entries, size * sizeof *entries);
+		if (!entries)
+			goto err;
+
+		registry.entries = entries;
+		registry.size = size;
+
+		/* reserve index 0 */
+		if (registry.count == 0) {
+			memset(&entries[0], 0, sizeof *entries);
+			registry.count = 1;
+		}
+	}
+
+	e = &registry.entries[registry.count];
+	e->name = strdup(name);
+	if (!e->name)
+		goto err;
+
+	e->hash = hash;
+	e->interface = NULL;
+
+	h = hash & (registry.names_size - 1);
+	while (registry.names[h])
+		h = (h + 1) & (registry.names_size - 1);
+
+	registry.names[h] = registry.count;
+
+	return registry.count++;
+
+err:
+	fprintf(stderr, "Out of memory, can not add interface '%s'\n", name);
+	return 0;
+}
+
+static unsigned int
+intern_name(const char *name)
+{
+	uint32_t hash = name_hash(name);
+	unsigned int index;
+
+	index = find_name(name, hash);
+	if (!index)
+		index = add_name(name, hash);
+
+	return index;
+}
+
+static inline unsigned int
+find_pointer(const struct wl_interface *intf)
+{
+	/* the indices are stored instead of pointers, 0 is not found */
+	return (uintptr_t) wldbg_pointer_map_get(&registry.pointers, intf);
+}
+
+static void
+add_pointer(const struct wl_interface *intf, unsigned int index)
+{
+	/* if it fails, we just won't find it by the pointer */
+	if (wldbg_pointer_map_insert(&registry.pointers, intf,
+				     (void *) (uintptr_t) index) < 0)
+		fprintf(stderr, "Out of memory\n");
+}
+
+unsigned int
+wldbg_interfaces_register(const struct wl_interface *intf)
+{
+	unsigned int index;
+
+	index = find_pointer(intf);
+	if (index)
+		return index;
+
+	index = intern_name(intf->name);
+	if (!index)
+		return 0;
+
+	/* if we already have an interface with this name,
+	 * keep the old one */
+	if (!registry.entries[index].interface)
+		registry.entries[index].interface = intf;
+
+	add_pointer(intf, index);
+
+	return index;
+}
+
+unsigned int
+wldbg_interfaces_name_index(const char *name)
+{
+	return intern_name(name);
+}
+
+unsigned int
+wldbg_interfaces_index(const struct wl_interface *intf)
+{
+	unsigned int index;
+
+	/* free_entry and unknown_interface have negative versions */
+	if (!intf || intf->version < 0)
+		return 0;
+
+	index = find_pointer(intf);
+	if (index)
+		return index;
+
+	return wldbg_interfaces_register(intf);
+}
+
+const struct wl_interface *
+wldbg_interfaces_lookup(const char *name)
+{
+	unsigned int index;
+
+	index = find_name(name, name_hash(name));
+	if (!index)
+		return NULL;
+
+	return registry.entries[index].interface;
+}
+
+const struct wl_interface *
+wldbg_interfaces_get(unsigned int index)
+{
+	if (index == 0 || index >= registry.count)
+		return NULL;
+
+	return registry.entries[index].interface;
+}
+
+void
+wldbg_interfaces_forget(const struct wl_interface *intf)
+{
+	unsigned int index;
+
+	index = (uintptr_t) wldbg_pointer_map_remove(&registry.pointers, intf);
+
+	/* the name keeps its index, only the interface goes away */
+	if (index && registry.entries[index].interface == intf)
+		registry.entries[index].interface = NULL;
+}
+
+unsigned int
+wldbg_interfaces_count(void)
+{
+	/* index 0 is always reserved */
+	return registry.count ? registry.count : 1;
+}
+
+void
+wldbg_interfaces_release(void)
+{
+	unsigned int i;
+
+	for (i = 1; i < registry.count; ++i)
+		free(registry.entries[i].name);
+
+	free(registry.entries);
+	free(registry.names);
+	wldbg_pointer_map_release(&registry.pointers, NULL);
+	memset(&registry, 0, sizeof registry);
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WLDBG_INTERFACES_H_
+#define _WLDBG_INTERFACES_H_
+
+#include <stdint.h>
+
+struct wl_interface;
+
+/*
+ * Registry of known interfaces. Every interface name is interned
+ * and gets a small index that stays the same while wldbg runs,
+ * so that the interfaces can be compared by the index and used
+ * to index tables instead of comparing the names.
+ * Index 0 means no (or unknown) interface.
+ */
+
+/* add interface to the registry. If there already is an interface
+ * with the same name, the old one is kept. Returns the index */
+unsigned int
+wldbg_interfaces_register(const struct wl_interface *intf);
+
+/* return the index for name. The name is interned if we do not
+ * know it yet, so the index does not change when an interface
+ * with this name is registered later */
+unsigned int
+wldbg_interfaces_name_index(const char *name);
+
+/* return the index of the interface, unknown interfaces are interned */
+unsigned int
+wldbg_interfaces_index(const struct wl_interface *intf);
+
+/* return interface registered under the name or NULL */
+const struct wl_interface *
+wldbg_interfaces_lookup(const char *name);
+
+/* return interface with the index or NULL */
+const struct wl_interface *
+wldbg_interfaces_get(unsigned int index);
+
+/* remove the interface before it is freed. Its name keeps
+ * the index, so the interface can be registered again */
+void
+wldbg_interfaces_forget(const struct wl_interface *intf);
+
+/* number of indices in use, including the index 0 */
+unsigned int
+wldbg_interfaces_count(void);
+
+void
+wldbg_interfaces_release(void);
+
+#endif /* _WLDBG_INTERFACES_H_ */
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "wldbg-lz.h"
+
+#define LZ_MIN_MATCH	4
+#define LZ_MAX_OFFSET	65535
+#define LZ_HASH_BITS	12
+/* no matches start in the last bytes, the compressor
+ * reads 4 bytes at once */
+#define LZ_LAST_LITERALS 5
+/* after this many misses in a row we start skipping bytes,
+ * data that do not compress are not slowing us down much then */
+#define LZ_SKIP_TRIGGER	6
+
+static inline uint32_t
+read32(const unsigned char *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof v);
+	return v;
+}
+
+static inline uint32_t
+hash4(uint32_t v)
+{
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* write the length that did not fit into the token */
+static unsigned char *
+write_length(unsigned char *op, const unsigned char *oend, size_t len)
+{
+	while (len >= 255) {
+		if (op == oend)
+			return NULL;
+		*op++ = 255;
+		len -= 255;
+	}
+
+	if (op == oend)
+		return NULL;
+	*op++ = len;
+
+	return op;
+}
+
+static unsigned char *
+write_sequence(unsigned char *op, const unsigned char *oend,
+	       const unsigned char *literals, size_t literal_len,
+	       size_t offset, size_t match_len)
+{
+	unsigned char *token;
+
+	if (op == oend)
+		return NULL;
+
+	token = op++;
+	*token = (literal_len < 15 ? literal_len : 15) << 4;
+	if (literal_len >= 15) {
+		op = write_length(op, oend, literal_len - 15);
+		if (!op)
+			return NULL;
+	}
+
+	if ((size_t) (oend - op) < literal_len)
+		return NULL;
+	memcpy(op, literals, literal_len);
+	op += literal_len;
+
+	/* the last sequence */
+	if (match_len == 0)
+		return op;
+
+	if (oend - op < 2)
+		return NULL;
+	*op++ = offset & 0xff;
+	*op++ = offset >> 8;
+
+	match_len -= LZ_MIN_MATCH;
+	*token |= match_len < 15 ? match_len : 15;
+	if (match_len >= 15)
+		op = write_length(op, oend, match_len - 15);
+
+	return op;
+}
+
+size_t
+wldbg_lz_compress(const void *src, size_t size, void *dst, size_t dst_size)
+{
+	uint32_t table[1 << LZ_HASH_BITS];
+	const unsigned char *base = src, *ip = base, *anchor = base;
+	const unsigned char *iend = base + size, *mlimit, *ref;
+	unsigned char *op = dst, *oend = op + dst_size;
+	unsigned int misses = 0;
+	uint32_t h, pos;
+
+	if (size > LZ_LAST_LITERALS + LZ_MIN_MATCH) {
+		/* positions + 1, 0 is an empty slot */
+		memset(table, 0, sizeof table);
+		mlimit = iend - LZ_LAST_LITERALS;
+
+		while (ip + LZ_MIN_MATCH <= mlimit) {
+			h = hash4(read32(ip));
+			pos = table[h];
+			table[h] = ip - base + 1;
+			ref = pos ? base + pos - 1 : NULL;
+
+			if (ref && ip - ref <= LZ_MAX_OFFSET
+			    && read32(ref) == read32(ip)) {
+				const unsigned char *start = ip, *m = ref;
+
+				/* extend the match backwards over literals */
+				while (start > anchor && m > base
+				       && start[-1] == m[-1]) {
+					--start;
+					--m;
+				}
+
+				ip += LZ_MIN_MATCH;
+				ref += LZ_MIN_MATCH;
+				while (ip < mlimit && *ip == *ref) {
+					++ip;
+					++ref;
+				}
+
+				op = write_sequence(op, oend, anchor,
+						    start - anchor, start - m,
+						    ip - start);
+				if (!op)
+					return 0;
+
+				anchor = ip;
+				misses = 0;
+				continue;
+			}
+
+			ip += 1 + (misses++ >> LZ_SKIP_TRIGGER);
+		}
+	}
+
+	op = write_sequence(op, oend, anchor, iend - anchor, 0, 0);
+	if (!op)
+		return 0;
+
+	return op - (unsigned char *) dst;
+}
+
+static int
+read_length(const unsigned char **ip, const unsigned char *iend, size_t *len)
+{
+	unsigned char c;
+
+	do {
+		if (*ip == iend)
+			return -1;
+
+		c = *(*ip)++;
+		*len += c;
+	} while (c == 255);
+
+	return 0;
+}
+
+int
+wldbg_lz_decompress(const void *src, size_t size, void *dst, size_t dst_size)
+{
+	const unsigned char *ip = src, *iend = ip + size;
+	unsigned char *op = dst, *oend = op + dst_size;
+	size_t len, offset;
+	unsigned char token;
+
+	while (ip < iend) {
+		token = *ip++;
+
+		len = token >> 4;
+		if (len == 15 && read_length(&ip, iend, &len) < 0)
+			return -1;
+
+		if ((size_t) (iend - ip) < len || (size_t) (oend - op) < len)
+			return -1;
+		memcpy(op, ip, len);
+		ip += len;
+		op += len;
+
+		/* the last sequence has no match */
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return -1;
+		offset = ip[0] | ip[1] << 8;
+		ip += 2;
+
+		len = token & 15;
+		if (len == 15 && read_length(&ip, iend, &len) < 0)
+			return -1;
+		len += LZ_MIN_MATCH;
+
+		if (offset == 0 || offset > (size_t) (op - (unsigned char *) dst)
+		    || (size_t) (oend - op) < len)
+			return -1;
+
+		/* the match can overlap with what it produces */
+		if (offset >= len) {
+			memcpy(op, op - offset, len);
+			op += len;
+		} else {
+			while (len--) {
+				*op = op[-offset];
+				++op;
+			}
+		}
+	}
+
+	return op == oend ? 0 : -1;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WLDBG_LZ_H_
+#define _WLDBG_LZ_H_
+
+#include <stddef.h>
+
+/*
+ * A small LZ77 compressor for blocks of traces. It is in the spirit
+ * of LZ4: byte-oriented, no entropy coding, so both directions are
+ * fast. The compressed data are sequences of
+ *
+ *   token | literal length | literals | offset | match length
+ *
+ * where the upper 4 bits of the token are the number of literals and
+ * the lower 4 bits are the length of the match minus 4. If a length
+ * does not fit into 4 bits (is 15), it continues in the next bytes,
+ * each of them is added to it until a byte is not 255. The offset
+ * is 2 bytes, little endian. The last sequence has only literals.
+ */
+
+/* the most that compressing size bytes can produce */
+static inline size_t
+wldbg_lz_bound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+/* compress src into dst. Returns the size of the compressed data
+ * or 0 if they do not fit into dst_size bytes */
+size_t
+wldbg_lz_compress(const void *src, size_t size, void *dst, size_t dst_size);
+
+/* decompress src into dst, the decompressed data must be exactly
+ * dst_size bytes. Returns -1 if the data are corrupted */
+int
+wldbg_lz_decompress(const void *src, size_t size, void *dst, size_t dst_size);
+
+#endif /* _WLDBG_LZ_H_ */
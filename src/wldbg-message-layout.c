@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "wayland/wayland-util.h"
+
+#include "wldbg-message-layout.h"
+#include "wldbg-hash.h"
+#include "util.h"
+
+/* compiled layouts, keyed by the message */
+static struct wldbg_pointer_map layouts;
+
+static struct wldbg_message_layout *
+compile(const struct wl_message *message)
+{
+	struct wldbg_message_layout *layout;
+	struct wldbg_arg_layout *arg;
+	const char *sig = message->signature;
+	int offset = 0, variable;
+	uint32_t bit;
+
+	if (!sig)
+		return NULL;
+
+	layout = calloc(1, sizeof *layout);
+	if (!layout)
+		return NULL;
+
+	layout->message = message;
+	layout->first_variable = WLDBG_LAYOUT_MAX_ARGS;
+
+	layout->since = atoi(sig);
+	if (layout->since == 0)
+		layout->since = 1;
+
+	for (; *sig; ++sig) {
+		bit = 1u << layout->arg_count;
+
+		if (*sig >= '0' && *sig <= '9')
+			continue;
+
+		if (*sig == '?') {
+			layout->nullable |= bit;
+			continue;
+		}
+
+		if (!strchr("iufsonah", *sig)
+		    || layout->arg_count == WLDBG_LAYOUT_MAX_ARGS)
+			goto err;
+
+		variable = *sig == 's' || *sig == 'a';
+
+		arg = &layout->args[layout->arg_count];
+		arg->type = *sig;
+		arg->offset = offset;
+
+		/* we know offsets only until the first
+		 * argument of variable length */
+		if (variable) {
+			layout->variable |= bit;
+			if (layout->first_variable == WLDBG_LAYOUT_MAX_ARGS)
+				layout->first_variable = layout->arg_count;
+			offset = -1;
+		} else if (offset >= 0) {
+			++offset;
+		}
+
+		if (*sig == 'n')
+			layout->new_ids[layout->new_id_count++]
+				= layout->arg_count;
+
+		++layout->arg_count;
+	}
+
+	if (layout->first_variable == WLDBG_LAYOUT_MAX_ARGS)
+		layout->first_variable = layout->arg_count;
+
+	return layout;
+
+err:
+	free(layout);
+	return NULL;
+}
+
+const struct wldbg_message_layout *
+wldbg_message_layout_get(const struct wl_message *message)
+{
+	struct wldbg_message_layout *layout;
+
+	if (!message)
+		return NULL;
+
+	layout = wldbg_pointer_map_get(&layouts, message);
+	if (layout)
+		return layout;
+
+	layout = compile(message);
+	if (!layout)
+		return NULL;
+
+	if (wldbg_pointer_map_insert(&layouts, message, layout) < 0) {
+		free(layout);
+		return NULL;
+	}
+
+	return layout;
+}
+
+int
+wldbg_message_layout_arg_offset(const struct wldbg_message_layout *layout,
+				const uint32_t *args, size_t words,
+				unsigned int arg)
+{
+	size_t off;
+	unsigned int i;
+
+	if (arg >= layout->arg_count)
+		return -1;
+
+	if (layout->args[arg].offset >= 0) {
+		off = layout->args[arg].offset;
+	} else {
+		/* skip strings and arrays from the first one */
+		off = layout->first_variable;
+		for (i = layout->first_variable; i < arg; ++i) {
+			if (off >= words)
+				return -1;
+
+			if (layout->variable & (1u << i))
+				off += 1 + DIV_ROUNDUP(args[off],
+						       sizeof(uint32_t));
+			else
+				++off;
+		}
+	}
+
+	if (off >= words)
+		return -1;
+
+	return off;
+}
+
+void
+wldbg_message_layout_forget(const struct wl_message *messages,
+			    unsigned int count)
+{
+	unsigned int i;
+
+	if (!messages)
+		return;
+
+	for (i = 0; i < count; ++i)
+		free(wldbg_pointer_map_remove(&layouts, &messages[i]));
+}
+
+void
+wldbg_message_layout_release(void)
+{
+	wldbg_pointer_map_release(&layouts, free);
+}
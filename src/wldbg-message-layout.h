@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WLDBG_MESSAGE_LAYOUT_H_
+#define _WLDBG_MESSAGE_LAYOUT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct wl_message;
+
+/* the same as WL_CLOSURE_MAX_ARGS */
+#define WLDBG_LAYOUT_MAX_ARGS 20
+
+/*
+ * Layout of arguments of a message, compiled once from the signature,
+ * so that we do not need to parse the signature ('?', version digits)
+ * for every message that goes through wldbg.
+ * Layouts are cached by the wl_message pointer.
+ */
+
+struct wldbg_arg_layout {
+	/* one of "iufsonah" */
+	char type;
+	/* offset in 32-bit words from the first argument,
+	 * -1 if there is a string or an array before the argument */
+	int8_t offset;
+};
+
+struct wldbg_message_layout {
+	const struct wl_message *message;
+
+	unsigned int arg_count;
+	/* version from the signature */
+	int since;
+
+	/* bit i is set if argument i can be null */
+	uint32_t nullable;
+	/* bit i is set if argument i is a string or an array */
+	uint32_t variable;
+
+	/* index of the first string or array (arg_count if there is none).
+	 * It is also the offset of that argument, all previous are one word */
+	unsigned int first_variable;
+
+	/* indices of new_id arguments. The same indices are to wl_message.types */
+	unsigned int new_id_count;
+	uint8_t new_ids[WLDBG_LAYOUT_MAX_ARGS];
+
+	struct wldbg_arg_layout args[WLDBG_LAYOUT_MAX_ARGS];
+};
+
+/* return the layout of the message, compile it if we see
+ * the message for the first time. Returns NULL if the
+ * signature is invalid or we are out of memory */
+const struct wldbg_message_layout *
+wldbg_message_layout_get(const struct wl_message *message);
+
+/* return offset of the argument in 32-bit words from the first argument
+ * (args) or -1 if the argument is not in the words that we have */
+int
+wldbg_message_layout_arg_offset(const struct wldbg_message_layout *layout,
+				const uint32_t *args, size_t words,
+				unsigned int arg);
+
+/* remove layouts of the messages, must be called before
+ * the messages are freed, so that new messages at the same
+ * address do not get a wrong layout */
+void
+wldbg_message_layout_forget(const struct wl_message *messages,
+			    unsigned int count);
+
+void
+wldbg_message_layout_release(void);
+
+#endif /* _WLDBG_MESSAGE_LAYOUT_H_ */
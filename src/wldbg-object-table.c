@@ -0,0 +1,411 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* for WL_SERVER_ID_START */
+#include "wayland/wayland-private.h"
+
+#include "wldbg-object-table.h"
+#include "wldbg-interfaces.h"
+
+#define SLOT(id) ((id) & (WLDBG_IDS_MAP_PAGE_SIZE - 1))
+
+void
+wldbg_object_table_init(struct wldbg_object_table *table)
+{
+	wldbg_ids_map_init(&table->pages[0]);
+	wldbg_ids_map_init(&table->pages[1]);
+	table->seq = 0;
+	table->interfaces = NULL;
+	table->interfaces_count = 0;
+	table->interfaces_size = 0;
+	table->slots = NULL;
+	table->slots_size = 0;
+}
+
+static void
+release_pages(struct wldbg_ids_map *pages)
+{
+	uint32_t n;
+
+	for (n = 0; n < pages->count; ++n)
+		free(wldbg_ids_map_get(pages, n));
+
+	wldbg_ids_map_release(pages);
+}
+
+void
+wldbg_object_table_release(struct wldbg_object_table *table)
+{
+	release_pages(&table->pages[0]);
+	release_pages(&table->pages[1]);
+	free(table->interfaces);
+	free(table->slots);
+	wldbg_object_table_init(table);
+}
+
+static void
+out_of_memory(void)
+{
+	/* the same as in wldbg-ids-map.c, we can not
+	 * lose objects silently */
+	fprintf(stderr, "Out of memory");
+	abort();
+}
+
+/* return the directory of pages for id and make id
+ * relative to the first id in the directory */
+static struct wldbg_ids_map *
+get_pages(struct wldbg_object_table *table, uint32_t *id)
+{
+	if (*id >= WL_SERVER_ID_START) {
+		*id -= WL_SERVER_ID_START;
+		return &table->pages[1];
+	}
+
+	return &table->pages[0];
+}
+
+static struct wldbg_object_page *
+get_page(struct wldbg_object_table *table, uint32_t *id)
+{
+	struct wldbg_ids_map *pages = get_pages(table, id);
+
+	return wldbg_ids_map_get(pages, *id >> WLDBG_IDS_MAP_PAGE_SHIFT);
+}
+
+static struct wldbg_object_page *
+get_or_create_page(struct wldbg_object_table *table, uint32_t *id)
+{
+	struct wldbg_ids_map *pages = get_pages(table, id);
+	struct wldbg_object_page *page;
+	uint32_t n = *id >> WLDBG_IDS_MAP_PAGE_SHIFT;
+
+	page = wldbg_ids_map_get(pages, n);
+	if (page)
+		return page;
+
+	page = calloc(1, sizeof *page);
+	if (!page)
+		out_of_memory();
+
+	wldbg_ids_map_insert(pages, n, page);
+	return page;
+}
+
+/* the id stopped being live or lost its info */
+static void
+put_page(struct wldbg_object_table *table, uint32_t id,
+	 struct wldbg_object_page *page, unsigned int slot)
+{
+	struct wldbg_ids_map *pages;
+
+	if ((page->flags[slot] & WLDBG_OBJECT_LIVE) || page->info[slot])
+		return;
+
+	if (--page->used > 0)
+		return;
+
+	/* nothing left in the page. The generations
+	 * start from the beginning if the page is created again */
+	pages = get_pages(table, &id);
+	wldbg_ids_map_remove(pages, id >> WLDBG_IDS_MAP_PAGE_SHIFT);
+	free(page);
+}
+
+static void
+grow_slots(struct wldbg_object_table *table, unsigned int index)
+{
+	uint16_t *slots;
+	unsigned int size;
+
+	size = table->slots_size ? table->slots_size : 32;
+	while (size <= index)
+		size *= 2;
+
+	slots = realloc(table->slots, size * sizeof *slots);
+	if (!slots)
+		out_of_memory();
+
+	memset(slots + table->slots_size, 0,
+	       (size - table->slots_size) * sizeof *slots);
+	table->slots = slots;
+	table->slots_size = size;
+}
+
+static unsigned int
+add_interface(struct wldbg_object_table *table, unsigned int index,
+	      const struct wl_interface *intf)
+{
+	struct wldbg_object_interface *interfaces;
+	unsigned int size, slot;
+
+	if (table->interfaces_count == 0)
+		/* slot 0 is the unknown interface */
+		table->interfaces_count = 1;
+
+	if (table->interfaces_count >= table->interfaces_size) {
+		size = table->interfaces_size ? table->interfaces_size * 2 : 32;
+		interfaces = realloc(table->interfaces,
+				     size * sizeof *interfaces);
+		if (!interfaces)
+			out_of_memory();
+
+		memset(interfaces + table->interfaces_size, 0,
+		       (size - table->interfaces_size) * sizeof *interfaces);
+		table->interfaces = interfaces;
+		table->interfaces_size = size;
+	}
+
+	slot = table->interfaces_count++;
+	table->interfaces[slot].interface = intf;
+	table->interfaces[slot].index = index;
+	table->interfaces[slot].next = 0;
+
+	return slot;
+}
+
+/* return the slot for the interface. Interfaces with the same name
+ * have the same index, so we look also at the version. When there
+ * are more interfaces with the same name and version (e. g. one
+ * from the protocol files and one from the client's binary),
+ * the first one used in the connection is kept */
+static unsigned int
+get_interface_slot(struct wldbg_object_table *table, unsigned int index,
+		   const struct wl_interface *intf)
+{
+	unsigned int slot, last = 0;
+
+	if (index >= table->slots_size)
+		grow_slots(table, index);
+
+	for (slot = table->slots[index]; slot != 0;
+	     slot = table->interfaces[slot].next) {
+		if (table->interfaces[slot].interface == intf
+		    || table->interfaces[slot].interface->version
+		       == intf->version)
+			return slot;
+
+		last = slot;
+	}
+
+	if (table->interfaces_count >= (1 << 16))
+		return 0;
+
+	slot = add_interface(table, index, intf);
+	if (last)
+		table->interfaces[last].next = slot;
+	else
+		table->slots[index] = slot;
+
+	return slot;
+}
+
+unsigned int
+wldbg_object_table_create(struct wldbg_object_table *table, uint32_t id,
+			  const struct wl_interface *intf)
+{
+	struct wldbg_object_page *page;
+	unsigned int slot = SLOT(id);
+	unsigned int index = 0, intf_slot = 0;
+
+	if (intf) {
+		index = wldbg_interfaces_index(intf);
+		intf_slot = get_interface_slot(table, index, intf);
+		if (intf_slot == 0) {
+			fprintf(stderr, "Too many interfaces, object %u "
+				"has unknown interface\n", id);
+			index = 0;
+		}
+	}
+
+	page = get_or_create_page(table, &id);
+	if (!(page->flags[slot] & WLDBG_OBJECT_LIVE) && !page->info[slot])
+		++page->used;
+
+	page->interface[slot] = intf_slot;
+	page->flags[slot] = WLDBG_OBJECT_LIVE;
+	++page->generation[slot];
+	page->seq[slot] = table->seq++;
+
+	return index;
+}
+
+void
+wldbg_object_table_delete(struct wldbg_object_table *table, uint32_t id)
+{
+	struct wldbg_object_page *page;
+	uint32_t orig_id = id;
+	unsigned int slot = SLOT(id);
+
+	page = get_page(table, &id);
+	if (!page || !(page->flags[slot] & WLDBG_OBJECT_LIVE))
+		return;
+
+	page->flags[slot] &= ~WLDBG_OBJECT_LIVE;
+	put_page(table, orig_id, page, slot);
+}
+
+const struct wl_interface *
+wldbg_object_table_get_interface(struct wldbg_object_table *table,
+				 uint32_t id, unsigned int *flags)
+{
+	struct wldbg_object_page *page;
+	unsigned int slot = SLOT(id);
+
+	page = get_page(table, &id);
+	if (!page || !(page->flags[slot] & WLDBG_OBJECT_LIVE)) {
+		*flags = 0;
+		return NULL;
+	}
+
+	*flags = page->flags[slot];
+	/* the slot is 0 for unknown interfaces */
+	if (page->interface[slot] == 0)
+		return NULL;
+
+	return table->interfaces[page->interface[slot]].interface;
+}
+
+static void
+fill_object(struct wldbg_object_table *table, struct wldbg_object *obj,
+	    uint32_t id, struct wldbg_object_page *page, unsigned int slot)
+{
+	struct wldbg_object_interface *oi;
+
+	obj->id = id;
+	if (page->interface[slot] == 0) {
+		obj->interface = NULL;
+		obj->interface_index = 0;
+	} else {
+		oi = &table->interfaces[page->interface[slot]];
+		obj->interface = oi->interface;
+		obj->interface_index = oi->index;
+	}
+
+	obj->flags = page->flags[slot];
+	obj->generation = page->generation[slot];
+	obj->seq = page->seq[slot];
+	obj->info = page->info[slot];
+}
+
+int
+wldbg_object_table_get(struct wldbg_object_table *table, uint32_t id,
+		       struct wldbg_object *obj)
+{
+	struct wldbg_object_page *page;
+	uint32_t orig_id = id;
+	unsigned int slot = SLOT(id);
+
+	page = get_page(table, &id);
+	if (!page
+	    || (!(page->flags[slot] & WLDBG_OBJECT_LIVE) && !page->info[slot]))
+		return 0;
+
+	fill_object(table, obj, orig_id, page, slot);
+	return 1;
+}
+
+void *
+wldbg_object_table_get_info(struct wldbg_object_table *table, uint32_t id)
+{
+	struct wldbg_object_page *page;
+	unsigned int slot = SLOT(id);
+
+	page = get_page(table, &id);
+	if (!page)
+		return NULL;
+
+	return page->info[slot];
+}
+
+void
+wldbg_object_table_set_info(struct wldbg_object_table *table, uint32_t id,
+			    void *info)
+{
+	struct wldbg_object_page *page;
+	uint32_t orig_id = id;
+	unsigned int slot = SLOT(id);
+
+	if (!info) {
+		page = get_page(table, &id);
+		if (!page || !page->info[slot])
+			return;
+
+		page->info[slot] = NULL;
+		put_page(table, orig_id, page, slot);
+		return;
+	}
+
+	page = get_or_create_page(table, &id);
+	if (!(page->flags[slot] & WLDBG_OBJECT_LIVE) && !page->info[slot])
+		++page->used;
+
+	page->info[slot] = info;
+}
+
+static void
+pages_for_each(struct wldbg_object_table *table, struct wldbg_ids_map *pages,
+	       uint32_t first_id,
+	       void (*func)(struct wldbg_object *obj, void *data),
+	       void *data)
+{
+	struct wldbg_object_page *page;
+	struct wldbg_object obj;
+	uint32_t n;
+	unsigned int slot;
+
+	for (n = 0; n < pages->count; ++n) {
+		page = wldbg_ids_map_get(pages, n);
+		if (!page)
+			continue;
+
+		for (slot = 0; slot < WLDBG_IDS_MAP_PAGE_SIZE; ++slot) {
+			if (!(page->flags[slot] & WLDBG_OBJECT_LIVE)
+			    && !page->info[slot])
+				continue;
+
+			fill_object(table, &obj,
+				    first_id + (n << WLDBG_IDS_MAP_PAGE_SHIFT)
+				    + slot, page, slot);
+			/* func must not change the table, it could
+			 * free the page */
+			func(&obj, data);
+		}
+	}
+}
+
+void
+wldbg_object_table_for_each(struct wldbg_object_table *table,
+			    void (*func)(struct wldbg_object *obj, void *data),
+			    void *data)
+{
+	pages_for_each(table, &table->pages[0], 0, func, data);
+	pages_for_each(table, &table->pages[1], WL_SERVER_ID_START,
+		       func, data);
+}
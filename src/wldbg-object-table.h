@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WLDBG_OBJECT_TABLE_H_
+#define _WLDBG_OBJECT_TABLE_H_
+
+#include <stdint.h>
+
+#include "wldbg-ids-map.h"
+
+struct wl_interface;
+
+/*
+ * Table of objects in a connection. Everything that we know
+ * about an id is in one place: the interface (resolving objects)
+ * and the info (gathering objinfo). The table is split into pages
+ * of WLDBG_IDS_MAP_PAGE_SIZE ids and every page keeps the columns
+ * in separate arrays, so looking up an interface touches only
+ * the interface and flags columns.
+ */
+
+/* flags of an object */
+enum {
+	/* the object was created and not deleted yet */
+	WLDBG_OBJECT_LIVE	= 1,
+};
+
+struct wldbg_object_page {
+	/* number of ids that are live or have info */
+	unsigned int used;
+
+	/* slot in wldbg_object_table.interfaces, 0 if unknown */
+	uint16_t interface[WLDBG_IDS_MAP_PAGE_SIZE];
+	uint16_t flags[WLDBG_IDS_MAP_PAGE_SIZE];
+	/* how many times the id was created */
+	uint32_t generation[WLDBG_IDS_MAP_PAGE_SIZE];
+	/* value of wldbg_object_table.seq when the object was created */
+	uint32_t seq[WLDBG_IDS_MAP_PAGE_SIZE];
+	/* struct wldbg_object_info * */
+	void *info[WLDBG_IDS_MAP_PAGE_SIZE];
+};
+
+struct wldbg_object_interface {
+	const struct wl_interface *interface;
+	/* index in the registry */
+	unsigned int index;
+	/* next slot with the same index, 0 if none */
+	uint16_t next;
+};
+
+struct wldbg_object_table {
+	/* pages for client ids and server ids (from WL_SERVER_ID_START).
+	 * These are indexed by the number of the page */
+	struct wldbg_ids_map pages[2];
+
+	/* number of objects created so far */
+	uint32_t seq;
+
+	/* interfaces used in this connection. We need it because
+	 * the interfaces from the client's binaries are not in the
+	 * registry. The registry has one index for a name, but
+	 * the connection can use more versions of an interface,
+	 * so the interfaces are keyed by the index and the version.
+	 * Slot 0 is the unknown interface */
+	struct wldbg_object_interface *interfaces;
+	unsigned int interfaces_count;
+	unsigned int interfaces_size;
+
+	/* the first slot for an index from the registry, 0 if none */
+	uint16_t *slots;
+	unsigned int slots_size;
+};
+
+/* an object gathered from the columns */
+struct wldbg_object {
+	uint32_t id;
+	/* NULL if unknown */
+	const struct wl_interface *interface;
+	unsigned int interface_index;
+	unsigned int flags;
+	uint32_t generation;
+	uint32_t seq;
+	void *info;
+};
+
+void
+wldbg_object_table_init(struct wldbg_object_table *table);
+
+void
+wldbg_object_table_release(struct wldbg_object_table *table);
+
+/* create an object, intf can be NULL if we do not know the interface.
+ * Returns the index of the interface in the registry */
+unsigned int
+wldbg_object_table_create(struct wldbg_object_table *table, uint32_t id,
+			  const struct wl_interface *intf);
+
+/* the object was deleted, its info is kept */
+void
+wldbg_object_table_delete(struct wldbg_object_table *table, uint32_t id);
+
+/* get the interface of a live object. Returns NULL and sets flags
+ * to 0 when there is no such object. The interface can be NULL
+ * also for a live object when we do not know its interface */
+const struct wl_interface *
+wldbg_object_table_get_interface(struct wldbg_object_table *table,
+				 uint32_t id, unsigned int *flags);
+
+/* fill obj, returns 0 if the id is neither live nor has info */
+int
+wldbg_object_table_get(struct wldbg_object_table *table, uint32_t id,
+		       struct wldbg_object *obj);
+
+void *
+wldbg_object_table_get_info(struct wldbg_object_table *table, uint32_t id);
+
+/* info can be NULL to remove it */
+void
+wldbg_object_table_set_info(struct wldbg_object_table *table, uint32_t id,
+			    void *info);
+
+/* call func for every id that is live or has info, in the order
+ * of ids. func must not change the table */
+void
+wldbg_object_table_for_each(struct wldbg_object_table *table,
+			    void (*func)(struct wldbg_object *obj, void *data),
+			    void *data);
+
+#endif /* _WLDBG_OBJECT_TABLE_H_ */
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+/* for WL_SERVER_ID_START */
+#include "wayland/wayland-private.h"
+
+#include "wldbg-objects-index.h"
+
+#define SLOT(id) ((id) & (WLDBG_IDS_MAP_PAGE_SIZE - 1))
+
+void
+wldbg_objects_index_init(struct wldbg_objects_index *index)
+{
+	index->sets = NULL;
+	index->sets_count = 0;
+	wldbg_ids_map_init(&index->pages[0]);
+	wldbg_ids_map_init(&index->pages[1]);
+}
+
+static void
+release_pages(struct wldbg_ids_map *pages)
+{
+	uint32_t n;
+
+	for (n = 0; n < pages->count; ++n)
+		free(wldbg_ids_map_get(pages, n));
+
+	wldbg_ids_map_release(pages);
+}
+
+void
+wldbg_objects_index_release(struct wldbg_objects_index *index)
+{
+	unsigned int i;
+
+	for (i = 0; i < index->sets_count; ++i)
+		wl_array_release(&index->sets[i]);
+
+	free(index->sets);
+	release_pages(&index->pages[0]);
+	release_pages(&index->pages[1]);
+	wldbg_objects_index_init(index);
+}
+
+/* return the directory of pages for id and make id
+ * relative to the first id in the directory */
+static struct wldbg_ids_map *
+get_pages(struct wldbg_objects_index *index, uint32_t *id)
+{
+	if (*id >= WL_SERVER_ID_START) {
+		*id -= WL_SERVER_ID_START;
+		return &index->pages[1];
+	}
+
+	return &index->pages[0];
+}
+
+/* return the page of id. If create is set, create the
+ * page if it does not exist (NULL when out of memory) */
+static struct wldbg_objects_index_page *
+get_page(struct wldbg_objects_index *index, uint32_t id, int create)
+{
+	struct wldbg_ids_map *pages = get_pages(index, &id);
+	struct wldbg_objects_index_page *page;
+	uint32_t n = id >> WLDBG_IDS_MAP_PAGE_SHIFT;
+
+	page = wldbg_ids_map_get(pages, n);
+	if (page || !create)
+		return page;
+
+	page = calloc(1, sizeof *page);
+	if (!page)
+		return NULL;
+
+	wldbg_ids_map_insert(pages, n, page);
+	return page;
+}
+
+static void
+put_page(struct wldbg_objects_index *index, uint32_t id,
+	 struct wldbg_objects_index_page *page)
+{
+	struct wldbg_ids_map *pages;
+
+	if (--page->used > 0)
+		return;
+
+	pages = get_pages(index, &id);
+	wldbg_ids_map_remove(pages, id >> WLDBG_IDS_MAP_PAGE_SHIFT);
+	free(page);
+}
+
+static int
+grow_sets(struct wldbg_objects_index *index, unsigned int interface)
+{
+	struct wl_array *sets;
+	unsigned int count, i;
+
+	count = index->sets_count ? index->sets_count : 32;
+	while (count <= interface)
+		count *= 2;
+
+	sets = realloc(index->sets, count * sizeof *sets);
+	if (!sets)
+		return -1;
+
+	for (i = index->sets_count; i < count; ++i)
+		wl_array_init(&sets[i]);
+
+	index->sets = sets;
+	index->sets_count = count;
+
+	return 0;
+}
+
+/* remove id that is in the page from its set */
+static void
+remove_from_set(struct wldbg_objects_index *index, uint32_t id,
+		struct wldbg_objects_index_page *page)
+{
+	unsigned int slot = SLOT(id);
+	struct wl_array *set = &index->sets[page->interface[slot]];
+	struct wldbg_objects_index_page *last_page;
+	uint32_t *ids = set->data, pos = page->position[slot], last;
+	unsigned int count = set->size / sizeof *ids;
+
+	/* move the last id in the place of the removed one */
+	last = ids[count - 1];
+	ids[pos] = last;
+	last_page = get_page(index, last, 0);
+	last_page->position[SLOT(last)] = pos;
+	set->size -= sizeof *ids;
+
+	page->interface[slot] = 0;
+}
+
+int
+wldbg_objects_index_add(struct wldbg_objects_index *index,
+			uint32_t id, unsigned int interface)
+{
+	struct wldbg_objects_index_page *page;
+	struct wl_array *set;
+	unsigned int slot = SLOT(id);
+	uint32_t *p;
+
+	/* no interface */
+	if (interface == 0)
+		return 0;
+
+	page = get_page(index, id, 0);
+	if (page && page->interface[slot] == interface)
+		return 0;
+
+	if (interface >= index->sets_count && grow_sets(index, interface) < 0)
+		return -1;
+
+	set = &index->sets[interface];
+	p = wl_array_add(set, sizeof *p);
+	if (!p)
+		return -1;
+
+	if (!page) {
+		page = get_page(index, id, 1);
+		if (!page) {
+			set->size -= sizeof *p;
+			return -1;
+		}
+	}
+
+	/* the id was created again without removing it first */
+	if (page->interface[slot] != 0)
+		remove_from_set(index, id, page);
+	else
+		++page->used;
+
+	*p = id;
+	page->interface[slot] = interface;
+	page->position[slot] = set->size / sizeof *p - 1;
+
+	return 0;
+}
+
+void
+wldbg_objects_index_remove(struct wldbg_objects_index *index,
+			   uint32_t id, unsigned int interface)
+{
+	struct wldbg_objects_index_page *page;
+
+	if (interface == 0)
+		return;
+
+	page = get_page(index, id, 0);
+	/* the id is not in this set */
+	if (!page || page->interface[SLOT(id)] != interface)
+		return;
+
+	remove_from_set(index, id, page);
+	put_page(index, id, page);
+}
+
+const uint32_t *
+wldbg_objects_index_get(struct wldbg_objects_index *index,
+			unsigned int interface, unsigned int *count)
+{
+	struct wl_array *set;
+
+	if (interface == 0 || interface >= index->sets_count) {
+		*count = 0;
+		return NULL;
+	}
+
+	set = &index->sets[interface];
+	*count = set->size / sizeof(uint32_t);
+
+	return *count ? set->data : NULL;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WLDBG_OBJECTS_INDEX_H_
+#define _WLDBG_OBJECTS_INDEX_H_
+
+#include <stdint.h>
+
+#include "wayland/wayland-util.h"
+#include "wldbg-ids-map.h"
+
+/*
+ * Reverse index of the objects in a connection - for every
+ * interface (by its index in the registry, see wldbg-interfaces.h)
+ * we keep the set of ids of its live objects. Adding and removing
+ * an id is O(1), so the index is kept up to date on every new_id
+ * and delete_id.
+ */
+
+/* where the ids of a page are in the sets. The pages are freed
+ * when they have no ids, like the pages of the ids map */
+struct wldbg_objects_index_page {
+	/* number of ids in the index */
+	unsigned int used;
+
+	/* the set that the id is in, 0 if it is not in the index */
+	uint32_t interface[WLDBG_IDS_MAP_PAGE_SIZE];
+	/* position of the id in the set */
+	uint32_t position[WLDBG_IDS_MAP_PAGE_SIZE];
+};
+
+struct wldbg_objects_index {
+	/* wl_array of uint32_t ids for every interface index */
+	struct wl_array *sets;
+	unsigned int sets_count;
+
+	/* struct wldbg_objects_index_page for the ids allocated
+	 * by client [0] and by server [1], indexed by the number
+	 * of the page */
+	struct wldbg_ids_map pages[2];
+};
+
+void
+wldbg_objects_index_init(struct wldbg_objects_index *index);
+
+void
+wldbg_objects_index_release(struct wldbg_objects_index *index);
+
+/* add id to the set of interface. If the id is in the set of another
+ * interface (it was created again without removing), it is moved.
+ * Returns -1 when out of memory */
+int
+wldbg_objects_index_add(struct wldbg_objects_index *index,
+			uint32_t id, unsigned int interface);
+
+/* remove id from the set of interface if it is there */
+void
+wldbg_objects_index_remove(struct wldbg_objects_index *index,
+			   uint32_t id, unsigned int interface);
+
+/* return ids of the objects with interface, in no particular order.
+ * The array is valid until the index is changed */
+const uint32_t *
+wldbg_objects_index_get(struct wldbg_objects_index *index,
+			unsigned int interface, unsigned int *count);
+
+#endif /* _WLDBG_OBJECTS_INDEX_H_ */
@@ -29,10 +29,13 @@
 #include <stdlib.h> /* size_t */
 #include <stdint.h>
 
+#include "wldbg-message-layout.h"
+
 struct wldbg_message;
 struct wl_message;
 struct wl_interface;
 struct wldbg_connection;
+struct wldbg_message_layout;
 
 struct wldbg_parsed_message {
 	uint32_t id;
@@ -59,18 +62,77 @@ struct wldbg_resolved_message {
 	struct wldbg_parsed_message base;
 	const struct wl_interface *wl_interface;
 	const struct wl_message *wl_message;
+	/* compiled signature of wl_message */
+	const struct wldbg_message_layout *layout;
 
 	/* position of arguments iterator */
 	struct wldbg_resolved_arg cur_arg;
-	const char *signature_position;
-    uint32_t *data_position;
+	unsigned int arg_index;
+	uint32_t *data_position;
+};
+
+/* the arguments are decoded by the layout, so there
+ * can not be more of them than the layout has */
+#define WLDBG_MESSAGE_MAX_ARGS WLDBG_LAYOUT_MAX_ARGS
+
+/* parts of struct wldbg_decoded_message that are filled */
+enum {
+	WLDBG_DECODED_MESSAGE	= 1 << 0,
+	WLDBG_DECODED_ARGUMENTS	= 1 << 1,
+	WLDBG_DECODED_NAME	= 1 << 2,
+};
+
+/* Everything that we decoded from a message. Every part is filled
+ * when somebody asks for it the first time and then it is reused by
+ * all the passes that process the message after that, so that the
+ * message is decoded only once. The connection keeps it for the
+ * message that it processes, so struct wldbg_message stays small */
+struct wldbg_decoded_message {
+	/* WLDBG_DECODED_* */
+	unsigned int valid;
+
+	/* the message that the rest belongs to */
+	const void *data;
+	size_t size;
+	int from;
+
+	/* what wldbg_resolve_message() returns */
+	int resolved;
+	struct wldbg_resolved_message message;
+	/* index of the interface in the registry */
+	unsigned int interface_index;
+
+	struct wldbg_resolved_arg args[WLDBG_MESSAGE_MAX_ARGS];
+	unsigned int args_count;
+
+	/* what wldbg_get_message_name() returns. If the name
+	 * does not fit, name_len is the length of the whole name */
+	char name[128];
+	size_t name_len;
 };
 
 int wldbg_parse_message(struct wldbg_message *msg, struct wldbg_parsed_message *out);
 
+/* the result is cached in the connection of the message,
+ * see wldbg_message_invalidate() */
 int wldbg_resolve_message(struct wldbg_message *msg,
 			  struct wldbg_resolved_message *out);
 
+/* return the index in the registry of the interface
+ * of the message, 0 if the message can not be resolved */
+unsigned int
+wldbg_message_get_interface_index(struct wldbg_message *msg);
+
+/* return the arguments of the message or NULL if the
+ * message can not be resolved. The arguments are cached */
+const struct wldbg_resolved_arg *
+wldbg_message_get_arguments(struct wldbg_message *msg, unsigned int *count);
+
+/* forget what was decoded from the message. Passes that
+ * change the data of the message must call this */
+void
+wldbg_message_invalidate(struct wldbg_message *msg);
+
 struct wldbg_resolved_arg *
 wldbg_resolved_message_next_argument(struct wldbg_resolved_message *msg);
 
@@ -84,7 +146,18 @@ wldbg_resolved_message_get_name(struct wldbg_resolved_message *msg,
 size_t
 wldbg_get_message_name(struct wldbg_message *message, char *buff, size_t maxsize);
 
-void
+/* print the message into the output of its connection, see
+ * wldbg_message_printf(). Returns 0 if the message was not printed
+ * because it was collapsed into a run of repeating messages */
+int
 wldbg_message_print(struct wldbg_message *message);
 
+/* print into the output of the connection of the message. Unless
+ * wldbg is interactive, the output is written by another thread,
+ * so passes that print next to the messages should use this
+ * instead of printf() to keep the order of lines */
+void
+wldbg_message_printf(struct wldbg_message *message, const char *fmt, ...)
+	__attribute__((__format__(__printf__, 2, 3)));
+
 #endif /*  _WLDBG_PARSED_MESSAGE_H_ */
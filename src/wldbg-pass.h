@@ -35,6 +35,31 @@ struct wldbg;
 enum {
 	/* suppress multiple loads of this pass */
 	WLDBG_PASS_LOAD_ONCE	= 1,
+	/* the pass never modifies messages. When all passes are
+	 * read-only, wldbg forwards the data without copying them
+	 * and message->data must be taken as const */
+	WLDBG_PASS_READ_ONLY	= 1 << 1,
+};
+
+/* directions for interests */
+enum {
+	WLDBG_FROM_SERVER	= 1,
+	WLDBG_FROM_CLIENT	= 1 << 1,
+	WLDBG_FROM_BOTH		= WLDBG_FROM_SERVER | WLDBG_FROM_CLIENT,
+};
+
+#define WLDBG_ANY_OPCODE -1
+
+/* what messages the pass wants to see */
+struct wldbg_pass_interest {
+	/* WLDBG_FROM_SERVER, WLDBG_FROM_CLIENT or WLDBG_FROM_BOTH */
+	unsigned int direction;
+	/* name of the interface of the object that the message
+	 * is sent to (i. e. "wl_surface") or NULL for any object */
+	const char *interface;
+	/* opcode of the message or WLDBG_ANY_OPCODE.
+	 * Ignored if interface is NULL */
+	int opcode;
 };
 
 struct wldbg_pass {
@@ -57,6 +82,12 @@ struct wldbg_pass {
 
 	/* flags for the pass, i. e. WLDBG_PASS_LOAD_ONCE, etc */
 	uint64_t flags;
+
+	/* array of interests terminated by an entry with zero direction.
+	 * The pass is run only for messages that match some of
+	 * the interests. If NULL, the pass is run for every message.
+	 * Can be set in init() */
+	const struct wldbg_pass_interest *interests;
 };
 
 enum {
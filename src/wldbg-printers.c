@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wayland/wayland-util.h"
+
+#include "wldbg.h"
+#include "wldbg-printers.h"
+#include "wldbg-interfaces.h"
+#include "wldbg-parse-message.h"
+#include "wldbg-writer.h"
+
+struct printer {
+	unsigned int interface;
+	const char *message;
+	int from;
+	unsigned int arg;
+	enum wldbg_printer_priority priority;
+	struct wldbg_arg_format format;
+};
+
+/* printers of one interface compiled for its messages */
+struct compiled_interface {
+	/* the interface that we compiled it for */
+	const struct wl_interface *intf;
+	/* indexed by from (SERVER (0) - events, CLIENT (1) - requests)
+	 * and opcode.
+	 * NULL if no argument of the message has a printer */
+	struct wldbg_arg_format **formats[2];
+	unsigned int count[2];
+};
+
+static struct {
+	struct wl_array printers;
+
+	/* indexed by the interface index */
+	struct compiled_interface *compiled;
+	unsigned int compiled_size;
+} printers;
+
+static void
+forget_compiled(struct compiled_interface *ci)
+{
+	unsigned int k, i;
+
+	for (k = 0; k < 2; ++k) {
+		for (i = 0; i < ci->count[k]; ++i)
+			free(ci->formats[k][i]);
+		free(ci->formats[k]);
+	}
+
+	memset(ci, 0, sizeof *ci);
+}
+
+int
+wldbg_printers_add(const char *interface, const char *message, int from,
+		   unsigned int arg, wldbg_arg_printer print, const void *data,
+		   enum wldbg_printer_priority priority)
+{
+	struct printer *p;
+	unsigned int index;
+
+	if (arg >= WLDBG_MESSAGE_MAX_ARGS)
+		return 0;
+
+	index = wldbg_interfaces_name_index(interface);
+	if (index == 0)
+		return -1;
+
+	p = wl_array_add(&printers.printers, sizeof *p);
+	if (!p)
+		return -1;
+
+	p->interface = index;
+	p->message = message;
+	p->from = from;
+	p->arg = arg;
+	p->priority = priority;
+	p->format.print = print;
+	p->format.data = data;
+
+	/* compile the interface again with the new printer */
+	if (index < printers.compiled_size)
+		forget_compiled(&printers.compiled[index]);
+
+	return 0;
+}
+
+static int
+print_enum(struct wldbg_output *out, const struct wldbg_resolved_arg *arg,
+	   const void *data)
+{
+	char buf[256];
+	size_t len;
+
+	len = wldbg_enum_format(data, *arg->data, buf, sizeof buf);
+	wldbg_output_append(out, buf, len < sizeof buf ? len : sizeof buf - 1);
+
+	return 1;
+}
+
+int
+wldbg_printers_add_enum(const char *interface, const char *message,
+			int from, unsigned int arg,
+			const struct wldbg_enum *enumeration,
+			enum wldbg_printer_priority priority)
+{
+	return wldbg_printers_add(interface, message, from, arg,
+				  print_enum, enumeration, priority);
+}
+
+static int
+find_opcode(const struct wl_message *messages, int count, const char *name)
+{
+	int i;
+
+	for (i = 0; i < count; ++i)
+		if (messages[i].name && strcmp(messages[i].name, name) == 0)
+			return i;
+
+	return -1;
+}
+
+static int
+compile(struct compiled_interface *ci, unsigned int index,
+	const struct wl_interface *intf)
+{
+	struct wldbg_arg_format **formats;
+	struct printer *p;
+	int opcode, k, priority;
+
+	ci->intf = intf;
+	ci->count[SERVER] = intf->event_count;
+	ci->count[CLIENT] = intf->method_count;
+
+	ci->formats[SERVER] = calloc(intf->event_count + 1, sizeof *formats);
+	ci->formats[CLIENT] = calloc(intf->method_count + 1, sizeof *formats);
+	if (!ci->formats[SERVER] || !ci->formats[CLIENT])
+		goto err;
+
+	/* printers with higher priority or added
+	 * later overwrite the others */
+	for (priority = WLDBG_PRINTER_BUILTIN;
+	     priority <= WLDBG_PRINTER_PROTOCOL; ++priority) {
+		wl_array_for_each(p, &printers.printers) {
+			if (p->interface != index
+			    || (int) p->priority != priority)
+				continue;
+
+			k = p->from == SERVER ? SERVER : CLIENT;
+			opcode = find_opcode(k == SERVER ? intf->events
+							 : intf->methods,
+					     ci->count[k], p->message);
+			if (opcode < 0)
+				continue;
+
+			formats = &ci->formats[k][opcode];
+			if (!*formats) {
+				*formats = calloc(WLDBG_MESSAGE_MAX_ARGS,
+						  sizeof **formats);
+				if (!*formats)
+					goto err;
+			}
+
+			(*formats)[p->arg] = p->format;
+		}
+	}
+
+	return 0;
+
+err:
+	fprintf(stderr, "Out of memory, printing %s plainly\n", intf->name);
+	forget_compiled(ci);
+	return -1;
+}
+
+const struct wldbg_arg_format *
+wldbg_printers_get(unsigned int interface_index,
+		   const struct wl_interface *intf, int from, uint32_t opcode)
+{
+	struct compiled_interface *ci, *compiled;
+	unsigned int size;
+	int k = from == SERVER ? SERVER : CLIENT;
+
+	if (interface_index >= printers.compiled_size) {
+		/* not an index from the registry */
+		if (interface_index >= wldbg_interfaces_count())
+			return NULL;
+
+		size = printers.compiled_size ? printers.compiled_size : 32;
+		while (size <= interface_index)
+			size *= 2;
+
+		compiled = realloc(printers.compiled, size * sizeof *compiled);
+		if (!compiled)
+			return NULL;
+
+		memset(compiled + printers.compiled_size, 0,
+		       (size - printers.compiled_size) * sizeof *compiled);
+		printers.compiled = compiled;
+		printers.compiled_size = size;
+	}
+
+	ci = &printers.compiled[interface_index];
+	if (ci->intf != intf) {
+		forget_compiled(ci);
+		if (compile(ci, interface_index, intf) < 0)
+			return NULL;
+	}
+
+	if (opcode >= ci->count[k])
+		return NULL;
+
+	return ci->formats[k][opcode];
+}
+
+size_t
+wldbg_enum_format(const struct wldbg_enum *enumeration, uint32_t value,
+		  char *buf, size_t size)
+{
+	const struct wldbg_enum_entry *e;
+	uint32_t i, rest = value;
+	size_t len = 0;
+	int ret;
+
+#define APPEND(...)							\
+	do {								\
+		ret = snprintf(buf + (len < size ? len : size),		\
+			       len < size ? size - len : 0,		\
+			       __VA_ARGS__);				\
+		if (ret > 0)						\
+			len += ret;					\
+	} while (0)
+
+	if (size > 0)
+		buf[0] = '\0';
+
+	for (i = 0; i < enumeration->entry_count; ++i) {
+		e = &enumeration->entries[i];
+
+		if (!enumeration->bitfield || value == 0) {
+			if (e->value == value) {
+				APPEND("%s", e->name);
+				return len;
+			}
+
+			continue;
+		}
+
+		if (e->value != 0 && (rest & e->value) == e->value) {
+			APPEND("%s%s", len ? "|" : "", e->name);
+			rest &= ~e->value;
+		}
+	}
+
+	if (!enumeration->bitfield || value == 0)
+		APPEND("%u", value);
+	else if (rest)
+		APPEND("%s0x%x", len ? "|" : "", rest);
+
+#undef APPEND
+
+	return len;
+}
+
+void
+wldbg_printers_forget(const struct wl_interface *intf)
+{
+	unsigned int i;
+
+	for (i = 0; i < printers.compiled_size; ++i)
+		if (printers.compiled[i].intf == intf)
+			forget_compiled(&printers.compiled[i]);
+}
+
+void
+wldbg_printers_release(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < printers.compiled_size; ++i)
+		forget_compiled(&printers.compiled[i]);
+
+	free(printers.compiled);
+	wl_array_release(&printers.printers);
+	memset(&printers, 0, sizeof printers);
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WLDBG_PRINTERS_H_
+#define _WLDBG_PRINTERS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct wl_interface;
+struct wldbg_resolved_arg;
+struct wldbg_output;
+
+/*
+ * Printers of arguments that are more than just numbers - enums,
+ * key codes and similar. The printers are added for arguments of
+ * messages by names. When a message is printed the first time,
+ * the printers of all messages of its interface are compiled into
+ * a table indexed by the interface index (see wldbg-interfaces.h),
+ * direction and opcode, so that finding the printers of a message
+ * is just looking into the table.
+ */
+
+/* print the argument into out, return 0 if the argument
+ * should be printed in the default way */
+typedef int (*wldbg_arg_printer)(struct wldbg_output *out,
+				 const struct wldbg_resolved_arg *arg,
+				 const void *data);
+
+struct wldbg_arg_format {
+	/* NULL if the argument has no printer */
+	wldbg_arg_printer print;
+	const void *data;
+};
+
+/* printers added by wldbg itself are used only if the
+ * protocol does not describe the argument */
+enum wldbg_printer_priority {
+	WLDBG_PRINTER_BUILTIN,
+	WLDBG_PRINTER_PROTOCOL,
+};
+
+struct wldbg_enum_entry {
+	const char *name;
+	uint32_t value;
+};
+
+struct wldbg_enum {
+	const char *name;
+	/* the values are flags that can be combined */
+	int bitfield;
+	uint32_t entry_count;
+	const struct wldbg_enum_entry *entries;
+};
+
+/* add printer for the argument arg (index in the signature) of
+ * the message. from is SERVER for events and CLIENT for requests.
+ * The names and data must be valid until wldbg_printers_release().
+ * Returns -1 when out of memory */
+int
+wldbg_printers_add(const char *interface, const char *message, int from,
+		   unsigned int arg, wldbg_arg_printer print, const void *data,
+		   enum wldbg_printer_priority priority);
+
+/* the same as above with the printer of enums */
+int
+wldbg_printers_add_enum(const char *interface, const char *message,
+			int from, unsigned int arg,
+			const struct wldbg_enum *enumeration,
+			enum wldbg_printer_priority priority);
+
+/* return formats for arguments of the message or NULL if
+ * all of them should be printed in the default way */
+const struct wldbg_arg_format *
+wldbg_printers_get(unsigned int interface_index,
+		   const struct wl_interface *intf, int from, uint32_t opcode);
+
+/* format value of the enum into buf like snprintf() */
+size_t
+wldbg_enum_format(const struct wldbg_enum *enumeration, uint32_t value,
+		  char *buf, size_t size);
+
+/* the interface is going to be freed */
+void
+wldbg_printers_forget(const struct wl_interface *intf);
+
+void
+wldbg_printers_release(void);
+
+/* defined in print.c - printers for the interfaces from libwayland */
+int
+wldbg_printers_add_builtin(void);
+
+#endif /* _WLDBG_PRINTERS_H_ */
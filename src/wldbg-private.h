@@ -40,6 +40,10 @@
 #include "wayland/wayland-util.h"
 #include "wldbg-pass.h"
 #include "wldbg-ids-map.h"
+#include "wldbg-objects-index.h"
+#include "wldbg-object-table.h"
+#include "wldbg-writer.h"
+#include "wldbg-parse-message.h"
 
 #ifdef DEBUG
 
@@ -88,16 +92,25 @@ extern const char *debug_domain;
 
 struct wldbg_connection;
 struct resolved_objects;
+struct pass_table;
+
+/* bucket i of latency histogram counts messages that
+ * spent less than 2^i microseconds in wldbg */
+#define WLDBG_LATENCY_BUCKETS 24
 
 struct wldbg {
 	int epoll_fd;
 	int signals_fd;
 
 	struct wldbg_message message;
+	/* buffer for messages that passes can modify */
 	char *buffer;
+	size_t buffer_size;
 
 	sigset_t handled_signals;
 	struct wl_list passes;
+	/* passes to run for particular messages, see passes.c */
+	struct pass_table *pass_table;
 	struct wl_list monitored_fds;
 
 	unsigned int resolving_objects : 1;
@@ -114,8 +127,44 @@ struct wldbg {
 		unsigned int exit              : 1;
         /* running in server mode */
 		unsigned int server_mode       : 1;
+        /* monitor connections edge-triggered and read them until EAGAIN */
+		unsigned int edge_triggered    : 1;
+        /* flush connection once per read instead of once per message */
+		unsigned int coalesce_writes   : 1;
+        /* some pass was added or removed */
+		unsigned int passes_changed    : 1;
+        /* print runs of repeating messages as one line */
+		unsigned int collapse_runs     : 1;
 	} flags;
 
+	/* size of the buffers of new connections */
+	struct {
+		size_t size;
+		/* the buffers can grow up to this size */
+		size_t max_size;
+		/* stop reading from a side of a connection when there is
+		 * more than high_watermark bytes queued for the other side
+		 * and start again when it drops under low_watermark */
+		size_t high_watermark;
+		size_t low_watermark;
+	} connection_buffers;
+
+	struct {
+		/* messages (or whole buffers) written into connections */
+		uint64_t messages;
+		/* flushes that really sent some data */
+		uint64_t flushes;
+		/* the most data queued for a peer at once */
+		uint64_t max_queued;
+		/* how many times and for how long (in ns) we stopped
+		 * reading because the other side did not keep up */
+		uint64_t stalls;
+		uint64_t stall_time;
+		/* latency that wldbg added to messages,
+		 * indexed by direction (SERVER, CLIENT) */
+		uint64_t latency[2][WLDBG_LATENCY_BUCKETS];
+	} statistics;
+
 	struct {
 		int fd;
 		struct sockaddr_un addr;
@@ -137,6 +186,58 @@ struct wldbg {
 	/* this will be list later */
 	struct wl_list connections;
 	int connections_num;
+	/* id of the last connection that was added */
+	uint32_t last_connection_id;
+
+	/* writes what we print in another thread,
+	 * NULL if we print synchronously */
+	struct wldbg_writer *writer;
+};
+
+/* flow control of one side of a connection */
+struct wldbg_flow {
+	/* events that the fd is monitored for */
+	uint32_t events;
+	/* we stopped reading from the fd, because
+	 * the other side has too much data queued */
+	int stalled;
+	uint64_t stalled_since;
+	/* messages queued for the fd that were not sent yet
+	 * and the time when the oldest of them was received */
+	uint64_t queued_messages;
+	uint64_t queued_since;
+};
+
+/* the longest cycle of messages that we collapse */
+#define WLDBG_COLLAPSE_MAX_PERIOD 4
+
+struct wldbg_collapse_key {
+	/* interface index, direction and opcode,
+	 * 0 if the message can not be collapsed */
+	uint64_t key;
+	const char *interface;
+	const char *message;
+};
+
+/* runs of repeating messages that are printed as one line, see print.c */
+struct wldbg_collapse {
+	/* the last printed messages, the newest is the last */
+	struct wldbg_collapse_key history[2 * WLDBG_COLLAPSE_MAX_PERIOD];
+	unsigned int history_count;
+
+	/* length of the repeating cycle (the last messages in
+	 * the history), 0 if we are not in a run */
+	unsigned int period;
+	/* position of the next message in the cycle */
+	unsigned int position;
+
+	/* the collapsed messages */
+	uint64_t count;
+	uint64_t first_received;
+	uint64_t last_received;
+	/* the first and the last collapsed message that starts the cycle */
+	struct wldbg_output first;
+	struct wldbg_output last;
 };
 
 struct pass {
@@ -147,17 +248,23 @@ struct pass {
 
 struct wldbg_connection {
 	struct wldbg *wldbg;
+	/* connections are numbered from 1 in the order they were added */
+	uint32_t id;
 
 	struct {
 		int fd;
 		/* TODO get rid of connection??? */
 		struct wl_connection *connection;
+		struct wldbg_fd_callback *cb;
+		struct wldbg_flow flow;
 		pid_t pid;
 	} server;
 
 	struct {
 		int fd;
 		struct wl_connection *connection;
+		struct wldbg_fd_callback *cb;
+		struct wldbg_flow flow;
 
 		char *program;
 		/* path to the binary */
@@ -169,8 +276,24 @@ struct wldbg_connection {
 		pid_t pid;
 	} client;
 
+	/* objects in the connection, shared by
+	 * resolved_objects and objects_info */
+	struct wldbg_object_table objects;
 	struct resolved_objects *resolved_objects;
 	struct wldbg_objects_info *objects_info;
+
+	/* what we decoded from the message that is processed */
+	struct wldbg_decoded_message decoded;
+
+	/* text printed about the messages of this connection
+	 * that was not handed over to the writer yet */
+	struct wldbg_output output;
+	struct wldbg_collapse collapse;
+
+	/* one side hung up, we only send the rest
+	 * of its messages to the other side */
+	int closing;
+
 	struct wl_list link;
 };
 
@@ -181,28 +304,75 @@ struct wldbg_fd_callback {
 	struct wl_list link;
 };
 
-struct resolved_objects_ids {
-	/* id's allocated by client */
-	struct wldbg_ids_map client_objects;
-	/* id's allocated by server */
-	struct wldbg_ids_map server_objects;
-};
+/* defined in wldbg.c */
+int
+wldbg_connection_flush(struct wldbg_connection *conn);
 
-struct resolved_objects {
-	struct resolved_objects_ids objects;
+/* defined in print.c. Hand the output of the connection over to the
+ * writer. Called after processing messages that were read together */
+void
+wldbg_output_flush(struct wldbg_connection *conn);
+
+/* print the run of repeating messages that we collapsed so far and
+ * start looking for runs from scratch. Called when wldbg stops, so
+ * that the user sees the messages that came last */
+void
+wldbg_collapse_flush(struct wldbg_connection *conn);
+
+void
+wldbg_collapse_release(struct wldbg_connection *conn);
+
+/* defined in passes.c */
+void
+wldbg_passes_changed(struct wldbg *wldbg);
+
+void
+wldbg_passes_forget(struct wldbg *wldbg, const struct wl_interface *intf);
+
+void
+wldbg_destroy_pass_table(struct wldbg *wldbg);
 
-	/* these are shared between connections */
-	struct wl_list *interfaces;
+int
+wldbg_passes_read_only(struct wldbg *wldbg);
 
-	/* these are specific for connection */
+struct pass **
+wldbg_message_passes(struct wldbg_message *message);
+
+/* defined in loop.c */
+struct wldbg_fd_callback *
+wldbg_monitor_fd_events(struct wldbg *wldbg, int fd, uint32_t events,
+			int (*dispatch)(int fd, void *data),
+			void *data);
+
+int
+wldbg_modify_fd_events(struct wldbg *wldbg, struct wldbg_fd_callback *cb,
+		       uint32_t events);
+
+/* interface specific for a connection */
+struct additional_interface {
+	const struct wl_interface *interface;
+	struct wl_list link;
+};
+
+struct resolved_objects {
+	/* NULL if the objects are not resolved for a connection of wldbg */
+	struct wldbg *wldbg;
+	/* interfaces of the objects are in there */
+	struct wldbg_object_table *table;
+	/* interface -> ids of its objects */
+	struct wldbg_objects_index index;
+
+	/* interfaces shared between connections are
+	 * in the registry, see wldbg-interfaces.h.
+	 * These are specific for connection, found in
+	 * the client's binaries (see elf-interfaces.h) */
 	struct wl_list additional_interfaces;
+	struct elf_interfaces *elf_interfaces;
 };
 
 struct wldbg_objects_info {
-	/* id's allocated by client */
-	struct wldbg_ids_map client_objects;
-	/* id's allocated by server */
-	struct wldbg_ids_map server_objects;
+	/* the infos are in there */
+	struct wldbg_object_table *table;
 };
 
 #endif /* _WLDBG_PRIVATE_H_ */
@@ -0,0 +1,1074 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "wldbg-trace.h"
+#include "wldbg-writer.h"
+#include "wldbg-hash.h"
+#include "wldbg-lz.h"
+
+/* the block is written when it has more records than this */
+#define TRACE_BLOCK_SIZE (64 * 1024)
+/* log2 of the number of the last messages that
+ * we remember when delta-encoding a block */
+#define TRACE_DELTA_BITS 8
+
+struct trace_key {
+	char *interface;
+	uint32_t opcode;
+	int from;
+	uint32_t hash;
+
+	/* indices of the blocks with the message */
+	uint32_t *blocks;
+	uint32_t block_count;
+	uint32_t blocks_allocated;
+	uint64_t count;
+};
+
+struct wldbg_trace_writer {
+	int fd;
+	uint32_t flags;
+	/* some write failed, we do not write anything anymore */
+	int error;
+	/* where the next block is going to be written */
+	uint64_t offset;
+	uint64_t seq;
+
+	/* the block header and the records of the current block */
+	struct wldbg_output block;
+	struct wldbg_trace_block_entry current;
+
+	/* the records delta-encoded and the block compressed */
+	char *delta;
+	size_t delta_size;
+	char *packed;
+	size_t packed_size;
+
+	struct wldbg_trace_block_entry *blocks;
+	uint32_t block_count;
+	uint32_t blocks_allocated;
+
+	struct trace_key *keys;
+	uint32_t key_count;
+	uint32_t keys_allocated;
+	/* hash table of indices to keys + 1, 0 is an empty slot */
+	uint32_t *slots;
+	uint32_t slots_count;
+};
+
+static int
+write_all(struct wldbg_trace_writer *writer, const void *data, size_t size)
+{
+	const char *p = data;
+	ssize_t ret;
+
+	if (writer->error)
+		return -1;
+
+	while (size > 0) {
+		ret = write(writer->fd, p, size);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			writer->error = 1;
+			return -1;
+		}
+
+		p += ret;
+		size -= ret;
+		writer->offset += ret;
+	}
+
+	return 0;
+}
+
+struct wldbg_trace_writer *
+wldbg_trace_writer_create(int fd, uint32_t flags)
+{
+	struct wldbg_trace_writer *writer;
+	struct wldbg_trace_header header;
+
+	writer = calloc(1, sizeof *writer);
+	if (!writer)
+		return NULL;
+
+	writer->fd = fd;
+	writer->flags = flags;
+
+	memset(&header, 0, sizeof header);
+	memcpy(header.magic, WLDBG_TRACE_MAGIC, sizeof header.magic);
+	header.version = WLDBG_TRACE_VERSION;
+	header.byte_order = WLDBG_TRACE_BYTE_ORDER;
+
+	if (write_all(writer, &header, sizeof header) < 0) {
+		free(writer);
+		return NULL;
+	}
+
+	return writer;
+}
+
+static int
+reserve(char **buffer, size_t *allocated, size_t size)
+{
+	char *data;
+
+	if (size <= *allocated)
+		return 0;
+
+	data = realloc(*buffer, size);
+	if (!data)
+		return -1;
+
+	*buffer = data;
+	*allocated = size;
+
+	return 0;
+}
+
+struct delta_slot {
+	uint32_t id;
+	/* opcode and direction */
+	uint32_t kind;
+	uint32_t connection;
+	/* offset of the data of the message + 1, 0 is an empty slot */
+	uint32_t offset;
+	uint32_t size;
+};
+
+static uint32_t
+hash_delta_slot(uint32_t id, uint32_t kind, uint32_t connection)
+{
+	return ((id * 31 + kind) * 31 + connection) * 2654435761u
+		>> (32 - TRACE_DELTA_BITS);
+}
+
+/* delta-encode (see WLDBG_TRACE_BLOCK_DELTA) or decode count records in
+ * data. When encoding, data is a copy of raw, the records as they came.
+ * When decoding, raw is data, the previous records are decoded already */
+static int
+delta_block(char *data, const char *raw, size_t size,
+	    uint32_t count, int decode)
+{
+	struct delta_slot slots[1 << TRACE_DELTA_BITS], *slot;
+	struct wldbg_trace_record_header rh;
+	uint64_t prev_time = 0, time;
+	uint32_t header[2], kind, i, w, words;
+	uint32_t *cur;
+	const uint32_t *prev;
+	size_t pos = 0, padded;
+
+	memset(slots, 0, sizeof slots);
+
+	for (i = 0; i < count; ++i) {
+		if (size - pos < sizeof rh)
+			return -1;
+
+		memcpy(&rh, data + pos, sizeof rh);
+		if (decode) {
+			rh.time += prev_time;
+			prev_time = rh.time;
+		} else {
+			time = rh.time;
+			rh.time -= prev_time;
+			prev_time = time;
+		}
+		memcpy(data + pos, &rh, sizeof rh);
+
+		pos += sizeof rh;
+		padded = ((size_t) rh.size + 3) & ~(size_t) 3;
+		if (size - pos < padded)
+			return -1;
+
+		if (rh.size < sizeof header) {
+			pos += padded;
+			continue;
+		}
+
+		/* the object and opcode are not encoded */
+		memcpy(header, raw + pos, sizeof header);
+		kind = (header[1] & 0xffff) | (uint32_t) rh.from << 16;
+		slot = &slots[hash_delta_slot(header[0], kind, rh.connection)];
+
+		if (slot->offset && slot->id == header[0] && slot->kind == kind
+		    && slot->connection == rh.connection) {
+			cur = (uint32_t *) (data + pos);
+			prev = (const uint32_t *) (raw + slot->offset - 1);
+			words = (rh.size < slot->size ? rh.size : slot->size) / 4;
+
+			for (w = 2; w < words; ++w) {
+				if (decode)
+					cur[w] += prev[w];
+				else
+					cur[w] -= prev[w];
+			}
+		}
+
+		slot->id = header[0];
+		slot->kind = kind;
+		slot->connection = rh.connection;
+		slot->offset = pos + 1;
+		slot->size = rh.size;
+
+		pos += padded;
+	}
+
+	return pos == size ? 0 : -1;
+}
+
+static uint32_t
+hash_key(const char *interface, int from, uint32_t opcode)
+{
+	uint32_t hash = wldbg_fnv32_str(WLDBG_FNV32_BASIS, interface);
+
+	hash ^= opcode << 1 | from;
+	hash *= WLDBG_FNV32_PRIME;
+
+	return hash;
+}
+
+static int
+grow_slots(struct wldbg_trace_writer *writer)
+{
+	uint32_t count = writer->slots_count ? writer->slots_count * 2 : 64;
+	uint32_t *slots, i, j;
+
+	slots = calloc(count, sizeof *slots);
+	if (!slots)
+		return -1;
+
+	for (i = 0; i < writer->key_count; ++i) {
+		j = writer->keys[i].hash & (count - 1);
+		while (slots[j])
+			j = (j + 1) & (count - 1);
+
+		slots[j] = i + 1;
+	}
+
+	free(writer->slots);
+	writer->slots = slots;
+	writer->slots_count = count;
+
+	return 0;
+}
+
+static struct trace_key *
+get_key(struct wldbg_trace_writer *writer, const char *interface,
+	int from, uint32_t opcode)
+{
+	struct trace_key *key, *keys;
+	uint32_t hash = hash_key(interface, from, opcode);
+	uint32_t i;
+
+	if (writer->slots_count) {
+		i = hash & (writer->slots_count - 1);
+		while (writer->slots[i]) {
+			key = &writer->keys[writer->slots[i] - 1];
+			if (key->hash == hash && key->opcode == opcode
+			    && key->from == from
+			    && strcmp(key->interface, interface) == 0)
+				return key;
+
+			i = (i + 1) & (writer->slots_count - 1);
+		}
+	}
+
+	/* keep the hash table at most half full */
+	if (2 * (writer->key_count + 1) > writer->slots_count
+	    && grow_slots(writer) < 0)
+		return NULL;
+
+	if (writer->key_count == writer->keys_allocated) {
+		i = writer->keys_allocated ? writer->keys_allocated * 2 : 32;
+		keys = realloc(writer->keys, i * sizeof *keys);
+		if (!keys)
+			return NULL;
+
+		writer->keys = keys;
+		writer->keys_allocated = i;
+	}
+
+	key = &writer->keys[writer->key_count];
+	memset(key, 0, sizeof *key);
+	key->interface = strdup(interface);
+	if (!key->interface)
+		return NULL;
+
+	key->from = from;
+	key->opcode = opcode;
+	key->hash = hash;
+
+	i = hash & (writer->slots_count - 1);
+	while (writer->slots[i])
+		i = (i + 1) & (writer->slots_count - 1);
+	writer->slots[i] = ++writer->key_count;
+
+	return key;
+}
+
+static int
+key_add_block(struct trace_key *key, uint32_t block)
+{
+	uint32_t *blocks, allocated;
+
+	if (key->block_count > 0 && key->blocks[key->block_count - 1] == block)
+		return 0;
+
+	if (key->block_count == key->blocks_allocated) {
+		allocated = key->blocks_allocated ? key->blocks_allocated * 2 : 8;
+		blocks = realloc(key->blocks, allocated * sizeof *blocks);
+		if (!blocks)
+			return -1;
+
+		key->blocks = blocks;
+		key->blocks_allocated = allocated;
+	}
+
+	key->blocks[key->block_count++] = block;
+	return 0;
+}
+
+/* compress the records of the current block into writer->packed,
+ * after the space for the block header. Returns the size of the
+ * compressed records or 0 if they do not get smaller */
+static size_t
+compress_block(struct wldbg_trace_writer *writer)
+{
+	const char *records;
+	size_t size, packed;
+	uint32_t raw_size;
+
+	records = writer->block.data + sizeof(struct wldbg_trace_block_header);
+	size = writer->block.size - sizeof(struct wldbg_trace_block_header);
+	packed = sizeof(struct wldbg_trace_block_header) + sizeof raw_size;
+
+	if (reserve(&writer->delta, &writer->delta_size, size) < 0
+	    || reserve(&writer->packed, &writer->packed_size,
+		       packed + wldbg_lz_bound(size)) < 0)
+		return 0;
+
+	memcpy(writer->delta, records, size);
+	if (delta_block(writer->delta, records, size,
+			writer->current.count, 0) < 0)
+		return 0;
+
+	raw_size = size;
+	memcpy(writer->packed + packed - sizeof raw_size,
+	       &raw_size, sizeof raw_size);
+
+	size = wldbg_lz_compress(writer->delta, size, writer->packed + packed,
+				 writer->packed_size - packed);
+	if (size == 0 || size + sizeof raw_size >= raw_size)
+		return 0;
+
+	return size + sizeof raw_size;
+}
+
+static int
+write_block(struct wldbg_trace_writer *writer)
+{
+	struct wldbg_trace_block_header header;
+	struct wldbg_trace_block_entry *blocks;
+	char *data = writer->block.data;
+	uint32_t allocated;
+	size_t size = 0;
+
+	if (writer->block_count == writer->blocks_allocated) {
+		allocated = writer->blocks_allocated
+				? writer->blocks_allocated * 2 : 64;
+		blocks = realloc(writer->blocks, allocated * sizeof *blocks);
+		if (!blocks) {
+			writer->error = 1;
+			return -1;
+		}
+
+		writer->blocks = blocks;
+		writer->blocks_allocated = allocated;
+	}
+
+	if (writer->flags & WLDBG_TRACE_COMPRESS)
+		size = compress_block(writer);
+
+	header.magic = WLDBG_TRACE_BLOCK_MAGIC;
+	header.count = writer->current.count;
+	header.first_seq = writer->current.first_seq;
+
+	if (size > 0) {
+		header.size = size;
+		header.flags = WLDBG_TRACE_BLOCK_DELTA | WLDBG_TRACE_BLOCK_LZ;
+		data = writer->packed;
+	} else {
+		/* store the records as they are */
+		header.size = writer->block.size - sizeof header;
+		header.flags = 0;
+	}
+
+	memcpy(data, &header, sizeof header);
+
+	writer->current.offset = writer->offset;
+	writer->current.size = header.size;
+	writer->blocks[writer->block_count++] = writer->current;
+
+	writer->block.size = 0;
+	return write_all(writer, data, sizeof header + header.size);
+}
+
+int
+wldbg_trace_writer_add(struct wldbg_trace_writer *writer,
+		       const struct wldbg_trace_record *record,
+		       const char *interface, uint32_t opcode)
+{
+	struct wldbg_trace_block_header header;
+	struct wldbg_trace_record_header rh;
+	struct trace_key *key;
+	static const char padding[4];
+
+	if (writer->error)
+		return -1;
+
+	if (writer->block.size == 0) {
+		memset(&header, 0, sizeof header);
+		memset(&writer->current, 0, sizeof writer->current);
+		writer->current.first_seq = writer->seq;
+		writer->current.first_time = record->time;
+
+		if (wldbg_output_append(&writer->block, (char *) &header,
+					sizeof header) < 0)
+			goto oom;
+	}
+
+	rh.time = record->time;
+	rh.size = record->size;
+	rh.connection = record->connection;
+	rh.from = record->from;
+	rh.fd_count = record->fd_count;
+
+	if (wldbg_output_append(&writer->block, (char *) &rh, sizeof rh) < 0
+	    || wldbg_output_append(&writer->block, record->data,
+				   record->size) < 0
+	    || wldbg_output_append(&writer->block, padding,
+				   -record->size & 3) < 0)
+		goto oom;
+
+	if (interface) {
+		key = get_key(writer, interface, record->from, opcode);
+		if (!key || key_add_block(key, writer->block_count) < 0)
+			goto oom;
+
+		++key->count;
+	}
+
+	++writer->current.count;
+	writer->current.last_time = record->time;
+	++writer->seq;
+
+	if (writer->block.size >= TRACE_BLOCK_SIZE)
+		return write_block(writer);
+
+	return 0;
+
+oom:
+	writer->error = 1;
+	return -1;
+}
+
+static int
+compare_keys(const void *a, const void *b)
+{
+	const struct trace_key *k1 = a, *k2 = b;
+	int ret = strcmp(k1->interface, k2->interface);
+
+	if (ret != 0)
+		return ret;
+	if (k1->from != k2->from)
+		return k1->from - k2->from;
+
+	return (k1->opcode > k2->opcode) - (k1->opcode < k2->opcode);
+}
+
+static int
+write_index(struct wldbg_trace_writer *writer)
+{
+	struct wldbg_output index;
+	struct wldbg_output strings;
+	struct wldbg_trace_key_entry entry;
+	struct wldbg_trace_trailer trailer;
+	static const char padding[8];
+	uint32_t i, refs = 0;
+	int ret = -1;
+
+	memset(&index, 0, sizeof index);
+	memset(&strings, 0, sizeof strings);
+
+	/* the index is read straight from the mapped file */
+	if (write_all(writer, padding, -writer->offset & 7) < 0)
+		return -1;
+
+	memset(&trailer, 0, sizeof trailer);
+	trailer.index_offset = writer->offset;
+	trailer.record_count = writer->seq;
+	trailer.block_count = writer->block_count;
+	trailer.key_count = writer->key_count;
+
+	if (wldbg_output_append(&index, (char *) writer->blocks,
+				writer->block_count * sizeof *writer->blocks) < 0)
+		goto out;
+
+	/* the keys go to the index sorted, the hash table is useless now */
+	qsort(writer->keys, writer->key_count, sizeof *writer->keys,
+	      compare_keys);
+
+	for (i = 0; i < writer->key_count; ++i) {
+		/* keys of one interface are next to each other */
+		if (i == 0 || strcmp(writer->keys[i - 1].interface,
+				     writer->keys[i].interface) != 0) {
+			entry.interface = strings.size;
+			if (wldbg_output_append(&strings,
+						writer->keys[i].interface,
+						strlen(writer->keys[i].interface)
+						+ 1) < 0)
+				goto out;
+		}
+
+		entry.opcode = writer->keys[i].opcode;
+		entry.from = writer->keys[i].from;
+		entry.reserved = 0;
+		entry.first_ref = refs;
+		entry.ref_count = writer->keys[i].block_count;
+		entry.count = writer->keys[i].count;
+		refs += entry.ref_count;
+
+		if (wldbg_output_append(&index, (char *) &entry,
+					sizeof entry) < 0)
+			goto out;
+	}
+
+	for (i = 0; i < writer->key_count; ++i) {
+		if (wldbg_output_append(&index, (char *) writer->keys[i].blocks,
+					writer->keys[i].block_count
+					* sizeof(uint32_t)) < 0)
+			goto out;
+	}
+
+	trailer.ref_count = refs;
+	trailer.strings_size = strings.size;
+	memcpy(trailer.magic, WLDBG_TRACE_INDEX_MAGIC, sizeof trailer.magic);
+
+	if (wldbg_output_append(&index, strings.data, strings.size) < 0
+	    || wldbg_output_append(&index, padding, -index.size & 7) < 0
+	    || wldbg_output_append(&index, (char *) &trailer,
+				   sizeof trailer) < 0)
+		goto out;
+
+	ret = write_all(writer, index.data, index.size);
+out:
+	if (ret < 0)
+		writer->error = 1;
+
+	wldbg_output_release(&index);
+	wldbg_output_release(&strings);
+	return ret;
+}
+
+int
+wldbg_trace_writer_finish(struct wldbg_trace_writer *writer)
+{
+	uint32_t i;
+	int ret;
+
+	if (writer->block.size > 0)
+		write_block(writer);
+
+	if (!writer->error)
+		write_index(writer);
+
+	ret = writer->error ? -1 : 0;
+
+	for (i = 0; i < writer->key_count; ++i) {
+		free(writer->keys[i].interface);
+		free(writer->keys[i].blocks);
+	}
+
+	wldbg_output_release(&writer->block);
+	free(writer->delta);
+	free(writer->packed);
+	free(writer->keys);
+	free(writer->slots);
+	free(writer->blocks);
+	free(writer);
+
+	return ret;
+}
+
+struct wldbg_trace {
+	const char *data;
+	size_t size;
+
+	const struct wldbg_trace_block_entry *blocks;
+	uint32_t block_count;
+	uint64_t record_count;
+
+	/* the index, key_count is 0 if the trace has no index */
+	const struct wldbg_trace_key_entry *keys;
+	uint32_t key_count;
+	const uint32_t *refs;
+	const char *strings;
+
+	/* blocks that we found in a trace without index */
+	struct wldbg_trace_block_entry *scanned;
+};
+
+static int
+read_index(struct wldbg_trace *trace)
+{
+	struct wldbg_trace_trailer trailer;
+	uint64_t size;
+	uint32_t i;
+
+	if (trace->size < sizeof(struct wldbg_trace_header) + sizeof trailer)
+		return -1;
+
+	memcpy(&trailer, trace->data + trace->size - sizeof trailer,
+	       sizeof trailer);
+	if (memcmp(trailer.magic, WLDBG_TRACE_INDEX_MAGIC,
+		   sizeof trailer.magic) != 0)
+		return -1;
+
+	size = (uint64_t) trailer.block_count
+			* sizeof(struct wldbg_trace_block_entry)
+		+ (uint64_t) trailer.key_count
+			* sizeof(struct wldbg_trace_key_entry)
+		+ (uint64_t) trailer.ref_count * sizeof(uint32_t)
+		+ trailer.strings_size;
+
+	if (trailer.index_offset % 8 != 0
+	    || trailer.index_offset > trace->size - sizeof trailer
+	    || size > trace->size - sizeof trailer - trailer.index_offset)
+		return -1;
+
+	trace->blocks = (const void *) (trace->data + trailer.index_offset);
+	trace->block_count = trailer.block_count;
+	trace->record_count = trailer.record_count;
+	trace->keys = (const void *) (trace->blocks + trailer.block_count);
+	trace->key_count = trailer.key_count;
+	trace->refs = (const void *) (trace->keys + trailer.key_count);
+	trace->strings = (const char *) (trace->refs + trailer.ref_count);
+
+	if (trailer.key_count > 0
+	    && (trailer.strings_size == 0
+		|| trace->strings[trailer.strings_size - 1] != '\0'))
+		return -1;
+
+	for (i = 0; i < trailer.key_count; ++i) {
+		if (trace->keys[i].interface >= trailer.strings_size
+		    || trace->keys[i].first_ref > trailer.ref_count
+		    || trace->keys[i].ref_count
+				> trailer.ref_count - trace->keys[i].first_ref)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* return the records of the block at offset, uncompressed into
+ * the buffer if the block is compressed. Returns NULL if the block
+ * is corrupted */
+static const char *
+load_block(struct wldbg_trace *trace, uint64_t offset,
+	   const struct wldbg_trace_block_header *header,
+	   char **buffer, size_t *buffer_size, size_t *size)
+{
+	const char *data = trace->data + offset + sizeof *header;
+	uint32_t raw_size;
+
+	*size = header->size;
+
+	if (header->flags & ~(WLDBG_TRACE_BLOCK_DELTA | WLDBG_TRACE_BLOCK_LZ))
+		return NULL;
+	if (header->flags == 0)
+		return data;
+
+	if (header->flags & WLDBG_TRACE_BLOCK_LZ) {
+		if (header->size < sizeof raw_size)
+			return NULL;
+
+		memcpy(&raw_size, data, sizeof raw_size);
+		/* a byte of the compressed data can not give more
+		 * than 255 bytes, do not allocate nonsense */
+		if (raw_size / 256 > header->size
+		    || reserve(buffer, buffer_size, raw_size + 1) < 0
+		    || wldbg_lz_decompress(data + sizeof raw_size,
+					   header->size - sizeof raw_size,
+					   *buffer, raw_size) < 0)
+			return NULL;
+
+		*size = raw_size;
+	} else {
+		if (reserve(buffer, buffer_size, header->size + 1) < 0)
+			return NULL;
+
+		memcpy(*buffer, data, header->size);
+	}
+
+	if ((header->flags & WLDBG_TRACE_BLOCK_DELTA)
+	    && delta_block(*buffer, *buffer, *size, header->count, 1) < 0)
+		return NULL;
+
+	return *buffer;
+}
+
+/* go through the blocks of a trace that has no index,
+ * the last block can be incomplete */
+static int
+scan_blocks(struct wldbg_trace *trace)
+{
+	struct wldbg_trace_block_header header;
+	struct wldbg_trace_record_header rh;
+	struct wldbg_trace_block_entry *entry, *blocks;
+	uint64_t offset = sizeof(struct wldbg_trace_header);
+	const char *records;
+	char *buffer = NULL;
+	size_t buffer_size = 0, size, pos;
+	uint32_t allocated = 0, i;
+	int ret = -1;
+
+	trace->blocks = NULL;
+	trace->block_count = 0;
+	trace->record_count = 0;
+	trace->keys = NULL;
+	trace->key_count = 0;
+
+	while (offset + sizeof header <= trace->size) {
+		memcpy(&header, trace->data + offset, sizeof header);
+		if (header.magic != WLDBG_TRACE_BLOCK_MAGIC
+		    || header.size > trace->size - offset - sizeof header)
+			break;
+
+		if (trace->block_count == allocated) {
+			allocated = allocated ? allocated * 2 : 64;
+			blocks = realloc(trace->scanned,
+					 allocated * sizeof *blocks);
+			if (!blocks)
+				goto out;
+
+			trace->scanned = blocks;
+		}
+
+		entry = &trace->scanned[trace->block_count];
+		entry->offset = offset;
+		entry->first_seq = header.first_seq;
+		entry->size = header.size;
+		entry->count = header.count;
+		entry->first_time = entry->last_time = 0;
+
+		records = load_block(trace, offset, &header,
+				    &buffer, &buffer_size, &size);
+		if (!records)
+			break;
+
+		/* we need the times for seeking */
+		pos = 0;
+		for (i = 0; i < header.count; ++i) {
+			if (size - pos < sizeof rh)
+				break;
+
+			memcpy(&rh, records + pos, sizeof rh);
+			if (i == 0)
+				entry->first_time = rh.time;
+			entry->last_time = rh.time;
+
+			pos += sizeof rh;
+			if (size - pos < (((size_t) rh.size + 3) & ~(size_t) 3))
+				break;
+			pos += ((size_t) rh.size + 3) & ~(size_t) 3;
+		}
+
+		if (i < header.count)
+			break;
+
+		trace->blocks = trace->scanned;
+		++trace->block_count;
+		trace->record_count += header.count;
+
+		offset += sizeof header + header.size;
+	}
+
+	ret = 0;
+out:
+	free(buffer);
+	return ret;
+}
+
+struct wldbg_trace *
+wldbg_trace_open(const char *path)
+{
+	struct wldbg_trace *trace;
+	struct wldbg_trace_header header;
+	struct stat st;
+	void *data;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stderr, "Failed opening trace '%s': %s\n",
+			path, strerror(errno));
+		return NULL;
+	}
+
+	if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof header) {
+		fprintf(stderr, "'%s' is not a wldbg trace\n", path);
+		close(fd);
+		return NULL;
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		fprintf(stderr, "Failed mapping trace '%s': %s\n",
+			path, strerror(errno));
+		return NULL;
+	}
+
+	memcpy(&header, data, sizeof header);
+	if (memcmp(header.magic, WLDBG_TRACE_MAGIC, sizeof header.magic) != 0
+	    || header.version != WLDBG_TRACE_VERSION
+	    || header.byte_order != WLDBG_TRACE_BYTE_ORDER) {
+		fprintf(stderr, "'%s' is not a wldbg trace or it was "
+			"recorded by another version or on another "
+			"architecture\n", path);
+		munmap(data, st.st_size);
+		return NULL;
+	}
+
+	trace = calloc(1, sizeof *trace);
+	if (!trace) {
+		munmap(data, st.st_size);
+		return NULL;
+	}
+
+	trace->data = data;
+	trace->size = st.st_size;
+
+	if (read_index(trace) < 0 && scan_blocks(trace) < 0) {
+		wldbg_trace_close(trace);
+		return NULL;
+	}
+
+	return trace;
+}
+
+void
+wldbg_trace_close(struct wldbg_trace *trace)
+{
+	munmap((void *) trace->data, trace->size);
+	free(trace->scanned);
+	free(trace);
+}
+
+uint64_t
+wldbg_trace_record_count(struct wldbg_trace *trace)
+{
+	return trace->record_count;
+}
+
+unsigned int
+wldbg_trace_block_count(struct wldbg_trace *trace)
+{
+	return trace->block_count;
+}
+
+const struct wldbg_trace_block_entry *
+wldbg_trace_get_block(struct wldbg_trace *trace, unsigned int block)
+{
+	if (block >= trace->block_count)
+		return NULL;
+
+	return &trace->blocks[block];
+}
+
+unsigned int
+wldbg_trace_find_time(struct wldbg_trace *trace, uint64_t time)
+{
+	unsigned int low = 0, high = trace->block_count, mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (trace->blocks[mid].last_time < time)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+static int
+compare_entry(struct wldbg_trace *trace,
+	      const struct wldbg_trace_key_entry *entry,
+	      const char *interface, int from, uint32_t opcode)
+{
+	int ret = strcmp(trace->strings + entry->interface, interface);
+
+	if (ret != 0)
+		return ret;
+	if (entry->from != from)
+		return entry->from - from;
+
+	return (entry->opcode > opcode) - (entry->opcode < opcode);
+}
+
+const uint32_t *
+wldbg_trace_find_message(struct wldbg_trace *trace, const char *interface,
+			 int from, uint32_t opcode, unsigned int *count)
+{
+	const struct wldbg_trace_key_entry *entry;
+	unsigned int low = 0, high = trace->key_count, mid;
+	int ret;
+
+	*count = 0;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		entry = &trace->keys[mid];
+
+		ret = compare_entry(trace, entry, interface, from, opcode);
+		if (ret == 0) {
+			*count = entry->ref_count;
+			return trace->refs + entry->first_ref;
+		}
+
+		if (ret < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return NULL;
+}
+
+int
+wldbg_trace_seek(struct wldbg_trace_cursor *cursor,
+		 struct wldbg_trace *trace, unsigned int block)
+{
+	const struct wldbg_trace_block_entry *entry;
+	struct wldbg_trace_block_header header;
+	char *buffer = cursor->buffer;
+	size_t buffer_size = cursor->buffer_size, size;
+	const char *records;
+
+	/* keep the buffer for the next blocks */
+	memset(cursor, 0, sizeof *cursor);
+	cursor->trace = trace;
+	cursor->block = block;
+	cursor->buffer = buffer;
+	cursor->buffer_size = buffer_size;
+
+	/* the end of the trace */
+	if (block >= trace->block_count) {
+		cursor->block = trace->block_count;
+		return 0;
+	}
+
+	entry = &trace->blocks[block];
+	if (entry->offset > trace->size
+	    || sizeof header > trace->size - entry->offset
+	    || entry->size > trace->size - entry->offset - sizeof header)
+		return -1;
+
+	memcpy(&header, trace->data + entry->offset, sizeof header);
+	if (header.magic != WLDBG_TRACE_BLOCK_MAGIC
+	    || header.size != entry->size)
+		return -1;
+
+	records = load_block(trace, entry->offset, &header,
+			     &cursor->buffer, &cursor->buffer_size, &size);
+	if (!records)
+		return -1;
+
+	cursor->position = records;
+	cursor->end = records + size;
+	cursor->seq = header.first_seq;
+
+	return 0;
+}
+
+int
+wldbg_trace_next(struct wldbg_trace_cursor *cursor,
+		 struct wldbg_trace_record *record)
+{
+	struct wldbg_trace_record_header rh;
+	size_t left, size;
+
+	while (cursor->position == cursor->end) {
+		if (cursor->block + 1 >= cursor->trace->block_count) {
+			cursor->block = cursor->trace->block_count;
+			cursor->position = cursor->end = NULL;
+			return 0;
+		}
+
+		if (wldbg_trace_seek(cursor, cursor->trace,
+				     cursor->block + 1) < 0)
+			return -1;
+	}
+
+	left = cursor->end - cursor->position;
+	if (left < sizeof rh)
+		return -1;
+
+	memcpy(&rh, cursor->position, sizeof rh);
+	size = ((size_t) rh.size + 3) & ~(size_t) 3;
+	if (left - sizeof rh < size)
+		return -1;
+
+	record->seq = cursor->seq++;
+	record->time = rh.time;
+	record->connection = rh.connection;
+	record->from = rh.from;
+	record->fd_count = rh.fd_count;
+	record->data = cursor->position + sizeof rh;
+	record->size = rh.size;
+
+	cursor->position += sizeof rh + size;
+
+	return 1;
+}
+
+void
+wldbg_trace_cursor_release(struct wldbg_trace_cursor *cursor)
+{
+	free(cursor->buffer);
+	cursor->buffer = NULL;
+	cursor->buffer_size = 0;
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WLDBG_TRACE_H_
+#define _WLDBG_TRACE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Recorded Wayland traffic (see the record pass).
+ *
+ * The file starts with a header and then there are blocks of records.
+ * A record is one message: the raw data and where and when it came
+ * from. When the trace is finished, an index is written after the last
+ * block, so that a reader can find the blocks by time or by messages
+ * without reading the whole file. All numbers are in the byte order
+ * of the machine that recorded the trace (like the wire format).
+ *
+ *   header | block | block | ... | index | trailer
+ *
+ * Blocks can be compressed, every block on its own, so that
+ * the trace can still be read from any block:
+ *
+ *  - WLDBG_TRACE_BLOCK_DELTA: the data of a message are stored as
+ *    the difference (word by word, except the object id and opcode,
+ *    as many words as both messages have) from the last message in
+ *    the block with the same object, opcode, direction and
+ *    connection. The time of
+ *    a record is the difference from the time of the previous record.
+ *    Repeating messages (motion, frame, damage, commit...) become
+ *    mostly zeros then.
+ *  - WLDBG_TRACE_BLOCK_LZ: the records are compressed by wldbg_lz
+ *    (see wldbg-lz.h). The size of the uncompressed records
+ *    (uint32_t) precedes the compressed data.
+ */
+
+#define WLDBG_TRACE_MAGIC		"WLDBGTRC"
+#define WLDBG_TRACE_INDEX_MAGIC		"WLDBGIDX"
+#define WLDBG_TRACE_BLOCK_MAGIC		0x4b4c4257 /* "WBLK" */
+#define WLDBG_TRACE_VERSION		1
+#define WLDBG_TRACE_BYTE_ORDER		0x01020304
+
+/* flags of blocks */
+#define WLDBG_TRACE_BLOCK_DELTA		(1 << 0)
+#define WLDBG_TRACE_BLOCK_LZ		(1 << 1)
+
+struct wldbg_trace_header {
+	char magic[8];
+	uint32_t version;
+	/* WLDBG_TRACE_BYTE_ORDER as written by the recording machine */
+	uint32_t byte_order;
+};
+
+struct wldbg_trace_block_header {
+	uint32_t magic;
+	/* size of the records that follow the header
+	 * (as they are stored in the file) */
+	uint32_t size;
+	uint32_t count;
+	/* WLDBG_TRACE_BLOCK_* */
+	uint32_t flags;
+	/* sequence number of the first record, the next records
+	 * have the following numbers */
+	uint64_t first_seq;
+};
+
+struct wldbg_trace_record_header {
+	/* CLOCK_MONOTONIC in nanoseconds */
+	uint64_t time;
+	/* size of the data that follow the header */
+	uint32_t size;
+	uint16_t connection;
+	/* SERVER or CLIENT */
+	uint8_t from;
+	/* number of file descriptors sent with the message.
+	 * The descriptors themselves are not recorded */
+	uint8_t fd_count;
+};
+
+/* index: blocks, keys, block references, strings, trailer */
+
+struct wldbg_trace_block_entry {
+	/* offset of the block header in the file */
+	uint64_t offset;
+	uint64_t first_seq;
+	uint64_t first_time;
+	uint64_t last_time;
+	uint32_t size;
+	uint32_t count;
+};
+
+/* blocks that contain a message. Keys are sorted
+ * by the name of the interface, direction and opcode */
+struct wldbg_trace_key_entry {
+	/* offset of the name of the interface in the strings */
+	uint32_t interface;
+	uint16_t opcode;
+	uint8_t from;
+	uint8_t reserved;
+	/* the blocks are refs[first_ref] .. refs[first_ref + ref_count - 1] */
+	uint32_t first_ref;
+	uint32_t ref_count;
+	/* number of the messages in the whole trace */
+	uint64_t count;
+};
+
+/* the last bytes of the file */
+struct wldbg_trace_trailer {
+	uint64_t index_offset;
+	uint64_t record_count;
+	uint32_t block_count;
+	uint32_t key_count;
+	uint32_t ref_count;
+	uint32_t strings_size;
+	char magic[8];
+};
+
+struct wldbg_trace_record {
+	uint64_t seq;
+	uint64_t time;
+	uint32_t connection;
+	int from;
+	unsigned int fd_count;
+	const void *data;
+	size_t size;
+};
+
+/* writing */
+
+struct wldbg_trace_writer;
+
+/* flags of the writer */
+#define WLDBG_TRACE_COMPRESS		(1 << 0)
+
+/* start a trace in fd. The fd is not closed by the writer.
+ * With WLDBG_TRACE_COMPRESS the blocks are compressed */
+struct wldbg_trace_writer *
+wldbg_trace_writer_create(int fd, uint32_t flags);
+
+/* add a record, the sequence number (record->seq) is assigned
+ * by the writer. interface and opcode identify the message
+ * in the index, interface can be NULL if it is not known */
+int
+wldbg_trace_writer_add(struct wldbg_trace_writer *writer,
+		       const struct wldbg_trace_record *record,
+		       const char *interface, uint32_t opcode);
+
+/* write the rest of the records and the index and destroy the writer.
+ * Returns -1 if some write failed (now or before) */
+int
+wldbg_trace_writer_finish(struct wldbg_trace_writer *writer);
+
+/* reading */
+
+struct wldbg_trace;
+
+/* map the trace into memory. If the trace has no index (wldbg was
+ * killed), the blocks are found by going through the file and the
+ * records can not be looked up by messages */
+struct wldbg_trace *
+wldbg_trace_open(const char *path);
+
+void
+wldbg_trace_close(struct wldbg_trace *trace);
+
+uint64_t
+wldbg_trace_record_count(struct wldbg_trace *trace);
+
+unsigned int
+wldbg_trace_block_count(struct wldbg_trace *trace);
+
+const struct wldbg_trace_block_entry *
+wldbg_trace_get_block(struct wldbg_trace *trace, unsigned int block);
+
+/* the first block with records received at time or later,
+ * wldbg_trace_block_count() if there is none */
+unsigned int
+wldbg_trace_find_time(struct wldbg_trace *trace, uint64_t time);
+
+/* the blocks that contain the message, in ascending order. Returns
+ * NULL if there is no such message or the trace has no index */
+const uint32_t *
+wldbg_trace_find_message(struct wldbg_trace *trace, const char *interface,
+			 int from, uint32_t opcode, unsigned int *count);
+
+struct wldbg_trace_cursor {
+	struct wldbg_trace *trace;
+	/* the block that we read from */
+	unsigned int block;
+	const char *position;
+	const char *end;
+	uint64_t seq;
+
+	/* the block uncompressed */
+	char *buffer;
+	size_t buffer_size;
+};
+
+/* set the cursor to the first record of the block. The cursor
+ * must be zeroed before the first seek and released when it is
+ * not needed anymore */
+int
+wldbg_trace_seek(struct wldbg_trace_cursor *cursor,
+		 struct wldbg_trace *trace, unsigned int block);
+
+/* read the record under the cursor and move to the next one.
+ * The data of the record point into the trace or into the buffer
+ * of the cursor, they are valid until the cursor moves to another
+ * block. Returns 1 if there was a record, 0 at the end of the trace
+ * and -1 if the trace is corrupted */
+int
+wldbg_trace_next(struct wldbg_trace_cursor *cursor,
+		 struct wldbg_trace_record *record);
+
+void
+wldbg_trace_cursor_release(struct wldbg_trace_cursor *cursor);
+
+#endif /* _WLDBG_TRACE_H_ */
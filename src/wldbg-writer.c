@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "wldbg-writer.h"
+
+/* how many buffers can wait in the queue */
+#define WRITER_QUEUE_LENGTH 256
+
+int
+wldbg_output_append(struct wldbg_output *out, const char *data, size_t size)
+{
+	size_t allocated;
+	char *new_data;
+
+	if (out->allocated - out->size < size) {
+		allocated = out->allocated ? out->allocated : 256;
+		while (allocated - out->size < size)
+			allocated *= 2;
+
+		new_data = realloc(out->data, allocated);
+		if (!new_data)
+			return -1;
+
+		out->data = new_data;
+		out->allocated = allocated;
+	}
+
+	memcpy(out->data + out->size, data, size);
+	out->size += size;
+
+	return 0;
+}
+
+int
+wldbg_output_vprintf(struct wldbg_output *out, const char *fmt, va_list ap)
+{
+	va_list copy;
+	size_t allocated;
+	char *new_data;
+	int len;
+
+	va_copy(copy, ap);
+	len = vsnprintf(out->data + out->size, out->allocated - out->size,
+			fmt, copy);
+	va_end(copy);
+
+	if (len < 0)
+		return -1;
+
+	/* it fit in, including the terminating zero */
+	if ((size_t) len < out->allocated - out->size) {
+		out->size += len;
+		return 0;
+	}
+
+	allocated = out->allocated ? out->allocated : 256;
+	while (allocated - out->size <= (size_t) len)
+		allocated *= 2;
+
+	new_data = realloc(out->data, allocated);
+	if (!new_data)
+		return -1;
+
+	out->data = new_data;
+	out->allocated = allocated;
+
+	vsnprintf(out->data + out->size, out->allocated - out->size, fmt, ap);
+
+	out->size += len;
+	return 0;
+}
+
+int
+wldbg_output_printf(struct wldbg_output *out, const char *fmt, ...)
+{
+	va_list ap;
+	int ret;
+
+	va_start(ap, fmt);
+	ret = wldbg_output_vprintf(out, fmt, ap);
+	va_end(ap);
+
+	return ret;
+}
+
+void
+wldbg_output_release(struct wldbg_output *out)
+{
+	free(out->data);
+	memset(out, 0, sizeof *out);
+}
+
+struct queued_output {
+	struct wldbg_output output;
+	/* lines dropped right before this output */
+	uint64_t dropped;
+	/* the marker of dropped lines */
+	char marker[64];
+};
+
+struct wldbg_writer {
+	int fd;
+	/* writing into the fd failed, we just throw the text away */
+	int broken;
+	pthread_t thread;
+
+	pthread_mutex_t lock;
+	/* the queue is not empty or we are quitting */
+	pthread_cond_t not_empty;
+	/* something was written */
+	pthread_cond_t written;
+	int quit;
+
+	/* the outputs from first are in the queue, the allocated
+	 * buffers in the rest are reused by wldbg_writer_write() */
+	struct queued_output queue[WRITER_QUEUE_LENGTH];
+	unsigned int first;
+	unsigned int count;
+	size_t size;
+	size_t max_size;
+
+	/* lines dropped since the last queued output */
+	uint64_t dropped;
+	uint64_t dropped_total;
+};
+
+static unsigned int
+count_lines(const struct wldbg_output *out)
+{
+	const char *p = out->data, *end = out->data + out->size;
+	unsigned int n = 0;
+
+	while ((p = memchr(p, '\n', end - p))) {
+		++n;
+		++p;
+	}
+
+	return n;
+}
+
+static void
+write_all(struct wldbg_writer *writer, struct iovec *iov, int iovcnt)
+{
+	ssize_t ret;
+
+	while (iovcnt > 0 && !writer->broken) {
+		ret = writev(writer->fd, iov, iovcnt);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			writer->broken = 1;
+			break;
+		}
+
+		/* skip what was written */
+		while (iovcnt > 0 && (size_t) ret >= iov->iov_len) {
+			ret -= iov->iov_len;
+			++iov;
+			--iovcnt;
+		}
+
+		if (iovcnt > 0) {
+			iov->iov_base = (char *) iov->iov_base + ret;
+			iov->iov_len -= ret;
+		}
+	}
+}
+
+static void
+write_queued(struct wldbg_writer *writer, unsigned int first,
+	     unsigned int count)
+{
+	struct iovec iov[2 * WRITER_QUEUE_LENGTH];
+	struct queued_output *q;
+	unsigned int i;
+	int n = 0;
+
+	for (i = 0; i < count; ++i) {
+		q = &writer->queue[(first + i) % WRITER_QUEUE_LENGTH];
+
+		if (q->dropped) {
+			iov[n].iov_base = q->marker;
+			iov[n].iov_len = snprintf(q->marker, sizeof q->marker,
+						  "[wldbg: %llu lines dropped]\n",
+						  (unsigned long long) q->dropped);
+			++n;
+		}
+
+		iov[n].iov_base = q->output.data;
+		iov[n].iov_len = q->output.size;
+		++n;
+	}
+
+	write_all(writer, iov, n);
+}
+
+static void *
+writer_thread(void *data)
+{
+	struct wldbg_writer *writer = data;
+	unsigned int first, count, i;
+	size_t size;
+
+	pthread_mutex_lock(&writer->lock);
+	for (;;) {
+		while (writer->count == 0 && !writer->quit)
+			pthread_cond_wait(&writer->not_empty, &writer->lock);
+
+		if (writer->count == 0)
+			break;
+
+		/* the queued outputs are ours until we remove
+		 * them from the queue, write them without the lock */
+		first = writer->first;
+		count = writer->count;
+		pthread_mutex_unlock(&writer->lock);
+
+		write_queued(writer, first, count);
+
+		pthread_mutex_lock(&writer->lock);
+		size = 0;
+		for (i = 0; i < count; ++i) {
+			size += writer->queue[(first + i)
+					      % WRITER_QUEUE_LENGTH].output.size;
+			writer->queue[(first + i)
+				      % WRITER_QUEUE_LENGTH].output.size = 0;
+		}
+
+		writer->first = (first + count) % WRITER_QUEUE_LENGTH;
+		writer->count -= count;
+		writer->size -= size;
+		pthread_cond_broadcast(&writer->written);
+	}
+	pthread_mutex_unlock(&writer->lock);
+
+	return NULL;
+}
+
+struct wldbg_writer *
+wldbg_writer_create(int fd, size_t max_size)
+{
+	struct wldbg_writer *writer;
+	sigset_t all, old;
+	int ret;
+
+	writer = calloc(1, sizeof *writer);
+	if (!writer)
+		return NULL;
+
+	writer->fd = fd;
+	writer->max_size = max_size;
+	pthread_mutex_init(&writer->lock, NULL);
+	pthread_cond_init(&writer->not_empty, NULL);
+	pthread_cond_init(&writer->written, NULL);
+
+	/* signals are handled by the main loop, not by us */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	ret = pthread_create(&writer->thread, NULL, writer_thread, writer);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (ret != 0) {
+		fprintf(stderr, "Failed creating writer thread: %s\n",
+			strerror(ret));
+		pthread_cond_destroy(&writer->written);
+		pthread_cond_destroy(&writer->not_empty);
+		pthread_mutex_destroy(&writer->lock);
+		free(writer);
+		return NULL;
+	}
+
+	return writer;
+}
+
+int
+wldbg_writer_write(struct wldbg_writer *writer, struct wldbg_output *out)
+{
+	struct queued_output *q;
+	struct wldbg_output tmp;
+
+	if (out->size == 0)
+		return 0;
+
+	pthread_mutex_lock(&writer->lock);
+
+	if (writer->count == WRITER_QUEUE_LENGTH
+	    || writer->size + out->size > writer->max_size) {
+		writer->dropped += count_lines(out);
+		pthread_mutex_unlock(&writer->lock);
+
+		out->size = 0;
+		return -1;
+	}
+
+	/* swap the buffers, so that the caller
+	 * gets an already allocated one */
+	q = &writer->queue[(writer->first + writer->count)
+			   % WRITER_QUEUE_LENGTH];
+	tmp = q->output;
+	q->output = *out;
+	*out = tmp;
+
+	q->dropped = writer->dropped;
+	writer->dropped_total += writer->dropped;
+	writer->dropped = 0;
+
+	writer->size += q->output.size;
+	if (writer->count++ == 0)
+		pthread_cond_signal(&writer->not_empty);
+
+	pthread_mutex_unlock(&writer->lock);
+
+	return 0;
+}
+
+void
+wldbg_writer_flush(struct wldbg_writer *writer)
+{
+	pthread_mutex_lock(&writer->lock);
+	while (writer->count > 0)
+		pthread_cond_wait(&writer->written, &writer->lock);
+	pthread_mutex_unlock(&writer->lock);
+}
+
+uint64_t
+wldbg_writer_dropped(struct wldbg_writer *writer)
+{
+	uint64_t dropped;
+
+	pthread_mutex_lock(&writer->lock);
+	dropped = writer->dropped_total + writer->dropped;
+	pthread_mutex_unlock(&writer->lock);
+
+	return dropped;
+}
+
+void
+wldbg_writer_destroy(struct wldbg_writer *writer)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&writer->lock);
+	writer->quit = 1;
+	pthread_cond_signal(&writer->not_empty);
+	pthread_mutex_unlock(&writer->lock);
+
+	pthread_join(writer->thread, NULL);
+
+	/* lines dropped after the last queued output */
+	if (writer->dropped) {
+		writer->queue[0].output.size = 0;
+		writer->queue[0].dropped = writer->dropped;
+		write_queued(writer, 0, 1);
+	}
+
+	for (i = 0; i < WRITER_QUEUE_LENGTH; ++i)
+		wldbg_output_release(&writer->queue[i].output);
+
+	pthread_cond_destroy(&writer->written);
+	pthread_cond_destroy(&writer->not_empty);
+	pthread_mutex_destroy(&writer->lock);
+	free(writer);
+}
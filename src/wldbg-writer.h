@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WLDBG_WRITER_H_
+#define _WLDBG_WRITER_H_
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wayland/wayland-util.h"
+
+/*
+ * Text that wldbg prints is formatted into an output buffer (one for
+ * every connection) and the buffer is handed over to the writer. The
+ * writer has its own thread that writes the buffers into the fd, so
+ * a slow terminal or a full pipe does not stop forwarding messages.
+ * The queue of the writer is bounded. When it is full, the buffers
+ * are dropped and the writer prints how many lines it dropped.
+ */
+
+struct wldbg_output {
+	char *data;
+	size_t size;
+	size_t allocated;
+};
+
+/* the functions return -1 when out of memory,
+ * the text is truncated in that case */
+int
+wldbg_output_printf(struct wldbg_output *out,
+		    const char *fmt, ...) WL_PRINTF(2, 3);
+
+int
+wldbg_output_vprintf(struct wldbg_output *out,
+		     const char *fmt, va_list ap) WL_PRINTF(2, 0);
+
+int
+wldbg_output_append(struct wldbg_output *out, const char *data, size_t size);
+
+static inline int
+wldbg_output_putc(struct wldbg_output *out, char c)
+{
+	if (out->size < out->allocated) {
+		out->data[out->size++] = c;
+		return 0;
+	}
+
+	return wldbg_output_append(out, &c, 1);
+}
+
+void
+wldbg_output_release(struct wldbg_output *out);
+
+struct wldbg_writer;
+
+/* start writing into fd. The writer holds at most max_size bytes */
+struct wldbg_writer *
+wldbg_writer_create(int fd, size_t max_size);
+
+/* queue the text from out, out is empty after this call. Returns 0
+ * when the text was queued and -1 when it was dropped */
+int
+wldbg_writer_write(struct wldbg_writer *writer, struct wldbg_output *out);
+
+/* wait until everything queued is written */
+void
+wldbg_writer_flush(struct wldbg_writer *writer);
+
+/* number of lines that the writer dropped so far */
+uint64_t
+wldbg_writer_dropped(struct wldbg_writer *writer);
+
+/* flush and destroy the writer */
+void
+wldbg_writer_destroy(struct wldbg_writer *writer);
+
+#endif /* _WLDBG_WRITER_H_ */
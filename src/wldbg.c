@@ -48,6 +48,8 @@
 #include "objinfo/objinfo.h"
 #include "sockets.h"
 #include "getopt.h"
+#include "replay.h"
+#include "protocols.h"
 #include "wayland/wayland-private.h"
 #include "wayland/wayland-util.h"
 #include "wayland/wayland-os.h"
@@ -70,31 +72,196 @@ load_passes(struct wldbg *wldbg, struct wldbg_options *opts,
 static int
 dispatch_messages(int fd, void *data);
 
+static struct wldbg_fd_callback *
+monitor_connection_fd(struct wldbg *wldbg, int fd,
+		      struct wldbg_connection *conn, struct wldbg_flow *flow)
+{
+	uint32_t events = EPOLLIN;
+
+	if (wldbg->flags.edge_triggered)
+		events |= EPOLLET;
+
+	flow->events = events;
+
+	return wldbg_monitor_fd_events(wldbg, fd, events,
+				       dispatch_messages, conn);
+}
+
+static void
+stop_stall(struct wldbg *wldbg, struct wldbg_flow *flow)
+{
+	if (!flow->stalled)
+		return;
+
+	wldbg->statistics.stall_time
+		+= monotonic_time_ns() - flow->stalled_since;
+	flow->stalled = 0;
+}
+
+/*
+ * Flow control for one side of a connection. Monitor the fd for
+ * writing while we have data queued for it (wl_conn). Stop reading
+ * from it when the other side (peer) has too much data queued,
+ * i. e. it does not keep up with reading, and start reading again
+ * when the other side drains them.
+ */
+static int
+update_flow(struct wldbg *wldbg, struct wldbg_fd_callback *cb,
+	    struct wldbg_flow *flow, struct wl_connection *wl_conn,
+	    struct wl_connection *peer)
+{
+	size_t queued = wl_connection_pending_output(peer);
+	size_t room = wldbg->connection_buffers.max_size - queued;
+	/* the most that one read from wl_conn can queue for the peer.
+	 * It is more than connection_buffers.size if the input
+	 * buffer grew for a big message */
+	size_t read_size = wl_connection_buffer_size(wl_conn);
+	uint32_t events;
+
+	if (queued > wldbg->statistics.max_queued)
+		wldbg->statistics.max_queued = queued;
+
+	if (!flow->stalled
+	    && (queued >= wldbg->connection_buffers.high_watermark
+		|| read_size > room)) {
+		vdbg("Stop reading fd %d, %zu bytes queued\n", cb->fd, queued);
+		flow->stalled = 1;
+		flow->stalled_since = monotonic_time_ns();
+		++wldbg->statistics.stalls;
+	} else if (flow->stalled
+		   && queued <= wldbg->connection_buffers.low_watermark
+		   && read_size <= room) {
+		vdbg("Resume reading fd %d\n", cb->fd);
+		stop_stall(wldbg, flow);
+	}
+
+	events = flow->stalled ? 0 : EPOLLIN;
+	if (wl_connection_pending_output(wl_conn) > 0)
+		events |= EPOLLOUT;
+	if (wldbg->flags.edge_triggered)
+		events |= EPOLLET;
+
+	if (events == flow->events)
+		return 0;
+
+	if (wldbg_modify_fd_events(wldbg, cb, events) < 0)
+		return -1;
+
+	flow->events = events;
+
+	return 0;
+}
+
+/* all messages queued for the fd were sent, account their latency */
+static void
+flow_flushed(struct wldbg *wldbg, struct wldbg_flow *flow, int from)
+{
+	uint64_t us;
+	int i = 0;
+
+	if (!flow->queued_messages)
+		return;
+
+	us = (monotonic_time_ns() - flow->queued_since) / 1000;
+	while (us > 0 && i < WLDBG_LATENCY_BUCKETS - 1) {
+		us >>= 1;
+		++i;
+	}
+
+	wldbg->statistics.latency[from][i] += flow->queued_messages;
+	flow->queued_messages = 0;
+}
+
+/*
+ * n messages from the 'from' side were written into write_conn.
+ * If some data are still queued, the latency of all queued
+ * messages is measured from the time the oldest of them
+ * was received, when they are all sent
+ */
+static void
+account_latency(struct wldbg_connection *conn,
+		struct wl_connection *write_conn, int from,
+		uint64_t received, int n)
+{
+	struct wldbg_flow *flow;
+
+	if (write_conn == conn->server.connection)
+		flow = &conn->server.flow;
+	else
+		flow = &conn->client.flow;
+
+	if (!flow->queued_messages)
+		flow->queued_since = received;
+	flow->queued_messages += n;
+
+	if (wl_connection_pending_output(write_conn) == 0)
+		flow_flushed(conn->wldbg, flow, from);
+}
+
+static int
+update_connection_flow(struct wldbg_connection *conn)
+{
+	struct wldbg *wldbg = conn->wldbg;
+
+	/* the client is not connected yet */
+	if (!conn->client.connection)
+		return 0;
+
+	if (update_flow(wldbg, conn->server.cb, &conn->server.flow,
+			conn->server.connection, conn->client.connection) < 0)
+		return -1;
+
+	return update_flow(wldbg, conn->client.cb, &conn->client.flow,
+			   conn->client.connection, conn->server.connection);
+}
+
+#define WLDBG_DEFAULT_BUFFER_SIZE	4096
+#define WLDBG_DEFAULT_MAX_BUFFER_SIZE	(1024 * 1024)
+/* how much printed text can wait for the writer */
+#define WLDBG_WRITER_MAX_SIZE		(4 * 1024 * 1024)
+
+static int
+set_connection_buffer_size(struct wldbg *wldbg, struct wl_connection *wl_conn)
+{
+	if (wl_connection_set_buffer_size(wl_conn,
+					  wldbg->connection_buffers.size,
+					  wldbg->connection_buffers.max_size) < 0) {
+		perror("Setting size of connection buffers");
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Create a connection together with its socket to the server.
+ * The server socket is owned by conn->server.connection and
+ * closed with it. On failure, everything acquired here is released
+ * (including the server socket) and NULL is returned. Fds of the
+ * caller (e. g. an accepted client fd) are never touched here, the
+ * caller keeps owning them on failure.
+ */
 static struct wldbg_connection *
 wldbg_connection_create(struct wldbg *wldbg)
 {
 	const char *sock_name = NULL;
-	int fd;
 
 	struct wldbg_connection *conn = calloc(1, sizeof *conn);
 	if (!conn)
 		return NULL;
 
+	wldbg_object_table_init(&conn->objects);
+
 	if (wldbg->resolving_objects) {
-		conn->resolved_objects = create_resolved_objects();
-		if (!conn->resolved_objects) {
-			free(conn);
-			return NULL;
-		}
+		conn->resolved_objects = create_resolved_objects(wldbg, &conn->objects);
+		if (!conn->resolved_objects)
+			goto err_table;
 	}
 
 	if (wldbg->gathering_info) {
-		conn->objects_info = create_objects_info();
-		if (!conn->objects_info) {
-			destroy_resolved_objects(conn->resolved_objects);
-			free(conn);
-			return NULL;
-		}
+		conn->objects_info = create_objects_info(&conn->objects);
+		if (!conn->objects_info)
+			goto err_resolved;
 	}
 
 	conn->wldbg = wldbg;
@@ -109,33 +276,46 @@ wldbg_connection_create(struct wldbg *wldbg)
 			sock_name = wldbg->server_mode.wldbg_socket_name;
 	}
 
-	fd = connect_to_wayland_server(conn, sock_name);
-	if (fd < 0) {
-		destroy_resolved_objects(conn->resolved_objects);
-		destroy_objects_info(conn->objects_info);
-		free(conn);
-		return NULL;
-	}
+	/* closes the socket itself when it fails */
+	if (connect_to_wayland_server(conn, sock_name) < 0)
+		goto err_info;
 
-	if (wldbg_monitor_fd(wldbg, conn->server.fd,
-			     dispatch_messages, conn) == NULL) {
-		destroy_resolved_objects(conn->resolved_objects);
-		destroy_objects_info(conn->objects_info);
-		free(conn);
-		close(fd);
-		return NULL;
-	}
+	if (set_connection_buffer_size(wldbg, conn->server.connection) < 0)
+		goto err_server;
+
+	conn->server.cb = monitor_connection_fd(wldbg, conn->server.fd, conn,
+						&conn->server.flow);
+	if (conn->server.cb == NULL)
+		goto err_server;
 
 	return conn;
+
+err_server:
+	/* closes conn->server.fd too */
+	wl_connection_destroy(conn->server.connection);
+err_info:
+	destroy_objects_info(conn->objects_info);
+err_resolved:
+	destroy_resolved_objects(conn->resolved_objects);
+err_table:
+	wldbg_object_table_release(&conn->objects);
+	free(conn);
+	return NULL;
 }
 
 static void
 wldbg_connection_destroy(struct wldbg_connection *conn)
 {
+	wldbg_collapse_flush(conn);
+	wldbg_output_flush(conn);
+	wldbg_output_release(&conn->output);
+	wldbg_collapse_release(conn);
+
 	if (conn->resolved_objects)
 		destroy_resolved_objects(conn->resolved_objects);
 	if (conn->objects_info)
 		destroy_objects_info(conn->objects_info);
+	wldbg_object_table_release(&conn->objects);
 
 	wl_connection_destroy(conn->server.connection);
 	wl_connection_destroy(conn->client.connection);
@@ -165,6 +345,7 @@ wldbg_add_connection(struct wldbg_connection *conn)
 
 	wl_list_insert(&wldbg->connections, &conn->link);
 	++wldbg->connections_num;
+	conn->id = ++wldbg->last_connection_id;
 
 	vdbg("Adding connection (%d) [%p]\n",
 	     wldbg->connections_num, conn);
@@ -203,12 +384,22 @@ wldbg_foreach_connection(struct wldbg *wldbg,
 }
 
 static int
-remove_connection(struct wldbg_connection *conn, struct wldbg_fd_callback *cb)
+remove_connection(struct wldbg_connection *conn)
 {
 	struct wldbg *wldbg = conn->wldbg;
+	int ret = 0;
 
 	wldbg_remove_connection(conn);
-	if (wldbg_remove_callback(wldbg, cb) != 0)
+
+	stop_stall(wldbg, &conn->server.flow);
+	stop_stall(wldbg, &conn->client.flow);
+
+	if (conn->server.cb)
+		ret |= wldbg_remove_callback(wldbg, conn->server.cb);
+	if (conn->client.cb)
+		ret |= wldbg_remove_callback(wldbg, conn->client.cb);
+
+	if (ret != 0)
 		return 0;
 
 	wldbg_connection_destroy(conn);
@@ -217,18 +408,251 @@ remove_connection(struct wldbg_connection *conn, struct wldbg_fd_callback *cb)
 	return wldbg->connections_num;
 }
 
+/* how many events we take from epoll at once */
+#define WLDBG_MAX_EVENTS 32
+
+/* The connection is going to be destroyed, so make sure
+ * that we won't touch its callbacks in the rest of the batch */
+static void
+invalidate_callback_events(struct epoll_event *events, int n,
+			   struct wldbg_fd_callback *cb)
+{
+	int i;
+
+	for (i = 0; i < n; ++i) {
+		if (events[i].data.ptr == cb)
+			events[i].data.ptr = NULL;
+	}
+}
+
+static void
+invalidate_connection_events(struct epoll_event *events, int n,
+			     struct wldbg_connection *conn)
+{
+	if (conn->server.cb)
+		invalidate_callback_events(events, n, conn->server.cb);
+	if (conn->client.cb)
+		invalidate_callback_events(events, n, conn->client.cb);
+}
+
 static int
-wldbg_dispatch(struct wldbg *wldbg)
+flush_connection(struct wldbg *wldbg, struct wl_connection *wl_conn);
+
+static int
+dispatch_output(struct wldbg_connection *conn, int fd)
 {
-	struct epoll_event ev;
-	struct wldbg_fd_callback *cb;
+	struct wl_connection *wl_conn;
+	struct wldbg_flow *flow;
+	int from;
+
+	/* we write to the client the messages from server
+	 * and vice versa */
+	if (fd == conn->client.fd) {
+		wl_conn = conn->client.connection;
+		flow = &conn->client.flow;
+		from = SERVER;
+	} else {
+		wl_conn = conn->server.connection;
+		flow = &conn->server.flow;
+		from = CLIENT;
+	}
+
+	if (flush_connection(conn->wldbg, wl_conn) < 0) {
+		perror("wl_connection_flush");
+		return -1;
+	}
+
+	if (wl_connection_pending_output(wl_conn) == 0)
+		flow_flushed(conn->wldbg, flow, from);
+
+	if (update_connection_flow(conn) < 0)
+		return -1;
+
+	return 1;
+}
+
+static int
+process_data(struct wldbg_connection *conn,
+	     struct wl_connection *wl_connection, int len,
+	     uint64_t received);
+
+/*
+ * The side of cb hung up or its socket failed. Read what is left in its
+ * socket, even if we stopped reading it because the other side did not
+ * keep up, and stop watching it. Then the other side gets the rest
+ * of the messages and only after that the connection is removed.
+ */
+static int
+close_side(struct wldbg_connection *conn, struct wldbg_fd_callback *cb,
+	   struct epoll_event *events, int n)
+{
+	struct wldbg *wldbg = conn->wldbg;
+	struct wl_connection *read_conn, *write_conn;
+	struct wldbg_fd_callback *peer_cb;
+	struct wldbg_flow *peer_flow;
+	int len, ret = 0;
+
+	if (cb == conn->client.cb) {
+		read_conn = conn->client.connection;
+		write_conn = conn->server.connection;
+		peer_cb = conn->server.cb;
+		peer_flow = &conn->server.flow;
+	} else {
+		read_conn = conn->server.connection;
+		write_conn = conn->client.connection;
+		peer_cb = conn->client.cb;
+		peer_flow = &conn->client.flow;
+	}
+
+	do {
+		len = wl_connection_read(read_conn);
+		if (len <= 0)
+			break;
+
+		ret = process_data(conn, read_conn, len, monotonic_time_ns());
+		wldbg_output_flush(conn);
+	} while (ret > 0 && !wldbg->flags.exit && !wldbg->flags.error);
+
+	if (wldbg->flags.exit || wldbg->flags.error)
+		return 1;
+
+	stop_stall(wldbg, &conn->server.flow);
+	stop_stall(wldbg, &conn->client.flow);
+
+	if (cb == conn->client.cb)
+		conn->client.cb = NULL;
+	else
+		conn->server.cb = NULL;
+
+	invalidate_callback_events(events, n, cb);
+	wldbg_remove_callback(wldbg, cb);
+
+	if (!peer_cb || flush_connection(wldbg, write_conn) < 0
+	    || wl_connection_pending_output(write_conn) == 0) {
+		invalidate_connection_events(events, n, conn);
+		/* if connections_num is 0, that we're done */
+		return remove_connection(conn);
+	}
+
+	/* wait until the other side can take the rest */
+	vdbg("Connection [%p] is closing, %zu bytes left\n",
+	     conn, wl_connection_pending_output(write_conn));
+	conn->closing = 1;
+	if (wldbg_modify_fd_events(wldbg, peer_cb, EPOLLOUT) < 0)
+		return -1;
+	peer_flow->events = EPOLLOUT;
+
+	return 1;
+}
+
+/* only one side of the connection is left, send it the rest */
+static int
+dispatch_closing(struct wldbg_connection *conn, struct wldbg_fd_callback *cb,
+		 uint32_t revents, struct epoll_event *events, int n)
+{
+	struct wldbg *wldbg = conn->wldbg;
+	struct wl_connection *wl_conn;
+	struct wldbg_flow *flow;
+	int from;
+
+	if (cb == conn->client.cb) {
+		wl_conn = conn->client.connection;
+		flow = &conn->client.flow;
+		from = SERVER;
+	} else {
+		wl_conn = conn->server.connection;
+		flow = &conn->server.flow;
+		from = CLIENT;
+	}
+
+	if (!(revents & (EPOLLHUP | EPOLLERR))
+	    && flush_connection(wldbg, wl_conn) >= 0
+	    && wl_connection_pending_output(wl_conn) > 0)
+		return 1;
+
+	if (wl_connection_pending_output(wl_conn) == 0)
+		flow_flushed(wldbg, flow, from);
+
+	invalidate_connection_events(events, n, conn);
+	/* if connections_num is 0, that we're done */
+	return remove_connection(conn);
+}
+
+static int
+dispatch_event(struct wldbg *wldbg, struct epoll_event *events,
+	       int i, int n)
+{
+	struct wldbg_fd_callback *cb = events[i].data.ptr;
 	struct wldbg_connection *conn;
-	int n, ret;
+	int ret = 1;
+
+	/* connection of this callback was removed earlier in the batch */
+	if (!cb)
+		return 1;
+
+	/* signals and server-mode socket. These are not connections,
+	 * so any problem with them is fatal */
+	if (cb->dispatch != dispatch_messages) {
+		if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+			fprintf(stderr, "epoll event error\n");
+			return -1;
+		}
+
+		vdbg("cb [%p]: dispatching %p(%d, %p)\n",
+		     cb, cb->dispatch, cb->fd, cb->data);
+
+		return cb->dispatch(cb->fd, cb->data) > 0 ? 1 : -1;
+	}
+
+	conn = cb->data;
+
+	if (conn->closing)
+		return dispatch_closing(conn, cb, events[i].events,
+					events + i + 1, n - i - 1);
+
+	/* the socket is writable again, send what we have queued */
+	if (events[i].events & EPOLLOUT)
+		ret = dispatch_output(conn, cb->fd);
+
+	/* read what is left in the socket even when the peer hung up,
+	 * so that we forward things like wl_display.error */
+	if (ret > 0 && (events[i].events & EPOLLIN)) {
+		vdbg("cb [%p]: dispatching %p(%d, %p)\n",
+		     cb, cb->dispatch, cb->fd, cb->data);
+
+		ret = cb->dispatch(cb->fd, cb->data);
+	}
+
+	if (wldbg->flags.exit || wldbg->flags.error)
+		return 1;
+
+	/* writing to this side failed, there is nobody to send the rest to */
+	if (ret < 0 && (events[i].events & EPOLLOUT)) {
+		invalidate_connection_events(events + i + 1, n - i - 1, conn);
+		/* if connections_num is 0, that we're done */
+		return remove_connection(conn);
+	}
+
+	if (ret <= 0 || (events[i].events & (EPOLLHUP | EPOLLERR))) {
+		ifdbg(events[i].events & EPOLLERR,
+		      "Error on connection [%p]\n", conn);
+
+		return close_side(conn, cb, events + i + 1, n - i - 1);
+	}
+
+	return ret;
+}
+
+static int
+wldbg_dispatch(struct wldbg *wldbg)
+{
+	struct epoll_event events[WLDBG_MAX_EVENTS];
+	int i, n, ret = 1;
 
 	assert(!wldbg->flags.exit);
 	assert(!wldbg->flags.error);
 
-	n = epoll_wait(wldbg->epoll_fd, &ev, 1, -1);
+	n = epoll_wait(wldbg->epoll_fd, events, WLDBG_MAX_EVENTS, -1);
 
 	if (n < 0) {
 		/* don't print error when we has been interrupted
@@ -240,27 +664,20 @@ wldbg_dispatch(struct wldbg *wldbg)
 		return -1;
 	}
 
-	cb = ev.data.ptr;
-	assert(cb && "No callback set in event");
-	conn = cb->data;
+	vdbg("epoll: got %d events\n", n);
 
-	if (ev.events & EPOLLHUP) {
-		/* if connections_num is 0, that we're done */
-		return remove_connection(conn, cb);
-	}
-
-	if (ev.events & EPOLLERR) {
-		fprintf(stderr, "epoll event error\n");
-		return -1;
-	}
+	for (i = 0; i < n; ++i) {
+		assert((events[i].data.ptr || i > 0)
+		       && "No callback set in event");
 
-	vdbg("cb [%p]: dispatching %p(%d, %p)\n",
-	     cb, cb->dispatch, cb->fd, cb->data);
+		ret = dispatch_event(wldbg, events, i, n);
+		if (ret <= 0)
+			break;
 
-	ret = cb->dispatch(cb->fd, cb->data);
-	if (ret <= 0) {
-		/* on error, remove connection */
-		return remove_connection(conn, cb);
+		/* some pass asked to exit or raised an error,
+		 * do not dispatch the rest of events */
+		if (wldbg->flags.exit || wldbg->flags.error)
+			break;
 	}
 
 	return ret;
@@ -269,12 +686,25 @@ wldbg_dispatch(struct wldbg *wldbg)
 static void
 run_passes(struct wldbg_message *message)
 {
-	struct pass *pass;
+	struct pass **passes, *pass;
 	struct wldbg *wldbg = message->connection->wldbg;
 
 	assert(wldbg && "BUG: No wldbg set in message->connection");
 
-	wl_list_for_each(pass, &wldbg->passes, link) {
+	/* the passes decode the message only once */
+	wldbg_message_invalidate(message);
+
+	/* objects must be known before the passes see the message */
+	wldbg_resolve_track_objects(message);
+
+	passes = wldbg_message_passes(message);
+	if (!passes) {
+		fprintf(stderr, "No memory for table of passes\n");
+		wldbg->flags.error = 1;
+		return;
+	}
+
+	while ((pass = *passes++)) {
 		if (message->from == SERVER) {
 			if (pass->wldbg_pass.server_pass(
 				pass->wldbg_pass.user_data,
@@ -286,26 +716,78 @@ run_passes(struct wldbg_message *message)
 				message) == PASS_STOP)
 				break;
 		}
+
+		/* the list can contain removed passes now */
+		if (wldbg->flags.passes_changed)
+			break;
 	}
 }
 
+static int
+flush_connection(struct wldbg *wldbg, struct wl_connection *wl_conn)
+{
+	int ret;
+
+	ret = wl_connection_flush(wl_conn);
+	if (ret > 0)
+		++wldbg->statistics.flushes;
+
+	/* the peer does not keep up with reading. The data stay
+	 * queued and we send them when the socket is writable */
+	if (ret < 0 && errno == EAGAIN)
+		return 0;
+
+	return ret;
+}
+
+/**
+ * Send out everything that is queued in the connection
+ * (in both directions). Used by passes that are going to block,
+ * so that the messages processed so far are not held back
+ * by write coalescing
+ */
+int
+wldbg_connection_flush(struct wldbg_connection *conn)
+{
+	struct wldbg *wldbg = conn->wldbg;
+
+	if (flush_connection(wldbg, conn->server.connection) < 0) {
+		perror("wl_connection_flush");
+		return -1;
+	}
+
+	if (conn->client.connection
+	    && flush_connection(wldbg, conn->client.connection) < 0) {
+		perror("wl_connection_flush");
+		return -1;
+	}
+
+	return 0;
+}
+
 static int
 process_one_by_one(struct wl_connection *write_conn,
 		   struct wldbg_message *message)
 {
 	int n = 0;
-	size_t rest = message->size;
+	size_t rest = message->size, size;
+	char *data = message->data;
 	struct wldbg *wldbg = message->connection->wldbg;
 
 	while (rest > 0) {
-		message->size = ((uint32_t *) message->data)[1] >> 16;
+		size = ((uint32_t *) data)[1] >> 16;
+		message->data = data;
+		message->size = size;
 
 		run_passes(message);
 
 		/* in interactive mode we can quit here. Do not
-		 * write into connection if we quit */
-		if (wldbg->flags.exit)
+		 * write into connection if we quit, but send
+		 * what we have queued so far */
+		if (wldbg->flags.exit) {
+			flush_connection(wldbg, write_conn);
 			return 0;
+		}
 		if (wldbg->flags.error)
 			return -1;
 
@@ -315,42 +797,238 @@ process_one_by_one(struct wl_connection *write_conn,
 			return -1;
 		}
 
-		if (wl_connection_flush(write_conn) < 0) {
+		++wldbg->statistics.messages;
+
+		/* when coalescing, flush only once after the whole read */
+		if (!wldbg->flags.coalesce_writes
+		    && flush_connection(wldbg, write_conn) < 0) {
 			perror("wl_connection_flush");
 			return -1;
 		}
 
-		message->data = message->data + message->size;
-		rest -= message->size;
+		/* a pass could have changed the message,
+		 * so use the original size */
+		data += size;
+		rest -= size;
 		++n;
 	}
 
 	assert(rest == 0 && "Bug!");
 
+	if (wldbg->flags.coalesce_writes
+	    && flush_connection(wldbg, write_conn) < 0) {
+		perror("wl_connection_flush");
+		return -1;
+	}
+
 	return n;
 }
 
+static int
+forward_data(struct wldbg *wldbg, struct wl_connection *read_conn,
+	     struct wl_connection *write_conn, size_t size)
+{
+	int ret;
+
+	ret = wl_connection_forward(read_conn, write_conn, size);
+	if (ret < 0) {
+		perror("wl_connection_forward");
+		return -1;
+	}
+
+	if (ret > 0)
+		++wldbg->statistics.flushes;
+
+	return 0;
+}
+
+/*
+ * All passes are read-only, so let them look at the messages
+ * right in the input buffer and then send the data from there.
+ * A message is copied only if it wraps around the end of the buffer.
+ */
+static int
+process_passthrough(struct wl_connection *read_conn,
+		    struct wl_connection *write_conn,
+		    struct wldbg_message *message, size_t len)
+{
+	uint32_t header[2], *p;
+	size_t offset = 0;
+	int n = 0;
+	struct wldbg *wldbg = message->connection->wldbg;
+
+	if (wldbg->flags.pass_whole_buffer) {
+		message->data = wl_connection_get_data(read_conn, 0, len,
+						       wldbg->buffer);
+		message->size = len;
+
+		run_passes(message);
+
+		if (wldbg->flags.exit)
+			return 0;
+		if (wldbg->flags.error)
+			return -1;
+
+		++wldbg->statistics.messages;
+
+		if (forward_data(wldbg, read_conn, write_conn, len) < 0)
+			return -1;
+
+		return 1;
+	}
+
+	while (offset < len) {
+		p = wl_connection_get_data(read_conn, offset,
+					   sizeof header, header);
+
+		message->size = p[1] >> 16;
+		message->data = wl_connection_get_data(read_conn, offset,
+						       message->size,
+						       wldbg->buffer);
+
+		run_passes(message);
+
+		/* send what we have processed so far */
+		if (wldbg->flags.exit) {
+			forward_data(wldbg, read_conn, write_conn, offset);
+			return 0;
+		}
+		if (wldbg->flags.error)
+			return -1;
+
+		offset += message->size;
+		++n;
+	}
+
+	wldbg->statistics.messages += n;
+
+	/* send everything at once */
+	if (forward_data(wldbg, read_conn, write_conn, len) < 0)
+		return -1;
+
+	return n;
+}
+
+static int
+process_whole_buffer(struct wl_connection *write_conn,
+		     struct wldbg_message *message)
+{
+	struct wldbg *wldbg = message->connection->wldbg;
+
+	/* process passes */
+	run_passes(message);
+
+	/* if some pass wants exit or an error occured,
+	 * do not write into the connection */
+	if (wldbg->flags.exit)
+		return 0;
+	if (wldbg->flags.error)
+		return -1;
+
+	/* resend the data. Use message->data, not buffer,
+	 * because some pass could have reallocated the data */
+	if (wl_connection_write(write_conn,
+				message->data, message->size) < 0) {
+		perror("wl_connection_write");
+		return -1;
+	}
+
+	++wldbg->statistics.messages;
+
+	if (flush_connection(wldbg, write_conn) < 0) {
+		perror("wl_connection_flush");
+		return -1;
+	}
+
+	return 1;
+}
+
+/* make sure that wldbg->buffer can hold size bytes */
+static int
+reserve_buffer(struct wldbg *wldbg, size_t size)
+{
+	char *buffer;
+
+	if (size <= wldbg->buffer_size)
+		return 0;
+
+	buffer = realloc(wldbg->buffer, size);
+	if (!buffer) {
+		fprintf(stderr, "No memory for buffer of %zu bytes\n", size);
+		return -1;
+	}
+
+	wldbg->buffer = buffer;
+	wldbg->buffer_size = size;
+
+	return 0;
+}
+
+/*
+ * Get the size of the complete messages at the beginning of the input
+ * buffer that has len bytes. An incomplete message at the end is left
+ * in the buffer until we read the rest of it. The size of the biggest
+ * message is stored into max_size. Returns -1 on malformed data.
+ */
+static int
+frame_messages(struct wl_connection *wl_conn, int len, size_t *max_size)
+{
+	uint32_t header[2], *p, size;
+	int offset = 0;
+
+	*max_size = 0;
+
+	while (offset + (int) sizeof header <= len) {
+		p = wl_connection_get_data(wl_conn, offset,
+					   sizeof header, header);
+
+		size = p[1] >> 16;
+		if (size < sizeof header) {
+			fprintf(stderr, "ERROR: Malformed message "
+				"(object %u, size %u)\n", p[0], size);
+			return -1;
+		}
+
+		if (offset + (int) size > len)
+			break;
+
+		if (size > *max_size)
+			*max_size = size;
+
+		offset += size;
+	}
+
+	return offset;
+}
+
 static int
 process_data(struct wldbg_connection *conn,
-	     struct wl_connection *wl_connection, int len)
+	     struct wl_connection *wl_connection, int len,
+	     uint64_t received)
 {
 	int ret = 0;
+	size_t max_size;
 	struct wl_connection *write_wl_conn;
 	struct wldbg *wldbg = conn->wldbg;
 	struct wldbg_message *message = &wldbg->message;
-	char *buffer = wldbg->buffer;
 
 	if (len == 0) {
 		fprintf(stderr, "ERROR: Message with length 0\n");
 		return -1;
 	}
 
+	/* pass on only complete messages */
+	len = frame_messages(wl_connection, len, &max_size);
+	if (len < 0)
+		return -1;
+
+	/* we have only a part of a message, wait for the rest */
+	if (len == 0)
+		return 1;
+
 	/* reset the message */
 	memset(message, 0, sizeof *message);
 
-	wl_connection_copy(wl_connection, buffer, len);
-	wl_connection_consume(wl_connection, len);
-
 	if (wl_connection == conn->server.connection) {
 		write_wl_conn = conn->client.connection;
 		message->from = SERVER;
@@ -361,40 +1039,37 @@ process_data(struct wldbg_connection *conn,
 
 	wl_connection_copy_fds(wl_connection, write_wl_conn);
 
-	message->data = buffer;
-	message->size = len;
 	message->connection = conn;
+	message->received = received;
 
-	if (!wldbg->flags.pass_whole_buffer) {
-		ret = process_one_by_one(write_wl_conn, message);
-	} else {
-		/* process passes */
-		run_passes(message);
-
-		/* if some pass wants exit or an error occured,
-		 * do not write into the connection */
-		if (wldbg->flags.exit)
-			return 0;
-		if (wldbg->flags.error)
+	/* nobody is going to modify the data, do not copy them. We need
+	 * the buffer only for messages that wrap around the ring buffer */
+	if (wldbg_passes_read_only(wldbg)) {
+		if (reserve_buffer(wldbg, wldbg->flags.pass_whole_buffer
+					  ? (size_t) len : max_size) < 0)
 			return -1;
 
-		/* resend the data. Use message->data, not buffer,
-		 * because some pass could have reallocated the data */
-		if (wl_connection_write(write_wl_conn,
-					message->data, message->size) < 0) {
-			perror("wl_connection_write");
+		ret = process_passthrough(wl_connection, write_wl_conn,
+					  message, len);
+	} else {
+		if (reserve_buffer(wldbg, len) < 0)
 			return -1;
-		}
 
-		if (wl_connection_flush(write_wl_conn) < 0) {
-			perror("wl_connection_flush");
-			return -1;
-		}
+		wl_connection_copy(wl_connection, wldbg->buffer, len);
+		wl_connection_consume(wl_connection, len);
+
+		message->data = wldbg->buffer;
+		message->size = len;
 
-		ret = 1;
+		if (!wldbg->flags.pass_whole_buffer)
+			ret = process_one_by_one(write_wl_conn, message);
+		else
+			ret = process_whole_buffer(write_wl_conn, message);
 	}
 
-	/* What if some pass reallocated the buffer? */
+	if (ret > 0)
+		account_latency(conn, write_wl_conn, message->from,
+				received, ret);
 
 	return ret;
 }
@@ -402,26 +1077,50 @@ process_data(struct wldbg_connection *conn,
 static int
 dispatch_messages(int fd, void *data)
 {
-	int len;
+	int len, ret;
 	struct wldbg_connection *conn = data;
+	struct wldbg *wldbg = conn->wldbg;
 	struct wl_connection *wl_conn;
+	struct wldbg_flow *flow;
 
-	if (fd == conn->client.fd)
+	if (fd == conn->client.fd) {
 		wl_conn = conn->client.connection;
-	else
+		flow = &conn->client.flow;
+	} else {
 		wl_conn = conn->server.connection;
+		flow = &conn->server.flow;
+	}
 
-	vdbg("Reading connection [%p] from %s\n", conn,
-		fd == conn->client.fd ? "client" : "server");
+	/* in edge-triggered mode we must read the socket
+	 * until it is empty, we wouldn't be woken up again otherwise */
+	do {
+		vdbg("Reading connection [%p] from %s\n", conn,
+			fd == conn->client.fd ? "client" : "server");
 
-	len = wl_connection_read(wl_conn);
-	if (len < 0 && errno != EAGAIN) {
-		perror("wl_connection_read");
-		return -1;
-	} else if (len < 0 && errno == EAGAIN)
-		return 1;
+		len = wl_connection_read(wl_conn);
+		if (len < 0 && errno != EAGAIN) {
+			perror("wl_connection_read");
+			return -1;
+		} else if (len < 0 && errno == EAGAIN)
+			return 1;
 
-	return process_data(conn, wl_conn, len);
+		/* the other side closed the connection */
+		if (len == 0)
+			return 0;
+
+		ret = process_data(conn, wl_conn, len, monotonic_time_ns());
+		wldbg_output_flush(conn);
+		if (ret <= 0)
+			return ret;
+
+		if (update_connection_flow(conn) < 0)
+			return -1;
+
+	/* do not read more if the other side does not keep up */
+	} while (wldbg->flags.edge_triggered && !flow->stalled
+		 && !wldbg->flags.exit && !wldbg->flags.error);
+
+	return ret;
 }
 
 static void
@@ -474,8 +1173,15 @@ create_client_connection_for_fd(struct wldbg_connection *conn, int fd)
 		return -1;
 	}
 
-	if (wldbg_monitor_fd(conn->wldbg, fd,
-			     dispatch_messages, conn) == NULL) {
+	if (set_connection_buffer_size(conn->wldbg,
+				       conn->client.connection) < 0) {
+		wl_connection_destroy(conn->client.connection);
+		return -1;
+	}
+
+	conn->client.cb = monitor_connection_fd(conn->wldbg, fd, conn,
+						&conn->client.flow);
+	if (conn->client.cb == NULL) {
 		wl_connection_destroy(conn->client.connection);
 		return -1;
 	}
@@ -649,6 +1355,19 @@ wldbg_destroy(struct wldbg *wldbg)
 {
 	struct pass *pass, *pass_tmp;
 	struct wldbg_fd_callback *cb, *cb_tmp;
+	struct wldbg_connection *conn;
+
+	/* write everything before the passes print their statistics */
+	wl_list_for_each(conn, &wldbg->connections, link)
+		wldbg_collapse_flush(conn);
+
+	if (wldbg->writer) {
+		wl_list_for_each(conn, &wldbg->connections, link)
+			wldbg_output_flush(conn);
+
+		wldbg_writer_destroy(wldbg->writer);
+		wldbg->writer = NULL;
+	}
 
 	/* free buffer */
 	free(wldbg->buffer);
@@ -658,6 +1377,7 @@ wldbg_destroy(struct wldbg *wldbg)
 	if (wldbg->signals_fd >= 0)
 		close(wldbg->signals_fd);
 
+	wldbg_destroy_pass_table(wldbg);
 	wl_list_for_each_safe(pass, pass_tmp, &wldbg->passes, link) {
 		if (pass->wldbg_pass.destroy)
 			pass->wldbg_pass.destroy(pass->wldbg_pass.user_data);
@@ -665,6 +1385,8 @@ wldbg_destroy(struct wldbg *wldbg)
 		free(pass);
 	}
 
+	wldbg_resolve_destroy(wldbg);
+
 	wl_list_for_each_safe(cb, cb_tmp, &wldbg->monitored_fds, link) {
 		free(cb);
 	}
@@ -675,6 +1397,9 @@ wldbg_destroy(struct wldbg *wldbg)
 	/* if there are any connections left that haven't got
 	 * HUP, free them */
 	wldbg_foreach_connection(wldbg, wldbg_connection_destroy);
+
+	/* the interfaces are not in the registry anymore */
+	wldbg_protocols_release();
 }
 
 static int
@@ -685,9 +1410,12 @@ wldbg_init(struct wldbg *wldbg)
 	memset(wldbg, 0, sizeof *wldbg);
 	wldbg->signals_fd = wldbg->epoll_fd = -1;
 
-	/* wl_buffer has size 4096 and probably will
-	 * have some time */
-	wldbg->buffer = malloc(4096);
+	wldbg->connection_buffers.size = WLDBG_DEFAULT_BUFFER_SIZE;
+	wldbg->connection_buffers.max_size = WLDBG_DEFAULT_MAX_BUFFER_SIZE;
+
+	/* the buffer grows when we get bigger messages */
+	wldbg->buffer_size = 4096;
+	wldbg->buffer = malloc(wldbg->buffer_size);
 	if (!wldbg->buffer)
 		return -1;
 
@@ -722,10 +1450,10 @@ wldbg_init(struct wldbg *wldbg)
 
 	wldbg->handled_signals = signals;
 
-	/* init resolving wayland objects */
-	/* FIXME: do it optional - it burns a lot of
-	 * processing time when we don't need it */
-	if (wldbg_add_resolve_pass(wldbg) < 0)
+	/* init resolving wayland objects. For every message we only
+	 * keep track of the objects, which is cheap. The arguments
+	 * are decoded only when somebody asks for them */
+	if (wldbg_resolve_init(wldbg) < 0)
 		goto err_signals;
 
 	return 0;
@@ -746,7 +1474,23 @@ help(void)
 	fprintf(stderr, "\nUsage:\n");
 	fprintf(stderr, "\twldbg [-i|--interactive] ARGUMENTS [PROGRAM]\n");
 	fprintf(stderr, "\twldbg pass ARGUMENTS, pass ARGUMENTS,... -- PROGRAM\n");
+	fprintf(stderr, "\twldbg [OPTIONS] -- PROGRAM\n");
 	fprintf(stderr, "\twldbg [-s|--server-mode]\n");
+	fprintf(stderr, "\twldbg [OPTIONS] replay [REPLAY OPTIONS] FILE\n");
+	fprintf(stderr, "\nOptions:\n");
+	fprintf(stderr, "\t-e|--edge-triggered\tread connections until "
+			"they are empty\n");
+	fprintf(stderr, "\t-c|--coalesce-writes\tflush connection once "
+			"per read, not per message\n");
+	fprintf(stderr, "\t--collapse\t\tprint runs of repeating messages "
+			"as one line\n");
+	fprintf(stderr, "\t--buffer-size=SIZE\tinitial size of connection "
+			"buffers (default 4K)\n");
+	fprintf(stderr, "\t--max-buffer-size=SIZE\tconnection buffers can "
+			"grow up to SIZE, at least twice the buffer size "
+			"(default 1M)\n");
+	fprintf(stderr, "\t--protocols=PATH[:PATH]\tload protocol XML "
+			"files from PATHs too\n");
 	fprintf(stderr, "\nTry 'wldbg help' too.\n"
 			"For interactive mode and server-mode description "
 			"see documentation.\n");
@@ -820,6 +1564,47 @@ server_mode_init(struct wldbg *wldbg)
 	return 0;
 }
 
+/* wldbg [OPTIONS] -- PROGRAM runs the program without passes */
+static int
+only_program(int argc, char *argv[], int pass_off)
+{
+	int i;
+
+	if (pass_off < 2 || pass_off >= argc
+	    || strcmp(argv[pass_off - 1], "--") != 0)
+		return 0;
+
+	/* wldbg [OPTIONS] -- pass ARGUMENTS -- PROGRAM */
+	for (i = pass_off; i < argc; ++i)
+		if (strcmp(argv[i], "--") == 0)
+			return 0;
+
+	return 1;
+}
+
+/* load protocols that are installed on the system
+ * and those that user gave us */
+static void
+load_protocols(const char *user_paths)
+{
+	char *paths;
+	int n;
+
+	if (asprintf(&paths, "%s:%s%s%s",
+		     WAYLAND_DATADIR, WAYLAND_PROTOCOLS_DATADIR,
+		     user_paths ? ":" : "",
+		     user_paths ? user_paths : "") < 0) {
+		fprintf(stderr, "Out of memory\n");
+		return;
+	}
+
+	/* we can live without them, the errors are reported already */
+	n = wldbg_protocols_load(paths, wldbg_protocols_cache_path());
+	dbg("Loaded %d interfaces from '%s'\n", n, paths);
+
+	free(paths);
+}
+
 static int
 parse_opts(struct wldbg *wldbg, struct wldbg_options *options,
 	   int argc, char *argv[])
@@ -836,6 +1621,48 @@ parse_opts(struct wldbg *wldbg, struct wldbg_options *options,
 		wldbg->flags.pass_whole_buffer = 1;
 	}
 
+	if (options->edge_triggered) {
+		wldbg->flags.edge_triggered = 1;
+	}
+
+	if (options->coalesce_writes) {
+		wldbg->flags.coalesce_writes = 1;
+	}
+
+	if (options->collapse_runs) {
+		wldbg->flags.collapse_runs = 1;
+	}
+
+	if (options->buffer_size)
+		wldbg->connection_buffers.size = options->buffer_size;
+
+	if (options->max_buffer_size)
+		wldbg->connection_buffers.max_size = options->max_buffer_size;
+
+	/* the connection rounds the sizes up to powers of two,
+	 * so the watermarks must be computed from the real sizes */
+	wldbg->connection_buffers.size
+		= wl_connection_round_buffer_size(wldbg->connection_buffers.size);
+	wldbg->connection_buffers.max_size
+		= wl_connection_round_buffer_size(wldbg->connection_buffers.max_size);
+
+	/* the default maximal size grows with the buffers */
+	if (!options->max_buffer_size
+	    && wldbg->connection_buffers.max_size
+	       < 2 * wldbg->connection_buffers.size)
+		wldbg->connection_buffers.max_size
+			= 2 * wldbg->connection_buffers.size;
+
+	/* leave enough room for what we can read at once */
+	if (buffer_watermarks(wldbg->connection_buffers.size,
+			      wldbg->connection_buffers.max_size,
+			      &wldbg->connection_buffers.high_watermark,
+			      &wldbg->connection_buffers.low_watermark) < 0) {
+		fprintf(stderr, "Error: max-buffer-size must be at least "
+			"twice the buffer-size\n");
+		return -1;
+	}
+
 	if (options->interactive) {
 		if (argc - pass_off < 1) {
 			fprintf(stderr, "Need client to run\n");
@@ -881,6 +1708,25 @@ parse_opts(struct wldbg *wldbg, struct wldbg_options *options,
 			return -1;
 
 		pass_num = 1;
+	} else if (only_program(argc, argv, pass_off)) {
+		/* no passes, just proxy the connection */
+		options->path = strdup(argv[pass_off]);
+		if (!options->path)
+			return -1;
+
+		options->argc = copy_arguments(&options->argv,
+					       argc - pass_off,
+					       (const char **) argv + pass_off);
+		if (options->argc == -1)
+			return -1;
+
+		pass_num = 0;
+	} else if (pass_off < argc && strcmp(argv[pass_off], "replay") == 0) {
+		/* we do not run any program, see main() */
+		options->replay_argc = argc - pass_off;
+		options->replay_argv = argv + pass_off;
+
+		return 0;
 	} else {
 		pass_num = load_passes(wldbg, options, argc - pass_off,
 				       (const char **) argv + pass_off);
@@ -890,7 +1736,7 @@ parse_opts(struct wldbg *wldbg, struct wldbg_options *options,
 		}
 	}
 
-	if (pass_num == 0 && !options->server_mode) {
+	if (pass_num == 0 && !options->server_mode && !options->path) {
 		fprintf(stderr, "No passes loaded...\n");
 		return -1;
 	}
@@ -919,6 +1765,15 @@ int main(int argc, char *argv[])
 	if (parse_opts(&wldbg, &options, argc, argv) < 0)
 		goto err;
 
+	if (options.replay_argv) {
+		load_protocols(options.protocols);
+		if (wldbg_replay(options.replay_argc, options.replay_argv) < 0)
+			goto err;
+
+		wldbg_destroy(&wldbg);
+		return EXIT_SUCCESS;
+	}
+
 	if (options.objinfo) {
 		/* init gathering additional information about
 		 * the objects */
@@ -943,6 +1798,20 @@ int main(int argc, char *argv[])
 		return EXIT_SUCCESS;
 	}
 
+	if (wldbg.resolving_objects)
+		load_protocols(options.protocols);
+
+	/* in the interactive mode we print the messages synchronously,
+	 * we wait for the user anyway. Otherwise the messages are
+	 * printed by the writer, so that we do not wait for the terminal */
+	if (!options.interactive && !options.server_mode) {
+		fflush(stdout);
+		wldbg.writer = wldbg_writer_create(STDOUT_FILENO,
+						   WLDBG_WRITER_MAX_SIZE);
+		if (!wldbg.writer)
+			fprintf(stderr, "Printing messages synchronously\n");
+	}
+
 	if (wldbg.flags.server_mode) {
 		printf("Listening for incoming connections...\n");
 	} else {
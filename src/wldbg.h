@@ -26,6 +26,8 @@
 #ifndef _WLDBG_H_
 #define _WLDBG_H_
 
+#include <stdint.h>
+
 #include "wldbg-pass.h"
 #include "wldbg-objects-info.h"
 
@@ -47,6 +49,10 @@ struct wldbg_message {
 
 	/* pointer to connectoin structure */
 	struct wldbg_connection *connection;
+
+	/* time when wldbg read the message from the socket
+	 * (CLOCK_MONOTONIC in nanoseconds) */
+	uint64_t received;
 };
 
 const struct wl_interface *
@@ -55,6 +61,12 @@ wldbg_message_get_object(struct wldbg_message *msg, uint32_t id);
 const struct wl_interface *
 wldbg_message_get_interface(struct wldbg_message *msg, const char *name);
 
+/* get ids of the live objects with the interface called name.
+ * The number of the ids is stored into count */
+const uint32_t *
+wldbg_message_get_objects(struct wldbg_message *msg, const char *name,
+			  unsigned int *count);
+
 void
 wldbg_message_objects_iterate(struct wldbg_message *message,
 			      void (*func)(uint32_t id,
@@ -62,6 +74,12 @@ wldbg_message_objects_iterate(struct wldbg_message *message,
 			                   void *data),
 			      void *data);
 
+/* number of the connection of the message. Connections are numbered
+ * from 1 in the order in which they were made and the numbers are
+ * not reused, unlike the connection pointers */
+uint32_t
+wldbg_message_get_connection_id(struct wldbg_message *msg);
+
 /* mercifully exit wldbg from the pass
  * and let it clean after itself */
 void
@@ -0,0 +1,445 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <wayland-server.h>
+
+#include "bench.h"
+
+static void
+surface_destroy(struct wl_client *client, struct wl_resource *resource)
+{
+	(void) client;
+
+	wl_resource_destroy(resource);
+}
+
+static void
+surface_attach(struct wl_client *client, struct wl_resource *resource,
+	       struct wl_resource *buffer, int32_t x, int32_t y)
+{
+	(void) client;
+	(void) resource;
+	(void) buffer;
+	(void) x;
+	(void) y;
+}
+
+static void
+surface_damage(struct wl_client *client, struct wl_resource *resource,
+	       int32_t x, int32_t y, int32_t width, int32_t height)
+{
+	(void) client;
+	(void) resource;
+	(void) x;
+	(void) y;
+	(void) width;
+	(void) height;
+}
+
+static void
+surface_frame(struct wl_client *client, struct wl_resource *resource,
+	      uint32_t callback)
+{
+	struct wl_resource *cb;
+
+	cb = wl_resource_create(client, &wl_callback_interface, 1, callback);
+	if (!cb) {
+		wl_resource_post_no_memory(resource);
+		return;
+	}
+
+	/* we have nothing to draw, so the frame is done right away */
+	wl_callback_send_done(cb, 0);
+	wl_resource_destroy(cb);
+}
+
+static void
+surface_set_region(struct wl_client *client, struct wl_resource *resource,
+		   struct wl_resource *region)
+{
+	(void) client;
+	(void) resource;
+	(void) region;
+}
+
+static void
+surface_commit(struct wl_client *client, struct wl_resource *resource)
+{
+	(void) client;
+	(void) resource;
+}
+
+static void
+surface_set_int(struct wl_client *client, struct wl_resource *resource,
+		int32_t value)
+{
+	(void) client;
+	(void) resource;
+	(void) value;
+}
+
+static const struct wl_surface_interface surface_implementation = {
+	.destroy = surface_destroy,
+	.attach = surface_attach,
+	.damage = surface_damage,
+	.frame = surface_frame,
+	.set_opaque_region = surface_set_region,
+	.set_input_region = surface_set_region,
+	.commit = surface_commit,
+	.set_buffer_transform = surface_set_int,
+	.set_buffer_scale = surface_set_int,
+};
+
+static void
+compositor_create_surface(struct wl_client *client,
+			  struct wl_resource *resource, uint32_t id)
+{
+	struct wl_resource *surface;
+
+	surface = wl_resource_create(client, &wl_surface_interface,
+				     wl_resource_get_version(resource), id);
+	if (!surface) {
+		wl_resource_post_no_memory(resource);
+		return;
+	}
+
+	wl_resource_set_implementation(surface, &surface_implementation,
+				       NULL, NULL);
+}
+
+static void
+compositor_create_region(struct wl_client *client,
+			 struct wl_resource *resource, uint32_t id)
+{
+	(void) client;
+	(void) id;
+
+	wl_resource_post_error(resource, WL_DISPLAY_ERROR_INVALID_METHOD,
+			       "regions are not supported");
+}
+
+static const struct wl_compositor_interface compositor_implementation = {
+	.create_surface = compositor_create_surface,
+	.create_region = compositor_create_region,
+};
+
+static void
+bind_compositor(struct wl_client *client, void *data,
+		uint32_t version, uint32_t id)
+{
+	struct wl_resource *resource;
+
+	(void) data;
+
+	resource = wl_resource_create(client, &wl_compositor_interface,
+				      version, id);
+	if (!resource) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	wl_resource_set_implementation(resource, &compositor_implementation,
+				       NULL, NULL);
+}
+
+static int
+handle_sigterm(int signal_number, void *data)
+{
+	(void) signal_number;
+
+	wl_display_terminate(data);
+
+	return 1;
+}
+
+static int
+run_server(const char *socket_name, int ready_fd)
+{
+	struct wl_display *display;
+	struct wl_event_loop *loop;
+	struct wl_event_source *sigterm;
+
+	display = wl_display_create();
+	if (!display) {
+		fprintf(stderr, "Failed creating display\n");
+		return -1;
+	}
+
+	if (wl_display_add_socket(display, socket_name) < 0) {
+		perror("Failed adding socket");
+		goto err;
+	}
+
+	/* version 3 is enough for everything we implement */
+	if (!wl_global_create(display, &wl_compositor_interface, 3,
+			      NULL, bind_compositor)) {
+		fprintf(stderr, "Failed creating wl_compositor global\n");
+		goto err;
+	}
+
+	loop = wl_display_get_event_loop(display);
+	sigterm = wl_event_loop_add_signal(loop, SIGTERM,
+					   handle_sigterm, display);
+	if (!sigterm) {
+		fprintf(stderr, "Failed adding SIGTERM handler\n");
+		goto err;
+	}
+
+	/* we are ready to accept clients */
+	if (write(ready_fd, "", 1) != 1) {
+		perror("Writing to ready pipe");
+		goto err_sigterm;
+	}
+	close(ready_fd);
+
+	wl_display_run(display);
+
+	wl_event_source_remove(sigterm);
+	wl_display_destroy(display);
+	return 0;
+
+err_sigterm:
+	wl_event_source_remove(sigterm);
+err:
+	wl_display_destroy(display);
+	return -1;
+}
+
+int
+bench_server_start(struct bench_server *server)
+{
+	int ready[2];
+	char c;
+
+	memset(server, 0, sizeof *server);
+
+	if (!getenv("XDG_RUNTIME_DIR")) {
+		server->runtime_dir = strdup("/tmp/wldbg-bench-XXXXXX");
+		if (!server->runtime_dir
+		    || !mkdtemp(server->runtime_dir)) {
+			perror("Creating runtime directory");
+			free(server->runtime_dir);
+			server->runtime_dir = NULL;
+			return -1;
+		}
+
+		setenv("XDG_RUNTIME_DIR", server->runtime_dir, 1);
+	}
+
+	snprintf(server->socket_name, sizeof server->socket_name,
+		 "wldbg-bench-%d", getpid());
+
+	if (pipe2(ready, O_CLOEXEC) < 0) {
+		perror("pipe");
+		goto err;
+	}
+
+	server->pid = fork();
+	if (server->pid < 0) {
+		perror("fork");
+		close(ready[0]);
+		close(ready[1]);
+		goto err;
+	}
+
+	if (server->pid == 0) {
+		close(ready[0]);
+		exit(run_server(server->socket_name, ready[1]) < 0
+			? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+
+	close(ready[1]);
+
+	/* wait until the server listens, if it fails,
+	 * read returns 0 (the pipe is closed) */
+	if (read(ready[0], &c, 1) != 1) {
+		fprintf(stderr, "Stand-in compositor failed to start\n");
+		close(ready[0]);
+		bench_wait(server->pid);
+		goto err;
+	}
+
+	close(ready[0]);
+
+	setenv("WAYLAND_DISPLAY", server->socket_name, 1);
+	unsetenv("WAYLAND_SOCKET");
+
+	return 0;
+
+err:
+	if (server->runtime_dir) {
+		rmdir(server->runtime_dir);
+		free(server->runtime_dir);
+		server->runtime_dir = NULL;
+	}
+
+	return -1;
+}
+
+void
+bench_server_stop(struct bench_server *server)
+{
+	if (server->pid > 0) {
+		kill(server->pid, SIGTERM);
+		bench_wait(server->pid);
+		server->pid = 0;
+	}
+
+	if (server->runtime_dir) {
+		if (rmdir(server->runtime_dir) < 0)
+			perror("Removing runtime directory");
+
+		free(server->runtime_dir);
+		server->runtime_dir = NULL;
+	}
+}
+
+pid_t
+bench_spawn(const char *argv[], const char *input, int quiet)
+{
+	int in[2] = { -1, -1 };
+	int null_fd;
+	pid_t pid;
+	size_t len;
+
+	if (input && pipe2(in, O_CLOEXEC) < 0) {
+		perror("pipe");
+		return -1;
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		if (input) {
+			close(in[0]);
+			close(in[1]);
+		}
+
+		return -1;
+	}
+
+	if (pid == 0) {
+		if (input)
+			dup2(in[0], STDIN_FILENO);
+
+		if (quiet) {
+			null_fd = open("/dev/null", O_WRONLY);
+			if (null_fd >= 0) {
+				dup2(null_fd, STDOUT_FILENO);
+				dup2(null_fd, STDERR_FILENO);
+				close(null_fd);
+			}
+		}
+
+		execvp(argv[0], (char * const *) argv);
+		fprintf(stderr, "Failed running '%s': %s\n",
+			argv[0], strerror(errno));
+		_exit(127);
+	}
+
+	if (input) {
+		close(in[0]);
+
+		/* the input is just a few commands,
+		 * it fits into the pipe */
+		len = strlen(input);
+		if (write(in[1], input, len) != (ssize_t) len)
+			perror("Writing input");
+
+		close(in[1]);
+	}
+
+	return pid;
+}
+
+int
+bench_wait(pid_t pid)
+{
+	int status;
+
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR)
+			return -1;
+	}
+
+	if (!WIFEXITED(status))
+		return -1;
+
+	return WEXITSTATUS(status);
+}
+
+static uint64_t
+rusage_cpu_time(int who)
+{
+	struct rusage ru;
+
+	if (getrusage(who, &ru) < 0)
+		return 0;
+
+	return (uint64_t) (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec)
+		* 1000000000
+		+ (uint64_t) (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec)
+		* 1000;
+}
+
+uint64_t
+bench_children_cpu_time(void)
+{
+	return rusage_cpu_time(RUSAGE_CHILDREN);
+}
+
+uint64_t
+bench_self_cpu_time(void)
+{
+	return rusage_cpu_time(RUSAGE_SELF);
+}
+
+uint64_t
+bench_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+const char *
+bench_self_path(void)
+{
+	static char path[256];
+	ssize_t len;
+
+	if (path[0])
+		return path;
+
+	len = readlink("/proc/self/exe", path, sizeof path - 1);
+	if (len < 0) {
+		perror("readlink");
+		return NULL;
+	}
+
+	path[len] = '\0';
+	return path;
+}
+
+const char *
+bench_arg_value(const char *arg, const char *name)
+{
+	size_t len = strlen(name);
+
+	if (strncmp(arg, name, len) == 0 && arg[len] == '=')
+		return arg + len + 1;
+
+	return NULL;
+}
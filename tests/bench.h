@@ -0,0 +1,58 @@
+#ifndef _WLDBG_BENCH_H_
+#define _WLDBG_BENCH_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* size of a message with n 32-bit arguments */
+#define BENCH_MESSAGE_SIZE(n) (8 + 4 * (n))
+
+/* stand-in compositor. It runs in a child process and
+ * implements only what the benchmark clients need:
+ * wl_compositor, wl_surface (frame callbacks are sent
+ * right away) and wl_display.sync */
+struct bench_server {
+	pid_t pid;
+	char socket_name[32];
+
+	/* set when we created XDG_RUNTIME_DIR ourselves */
+	char *runtime_dir;
+};
+
+int
+bench_server_start(struct bench_server *server);
+
+void
+bench_server_stop(struct bench_server *server);
+
+/* fork and exec argv. If input is not NULL, it is written to
+ * the program's stdin. With quiet set, the output of the program
+ * goes to /dev/null */
+pid_t
+bench_spawn(const char *argv[], const char *input, int quiet);
+
+/* wait for the process, returns its exit status or -1 */
+int
+bench_wait(pid_t pid);
+
+/* CPU time (user + system) of all waited-for children in ns */
+uint64_t
+bench_children_cpu_time(void);
+
+/* CPU time (user + system) of this process in ns */
+uint64_t
+bench_self_cpu_time(void);
+
+uint64_t
+bench_time_ns(void);
+
+/* path to the running executable, so that we can spawn ourselves
+ * as the client (possibly through wldbg) */
+const char *
+bench_self_path(void);
+
+/* if arg is NAME=VALUE, return VALUE */
+const char *
+bench_arg_value(const char *arg, const char *name);
+
+#endif /* _WLDBG_BENCH_H_ */
@@ -0,0 +1,156 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "wayland/wayland-util.h"
+#include "wldbg-private.h"
+#include "wldbg-interfaces.h"
+#include "elf-interfaces.h"
+#include "test-runner.h"
+
+/* the interfaces that we should find in our own symbol table */
+extern const struct wl_interface wldbg_test_object_interface;
+extern const struct wl_interface wldbg_test_manager_interface;
+
+/* the registry has this one */
+static const struct wl_interface surface_interface = {
+	"wl_surface", 4, 0, NULL, 0, NULL
+};
+
+/* [1] and [4] are interfaces that are not in the symbol
+ * tables, they are allocated in the test */
+static const struct wl_interface *manager_types[] = {
+	&wldbg_test_object_interface,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+};
+
+static const struct wl_message manager_requests[] = {
+	{ "create", "n?o", manager_types },
+	{ "destroy", "", manager_types + 2 },
+};
+
+static const struct wl_message manager_events[] = {
+	{ "hidden", "2uo", manager_types + 3 },
+};
+
+const struct wl_interface wldbg_test_manager_interface = {
+	"wldbg_test_manager", 2,
+	2, manager_requests,
+	1, manager_events,
+};
+
+static const struct wl_message object_events[] = {
+	{ "text", "sh", manager_types + 2 },
+};
+
+const struct wl_interface wldbg_test_object_interface = {
+	"wldbg_test_object", 1,
+	0, NULL,
+	1, object_events,
+};
+
+/* passes.c is not linked into the test, there is no pass table */
+void
+wldbg_passes_forget(struct wldbg *wldbg, const struct wl_interface *intf)
+{
+}
+
+static const struct wl_interface *
+find(struct resolved_objects *ro, const char *name)
+{
+	struct additional_interface *i;
+
+	wl_list_for_each(i, &ro->additional_interfaces, link)
+		if (strcmp(i->interface->name, name) == 0)
+			return i->interface;
+
+	return NULL;
+}
+
+TEST(elf_interfaces_discover_self)
+{
+	struct resolved_objects ro;
+	const struct wl_interface *manager, *object, *hidden;
+	const struct wl_message *msg;
+	struct wl_interface *allocated[2];
+
+	memset(&ro, 0, sizeof ro);
+	wl_list_init(&ro.additional_interfaces);
+
+	wldbg_interfaces_register(&surface_interface);
+
+	allocated[0] = calloc(1, sizeof *allocated[0]);
+	allocated[1] = calloc(1, sizeof *allocated[1]);
+	assert(allocated[0] && allocated[1]);
+	allocated[0]->name = "wl_surface";
+	allocated[0]->version = 4;
+	allocated[1]->name = "wldbg_test_hidden";
+	allocated[1]->version = 1;
+	manager_types[1] = allocated[0];
+	manager_types[4] = allocated[1];
+
+	assert(elf_interfaces_discover(&ro, getpid()) >= 2);
+
+	manager = find(&ro, "wldbg_test_manager");
+	object = find(&ro, "wldbg_test_object");
+	assert(manager && object);
+
+	/* these are copies */
+	assert(manager != &wldbg_test_manager_interface);
+	assert(manager->version == 2);
+	assert(manager->method_count == 2);
+	assert(manager->event_count == 1);
+
+	msg = &manager->methods[0];
+	assert(msg->name != manager_requests[0].name);
+	assert(strcmp(msg->name, "create") == 0);
+	assert(strcmp(msg->signature, "n?o") == 0);
+	assert(msg->types[0] == object);
+	/* referenced interfaces known to the registry are not copied */
+	assert(msg->types[1] == &surface_interface);
+
+	msg = &manager->methods[1];
+	assert(strcmp(msg->name, "destroy") == 0);
+	assert(msg->types != NULL);
+
+	/* interfaces without a symbol are copied when referenced */
+	msg = &manager->events[0];
+	assert(strcmp(msg->signature, "2uo") == 0);
+	assert(msg->types[0] == NULL);
+	hidden = msg->types[1];
+	assert(hidden && hidden != allocated[1]);
+	assert(strcmp(hidden->name, "wldbg_test_hidden") == 0);
+	assert(find(&ro, "wldbg_test_hidden") == hidden);
+
+	assert(strcmp(object->events[0].signature, "sh") == 0);
+
+	/* nothing changed in the process */
+	assert(elf_interfaces_discover(&ro, getpid()) == 0);
+
+	elf_interfaces_destroy(ro.elf_interfaces, NULL);
+	wldbg_interfaces_release();
+	free(allocated[0]);
+	free(allocated[1]);
+}
+
+TEST(elf_interfaces_no_process)
+{
+	struct resolved_objects ro;
+
+	memset(&ro, 0, sizeof ro);
+	wl_list_init(&ro.additional_interfaces);
+
+	assert(elf_interfaces_discover(&ro, 0) == 0);
+	assert(ro.elf_interfaces == NULL);
+
+	/* the pid does not exist */
+	assert(elf_interfaces_discover(&ro, 999999999) < 0);
+	assert(wl_list_empty(&ro.additional_interfaces));
+	assert(elf_interfaces_discover(&ro, 999999999) < 0);
+
+	elf_interfaces_destroy(ro.elf_interfaces, NULL);
+}
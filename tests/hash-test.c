@@ -0,0 +1,143 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "wldbg-hash.h"
+#include "test-runner.h"
+
+TEST(fnv_values)
+{
+	/* reference values of FNV-1a */
+	assert(wldbg_fnv32(WLDBG_FNV32_BASIS, "", 0) == WLDBG_FNV32_BASIS);
+	assert(wldbg_fnv32(WLDBG_FNV32_BASIS, "a", 1) == 0xe40c292cu);
+	assert(wldbg_fnv32(WLDBG_FNV32_BASIS, "foobar", 6) == 0xbf9cf968u);
+	assert(wldbg_fnv32_str(WLDBG_FNV32_BASIS, "foobar") == 0xbf9cf968u);
+
+	assert(wldbg_fnv64(WLDBG_FNV64_BASIS, "", 0) == WLDBG_FNV64_BASIS);
+	assert(wldbg_fnv64(WLDBG_FNV64_BASIS, "a", 1)
+	       == 0xaf63dc4c8601ec8cull);
+	assert(wldbg_fnv64(WLDBG_FNV64_BASIS, "foobar", 6)
+	       == 0x85944171f73967e8ull);
+}
+
+TEST(fnv_incremental)
+{
+	uint32_t h32;
+	uint64_t h64;
+
+	h32 = wldbg_fnv32_str(WLDBG_FNV32_BASIS, "foo");
+	assert(wldbg_fnv32(h32, "bar", 3) == 0xbf9cf968u);
+
+	h64 = wldbg_fnv64(WLDBG_FNV64_BASIS, "foo", 3);
+	assert(wldbg_fnv64(h64, "bar", 3) == 0x85944171f73967e8ull);
+}
+
+TEST(pointer_map_basic)
+{
+	struct wldbg_pointer_map map;
+	int keys[3], values[3];
+
+	wldbg_pointer_map_init(&map);
+	assert(wldbg_pointer_map_get(&map, &keys[0]) == NULL);
+	assert(wldbg_pointer_map_remove(&map, &keys[0]) == NULL);
+
+	assert(wldbg_pointer_map_insert(&map, &keys[0], &values[0]) == 0);
+	assert(wldbg_pointer_map_insert(&map, &keys[1], &values[1]) == 0);
+	assert(map.num == 2);
+
+	assert(wldbg_pointer_map_get(&map, &keys[0]) == &values[0]);
+	assert(wldbg_pointer_map_get(&map, &keys[1]) == &values[1]);
+	assert(wldbg_pointer_map_get(&map, &keys[2]) == NULL);
+
+	/* inserting again replaces the value */
+	assert(wldbg_pointer_map_insert(&map, &keys[0], &values[2]) == 0);
+	assert(map.num == 2);
+	assert(wldbg_pointer_map_get(&map, &keys[0]) == &values[2]);
+
+	assert(wldbg_pointer_map_remove(&map, &keys[0]) == &values[2]);
+	assert(wldbg_pointer_map_get(&map, &keys[0]) == NULL);
+	assert(wldbg_pointer_map_remove(&map, &keys[0]) == NULL);
+	assert(map.num == 1);
+
+	wldbg_pointer_map_release(&map, NULL);
+	assert(map.size == 0 && map.num == 0);
+}
+
+#define KEYS_NUM 5000
+
+/* removing entries must not make other entries unreachable,
+ * even when they wrapped around the end of the table */
+TEST(pointer_map_remove_keeps_others)
+{
+	struct wldbg_pointer_map map;
+	static char keys[KEYS_NUM * 8];
+	unsigned int i, step;
+
+	wldbg_pointer_map_init(&map);
+
+	for (i = 0; i < KEYS_NUM; ++i)
+		assert(wldbg_pointer_map_insert(&map, &keys[i * 8],
+						&keys[i * 8 + 1]) == 0);
+
+	assert(map.num == KEYS_NUM);
+	assert(2 * map.num <= map.size);
+
+	for (step = 7; step > 1; --step) {
+		for (i = 0; i < KEYS_NUM; i += step)
+			wldbg_pointer_map_remove(&map, &keys[i * 8]);
+
+		for (i = 0; i < KEYS_NUM; ++i) {
+			if (wldbg_pointer_map_get(&map, &keys[i * 8]))
+				assert(wldbg_pointer_map_get(&map,
+							     &keys[i * 8])
+				       == &keys[i * 8 + 1]);
+		}
+
+		/* put them back */
+		for (i = 0; i < KEYS_NUM; i += step)
+			assert(wldbg_pointer_map_insert(&map, &keys[i * 8],
+							&keys[i * 8 + 1]) == 0);
+
+		assert(map.num == KEYS_NUM);
+		for (i = 0; i < KEYS_NUM; ++i)
+			assert(wldbg_pointer_map_get(&map, &keys[i * 8])
+			       == &keys[i * 8 + 1]);
+	}
+
+	for (i = 0; i < KEYS_NUM; ++i)
+		assert(wldbg_pointer_map_remove(&map, &keys[i * 8])
+		       == &keys[i * 8 + 1]);
+
+	assert(map.num == 0);
+	for (i = 0; i < map.size; ++i)
+		assert(map.entries[i].key == NULL);
+
+	wldbg_pointer_map_release(&map, NULL);
+}
+
+static int destroyed;
+
+static void
+destroy(void *value)
+{
+	assert(value);
+	++destroyed;
+}
+
+TEST(pointer_map_release_destroys)
+{
+	struct wldbg_pointer_map map;
+	int keys[10], values[10];
+	unsigned int i;
+
+	wldbg_pointer_map_init(&map);
+	for (i = 0; i < 10; ++i)
+		assert(wldbg_pointer_map_insert(&map, &keys[i],
+						&values[i]) == 0);
+
+	wldbg_pointer_map_remove(&map, &keys[3]);
+
+	destroyed = 0;
+	wldbg_pointer_map_release(&map, destroy);
+	assert(destroyed == 9);
+}
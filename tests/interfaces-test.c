@@ -0,0 +1,137 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "wayland/wayland-util.h"
+#include "wldbg-interfaces.h"
+#include "test-runner.h"
+
+static const struct wl_interface foo_interface = {
+	"foo", 1, 0, NULL, 0, NULL
+};
+
+static const struct wl_interface foo2_interface = {
+	"foo", 2, 0, NULL, 0, NULL
+};
+
+static const struct wl_interface bar_interface = {
+	"bar", 1, 0, NULL, 0, NULL
+};
+
+static const struct wl_interface negative_interface = {
+	"negative", -1, 0, NULL, 0, NULL
+};
+
+TEST(interfaces_register)
+{
+	unsigned int foo, bar;
+
+	assert(wldbg_interfaces_count() == 1);
+	assert(wldbg_interfaces_lookup("foo") == NULL);
+
+	foo = wldbg_interfaces_register(&foo_interface);
+	bar = wldbg_interfaces_register(&bar_interface);
+	assert(foo != 0 && bar != 0 && foo != bar);
+	assert(wldbg_interfaces_count() == 3);
+
+	assert(wldbg_interfaces_lookup("foo") == &foo_interface);
+	assert(wldbg_interfaces_lookup("bar") == &bar_interface);
+	assert(wldbg_interfaces_get(foo) == &foo_interface);
+	assert(wldbg_interfaces_get(0) == NULL);
+	assert(wldbg_interfaces_get(100) == NULL);
+
+	/* the same name keeps the first interface and the index */
+	assert(wldbg_interfaces_register(&foo2_interface) == foo);
+	assert(wldbg_interfaces_lookup("foo") == &foo_interface);
+	assert(wldbg_interfaces_index(&foo2_interface) == foo);
+	assert(wldbg_interfaces_count() == 3);
+
+	wldbg_interfaces_release();
+	assert(wldbg_interfaces_count() == 1);
+}
+
+TEST(interfaces_name_index)
+{
+	unsigned int idx;
+
+	/* name interned before the interface is known */
+	idx = wldbg_interfaces_name_index("foo");
+	assert(idx != 0);
+	assert(wldbg_interfaces_lookup("foo") == NULL);
+	assert(wldbg_interfaces_name_index("foo") == idx);
+
+	assert(wldbg_interfaces_index(&foo_interface) == idx);
+	assert(wldbg_interfaces_lookup("foo") == &foo_interface);
+
+	assert(wldbg_interfaces_index(NULL) == 0);
+	assert(wldbg_interfaces_index(&negative_interface) == 0);
+
+	wldbg_interfaces_release();
+}
+
+TEST(interfaces_many)
+{
+	struct wl_interface intfs[1000];
+	char names[1000][16];
+	unsigned int idx[1000];
+	int i;
+
+	memset(intfs, 0, sizeof intfs);
+
+	for (i = 0; i < 1000; ++i) {
+		snprintf(names[i], sizeof names[i], "intf_%d", i);
+		intfs[i].name = names[i];
+		intfs[i].version = 1;
+		idx[i] = wldbg_interfaces_register(&intfs[i]);
+		assert(idx[i] == (unsigned int) i + 1);
+	}
+
+	/* indices are stable when the tables grow */
+	for (i = 0; i < 1000; ++i) {
+		assert(wldbg_interfaces_index(&intfs[i]) == idx[i]);
+		assert(wldbg_interfaces_name_index(names[i]) == idx[i]);
+		assert(wldbg_interfaces_lookup(names[i]) == &intfs[i]);
+	}
+
+	wldbg_interfaces_release();
+}
+
+TEST(interfaces_forget)
+{
+	struct wl_interface intfs[100];
+	char names[100][16];
+	unsigned int idx[100];
+	int i;
+
+	memset(intfs, 0, sizeof intfs);
+
+	for (i = 0; i < 100; ++i) {
+		snprintf(names[i], sizeof names[i], "intf_%d", i);
+		intfs[i].name = names[i];
+		intfs[i].version = 1;
+		idx[i] = wldbg_interfaces_register(&intfs[i]);
+	}
+
+	for (i = 0; i < 100; i += 2)
+		wldbg_interfaces_forget(&intfs[i]);
+
+	/* the name keeps the index */
+	for (i = 0; i < 100; ++i) {
+		if (i % 2 == 0) {
+			assert(wldbg_interfaces_lookup(names[i]) == NULL);
+			assert(wldbg_interfaces_name_index(names[i]) == idx[i]);
+		} else {
+			assert(wldbg_interfaces_lookup(names[i]) == &intfs[i]);
+			assert(wldbg_interfaces_index(&intfs[i]) == idx[i]);
+		}
+	}
+
+	/* the interface can be registered again */
+	assert(wldbg_interfaces_register(&intfs[0]) == idx[0]);
+	assert(wldbg_interfaces_lookup(names[0]) == &intfs[0]);
+
+	/* unknown interface is ignored */
+	wldbg_interfaces_forget(&foo_interface);
+
+	wldbg_interfaces_release();
+}
@@ -0,0 +1,345 @@
+/*
+ * Round-trip latency benchmark. A client runs wl_display.sync ->
+ * wl_callback.done ping-pong against the stand-in compositor
+ * directly, through wldbg that spawned it (WAYLAND_SOCKET) and
+ * through wldbg in server mode, and we report the latency
+ * percentiles for each configuration.
+ *
+ * latency-bench [--wldbg=PATH] [--iterations=N] [--verbose]
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+
+#include <wayland-client.h>
+
+#include "bench.h"
+
+/* these round-trips are not measured */
+#define WARMUP 1000
+
+/* wldbg renames the compositor's socket to this in server mode */
+#define SERVER_MODE_SOCKET_NAME "wldbg-wayland-0"
+
+static void
+sync_done(void *data, struct wl_callback *callback, uint32_t serial)
+{
+	int *done = data;
+
+	(void) serial;
+
+	*done = 1;
+	wl_callback_destroy(callback);
+}
+
+static const struct wl_callback_listener sync_listener = {
+	sync_done
+};
+
+static int
+compare_samples(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* nearest-rank percentile of sorted samples */
+static uint64_t
+percentile(const uint64_t *samples, int count, double p)
+{
+	int rank = (int) (p * count + 0.999999);
+
+	if (rank < 1)
+		rank = 1;
+
+	return samples[rank - 1];
+}
+
+static int
+run_client(int iterations, const char *result)
+{
+	struct wl_display *display;
+	struct wl_callback *callback;
+	uint64_t *samples, start;
+	int i, done;
+	FILE *f;
+
+	samples = malloc(iterations * sizeof *samples);
+	if (!samples) {
+		fprintf(stderr, "Out of memory\n");
+		return -1;
+	}
+
+	display = wl_display_connect(NULL);
+	if (!display) {
+		perror("Failed connecting to display");
+		free(samples);
+		return -1;
+	}
+
+	for (i = -WARMUP; i < iterations; ++i) {
+		done = 0;
+		start = bench_time_ns();
+
+		callback = wl_display_sync(display);
+		wl_callback_add_listener(callback, &sync_listener, &done);
+
+		while (!done)
+			if (wl_display_dispatch(display) < 0)
+				goto err;
+
+		if (i >= 0)
+			samples[i] = bench_time_ns() - start;
+	}
+
+	qsort(samples, iterations, sizeof *samples, compare_samples);
+
+	/* write the result while we are still connected, wldbg
+	 * exits once we disconnect and the result must be there */
+	f = fopen(result, "w");
+	if (!f) {
+		perror("Opening result file");
+		goto err;
+	}
+
+	fprintf(f, "%" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+		percentile(samples, iterations, 0.5),
+		percentile(samples, iterations, 0.99),
+		percentile(samples, iterations, 0.999),
+		samples[iterations - 1]);
+	fclose(f);
+
+	wl_display_disconnect(display);
+	free(samples);
+
+	return 0;
+
+err:
+	wl_display_disconnect(display);
+	free(samples);
+	return -1;
+}
+
+enum mode {
+	DIRECT,
+	SPAWN,
+	SERVER_MODE,
+};
+
+static const struct {
+	const char *name;
+	enum mode mode;
+} configurations[] = {
+	{ "direct", DIRECT },
+	{ "spawn", SPAWN },
+	{ "server-mode", SERVER_MODE },
+	{ NULL, 0 }
+};
+
+struct bench {
+	const char *wldbg;
+	int iterations;
+	int verbose;
+
+	char result_path[256];
+	struct bench_server server;
+};
+
+/* wait until wldbg in server mode moved the compositor's
+ * socket away and listens on its place */
+static int
+wait_for_server_mode(struct bench *bench, pid_t wldbg)
+{
+	const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+	char renamed[256], orig[256];
+	struct timespec ts = { 0, 1000000 };
+	struct stat st;
+	int i;
+
+	snprintf(renamed, sizeof renamed, "%s/%s",
+		 runtime_dir, SERVER_MODE_SOCKET_NAME);
+	snprintf(orig, sizeof orig, "%s/%s",
+		 runtime_dir, bench->server.socket_name);
+
+	/* give it 5 seconds */
+	for (i = 0; i < 5000; ++i) {
+		if (stat(renamed, &st) == 0 && stat(orig, &st) == 0)
+			return 0;
+
+		if (kill(wldbg, 0) < 0)
+			break;
+
+		nanosleep(&ts, NULL);
+	}
+
+	fprintf(stderr, "wldbg did not start in server mode\n");
+	return -1;
+}
+
+static int
+run_configuration(struct bench *bench, enum mode mode, uint64_t res[4])
+{
+	const char *wldbg_argv[] = { bench->wldbg, "-s", NULL };
+	const char *argv[8];
+	char iterations[16];
+	pid_t wldbg = 0, pid;
+	int n = 0, ret = 0;
+	FILE *f;
+
+	if (mode == SPAWN) {
+		argv[n++] = bench->wldbg;
+		argv[n++] = "--";
+	}
+
+	snprintf(iterations, sizeof iterations, "%d", bench->iterations);
+	argv[n++] = bench_self_path();
+	argv[n++] = "client";
+	argv[n++] = iterations;
+	argv[n++] = bench->result_path;
+	argv[n] = NULL;
+
+	unlink(bench->result_path);
+
+	if (mode == SERVER_MODE) {
+		/* server mode is interactive. Continue on the first
+		 * message and quit when we interrupt it at the end */
+		wldbg = bench_spawn(wldbg_argv, "c\nq\ny\n", !bench->verbose);
+		if (wldbg < 0)
+			return -1;
+
+		if (wait_for_server_mode(bench, wldbg) < 0) {
+			ret = -1;
+			goto out;
+		}
+	}
+
+	pid = bench_spawn(argv, NULL, !bench->verbose);
+	if (pid < 0) {
+		ret = -1;
+		goto out;
+	}
+
+	if (bench_wait(pid) != 0) {
+		fprintf(stderr, "'%s' failed\n", argv[0]);
+		ret = -1;
+		goto out;
+	}
+
+	f = fopen(bench->result_path, "r");
+	if (!f) {
+		fprintf(stderr, "Client did not finish\n");
+		ret = -1;
+		goto out;
+	}
+
+	if (fscanf(f, "%" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64,
+		   &res[0], &res[1], &res[2], &res[3]) != 4) {
+		fprintf(stderr, "Malformed result\n");
+		ret = -1;
+	}
+	fclose(f);
+
+out:
+	if (wldbg > 0) {
+		/* wldbg renames the sockets back on exit */
+		kill(wldbg, SIGINT);
+		bench_wait(wldbg);
+	}
+
+	return ret;
+}
+
+static int
+parse_args(struct bench *bench, int argc, char *argv[])
+{
+	const char *val;
+	int i;
+
+	for (i = 1; i < argc; ++i) {
+		if ((val = bench_arg_value(argv[i], "--wldbg")))
+			bench->wldbg = val;
+		else if ((val = bench_arg_value(argv[i], "--iterations")))
+			bench->iterations = atoi(val);
+		else if (strcmp(argv[i], "--verbose") == 0)
+			bench->verbose = 1;
+		else {
+			fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	if (bench->iterations <= 0) {
+		fprintf(stderr, "Iterations must be positive\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct bench bench;
+	uint64_t res[4];
+	int i, ret = EXIT_SUCCESS;
+
+	if (argc == 4 && strcmp(argv[1], "client") == 0)
+		return run_client(atoi(argv[2]), argv[3]) < 0
+			? EXIT_FAILURE : EXIT_SUCCESS;
+
+	memset(&bench, 0, sizeof bench);
+	bench.wldbg = "wldbg";
+	bench.iterations = 100000;
+
+	if (parse_args(&bench, argc, argv) < 0)
+		return EXIT_FAILURE;
+
+	if (!bench_self_path())
+		return EXIT_FAILURE;
+
+	/* reap the clients that wldbg left behind */
+	if (prctl(PR_SET_CHILD_SUBREAPER, 1) < 0) {
+		perror("prctl");
+		return EXIT_FAILURE;
+	}
+
+	if (bench_server_start(&bench.server) < 0)
+		return EXIT_FAILURE;
+
+	snprintf(bench.result_path, sizeof bench.result_path,
+		 "%s/%s.result", getenv("XDG_RUNTIME_DIR"),
+		 bench.server.socket_name);
+
+	printf("%d round-trips of wl_display.sync\n\n", bench.iterations);
+	printf("%-12s %10s %10s %10s %10s\n", "", "p50 us", "p99 us",
+	       "p99.9 us", "max us");
+
+	for (i = 0; configurations[i].name; ++i) {
+		if (run_configuration(&bench, configurations[i].mode,
+				      res) < 0) {
+			ret = EXIT_FAILURE;
+			break;
+		}
+
+		printf("%-12s %10.1f %10.1f %10.1f %10.1f\n",
+		       configurations[i].name, res[0] / 1e3, res[1] / 1e3,
+		       res[2] / 1e3, res[3] / 1e3);
+	}
+
+	unlink(bench.result_path);
+	bench_server_stop(&bench.server);
+
+	return ret;
+}
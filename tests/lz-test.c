@@ -0,0 +1,101 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wldbg-lz.h"
+#include "test-runner.h"
+
+/* compress and decompress, return the compressed size */
+static size_t
+roundtrip(const void *data, size_t size)
+{
+	size_t bound = wldbg_lz_bound(size), csize;
+	char *packed, *out;
+
+	packed = malloc(bound);
+	out = malloc(size + 1);
+	assert(packed && out);
+
+	csize = wldbg_lz_compress(data, size, packed, bound);
+	assert(csize > 0 && csize <= bound);
+	assert(wldbg_lz_decompress(packed, csize, out, size) == 0);
+	assert(memcmp(out, data, size) == 0);
+
+	/* the size must be exact */
+	if (size > 0)
+		assert(wldbg_lz_decompress(packed, csize, out, size - 1) < 0);
+	assert(wldbg_lz_decompress(packed, csize, out, size + 1) < 0);
+
+	free(packed);
+	free(out);
+
+	return csize;
+}
+
+TEST(lz_small)
+{
+	const char text[] = "abcabcabcabcabcabcabcabcabcabcabc";
+	unsigned int i;
+
+	for (i = 0; i <= sizeof text; ++i)
+		roundtrip(text, i);
+}
+
+TEST(lz_repeating)
+{
+	uint32_t data[16 * 1024];
+	unsigned int i;
+
+	/* like motion events */
+	for (i = 0; i < sizeof data / sizeof data[0]; i += 4) {
+		data[i] = 3;
+		data[i + 1] = 16 << 16 | 1;
+		data[i + 2] = 0;
+		data[i + 3] = i % 8 == 0 ? 8 : 256;
+	}
+
+	assert(roundtrip(data, sizeof data) < sizeof data / 50);
+
+	/* long runs of one byte, the match overlaps what it copies */
+	memset(data, 0, sizeof data);
+	assert(roundtrip(data, sizeof data) < sizeof data / 200);
+}
+
+TEST(lz_random)
+{
+	unsigned char data[100 * 1000];
+	unsigned int i;
+
+	srand(1);
+	for (i = 0; i < sizeof data; ++i)
+		data[i] = rand();
+
+	/* does not compress, but it must fit into the bound */
+	roundtrip(data, sizeof data);
+
+	/* too small output */
+	assert(wldbg_lz_compress(data, sizeof data, data, 100) == 0);
+}
+
+TEST(lz_corrupted)
+{
+	char data[1000], packed[2000], out[1000];
+	size_t size, i;
+
+	for (i = 0; i < sizeof data; ++i)
+		data[i] = "wayland"[i % 7] + i / 100;
+
+	size = wldbg_lz_compress(data, sizeof data, packed, sizeof packed);
+	assert(size > 0 && size < sizeof data);
+
+	/* truncated data */
+	for (i = 0; i < size; ++i)
+		assert(wldbg_lz_decompress(packed, i, out, sizeof out) < 0);
+
+	/* an offset before the start of the data */
+	packed[0] = 0x00;
+	packed[1] = 0xff;
+	packed[2] = 0xff;
+	assert(wldbg_lz_decompress(packed, 4, out, sizeof out) < 0);
+}
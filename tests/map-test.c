@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <stdint.h>
 #include "wldbg-ids-map.h"
 #include "test-runner.h"
 
@@ -39,3 +40,66 @@ TEST(map_insert)
 
 	wldbg_ids_map_release(&m);
 }
+
+TEST(map_remove)
+{
+	struct wldbg_ids_map m;
+	uint32_t i;
+
+	wldbg_ids_map_init(&m);
+
+	for (i = 1; i <= 10000; ++i)
+		wldbg_ids_map_insert(&m, i, (void *) (uintptr_t) i);
+	assert(m.count == 10001);
+
+	/* remove everything but the first and the last id */
+	for (i = 2; i < 10000; ++i)
+		wldbg_ids_map_remove(&m, i);
+
+	assert(m.count == 10001);
+	assert(wldbg_ids_map_get(&m, 1) == (void *) 1);
+	assert(wldbg_ids_map_get(&m, 5000) == NULL);
+	assert(wldbg_ids_map_get(&m, 10000) == (void *) 10000);
+
+	/* the pages in the middle are freed */
+	for (i = 1; i < 10000 / WLDBG_IDS_MAP_PAGE_SIZE; ++i)
+		assert(m.pages[i] == NULL);
+
+	/* removing the highest id lowers count */
+	wldbg_ids_map_insert(&m, 10000, NULL);
+	assert(m.count == 2);
+	assert(m.pages_count < 10000 / WLDBG_IDS_MAP_PAGE_SIZE);
+
+	/* removing something that is not there */
+	wldbg_ids_map_remove(&m, 10000);
+	wldbg_ids_map_remove(&m, 0);
+	assert(m.count == 2);
+
+	wldbg_ids_map_remove(&m, 1);
+	assert(m.count == 0);
+	assert(wldbg_ids_map_get(&m, 1) == NULL);
+
+	/* and we can use it again */
+	wldbg_ids_map_insert(&m, 300, (void *) 0x300);
+	assert(m.count == 301);
+	assert(wldbg_ids_map_get(&m, 300) == (void *) 0x300);
+
+	wldbg_ids_map_release(&m);
+}
+
+TEST(map_sparse)
+{
+	struct wldbg_ids_map m;
+
+	wldbg_ids_map_init(&m);
+
+	/* we do not allocate everything up to the id */
+	wldbg_ids_map_insert(&m, 0xffffff, (void *) 0x1);
+	assert(m.count == 0x1000000);
+	assert(wldbg_ids_map_get(&m, 0xffffff) == (void *) 0x1);
+	assert(wldbg_ids_map_get(&m, 0xfffffe) == NULL);
+	assert(wldbg_ids_map_get(&m, 0) == NULL);
+	assert(m.pages[0] == NULL);
+
+	wldbg_ids_map_release(&m);
+}
@@ -0,0 +1,121 @@
+#include <assert.h>
+#include <string.h>
+
+#include "wayland/wayland-util.h"
+#include "wldbg-message-layout.h"
+#include "test-runner.h"
+
+static const struct wl_message messages[] = {
+	{ "fixed", "4i?o2nh", NULL },
+	{ "strings", "1s?a?sn2on", NULL },
+	{ "empty", "", NULL },
+	{ "invalid", "ix", NULL },
+	{ "too_long", "iiiiiiiiiiiiiiiiiiiii", NULL },
+};
+
+TEST(message_layout_fixed)
+{
+	const struct wldbg_message_layout *l;
+	uint32_t args[] = { 1, 2, 3, 4 };
+
+	l = wldbg_message_layout_get(&messages[0]);
+	assert(l);
+	/* we compile it only once */
+	assert(wldbg_message_layout_get(&messages[0]) == l);
+
+	assert(l->message == &messages[0]);
+	assert(l->since == 4);
+	assert(l->arg_count == 4);
+	assert(l->nullable == 0x2);
+	assert(l->variable == 0);
+	assert(l->first_variable == 4);
+	assert(l->new_id_count == 1 && l->new_ids[0] == 2);
+
+	assert(l->args[0].type == 'i' && l->args[0].offset == 0);
+	assert(l->args[1].type == 'o' && l->args[1].offset == 1);
+	assert(l->args[2].type == 'n' && l->args[2].offset == 2);
+	assert(l->args[3].type == 'h' && l->args[3].offset == 3);
+
+	assert(wldbg_message_layout_arg_offset(l, args, 4, 3) == 3);
+	/* not in the message */
+	assert(wldbg_message_layout_arg_offset(l, args, 3, 3) == -1);
+	assert(wldbg_message_layout_arg_offset(l, args, 4, 4) == -1);
+
+	wldbg_message_layout_release();
+}
+
+TEST(message_layout_variable)
+{
+	const struct wldbg_message_layout *l;
+	/* "abcdef", empty array, "x", new id 10, object 11, new id 12 */
+	uint32_t args[] = { 7, 0, 0, 0, 2, 0, 10, 11, 12 };
+
+	l = wldbg_message_layout_get(&messages[1]);
+	assert(l);
+	assert(l->since == 1);
+	assert(l->arg_count == 6);
+	assert(l->nullable == 0x6);
+	assert(l->variable == 0x7);
+	assert(l->first_variable == 0);
+	assert(l->new_id_count == 2);
+	assert(l->new_ids[0] == 3 && l->new_ids[1] == 5);
+
+	assert(l->args[0].offset == 0);
+	assert(l->args[1].offset == -1);
+	assert(l->args[5].type == 'n' && l->args[5].offset == -1);
+
+	assert(wldbg_message_layout_arg_offset(l, args, 9, 1) == 3);
+	assert(wldbg_message_layout_arg_offset(l, args, 9, 2) == 4);
+	assert(wldbg_message_layout_arg_offset(l, args, 9, 3) == 6);
+	assert(wldbg_message_layout_arg_offset(l, args, 9, 5) == 8);
+
+	/* the string is longer than the message */
+	args[0] = 100;
+	assert(wldbg_message_layout_arg_offset(l, args, 9, 5) == -1);
+
+	wldbg_message_layout_release();
+}
+
+TEST(message_layout_invalid)
+{
+	const struct wldbg_message_layout *l;
+
+	l = wldbg_message_layout_get(&messages[2]);
+	assert(l && l->arg_count == 0 && l->since == 1);
+
+	assert(wldbg_message_layout_get(&messages[3]) == NULL);
+	assert(wldbg_message_layout_get(&messages[4]) == NULL);
+	assert(wldbg_message_layout_get(NULL) == NULL);
+
+	wldbg_message_layout_release();
+}
+
+TEST(message_layout_forget)
+{
+	struct wl_message many[1000];
+	const struct wldbg_message_layout *l;
+	int i;
+
+	memset(many, 0, sizeof many);
+	for (i = 0; i < 1000; ++i) {
+		many[i].name = "many";
+		many[i].signature = i % 2 ? "u" : "su";
+		assert(wldbg_message_layout_get(&many[i]));
+	}
+
+	/* forget every other message, the rest must be still found */
+	for (i = 0; i < 1000; i += 2)
+		wldbg_message_layout_forget(&many[i], 1);
+
+	for (i = 1; i < 1000; i += 2) {
+		l = wldbg_message_layout_get(&many[i]);
+		assert(l && l->message == &many[i] && l->arg_count == 1);
+	}
+
+	/* the message changed, we get a new layout */
+	wldbg_message_layout_forget(many, 1000);
+	many[1].signature = "uu";
+	assert(wldbg_message_layout_get(&many[1])->arg_count == 2);
+
+	wldbg_message_layout_release();
+}
@@ -0,0 +1,210 @@
+#include <assert.h>
+#include <string.h>
+
+#include "wayland/wayland-private.h"
+#include "wldbg-object-table.h"
+#include "wldbg-interfaces.h"
+#include "test-runner.h"
+
+static const struct wl_interface surface_interface = {
+	"wl_surface", 4, 0, NULL, 0, NULL
+};
+
+static const struct wl_interface buffer_interface = {
+	"wl_buffer", 1, 0, NULL, 0, NULL
+};
+
+/* the same name, but a different version */
+static const struct wl_interface other_surface_interface = {
+	"wl_surface", 3, 0, NULL, 0, NULL
+};
+
+/* the same name and version, e. g. a copy from a binary */
+static const struct wl_interface surface_copy_interface = {
+	"wl_surface", 4, 0, NULL, 0, NULL
+};
+
+TEST(object_table_create_delete)
+{
+	struct wldbg_object_table t;
+	struct wldbg_object obj;
+	unsigned int flags, index;
+
+	wldbg_object_table_init(&t);
+
+	index = wldbg_object_table_create(&t, 3, &surface_interface);
+	assert(index == wldbg_interfaces_index(&surface_interface));
+	assert(wldbg_object_table_create(&t, WL_SERVER_ID_START + 1,
+					 &buffer_interface) != index);
+	/* unknown interface */
+	assert(wldbg_object_table_create(&t, 4, NULL) == 0);
+
+	assert(wldbg_object_table_get_interface(&t, 3, &flags)
+		== &surface_interface);
+	assert(flags == WLDBG_OBJECT_LIVE);
+	assert(wldbg_object_table_get_interface(&t, WL_SERVER_ID_START + 1,
+						&flags) == &buffer_interface);
+	assert(wldbg_object_table_get_interface(&t, 4, &flags) == NULL);
+	assert(flags == WLDBG_OBJECT_LIVE);
+	assert(wldbg_object_table_get_interface(&t, 5, &flags) == NULL);
+	assert(flags == 0);
+	assert(wldbg_object_table_get_interface(&t, WL_SERVER_ID_START,
+						&flags) == NULL);
+	assert(flags == 0);
+
+	assert(wldbg_object_table_get(&t, 3, &obj));
+	assert(obj.id == 3 && obj.interface == &surface_interface);
+	assert(obj.interface_index == index);
+	assert(obj.generation == 1 && obj.seq == 0);
+	assert(obj.info == NULL);
+
+	wldbg_object_table_delete(&t, 3);
+	assert(wldbg_object_table_get_interface(&t, 3, &flags) == NULL);
+	assert(flags == 0);
+	assert(!wldbg_object_table_get(&t, 3, &obj));
+	/* deleting twice is harmless */
+	wldbg_object_table_delete(&t, 3);
+	wldbg_object_table_delete(&t, 1000);
+
+	/* the id is reused */
+	wldbg_object_table_create(&t, 3, &buffer_interface);
+	assert(wldbg_object_table_get(&t, 3, &obj));
+	assert(obj.interface == &buffer_interface);
+	assert(obj.generation == 2 && obj.seq == 3);
+
+	wldbg_object_table_release(&t);
+	wldbg_interfaces_release();
+}
+
+TEST(object_table_info)
+{
+	struct wldbg_object_table t;
+	struct wldbg_object obj;
+	unsigned int flags;
+	int info;
+
+	wldbg_object_table_init(&t);
+
+	wldbg_object_table_create(&t, 10, &surface_interface);
+	wldbg_object_table_set_info(&t, 10, &info);
+	assert(wldbg_object_table_get_info(&t, 10) == &info);
+
+	/* the info outlives the object */
+	wldbg_object_table_delete(&t, 10);
+	assert(wldbg_object_table_get_interface(&t, 10, &flags) == NULL);
+	assert(wldbg_object_table_get_info(&t, 10) == &info);
+	assert(wldbg_object_table_get(&t, 10, &obj));
+	assert(obj.flags == 0 && obj.info == &info);
+	assert(obj.interface == &surface_interface);
+
+	/* and there may be info without the object */
+	wldbg_object_table_set_info(&t, 700, &info);
+	assert(wldbg_object_table_get_info(&t, 700) == &info);
+	assert(wldbg_object_table_get_interface(&t, 700, &flags) == NULL);
+	assert(flags == 0);
+
+	wldbg_object_table_set_info(&t, 10, NULL);
+	wldbg_object_table_set_info(&t, 700, NULL);
+	assert(!wldbg_object_table_get(&t, 10, &obj));
+	assert(wldbg_object_table_get_info(&t, 700) == NULL);
+
+	/* all pages are gone */
+	assert(t.pages[0].count == 0);
+
+	wldbg_object_table_release(&t);
+	wldbg_interfaces_release();
+}
+
+static void
+collect(struct wldbg_object *obj, void *data)
+{
+	uint32_t **ids = data;
+
+	*(*ids)++ = obj->id;
+}
+
+TEST(object_table_for_each)
+{
+	struct wldbg_object_table t;
+	uint32_t ids[8], *p = ids;
+	int info;
+
+	wldbg_object_table_init(&t);
+
+	wldbg_object_table_create(&t, WL_SERVER_ID_START, &buffer_interface);
+	wldbg_object_table_create(&t, 1000, &surface_interface);
+	wldbg_object_table_create(&t, 1, &surface_interface);
+	wldbg_object_table_create(&t, 2, &surface_interface);
+	wldbg_object_table_delete(&t, 2);
+	wldbg_object_table_set_info(&t, 5, &info);
+
+	wldbg_object_table_for_each(&t, collect, &p);
+	assert(p - ids == 4);
+	assert(ids[0] == 1 && ids[1] == 5 && ids[2] == 1000);
+	assert(ids[3] == WL_SERVER_ID_START);
+
+	wldbg_object_table_release(&t);
+	wldbg_interfaces_release();
+}
+
+TEST(object_table_same_name)
+{
+	struct wldbg_object_table t1, t2;
+	unsigned int flags;
+
+	wldbg_object_table_init(&t1);
+	wldbg_object_table_init(&t2);
+
+	/* every connection can have its own version of an interface */
+	assert(wldbg_object_table_create(&t1, 3, &surface_interface)
+		== wldbg_object_table_create(&t2, 3, &other_surface_interface));
+	assert(wldbg_object_table_get_interface(&t1, 3, &flags)
+		== &surface_interface);
+	assert(wldbg_object_table_get_interface(&t2, 3, &flags)
+		== &other_surface_interface);
+
+	wldbg_object_table_release(&t1);
+	wldbg_object_table_release(&t2);
+	wldbg_interfaces_release();
+}
+
+TEST(object_table_same_name_one_connection)
+{
+	struct wldbg_object_table t;
+	struct wldbg_object obj;
+	unsigned int flags, index;
+
+	wldbg_object_table_init(&t);
+
+	index = wldbg_object_table_create(&t, 3, &surface_interface);
+	assert(wldbg_object_table_create(&t, 4, &other_surface_interface)
+		== index);
+
+	/* using the other version does not change the existing objects */
+	assert(wldbg_object_table_get_interface(&t, 3, &flags)
+		== &surface_interface);
+	assert(wldbg_object_table_get_interface(&t, 4, &flags)
+		== &other_surface_interface);
+	assert(wldbg_object_table_get(&t, 4, &obj));
+	assert(obj.interface == &other_surface_interface);
+	assert(obj.interface_index == index);
+
+	/* with the same version, the first interface is kept */
+	assert(wldbg_object_table_create(&t, 5, &surface_copy_interface)
+		== index);
+	assert(wldbg_object_table_get_interface(&t, 5, &flags)
+		== &surface_interface);
+	assert(wldbg_object_table_get_interface(&t, 3, &flags)
+		== &surface_interface);
+
+	/* and the first version is still found */
+	wldbg_object_table_create(&t, 6, &surface_interface);
+	assert(wldbg_object_table_get_interface(&t, 6, &flags)
+		== &surface_interface);
+	wldbg_object_table_create(&t, 7, &other_surface_interface);
+	assert(wldbg_object_table_get_interface(&t, 7, &flags)
+		== &other_surface_interface);
+
+	wldbg_object_table_release(&t);
+	wldbg_interfaces_release();
+}
@@ -0,0 +1,161 @@
+#include <assert.h>
+#include <string.h>
+
+#include "wayland/wayland-private.h"
+#include "wldbg-objects-index.h"
+#include "test-runner.h"
+
+static int
+contains(const uint32_t *ids, unsigned int count, uint32_t id)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; ++i)
+		if (ids[i] == id)
+			return 1;
+
+	return 0;
+}
+
+TEST(objects_index_add_remove)
+{
+	struct wldbg_objects_index index;
+	const uint32_t *ids;
+	unsigned int count;
+
+	wldbg_objects_index_init(&index);
+
+	assert(wldbg_objects_index_add(&index, 3, 1) == 0);
+	assert(wldbg_objects_index_add(&index, 4, 1) == 0);
+	assert(wldbg_objects_index_add(&index, 5, 1) == 0);
+	assert(wldbg_objects_index_add(&index, WL_SERVER_ID_START, 1) == 0);
+	assert(wldbg_objects_index_add(&index, 6, 100) == 0);
+	/* no interface */
+	assert(wldbg_objects_index_add(&index, 7, 0) == 0);
+
+	ids = wldbg_objects_index_get(&index, 1, &count);
+	assert(count == 4);
+	assert(contains(ids, count, 3) && contains(ids, count, 5));
+	assert(contains(ids, count, WL_SERVER_ID_START));
+
+	ids = wldbg_objects_index_get(&index, 100, &count);
+	assert(count == 1 && ids[0] == 6);
+
+	assert(wldbg_objects_index_get(&index, 0, &count) == NULL);
+	assert(count == 0);
+	assert(wldbg_objects_index_get(&index, 2, &count) == NULL);
+	assert(count == 0);
+
+	wldbg_objects_index_remove(&index, 3, 1);
+	/* not in the set */
+	wldbg_objects_index_remove(&index, 6, 1);
+	wldbg_objects_index_remove(&index, 1000, 1);
+
+	ids = wldbg_objects_index_get(&index, 1, &count);
+	assert(count == 3);
+	assert(!contains(ids, count, 3));
+	assert(contains(ids, count, 4) && contains(ids, count, 5));
+
+	/* positions must be right after the last id was moved */
+	wldbg_objects_index_remove(&index, WL_SERVER_ID_START, 1);
+	wldbg_objects_index_remove(&index, 4, 1);
+	ids = wldbg_objects_index_get(&index, 1, &count);
+	assert(count == 1 && ids[0] == 5);
+
+	/* the id can be reused by another interface */
+	wldbg_objects_index_remove(&index, 5, 1);
+	assert(wldbg_objects_index_add(&index, 5, 2) == 0);
+	wldbg_objects_index_get(&index, 1, &count);
+	assert(count == 0);
+	ids = wldbg_objects_index_get(&index, 2, &count);
+	assert(count == 1 && ids[0] == 5);
+
+	wldbg_objects_index_release(&index);
+}
+
+TEST(objects_index_many)
+{
+	struct wldbg_objects_index index;
+	const uint32_t *ids;
+	unsigned int count;
+	uint32_t id;
+
+	wldbg_objects_index_init(&index);
+
+	for (id = 1; id <= 10000; ++id)
+		assert(wldbg_objects_index_add(&index, id, id % 7 + 1) == 0);
+
+	for (id = 1; id <= 10000; id += 2)
+		wldbg_objects_index_remove(&index, id, id % 7 + 1);
+
+	ids = wldbg_objects_index_get(&index, 3, &count);
+	for (id = 1; id <= 10000; ++id)
+		assert(contains(ids, count, id) == (id % 7 == 2 && id % 2 == 0));
+
+	wldbg_objects_index_release(&index);
+}
+
+TEST(objects_index_add_twice)
+{
+	struct wldbg_objects_index index;
+	const uint32_t *ids;
+	unsigned int count;
+
+	wldbg_objects_index_init(&index);
+
+	assert(wldbg_objects_index_add(&index, 3, 1) == 0);
+	assert(wldbg_objects_index_add(&index, 4, 1) == 0);
+	/* adding the id again does not duplicate it */
+	assert(wldbg_objects_index_add(&index, 3, 1) == 0);
+	ids = wldbg_objects_index_get(&index, 1, &count);
+	assert(count == 2);
+
+	/* the id was created again with another interface
+	 * without removing it, it moves to the other set */
+	assert(wldbg_objects_index_add(&index, 3, 2) == 0);
+	ids = wldbg_objects_index_get(&index, 1, &count);
+	assert(count == 1 && ids[0] == 4);
+	ids = wldbg_objects_index_get(&index, 2, &count);
+	assert(count == 1 && ids[0] == 3);
+
+	/* the stale entry does not break the positions */
+	wldbg_objects_index_remove(&index, 3, 1);
+	wldbg_objects_index_remove(&index, 4, 1);
+	wldbg_objects_index_get(&index, 1, &count);
+	assert(count == 0);
+	ids = wldbg_objects_index_get(&index, 2, &count);
+	assert(count == 1 && ids[0] == 3);
+
+	wldbg_objects_index_remove(&index, 3, 2);
+	wldbg_objects_index_get(&index, 2, &count);
+	assert(count == 0);
+
+	wldbg_objects_index_release(&index);
+}
+
+TEST(objects_index_pages_freed)
+{
+	struct wldbg_objects_index index;
+	uint32_t id, n;
+
+	wldbg_objects_index_init(&index);
+
+	for (id = 1; id <= 10000; ++id) {
+		assert(wldbg_objects_index_add(&index, id, 1) == 0);
+		assert(wldbg_objects_index_add(&index,
+					       WL_SERVER_ID_START + id, 2) == 0);
+	}
+
+	for (id = 1; id <= 10000; ++id) {
+		wldbg_objects_index_remove(&index, id, 1);
+		wldbg_objects_index_remove(&index, WL_SERVER_ID_START + id, 2);
+	}
+
+	/* nothing is left from the positions of the ids */
+	for (n = 0; n < index.pages[0].count; ++n)
+		assert(wldbg_ids_map_get(&index.pages[0], n) == NULL);
+	for (n = 0; n < index.pages[1].count; ++n)
+		assert(wldbg_ids_map_get(&index.pages[1], n) == NULL);
+
+	wldbg_objects_index_release(&index);
+}
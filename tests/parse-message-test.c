@@ -1,8 +1,14 @@
 #include <assert.h>
+#include <string.h>
+#include <unistd.h>
 #include "test-runner.h"
 
 #include "wldbg-parse-message.h"
+#include "wldbg-message-layout.h"
 #include "wldbg.h"
+#include "wldbg-private.h"
+#include "wldbg-interfaces.h"
+#include "wldbg-printers.h"
 #include "wayland/wayland-util.h"
 
 TEST(parse_base_message)
@@ -93,6 +99,9 @@ TEST(resolved_message_iterator_types)
 
 	arg = wldbg_resolved_message_next_argument(&rm);
 	assert(arg == NULL);
+
+	/* the iterator compiled the signatures */
+	wldbg_message_layout_release();
 }
 
 TEST(resolved_iterator_test)
@@ -189,6 +198,8 @@ TEST(resolved_iterator_test)
 	assert(arg == NULL);
 	arg = wldbg_resolved_message_next_argument(&rm);
 	assert(arg == NULL);
+
+	wldbg_message_layout_release();
 }
 
 TEST(resolve_message_test2)
@@ -232,6 +243,8 @@ TEST(resolve_message_test2)
 	assert(arg == NULL);
 	arg = wldbg_resolved_message_next_argument(&rm);
 	assert(arg == NULL);
+
+	wldbg_message_layout_release();
 }
 
 TEST(message_no_arguments)
@@ -249,4 +262,152 @@ TEST(message_no_arguments)
 	assert(arg == NULL);
 	arg = wldbg_resolved_message_next_argument(&rm);
 	assert(arg == NULL);
+
+	wldbg_message_layout_release();
+}
+
+TEST(message_decoded_once)
+{
+	uint32_t data[] = { 5, 0x00080003 };
+	struct wldbg_connection conn;
+	struct wldbg_message msg = {
+		.data = data,
+		.size = sizeof data,
+		.connection = &conn,
+	};
+	char buf[32];
+	unsigned int count;
+
+	/* we do not resolve objects in this connection */
+	memset(&conn, 0, sizeof conn);
+
+	assert(wldbg_get_message_name(&msg, buf, sizeof buf) == 11);
+	assert(strcmp(buf, "unknown@5.3") == 0);
+	/* it is truncated, but we get the whole length */
+	assert(wldbg_get_message_name(&msg, buf, 8) == 11);
+	assert(strcmp(buf, "unknown") == 0);
+
+	/* the name is cached until the message is invalidated */
+	data[0] = 6;
+	wldbg_get_message_name(&msg, buf, sizeof buf);
+	assert(strcmp(buf, "unknown@5.3") == 0);
+
+	wldbg_message_invalidate(&msg);
+	wldbg_get_message_name(&msg, buf, sizeof buf);
+	assert(strcmp(buf, "unknown@6.3") == 0);
+
+	assert(wldbg_message_get_arguments(&msg, &count) == NULL);
+	assert(count == 0);
+}
+
+static const struct wl_message pointer_requests[] = {
+	{ "stop", "", NULL },
+};
+
+static const struct wl_message pointer_events[] = {
+	{ "motion", "u", NULL },
+	{ "frame", "", NULL },
+};
+
+static const struct wl_interface pointer_interface = {
+	"test_pointer", 1,
+	1, pointer_requests,
+	2, pointer_events,
+};
+
+static uint64_t now_ms;
+
+static void
+print_test_message(struct wldbg_connection *conn, int from,
+		   uint32_t opcode, uint32_t *arg)
+{
+	uint32_t data[3] = { 3, 0, 0 };
+	struct wldbg_message msg;
+
+	memset(&msg, 0, sizeof msg);
+	data[1] = ((arg ? 12 : 8) << 16) | opcode;
+	if (arg)
+		data[2] = *arg;
+
+	msg.data = data;
+	msg.size = arg ? 12 : 8;
+	msg.from = from;
+	msg.connection = conn;
+	/* one message per millisecond */
+	msg.received = ++now_ms * 1000000;
+
+	wldbg_message_print(&msg);
+}
+
+/* glibc keeps memory of finished threads for the next threads,
+ * which looks like a leak to the test runner */
+extern int leak_check_enabled;
+
+TEST(print_collapse_runs)
+{
+	const char expected[] =
+		"S: test_pointer@3.motion(1)\n"
+		"S: test_pointer@3.frame()\n"
+		"S: test_pointer@3.motion(2)\n"
+		"S: test_pointer@3.frame()\n"
+		"S: ... 6 more of (test_pointer.motion, test_pointer.frame)"
+		" in 5.000 ms, first: test_pointer@3.motion(3),"
+		" last: test_pointer@3.motion(5)\n"
+		"C: test_pointer@3.stop()\n"
+		"S: test_pointer@3.frame()\n"
+		"S: test_pointer@3.frame()\n"
+		"S: ... 1 more of (test_pointer.frame) in 0.000 ms,"
+		" first: test_pointer@3.frame()\n";
+	struct wldbg wldbg;
+	struct wldbg_connection conn;
+	struct resolved_objects ro;
+	char buf[sizeof expected];
+	uint32_t i;
+	int fds[2];
+
+	leak_check_enabled = 0;
+
+	memset(&wldbg, 0, sizeof wldbg);
+	memset(&conn, 0, sizeof conn);
+	memset(&ro, 0, sizeof ro);
+
+	assert(pipe(fds) == 0);
+	wldbg.writer = wldbg_writer_create(fds[1], 4096);
+	assert(wldbg.writer);
+	wldbg.flags.collapse_runs = 1;
+
+	conn.wldbg = &wldbg;
+	conn.resolved_objects = &ro;
+	wldbg_object_table_init(&conn.objects);
+	ro.table = &conn.objects;
+	wldbg_object_table_create(&conn.objects, 3, &pointer_interface);
+
+	for (i = 1; i <= 5; ++i) {
+		print_test_message(&conn, SERVER, 0, &i);
+		print_test_message(&conn, SERVER, 1, NULL);
+	}
+
+	/* the run breaks */
+	print_test_message(&conn, CLIENT, 0, NULL);
+
+	for (i = 0; i < 3; ++i)
+		print_test_message(&conn, SERVER, 1, NULL);
+
+	/* wldbg stops here */
+	wldbg_collapse_flush(&conn);
+
+	wldbg_output_flush(&conn);
+	wldbg_writer_destroy(wldbg.writer);
+
+	assert(read(fds[0], buf, sizeof buf) == sizeof expected - 1);
+	assert(memcmp(buf, expected, sizeof expected - 1) == 0);
+
+	close(fds[0]);
+	close(fds[1]);
+	wldbg_collapse_release(&conn);
+	wldbg_output_release(&conn.output);
+	wldbg_object_table_release(&conn.objects);
+	wldbg_printers_release();
+	wldbg_interfaces_release();
+	wldbg_message_layout_release();
 }
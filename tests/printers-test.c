@@ -0,0 +1,156 @@
+#include <assert.h>
+#include <string.h>
+
+#include "wayland/wayland-util.h"
+#include "wldbg.h"
+#include "wldbg-interfaces.h"
+#include "wldbg-printers.h"
+#include "test-runner.h"
+
+static const struct wldbg_enum_entry state_entries[] = {
+	{ "released", 0 },
+	{ "pressed", 1 },
+};
+
+static const struct wldbg_enum state = {
+	"state", 0, 2, state_entries
+};
+
+static const struct wldbg_enum_entry caps_entries[] = {
+	{ "pointer", 1 },
+	{ "keyboard", 2 },
+	{ "touch", 4 },
+};
+
+static const struct wldbg_enum caps = {
+	"capability", 1, 3, caps_entries
+};
+
+static const struct wl_message requests[] = {
+	{ "set", "uu", NULL },
+	{ "destroy", "", NULL },
+};
+
+static const struct wl_message events[] = {
+	{ "key", "uuuu", NULL },
+};
+
+static const struct wl_interface test_interface = {
+	"wldbg_test_keys", 1,
+	2, requests,
+	1, events,
+};
+
+static int
+print_nothing(struct wldbg_output *out, const struct wldbg_resolved_arg *arg,
+	      const void *data)
+{
+	return 1;
+}
+
+static const char *
+format(const struct wldbg_enum *e, uint32_t value)
+{
+	static char buf[64];
+
+	wldbg_enum_format(e, value, buf, sizeof buf);
+	return buf;
+}
+
+TEST(enum_format)
+{
+	char buf[8];
+
+	assert(strcmp(format(&state, 0), "released") == 0);
+	assert(strcmp(format(&state, 1), "pressed") == 0);
+	assert(strcmp(format(&state, 7), "7") == 0);
+
+	assert(strcmp(format(&caps, 0), "0") == 0);
+	assert(strcmp(format(&caps, 2), "keyboard") == 0);
+	assert(strcmp(format(&caps, 5), "pointer|touch") == 0);
+	assert(strcmp(format(&caps, 0x13), "pointer|keyboard|0x10") == 0);
+	assert(strcmp(format(&caps, 0x10), "0x10") == 0);
+
+	/* like snprintf, returns the length that it wanted */
+	assert(wldbg_enum_format(&caps, 7, buf, sizeof buf)
+	       == strlen("pointer|keyboard|touch"));
+	assert(strcmp(buf, "pointer") == 0);
+}
+
+TEST(printers_table)
+{
+	const struct wldbg_arg_format *f;
+	unsigned int index;
+
+	assert(wldbg_printers_add_enum("wldbg_test_keys", "key", SERVER, 3,
+				       &state, WLDBG_PRINTER_PROTOCOL) == 0);
+	assert(wldbg_printers_add("wldbg_test_keys", "key", SERVER, 2,
+				  print_nothing, NULL,
+				  WLDBG_PRINTER_BUILTIN) == 0);
+	/* the builtin printer does not overwrite the protocol */
+	assert(wldbg_printers_add("wldbg_test_keys", "key", SERVER, 3,
+				  print_nothing, NULL,
+				  WLDBG_PRINTER_BUILTIN) == 0);
+	assert(wldbg_printers_add_enum("wldbg_test_keys", "set", CLIENT, 1,
+				       &caps, WLDBG_PRINTER_BUILTIN) == 0);
+	/* the message does not exist, it is skipped */
+	assert(wldbg_printers_add_enum("wldbg_test_keys", "nothing", CLIENT,
+				       0, &caps, WLDBG_PRINTER_BUILTIN) == 0);
+
+	/* we can add printers before the interface is registered */
+	wldbg_interfaces_register(&test_interface);
+	index = wldbg_interfaces_index(&test_interface);
+	assert(index != 0);
+
+	f = wldbg_printers_get(index, &test_interface, SERVER, 0);
+	assert(f);
+	assert(f[0].print == NULL && f[1].print == NULL);
+	assert(f[2].print == print_nothing);
+	assert(f[3].print && f[3].print != print_nothing);
+	assert(f[3].data == &state);
+	/* we compile it only once */
+	assert(wldbg_printers_get(index, &test_interface, SERVER, 0) == f);
+
+	f = wldbg_printers_get(index, &test_interface, CLIENT, 0);
+	assert(f && f[0].print == NULL && f[1].data == &caps);
+	assert(wldbg_printers_get(index, &test_interface, CLIENT, 1) == NULL);
+
+	/* out of range */
+	assert(wldbg_printers_get(index, &test_interface, SERVER, 1) == NULL);
+	assert(wldbg_printers_get(index, &test_interface, CLIENT, 2) == NULL);
+	assert(wldbg_printers_get(100000, &test_interface, SERVER, 0) == NULL);
+
+	wldbg_printers_release();
+	wldbg_interfaces_release();
+}
+
+TEST(printers_forget)
+{
+	const struct wldbg_arg_format *f;
+	struct wl_interface copy = test_interface;
+	unsigned int index;
+
+	wldbg_interfaces_register(&test_interface);
+	index = wldbg_interfaces_index(&test_interface);
+
+	assert(wldbg_printers_add_enum("wldbg_test_keys", "key", SERVER, 1,
+				       &state, WLDBG_PRINTER_BUILTIN) == 0);
+	f = wldbg_printers_get(index, &test_interface, SERVER, 0);
+	assert(f && f[1].data == &state);
+
+	/* another interface with the same name, the table is
+	 * compiled again for it */
+	wldbg_printers_forget(&test_interface);
+	copy.event_count = 0;
+	assert(wldbg_printers_get(index, &copy, SERVER, 0) == NULL);
+
+	/* adding a printer compiles the table again too */
+	copy.event_count = 1;
+	assert(wldbg_printers_add_enum("wldbg_test_keys", "key", SERVER, 2,
+				       &caps, WLDBG_PRINTER_BUILTIN) == 0);
+	f = wldbg_printers_get(index, &copy, SERVER, 0);
+	assert(f && f[1].data == &state && f[2].data == &caps);
+
+	wldbg_printers_release();
+	wldbg_interfaces_release();
+}
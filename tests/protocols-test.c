@@ -0,0 +1,228 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "wayland/wayland-util.h"
+#include "wldbg.h"
+#include "wldbg-interfaces.h"
+#include "wldbg-printers.h"
+#include "protocols.h"
+#include "test-runner.h"
+
+static const char test_protocol[] =
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	"<protocol name=\"test\">\n"
+	"  <interface name=\"test_manager\" version=\"3\">\n"
+	"    <description summary=\"ignored\"/>\n"
+	"    <request name=\"create\">\n"
+	"      <arg name=\"id\" type=\"new_id\" interface=\"test_object\"/>\n"
+	"      <arg name=\"surface\" type=\"object\" interface=\"wl_surface\""
+	" allow-null=\"true\"/>\n"
+	"    </request>\n"
+	"    <request name=\"bind\" since=\"2\">\n"
+	"      <arg name=\"name\" type=\"uint\"/>\n"
+	"      <arg name=\"id\" type=\"new_id\"/>\n"
+	"    </request>\n"
+	"    <event name=\"done\"/>\n"
+	"    <enum name=\"error\">\n"
+	"      <entry name=\"invalid\" value=\"0\"/>\n"
+	"    </enum>\n"
+	"    <enum name=\"mode\" bitfield=\"true\">\n"
+	"      <entry name=\"read\" value=\"0x1\"/>\n"
+	"      <entry name=\"write\" value=\"0x2\"/>\n"
+	"    </enum>\n"
+	"  </interface>\n"
+	"  <interface name=\"test_object\" version=\"1\">\n"
+	"    <event name=\"text\">\n"
+	"      <arg name=\"text\" type=\"string\"/>\n"
+	"      <arg name=\"fd\" type=\"fd\"/>\n"
+	"      <arg name=\"value\" type=\"fixed\"/>\n"
+	"      <arg name=\"mode\" type=\"uint\""
+	" enum=\"test_manager.mode\"/>\n"
+	"      <arg name=\"nothing\" type=\"uint\" enum=\"nothing\"/>\n"
+	"    </event>\n"
+	"  </interface>\n"
+	"</protocol>\n";
+
+static const char broken_protocol[] =
+	"<protocol name=\"broken\">\n"
+	"  <interface name=\"broken_interface\" version=\"1\">\n"
+	"    <request name=\"oops\">\n"
+	"  </interface>\n"
+	"</protocol>\n";
+
+static const struct wl_interface surface_interface = {
+	"wl_surface", 4, 0, NULL, 0, NULL
+};
+
+static void
+write_file(const char *dir, const char *name, const char *content)
+{
+	char path[256];
+	FILE *f;
+
+	snprintf(path, sizeof path, "%s/%s", dir, name);
+	f = fopen(path, "w");
+	assert(f);
+	assert(fputs(content, f) >= 0);
+	fclose(f);
+}
+
+static void
+remove_file(const char *dir, const char *name)
+{
+	char path[256];
+
+	snprintf(path, sizeof path, "%s/%s", dir, name);
+	unlink(path);
+}
+
+static void
+check_interfaces(void)
+{
+	const struct wl_interface *manager, *object;
+	const struct wl_message *msg;
+
+	manager = wldbg_interfaces_lookup("test_manager");
+	object = wldbg_interfaces_lookup("test_object");
+	assert(manager && object);
+	assert(wldbg_interfaces_lookup("broken_interface") == NULL);
+
+	assert(strcmp(manager->name, "test_manager") == 0);
+	assert(manager->version == 3);
+	assert(manager->method_count == 2);
+	assert(manager->event_count == 1);
+
+	msg = &manager->methods[0];
+	assert(strcmp(msg->name, "create") == 0);
+	assert(strcmp(msg->signature, "n?o") == 0);
+	assert(msg->types[0] == object);
+	/* interfaces from other protocols are taken from the registry */
+	assert(msg->types[1] == &surface_interface);
+
+	msg = &manager->methods[1];
+	assert(strcmp(msg->name, "bind") == 0);
+	assert(strcmp(msg->signature, "2usun") == 0);
+	assert(msg->types[0] == NULL && msg->types[3] == NULL);
+
+	msg = &manager->events[0];
+	assert(strcmp(msg->name, "done") == 0);
+	assert(strcmp(msg->signature, "") == 0);
+	assert(msg->types != NULL);
+
+	assert(object->version == 1);
+	assert(object->method_count == 0);
+	assert(object->event_count == 1);
+	assert(strcmp(object->events[0].signature, "shfuu") == 0);
+}
+
+static void
+check_enums(void)
+{
+	const struct wl_interface *object;
+	const struct wldbg_arg_format *f;
+	const struct wldbg_enum *mode;
+	char buf[32];
+
+	object = wldbg_interfaces_lookup("test_object");
+	f = wldbg_printers_get(wldbg_interfaces_index(object), object,
+			       SERVER, 0);
+	assert(f);
+	assert(f[0].print == NULL && f[4].print == NULL);
+
+	/* the enum from another interface */
+	mode = f[3].data;
+	assert(f[3].print && mode);
+	assert(strcmp(mode->name, "mode") == 0);
+	assert(mode->bitfield);
+	assert(mode->entry_count == 2);
+	assert(strcmp(mode->entries[1].name, "write") == 0);
+	assert(mode->entries[1].value == 2);
+
+	wldbg_enum_format(mode, 3, buf, sizeof buf);
+	assert(strcmp(buf, "read|write") == 0);
+}
+
+static void
+release(void)
+{
+	wldbg_printers_release();
+	wldbg_interfaces_release();
+	wldbg_protocols_release();
+
+	/* the registry is empty now, put our wl_surface back */
+	wldbg_interfaces_register(&surface_interface);
+}
+
+TEST(protocols_load_and_cache)
+{
+	char dir[] = "/tmp/wldbg-protocols-test-XXXXXX";
+	char sub[256], paths[512], cache[256];
+	struct stat st;
+
+	assert(mkdtemp(dir));
+	snprintf(sub, sizeof sub, "%s/stable", dir);
+	assert(mkdir(sub, 0700) == 0);
+	snprintf(cache, sizeof cache, "%s/cache/protocols", dir);
+	/* the directory and a file that does not exist */
+	snprintf(paths, sizeof paths, "%s:%s/nothing.xml", dir, dir);
+
+	write_file(sub, "test.xml", test_protocol);
+	write_file(dir, "broken.xml", broken_protocol);
+	/* not an XML file, is skipped */
+	write_file(sub, "README", broken_protocol);
+
+	wldbg_interfaces_register(&surface_interface);
+
+	/* parse the XML and create the cache */
+	assert(wldbg_protocols_load(paths, cache) == 2);
+	assert(stat(cache, &st) == 0);
+	check_interfaces();
+	check_enums();
+	release();
+
+	/* now the same from the cache */
+	assert(wldbg_protocols_load(paths, cache) == 2);
+	check_interfaces();
+	check_enums();
+	release();
+
+	/* we ignore the cache if it is broken */
+	write_file(dir, "cache/protocols", "garbage");
+	assert(wldbg_protocols_load(paths, cache) == 2);
+	check_interfaces();
+	check_enums();
+	release();
+
+	/* and we rebuild it when the files change */
+	remove_file(dir, "broken.xml");
+	write_file(dir, "other.xml",
+		   "<protocol name=\"other\">\n"
+		   "  <interface name=\"other\" version=\"1\"/>\n"
+		   "</protocol>\n");
+	assert(wldbg_protocols_load(paths, cache) == 3);
+	check_interfaces();
+	assert(wldbg_interfaces_lookup("other"));
+	release();
+
+	/* the user can give us any file */
+	snprintf(paths, sizeof paths, "%s/README", sub);
+	assert(wldbg_protocols_load(paths, NULL) == 0);
+	release();
+
+	wldbg_interfaces_release();
+
+	remove_file(sub, "test.xml");
+	remove_file(sub, "README");
+	remove_file(dir, "other.xml");
+	remove_file(dir, "cache/protocols");
+	snprintf(paths, sizeof paths, "%s/cache", dir);
+	rmdir(paths);
+	rmdir(sub);
+	rmdir(dir);
+}
@@ -0,0 +1,538 @@
+/*
+ * Throughput benchmark. A client floods the stand-in compositor
+ * with wl_surface requests (every frame callback is answered by
+ * the server) and we measure how fast the messages go through
+ * different wldbg pipelines.
+ *
+ * throughput-bench [--wldbg=PATH] [--iterations=N] [--runs=N]
+ *                  [--baseline=FILE [--save]] [--budget=PERCENT]
+ *                  [--verbose]
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+
+#include <wayland-client.h>
+
+#include "bench.h"
+
+/* flush after this many iterations, so that the requests
+ * always fit into libwayland-client's buffer */
+#define FLUSH_EVERY 32
+
+struct flood {
+	struct wl_compositor *compositor;
+	uint64_t frames_done;
+};
+
+static void
+frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+	struct flood *flood = data;
+
+	(void) time;
+
+	++flood->frames_done;
+	wl_callback_destroy(callback);
+}
+
+static const struct wl_callback_listener frame_listener = {
+	frame_done
+};
+
+static void
+registry_global(void *data, struct wl_registry *registry, uint32_t name,
+		const char *interface, uint32_t version)
+{
+	struct flood *flood = data;
+
+	(void) version;
+
+	if (strcmp(interface, "wl_compositor") == 0)
+		flood->compositor = wl_registry_bind(registry, name,
+						     &wl_compositor_interface,
+						     3);
+}
+
+static void
+registry_global_remove(void *data, struct wl_registry *registry,
+		       uint32_t name)
+{
+	(void) data;
+	(void) registry;
+	(void) name;
+}
+
+static const struct wl_registry_listener registry_listener = {
+	registry_global,
+	registry_global_remove
+};
+
+/* read and dispatch events, wait at most timeout ms for them */
+static int
+read_events(struct wl_display *display, short events, int timeout)
+{
+	struct pollfd pfd;
+
+	while (wl_display_prepare_read(display) != 0)
+		if (wl_display_dispatch_pending(display) < 0)
+			return -1;
+
+	pfd.fd = wl_display_get_fd(display);
+	pfd.events = events;
+
+	if (poll(&pfd, 1, timeout) < 0) {
+		wl_display_cancel_read(display);
+		return -1;
+	}
+
+	if (pfd.revents & POLLIN) {
+		if (wl_display_read_events(display) < 0)
+			return -1;
+	} else {
+		wl_display_cancel_read(display);
+	}
+
+	return wl_display_dispatch_pending(display);
+}
+
+static int
+flush_display(struct wl_display *display)
+{
+	while (wl_display_flush(display) < 0) {
+		if (errno != EAGAIN)
+			return -1;
+
+		/* the socket is full. Read the events meanwhile,
+		 * otherwise the other side could stall on us */
+		if (read_events(display, POLLIN | POLLOUT, -1) < 0)
+			return -1;
+	}
+
+	return read_events(display, POLLIN, 0);
+}
+
+static int
+run_client(int iterations, const char *result)
+{
+	struct wl_display *display;
+	struct wl_registry *registry;
+	struct wl_surface *surface;
+	struct wl_callback *callback;
+	struct flood flood;
+	uint64_t start, elapsed, messages, bytes;
+	FILE *f;
+	int i;
+
+	memset(&flood, 0, sizeof flood);
+
+	display = wl_display_connect(NULL);
+	if (!display) {
+		perror("Failed connecting to display");
+		return -1;
+	}
+
+	registry = wl_display_get_registry(display);
+	wl_registry_add_listener(registry, &registry_listener, &flood);
+	if (wl_display_roundtrip(display) < 0 || !flood.compositor) {
+		fprintf(stderr, "Failed binding wl_compositor\n");
+		goto err;
+	}
+
+	surface = wl_compositor_create_surface(flood.compositor);
+	if (wl_display_roundtrip(display) < 0)
+		goto err;
+
+	start = bench_time_ns();
+
+	for (i = 0; i < iterations; ++i) {
+		wl_surface_damage(surface, 0, 0, 64, 64);
+		callback = wl_surface_frame(surface);
+		wl_callback_add_listener(callback, &frame_listener, &flood);
+		wl_surface_commit(surface);
+
+		if ((i + 1) % FLUSH_EVERY == 0
+		    && flush_display(display) < 0)
+			goto err;
+	}
+
+	if (wl_display_roundtrip(display) < 0)
+		goto err;
+
+	elapsed = bench_time_ns() - start;
+
+	if (flood.frames_done != (uint64_t) iterations) {
+		fprintf(stderr, "Got %" PRIu64 " frame callbacks, "
+			"expected %d\n", flood.frames_done, iterations);
+		goto err;
+	}
+
+	/* damage + frame + commit and done + delete_id
+	 * for every iteration, sync + done + delete_id at the end */
+	messages = 5 * (uint64_t) iterations + 3;
+	bytes = (uint64_t) iterations * (BENCH_MESSAGE_SIZE(4)
+					 + BENCH_MESSAGE_SIZE(1)
+					 + BENCH_MESSAGE_SIZE(0)
+					 + 2 * BENCH_MESSAGE_SIZE(1))
+		+ 3 * BENCH_MESSAGE_SIZE(1);
+
+	/* write the result while we are still connected, wldbg
+	 * exits once we disconnect and the result must be there */
+	f = fopen(result, "w");
+	if (!f) {
+		perror("Opening result file");
+		goto err;
+	}
+
+	fprintf(f, "%d %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+		getpid(), messages, bytes, elapsed, bench_self_cpu_time());
+	fclose(f);
+
+	wl_surface_destroy(surface);
+	wl_compositor_destroy(flood.compositor);
+	wl_registry_destroy(registry);
+	wl_display_disconnect(display);
+
+	return 0;
+
+err:
+	wl_display_disconnect(display);
+	return -1;
+}
+
+struct pipeline {
+	const char *name;
+	/* run the client without wldbg */
+	int direct;
+	/* wldbg arguments before '-- PROGRAM' */
+	const char *args[6];
+	/* commands for interactive mode */
+	const char *input;
+};
+
+/* 'proxy' is wldbg without passes, it only keeps track of the objects */
+static const struct pipeline pipelines[] = {
+	{ "direct", 1, { NULL }, NULL },
+	{ "proxy", 0, { NULL }, NULL },
+	{ "dump", 0, { "dump", "no-output", NULL }, NULL },
+	{ "objinfo", 0, { "-g", "dump", "no-output", NULL }, NULL },
+	{ "interactive", 0, { "-i", NULL },
+	  "hide damage\nshowonly wl_surface\nc\n" },
+	{ NULL, 0, { NULL }, NULL }
+};
+
+struct result {
+	const char *name;
+	uint64_t messages;
+	uint64_t bytes;
+	uint64_t elapsed;
+	/* CPU time spent in wldbg */
+	uint64_t cpu;
+};
+
+struct bench {
+	const char *wldbg;
+	const char *baseline;
+	int iterations;
+	int runs;
+	double budget;
+	int save;
+	int verbose;
+
+	char result_path[256];
+	struct bench_server server;
+};
+
+static double
+messages_per_second(const struct result *res)
+{
+	return res->messages * 1e9 / res->elapsed;
+}
+
+static double
+cpu_per_message(const struct result *res)
+{
+	return (double) res->cpu / res->messages;
+}
+
+static int
+run_pipeline(struct bench *bench, const struct pipeline *pipeline,
+	     struct result *res)
+{
+	const char *argv[16];
+	char iterations[16];
+	uint64_t cpu;
+	int n = 0, i, client_pid, status;
+	uint64_t client_cpu;
+	pid_t pid;
+	FILE *f;
+
+	if (!pipeline->direct) {
+		argv[n++] = bench->wldbg;
+		for (i = 0; pipeline->args[i]; ++i)
+			argv[n++] = pipeline->args[i];
+		argv[n++] = "--";
+	}
+
+	snprintf(iterations, sizeof iterations, "%d", bench->iterations);
+	argv[n++] = bench_self_path();
+	argv[n++] = "client";
+	argv[n++] = iterations;
+	argv[n++] = bench->result_path;
+	argv[n] = NULL;
+
+	unlink(bench->result_path);
+	cpu = bench_children_cpu_time();
+
+	pid = bench_spawn(argv, pipeline->input, !bench->verbose);
+	if (pid < 0)
+		return -1;
+
+	status = bench_wait(pid);
+	if (status != 0) {
+		fprintf(stderr, "%s: '%s' failed (%d)\n", pipeline->name,
+			argv[0], status);
+		return -1;
+	}
+
+	f = fopen(bench->result_path, "r");
+	if (!f) {
+		fprintf(stderr, "%s: client did not finish\n", pipeline->name);
+		return -1;
+	}
+
+	if (fscanf(f, "%d %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64,
+		   &client_pid, &res->messages, &res->bytes,
+		   &res->elapsed, &client_cpu) != 5) {
+		fprintf(stderr, "%s: malformed result\n", pipeline->name);
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+
+	/* wldbg may have exited before it reaped the client.
+	 * We are the subreaper then, so wait for it, otherwise
+	 * its CPU time would not be accounted */
+	if (!pipeline->direct)
+		bench_wait(client_pid);
+
+	cpu = bench_children_cpu_time() - cpu;
+	res->cpu = cpu > client_cpu ? cpu - client_cpu : 0;
+	res->name = pipeline->name;
+
+	return 0;
+}
+
+static void
+print_result(const struct result *res)
+{
+	printf("%-12s %12.0f %10.2f %10.1f\n", res->name,
+	       messages_per_second(res),
+	       res->bytes * 1e9 / res->elapsed / (1024 * 1024),
+	       cpu_per_message(res));
+}
+
+static int
+save_baseline(struct bench *bench, struct result *results)
+{
+	struct result *res;
+	FILE *f;
+
+	f = fopen(bench->baseline, "w");
+	if (!f) {
+		perror("Opening baseline");
+		return -1;
+	}
+
+	fprintf(f, "# pipeline messages/s wldbg-cpu-ns/message\n");
+	for (res = results; res->name; ++res)
+		fprintf(f, "%s %.0f %.1f\n", res->name,
+			messages_per_second(res), cpu_per_message(res));
+
+	fclose(f);
+	printf("Baseline saved to '%s'\n", bench->baseline);
+
+	return 0;
+}
+
+static int
+check_baseline(struct bench *bench, struct result *results)
+{
+	char line[256], name[64];
+	double rate, cpu, budget = bench->budget / 100;
+	struct result *res;
+	int regressions = 0;
+	FILE *f;
+
+	f = fopen(bench->baseline, "r");
+	if (!f) {
+		printf("No baseline in '%s', run 'make bench-baseline' "
+		       "to create it\n", bench->baseline);
+		return 0;
+	}
+
+	while (fgets(line, sizeof line, f)) {
+		if (line[0] == '#')
+			continue;
+
+		if (sscanf(line, "%63s %lf %lf", name, &rate, &cpu) != 3)
+			continue;
+
+		for (res = results; res->name; ++res)
+			if (strcmp(res->name, name) == 0)
+				break;
+
+		if (!res->name)
+			continue;
+
+		if (messages_per_second(res) < rate * (1 - budget)) {
+			printf("REGRESSION: %s: %.0f messages/s, "
+			       "baseline %.0f\n", name,
+			       messages_per_second(res), rate);
+			++regressions;
+		}
+
+		/* the direct run has no wldbg CPU time */
+		if (cpu > 0 && cpu_per_message(res) > cpu * (1 + budget)) {
+			printf("REGRESSION: %s: %.1f ns CPU/message, "
+			       "baseline %.1f\n", name,
+			       cpu_per_message(res), cpu);
+			++regressions;
+		}
+	}
+
+	fclose(f);
+
+	if (regressions)
+		printf("%d regression(s) beyond %.0f%% budget\n",
+		       regressions, bench->budget);
+	else
+		printf("No regressions beyond %.0f%% budget\n",
+		       bench->budget);
+
+	return regressions ? -1 : 0;
+}
+
+static int
+parse_args(struct bench *bench, int argc, char *argv[])
+{
+	const char *val;
+	int i;
+
+	for (i = 1; i < argc; ++i) {
+		if ((val = bench_arg_value(argv[i], "--wldbg")))
+			bench->wldbg = val;
+		else if ((val = bench_arg_value(argv[i], "--baseline")))
+			bench->baseline = val;
+		else if ((val = bench_arg_value(argv[i], "--iterations")))
+			bench->iterations = atoi(val);
+		else if ((val = bench_arg_value(argv[i], "--runs")))
+			bench->runs = atoi(val);
+		else if ((val = bench_arg_value(argv[i], "--budget")))
+			bench->budget = atof(val);
+		else if (strcmp(argv[i], "--save") == 0)
+			bench->save = 1;
+		else if (strcmp(argv[i], "--verbose") == 0)
+			bench->verbose = 1;
+		else {
+			fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	if (bench->iterations <= 0 || bench->runs <= 0) {
+		fprintf(stderr, "Iterations and runs must be positive\n");
+		return -1;
+	}
+
+	if (bench->save && !bench->baseline) {
+		fprintf(stderr, "--save needs --baseline\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct result results[sizeof pipelines / sizeof *pipelines];
+	struct bench bench;
+	struct result res;
+	int i, r, ret = EXIT_SUCCESS;
+
+	if (argc == 4 && strcmp(argv[1], "client") == 0)
+		return run_client(atoi(argv[2]), argv[3]) < 0
+			? EXIT_FAILURE : EXIT_SUCCESS;
+
+	memset(&bench, 0, sizeof bench);
+	bench.wldbg = "wldbg";
+	bench.iterations = 100000;
+	bench.runs = 3;
+	bench.budget = 10;
+
+	if (parse_args(&bench, argc, argv) < 0)
+		return EXIT_FAILURE;
+
+	if (!bench_self_path())
+		return EXIT_FAILURE;
+
+	/* the clients spawned by wldbg are re-parented to us
+	 * if wldbg exits first, so we can account their CPU time */
+	if (prctl(PR_SET_CHILD_SUBREAPER, 1) < 0) {
+		perror("prctl");
+		return EXIT_FAILURE;
+	}
+
+	if (bench_server_start(&bench.server) < 0)
+		return EXIT_FAILURE;
+
+	snprintf(bench.result_path, sizeof bench.result_path,
+		 "%s/%s.result", getenv("XDG_RUNTIME_DIR"),
+		 bench.server.socket_name);
+
+	printf("%d iterations (%d messages), best of %d runs\n\n",
+	       bench.iterations, 5 * bench.iterations + 3, bench.runs);
+	printf("%-12s %12s %10s %10s\n", "pipeline", "messages/s",
+	       "MiB/s", "CPU ns/msg");
+
+	memset(results, 0, sizeof results);
+	for (i = 0; pipelines[i].name; ++i) {
+		for (r = 0; r < bench.runs; ++r) {
+			if (run_pipeline(&bench, &pipelines[i], &res) < 0) {
+				ret = EXIT_FAILURE;
+				goto out;
+			}
+
+			if (!results[i].name
+			    || res.elapsed < results[i].elapsed)
+				results[i] = res;
+		}
+
+		print_result(&results[i]);
+	}
+
+	putchar('\n');
+
+	if (bench.save) {
+		if (save_baseline(&bench, results) < 0)
+			ret = EXIT_FAILURE;
+	} else if (bench.baseline) {
+		if (check_baseline(&bench, results) < 0)
+			ret = EXIT_FAILURE;
+	}
+
+out:
+	unlink(bench.result_path);
+	bench_server_stop(&bench.server);
+
+	return ret;
+}
@@ -0,0 +1,292 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "wldbg-trace.h"
+#include "test-runner.h"
+
+#define RECORDS 10000
+
+static const char *interfaces[] = { "wl_pointer", "wl_surface", NULL };
+
+static void
+make_record(unsigned int i, struct wldbg_trace_record *rec, uint32_t *data)
+{
+	unsigned int j, words = 2 + i % 7;
+
+	memset(rec, 0, sizeof *rec);
+	rec->time = 1000 + 10 * (uint64_t) i;
+	rec->connection = 1 + i % 2;
+	rec->from = i % 3 == 1;
+	rec->fd_count = i % 5 == 0;
+
+	data[0] = 3 + i % 3;
+	data[1] = words * 4 << 16 | i % 3;
+	for (j = 2; j < words; ++j)
+		data[j] = i * j;
+
+	rec->data = data;
+	rec->size = words * 4;
+}
+
+static int
+create_trace(char *path, uint32_t flags)
+{
+	struct wldbg_trace_writer *writer;
+	struct wldbg_trace_record rec;
+	uint32_t data[16];
+	unsigned int i;
+	int fd;
+
+	fd = mkstemp(path);
+	assert(fd >= 0);
+
+	writer = wldbg_trace_writer_create(fd, flags);
+	assert(writer);
+
+	for (i = 0; i < RECORDS; ++i) {
+		make_record(i, &rec, data);
+		assert(wldbg_trace_writer_add(writer, &rec, interfaces[i % 3],
+					      data[1] & 0xffff) == 0);
+	}
+
+	assert(wldbg_trace_writer_finish(writer) == 0);
+	return fd;
+}
+
+/* read the records from the cursor and compare them with what we wrote */
+static unsigned int
+check_records(struct wldbg_trace_cursor *cursor, unsigned int i)
+{
+	struct wldbg_trace_record rec, expected;
+	uint32_t data[16];
+	int ret;
+
+	while ((ret = wldbg_trace_next(cursor, &rec)) == 1) {
+		make_record(i, &expected, data);
+		assert(rec.seq == i);
+		assert(rec.time == expected.time);
+		assert(rec.connection == expected.connection);
+		assert(rec.from == expected.from);
+		assert(rec.fd_count == expected.fd_count);
+		assert(rec.size == expected.size);
+		assert(memcmp(rec.data, data, rec.size) == 0);
+		++i;
+	}
+
+	assert(ret == 0);
+	return i;
+}
+
+static void
+check_write_read(uint32_t flags)
+{
+	char path[] = "/tmp/wldbg-trace-test-XXXXXX";
+	struct wldbg_trace *trace;
+	struct wldbg_trace_cursor cursor;
+	const struct wldbg_trace_block_entry *block;
+	const uint32_t *blocks;
+	unsigned int count, i;
+	int fd;
+
+	memset(&cursor, 0, sizeof cursor);
+	fd = create_trace(path, flags);
+
+	trace = wldbg_trace_open(path);
+	assert(trace);
+	assert(wldbg_trace_record_count(trace) == RECORDS);
+	assert(wldbg_trace_block_count(trace) > 1);
+
+	assert(wldbg_trace_seek(&cursor, trace, 0) == 0);
+	assert(check_records(&cursor, 0) == RECORDS);
+
+	/* start in the middle */
+	block = wldbg_trace_get_block(trace, 1);
+	assert(block && block->first_seq > 0);
+	assert(wldbg_trace_seek(&cursor, trace, 1) == 0);
+	assert(check_records(&cursor, block->first_seq) == RECORDS);
+
+	/* find by time */
+	assert(wldbg_trace_find_time(trace, 0) == 0);
+	assert(wldbg_trace_find_time(trace, 1000 + 10 * RECORDS)
+	       == wldbg_trace_block_count(trace));
+	i = wldbg_trace_find_time(trace, 1000 + 10 * 7777);
+	block = wldbg_trace_get_block(trace, i);
+	assert(block->first_seq <= 7777);
+	assert(block->first_seq + block->count > 7777);
+
+	/* find by messages, wl_pointer.2 is only in the records
+	 * where i % 3 == 0 and i % 3 == 2, that is never */
+	assert(wldbg_trace_find_message(trace, "wl_pointer", 0, 2,
+					&count) == NULL);
+	assert(count == 0);
+	assert(wldbg_trace_find_message(trace, "wl_keyboard", 0, 0,
+					&count) == NULL);
+
+	blocks = wldbg_trace_find_message(trace, "wl_surface", 1, 1, &count);
+	assert(blocks && count == wldbg_trace_block_count(trace));
+	for (i = 0; i < count; ++i)
+		assert(blocks[i] == i);
+
+	wldbg_trace_cursor_release(&cursor);
+	wldbg_trace_close(trace);
+	close(fd);
+	unlink(path);
+}
+
+TEST(trace_write_read)
+{
+	check_write_read(0);
+}
+
+TEST(trace_write_read_compressed)
+{
+	check_write_read(WLDBG_TRACE_COMPRESS);
+}
+
+/* pointer motion and frame events, what long traces are made of */
+static uint64_t
+motion_trace_size(uint32_t flags)
+{
+	char path[] = "/tmp/wldbg-trace-test-XXXXXX";
+	struct wldbg_trace_writer *writer;
+	struct wldbg_trace_record rec;
+	uint32_t data[5];
+	uint64_t time = 1000000, size;
+	unsigned int i;
+	int fd;
+
+	fd = mkstemp(path);
+	assert(fd >= 0);
+
+	writer = wldbg_trace_writer_create(fd, flags);
+	assert(writer);
+
+	memset(&rec, 0, sizeof rec);
+	rec.connection = 1;
+	rec.from = 0;
+	rec.data = data;
+
+	for (i = 0; i < RECORDS; ++i) {
+		data[0] = 12;
+		if (i % 2 == 0) {
+			/* about 8 ms between the events */
+			time += 8000000 + i * 7919 % 1000000;
+			data[1] = 20 << 16 | 2;
+			data[2] = time / 1000000;
+			data[3] = (100 + i / 2 % 300) * 256;
+			data[4] = (200 + i / 2 % 200) * 256;
+			rec.size = 20;
+		} else {
+			data[1] = 8 << 16 | 5;
+			rec.size = 8;
+		}
+
+		rec.time = time;
+		assert(wldbg_trace_writer_add(writer, &rec, "wl_pointer",
+					      data[1] & 0xffff) == 0);
+	}
+
+	assert(wldbg_trace_writer_finish(writer) == 0);
+
+	size = lseek(fd, 0, SEEK_END);
+	close(fd);
+	unlink(path);
+
+	return size;
+}
+
+TEST(trace_compressed_size)
+{
+	char path[] = "/tmp/wldbg-trace-test-XXXXXX";
+	struct wldbg_trace *trace;
+	struct wldbg_trace_block_header header;
+	const struct wldbg_trace_block_entry *block;
+	int fd;
+
+	assert(motion_trace_size(WLDBG_TRACE_COMPRESS) * 5
+	       < motion_trace_size(0));
+
+	fd = create_trace(path, WLDBG_TRACE_COMPRESS);
+	trace = wldbg_trace_open(path);
+	assert(trace);
+	block = wldbg_trace_get_block(trace, 0);
+	assert(pread(fd, &header, sizeof header, block->offset)
+	       == sizeof header);
+	assert(header.flags == (WLDBG_TRACE_BLOCK_DELTA | WLDBG_TRACE_BLOCK_LZ));
+	assert(header.size == block->size);
+	wldbg_trace_close(trace);
+
+	close(fd);
+	unlink(path);
+}
+
+static void
+check_without_index(uint32_t flags)
+{
+	char path[] = "/tmp/wldbg-trace-test-XXXXXX";
+	struct wldbg_trace *trace;
+	struct wldbg_trace_cursor cursor;
+	unsigned int count, blocks;
+	uint64_t records, last;
+	int fd;
+
+	memset(&cursor, 0, sizeof cursor);
+	fd = create_trace(path, flags);
+
+	trace = wldbg_trace_open(path);
+	assert(trace);
+	blocks = wldbg_trace_block_count(trace);
+	last = wldbg_trace_get_block(trace, blocks - 1)->offset;
+	wldbg_trace_close(trace);
+
+	/* wldbg was killed while writing the last block */
+	assert(ftruncate(fd, last + 100) == 0);
+
+	trace = wldbg_trace_open(path);
+	assert(trace);
+	assert(wldbg_trace_block_count(trace) == blocks - 1);
+	records = wldbg_trace_record_count(trace);
+	assert(records == wldbg_trace_get_block(trace, blocks - 2)->first_seq
+			  + wldbg_trace_get_block(trace, blocks - 2)->count);
+
+	assert(wldbg_trace_seek(&cursor, trace, 0) == 0);
+	assert(check_records(&cursor, 0) == records);
+
+	assert(wldbg_trace_find_time(trace, 1000) == 0);
+	assert(wldbg_trace_find_message(trace, "wl_surface", 1, 1,
+					&count) == NULL);
+
+	wldbg_trace_cursor_release(&cursor);
+	wldbg_trace_close(trace);
+	close(fd);
+	unlink(path);
+}
+
+TEST(trace_without_index)
+{
+	check_without_index(0);
+}
+
+TEST(trace_without_index_compressed)
+{
+	check_without_index(WLDBG_TRACE_COMPRESS);
+}
+
+TEST(trace_not_a_trace)
+{
+	char path[] = "/tmp/wldbg-trace-test-XXXXXX";
+	int fd;
+
+	fd = mkstemp(path);
+	assert(fd >= 0);
+	assert(write(fd, "WLDBGTRCgarbage", 15) == 15);
+
+	assert(wldbg_trace_open(path) == NULL);
+	assert(wldbg_trace_open("/nonexistent/trace") == NULL);
+
+	close(fd);
+	unlink(path);
+}
@@ -0,0 +1,95 @@
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "wayland/wayland-private.h"
+#include "test-runner.h"
+#include "util.h"
+
+TEST(watermarks_values)
+{
+	size_t high, low;
+
+	assert(buffer_watermarks(4096, 1024 * 1024, &high, &low) == 0);
+	assert(high == 1024 * 1024 - 4096);
+	assert(low == 1024 * 1024 / 8);
+
+	assert(buffer_watermarks(4096, 8192, &high, &low) == 0);
+	assert(high == 4096 && low == 1024);
+
+	/* no room for queueing */
+	assert(buffer_watermarks(4096, 4096, &high, &low) < 0);
+	assert(buffer_watermarks(8192, 8191, &high, &low) < 0);
+	assert(buffer_watermarks(0, 8192, &high, &low) < 0);
+}
+
+/* fill the socket, so that everything written
+ * into the connection stays queued */
+static void
+fill_socket(int fd)
+{
+	char buf[4096];
+
+	memset(buf, 0, sizeof buf);
+	while (write(fd, buf, sizeof buf) > 0)
+		;
+
+	assert(errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+/* queue data up to just under the high watermark, as if wldbg kept
+ * reading, and then one more read of the whole buffer must fit */
+static void
+queue_to_watermark(size_t size, size_t max_size)
+{
+	struct wl_connection *conn;
+	uint32_t data[1024];
+	size_t high, low, chunk;
+	int fds[2];
+
+	size = wl_connection_round_buffer_size(size);
+	max_size = wl_connection_round_buffer_size(max_size);
+	assert(buffer_watermarks(size, max_size, &high, &low) == 0);
+
+	assert(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+	fill_socket(fds[0]);
+
+	conn = wl_connection_create(fds[0]);
+	assert(conn);
+	assert(wl_connection_set_buffer_size(conn, size, max_size) == 0);
+
+	memset(data, 0, sizeof data);
+	while (wl_connection_pending_output(conn) + sizeof(uint32_t) < high) {
+		chunk = high - sizeof(uint32_t)
+			- wl_connection_pending_output(conn);
+		if (chunk > sizeof data)
+			chunk = sizeof data;
+
+		assert(wl_connection_write(conn, data, chunk) == 0);
+	}
+
+	/* what one read from the other side can bring */
+	for (chunk = 0; chunk < size; chunk += sizeof data)
+		assert(wl_connection_write(conn, data, sizeof data) == 0);
+
+	/* and it was the last one that fits */
+	assert(wl_connection_pending_output(conn)
+		== max_size - sizeof(uint32_t));
+	assert(wl_connection_write(conn, data, 2 * sizeof(uint32_t)) < 0);
+	assert(errno == E2BIG);
+
+	/* closes fds[0] */
+	wl_connection_destroy(conn);
+	close(fds[1]);
+}
+
+TEST(watermarks_one_more_read)
+{
+	queue_to_watermark(4096, 1024 * 1024);
+	queue_to_watermark(4096, 8192);
+	queue_to_watermark(64 * 1024, 128 * 1024);
+	/* the sizes are rounded up */
+	queue_to_watermark(5000, 12000);
+}
@@ -0,0 +1,158 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "wldbg-writer.h"
+#include "test-runner.h"
+
+/* glibc keeps memory of finished threads for the next threads,
+ * which looks like a leak to the test runner */
+extern int leak_check_enabled;
+
+/* fill the pipe, so that the writer blocks until we read it */
+static size_t
+fill_pipe(int fd)
+{
+	char buf[4096];
+	size_t size = 0;
+	ssize_t ret;
+
+	memset(buf, 'x', sizeof buf);
+
+	assert(fcntl(fd, F_SETFL, O_NONBLOCK) == 0);
+	while ((ret = write(fd, buf, sizeof buf)) > 0)
+		size += ret;
+	assert(fcntl(fd, F_SETFL, 0) == 0);
+
+	return size;
+}
+
+static void
+read_all(int fd, char *buf, size_t size)
+{
+	ssize_t ret;
+
+	while (size > 0) {
+		ret = read(fd, buf, size);
+		assert(ret > 0);
+		buf += ret;
+		size -= ret;
+	}
+}
+
+TEST(output_printf)
+{
+	struct wldbg_output out;
+	char line[1000];
+	int i;
+
+	memset(&out, 0, sizeof out);
+	memset(line, 'a', sizeof line - 1);
+	line[sizeof line - 1] = '\0';
+
+	for (i = 0; i < 10; ++i)
+		assert(wldbg_output_printf(&out, "%d%s", i, line) == 0);
+	assert(wldbg_output_putc(&out, '\n') == 0);
+	assert(wldbg_output_append(&out, "end", 3) == 0);
+
+	assert(out.size == 10 * 1000 + 4);
+	assert(out.data[0] == '0' && out.data[1000] == '1');
+	assert(memcmp(out.data + out.size - 4, "\nend", 4) == 0);
+
+	wldbg_output_release(&out);
+}
+
+TEST(writer_write)
+{
+	struct wldbg_writer *writer;
+	struct wldbg_output out;
+	char buf[64];
+	int fds[2];
+
+	leak_check_enabled = 0;
+
+	assert(pipe(fds) == 0);
+	memset(&out, 0, sizeof out);
+
+	writer = wldbg_writer_create(fds[1], 1024);
+	assert(writer);
+
+	wldbg_output_printf(&out, "one\n");
+	assert(wldbg_writer_write(writer, &out) == 0);
+	assert(out.size == 0);
+	wldbg_output_printf(&out, "two\n");
+	assert(wldbg_writer_write(writer, &out) == 0);
+	/* nothing to write */
+	assert(wldbg_writer_write(writer, &out) == 0);
+
+	wldbg_writer_flush(writer);
+	read_all(fds[0], buf, 8);
+	assert(memcmp(buf, "one\ntwo\n", 8) == 0);
+	assert(wldbg_writer_dropped(writer) == 0);
+
+	wldbg_writer_destroy(writer);
+	wldbg_output_release(&out);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+TEST(writer_drop)
+{
+	struct wldbg_writer *writer;
+	struct wldbg_output out;
+	char buf[4096];
+	const char *expected = "a\n[wldbg: 4 lines dropped]\nd\n";
+	size_t filled;
+	int fds[2];
+
+	leak_check_enabled = 0;
+
+	assert(pipe(fds) == 0);
+	memset(&out, 0, sizeof out);
+
+	filled = fill_pipe(fds[1]);
+	writer = wldbg_writer_create(fds[1], 4);
+	assert(writer);
+
+	/* the writer is stuck with this one */
+	wldbg_output_printf(&out, "a\n");
+	assert(wldbg_writer_write(writer, &out) == 0);
+
+	/* these do not fit in */
+	wldbg_output_printf(&out, "bb\nbb\n");
+	assert(wldbg_writer_write(writer, &out) == -1);
+	assert(out.size == 0);
+	wldbg_output_printf(&out, "c\n");
+	wldbg_output_printf(&out, "c\n");
+	assert(wldbg_writer_write(writer, &out) == -1);
+	assert(wldbg_writer_dropped(writer) == 4);
+
+	while (filled > 0) {
+		read_all(fds[0], buf, filled > sizeof buf ? sizeof buf : filled);
+		filled -= filled > sizeof buf ? sizeof buf : filled;
+	}
+
+	wldbg_writer_flush(writer);
+	wldbg_output_printf(&out, "d\n");
+	assert(wldbg_writer_write(writer, &out) == 0);
+	wldbg_writer_flush(writer);
+
+	read_all(fds[0], buf, strlen(expected));
+	assert(memcmp(buf, expected, strlen(expected)) == 0);
+
+	/* bigger than the writer can hold, dropped after
+	 * the last write, so printed on destroy */
+	wldbg_output_printf(&out, "eeeeee\nf\n");
+	assert(wldbg_writer_write(writer, &out) == -1);
+	assert(wldbg_writer_dropped(writer) == 6);
+
+	wldbg_writer_destroy(writer);
+	read_all(fds[0], buf, strlen("[wldbg: 2 lines dropped]\n"));
+	assert(memcmp(buf, "[wldbg: 2 lines dropped]\n",
+		      strlen("[wldbg: 2 lines dropped]\n")) == 0);
+
+	wldbg_output_release(&out);
+	close(fds[0]);
+	close(fds[1]);
+}
@@ -43,12 +43,19 @@
 
 #define DIV_ROUNDUP(n, a) ( ((n) + ((a) - 1)) / (a) )
 
+/*
+ * The buffers start with 4096 bytes and can grow up to the maximal size
+ * (both are powers of two). The buffers for fds have fixed size.
+ */
 struct wl_buffer {
-	char data[4096];
+	char *data;
 	uint32_t head, tail;
+	uint32_t size_bits;
+	uint32_t max_size_bits;
 };
 
-#define MASK(i) ((i) & 4095)
+#define DEFAULT_BUFFER_BITS	12
+#define FDS_BUFFER_SIZE		(1 << DEFAULT_BUFFER_BITS)
 
 #define MAX_FDS_OUT	28
 #define CLEN		(CMSG_LEN(MAX_FDS_OUT * sizeof(int32_t)))
@@ -60,23 +67,89 @@ struct wl_connection {
 	int want_flush;
 };
 
+static inline uint32_t
+wl_buffer_capacity(const struct wl_buffer *b)
+{
+	return 1U << b->size_bits;
+}
+
+static inline uint32_t
+wl_buffer_mask(const struct wl_buffer *b, uint32_t i)
+{
+	return i & (wl_buffer_capacity(b) - 1);
+}
+
+static uint32_t
+wl_buffer_size(struct wl_buffer *b)
+{
+	return b->head - b->tail;
+}
+
 static int
-wl_buffer_put(struct wl_buffer *b, const void *data, size_t count)
+wl_buffer_init(struct wl_buffer *b, uint32_t size_bits)
 {
-	uint32_t head, size;
+	b->data = malloc(1U << size_bits);
+	if (!b->data)
+		return -1;
+
+	b->head = b->tail = 0;
+	b->size_bits = b->max_size_bits = size_bits;
 
-	if (count > sizeof(b->data)) {
-		wl_log("Data too big for buffer (%d > %d).\n",
-		       count, sizeof(b->data));
+	return 0;
+}
+
+static void wl_buffer_copy(struct wl_buffer *b, void *data, size_t count);
+
+/* make room for count more bytes, grow the buffer if needed */
+static int
+wl_buffer_ensure_space(struct wl_buffer *b, size_t count)
+{
+	uint32_t size = wl_buffer_size(b), bits;
+	char *data;
+
+	if (size + count <= wl_buffer_capacity(b))
+		return 0;
+
+	bits = b->size_bits;
+	while (bits < b->max_size_bits && (1UL << bits) < size + count)
+		++bits;
+
+	if ((1UL << bits) < size + count) {
+		wl_log("Data too big for buffer (%d + %d > %d).\n",
+		       size, count, 1U << b->max_size_bits);
 		errno = E2BIG;
 		return -1;
 	}
 
-	head = MASK(b->head);
-	if (head + count <= sizeof b->data) {
+	data = malloc(1U << bits);
+	if (!data)
+		return -1;
+
+	/* the data start at the beginning of the new buffer */
+	wl_buffer_copy(b, data, size);
+	free(b->data);
+
+	b->data = data;
+	b->size_bits = bits;
+	b->tail = 0;
+	b->head = size;
+
+	return 0;
+}
+
+static int
+wl_buffer_put(struct wl_buffer *b, const void *data, size_t count)
+{
+	uint32_t head, size;
+
+	if (wl_buffer_ensure_space(b, count) < 0)
+		return -1;
+
+	head = wl_buffer_mask(b, b->head);
+	if (head + count <= wl_buffer_capacity(b)) {
 		memcpy(b->data + head, data, count);
 	} else {
-		size = sizeof b->data - head;
+		size = wl_buffer_capacity(b) - head;
 		memcpy(b->data + head, data, size);
 		memcpy(b->data, (const char *) data + size, count - size);
 	}
@@ -91,19 +164,19 @@ wl_buffer_put_iov(struct wl_buffer *b, struct iovec *iov, int *count)
 {
 	uint32_t head, tail;
 
-	head = MASK(b->head);
-	tail = MASK(b->tail);
+	head = wl_buffer_mask(b, b->head);
+	tail = wl_buffer_mask(b, b->tail);
 	if (head < tail) {
 		iov[0].iov_base = b->data + head;
 		iov[0].iov_len = tail - head;
 		*count = 1;
 	} else if (tail == 0) {
 		iov[0].iov_base = b->data + head;
-		iov[0].iov_len = sizeof b->data - head;
+		iov[0].iov_len = wl_buffer_capacity(b) - head;
 		*count = 1;
 	} else {
 		iov[0].iov_base = b->data + head;
-		iov[0].iov_len = sizeof b->data - head;
+		iov[0].iov_len = wl_buffer_capacity(b) - head;
 		iov[1].iov_base = b->data;
 		iov[1].iov_len = tail;
 		*count = 2;
@@ -115,19 +188,19 @@ wl_buffer_get_iov(struct wl_buffer *b, struct iovec *iov, int *count)
 {
 	uint32_t head, tail;
 
-	head = MASK(b->head);
-	tail = MASK(b->tail);
+	head = wl_buffer_mask(b, b->head);
+	tail = wl_buffer_mask(b, b->tail);
 	if (tail < head) {
 		iov[0].iov_base = b->data + tail;
 		iov[0].iov_len = head - tail;
 		*count = 1;
 	} else if (head == 0) {
 		iov[0].iov_base = b->data + tail;
-		iov[0].iov_len = sizeof b->data - tail;
+		iov[0].iov_len = wl_buffer_capacity(b) - tail;
 		*count = 1;
 	} else {
 		iov[0].iov_base = b->data + tail;
-		iov[0].iov_len = sizeof b->data - tail;
+		iov[0].iov_len = wl_buffer_capacity(b) - tail;
 		iov[1].iov_base = b->data;
 		iov[1].iov_len = head;
 		*count = 2;
@@ -139,22 +212,16 @@ wl_buffer_copy(struct wl_buffer *b, void *data, size_t count)
 {
 	uint32_t tail, size;
 
-	tail = MASK(b->tail);
-	if (tail + count <= sizeof b->data) {
+	tail = wl_buffer_mask(b, b->tail);
+	if (tail + count <= wl_buffer_capacity(b)) {
 		memcpy(data, b->data + tail, count);
 	} else {
-		size = sizeof b->data - tail;
+		size = wl_buffer_capacity(b) - tail;
 		memcpy(data, b->data + tail, size);
 		memcpy((char *) data + size, b->data, count - size);
 	}
 }
 
-static uint32_t
-wl_buffer_size(struct wl_buffer *b)
-{
-	return b->head - b->tail;
-}
-
 struct wl_connection *
 wl_connection_create(int fd)
 {
@@ -164,15 +231,89 @@ wl_connection_create(int fd)
 	if (connection == NULL)
 		return NULL;
 	memset(connection, 0, sizeof *connection);
+
+	if (wl_buffer_init(&connection->in, DEFAULT_BUFFER_BITS) < 0
+	    || wl_buffer_init(&connection->out, DEFAULT_BUFFER_BITS) < 0
+	    || wl_buffer_init(&connection->fds_in, DEFAULT_BUFFER_BITS) < 0
+	    || wl_buffer_init(&connection->fds_out, DEFAULT_BUFFER_BITS) < 0) {
+		free(connection->in.data);
+		free(connection->out.data);
+		free(connection->fds_in.data);
+		free(connection->fds_out.data);
+		free(connection);
+		return NULL;
+	}
+
 	connection->fd = fd;
 
 	return connection;
 }
 
+static uint32_t
+size_to_bits(size_t size)
+{
+	uint32_t bits = DEFAULT_BUFFER_BITS;
+
+	while (bits < 31 && (1UL << bits) < size)
+		++bits;
+
+	return bits;
+}
+
+/* the size that the buffers really have when we ask for size */
+size_t
+wl_connection_round_buffer_size(size_t size)
+{
+	return 1UL << size_to_bits(size);
+}
+
+/*
+ * Set the size of the input and output buffers of the connection
+ * and the size up to which they can grow. The sizes are rounded up
+ * to powers of two. Data in the buffers are kept.
+ */
+int
+wl_connection_set_buffer_size(struct wl_connection *connection,
+			      size_t size, size_t max_size)
+{
+	uint32_t bits = size_to_bits(size);
+	uint32_t max_bits = size_to_bits(max_size);
+
+	if (max_bits < bits)
+		max_bits = bits;
+
+	connection->in.max_size_bits = max_bits;
+	connection->out.max_size_bits = max_bits;
+
+	if (wl_buffer_capacity(&connection->in) < (1U << bits)
+	    && wl_buffer_ensure_space(&connection->in,
+				      (1U << bits) - wl_buffer_size(&connection->in)) < 0)
+		return -1;
+
+	if (wl_buffer_capacity(&connection->out) < (1U << bits)
+	    && wl_buffer_ensure_space(&connection->out,
+				      (1U << bits) - wl_buffer_size(&connection->out)) < 0)
+		return -1;
+
+	return 0;
+}
+
+size_t
+wl_connection_buffer_size(struct wl_connection *connection)
+{
+	return wl_buffer_capacity(&connection->in);
+}
+
+size_t
+wl_connection_pending_output(struct wl_connection *connection)
+{
+	return wl_buffer_size(&connection->out);
+}
+
 static void
 close_fds(struct wl_buffer *buffer, int max)
 {
-	int32_t fds[sizeof(buffer->data) / sizeof(int32_t)], i, count;
+	int32_t fds[FDS_BUFFER_SIZE / sizeof(int32_t)], i, count;
 	size_t size;
 
 	size = buffer->head - buffer->tail;
@@ -194,9 +335,19 @@ wl_connection_destroy(struct wl_connection *connection)
 	close_fds(&connection->fds_out, -1);
 	close_fds(&connection->fds_in, -1);
 	close(connection->fd);
+	free(connection->in.data);
+	free(connection->out.data);
+	free(connection->fds_in.data);
+	free(connection->fds_out.data);
 	free(connection);
 }
 
+void
+wl_connection_close_fds_in(struct wl_connection *connection, int max)
+{
+	close_fds(&connection->fds_in, max);
+}
+
 void
 wl_connection_copy(struct wl_connection *connection, void *data, size_t size)
 {
@@ -245,7 +396,7 @@ decode_cmsg(struct wl_buffer *buffer, struct msghdr *msg)
 			continue;
 
 		size = cmsg->cmsg_len - CMSG_LEN(0);
-		max = sizeof(buffer->data) - wl_buffer_size(buffer);
+		max = wl_buffer_capacity(buffer) - wl_buffer_size(buffer);
 		if (size > max || overflow) {
 			overflow = 1;
 			size /= sizeof(int32_t);
@@ -316,7 +467,10 @@ wl_connection_read(struct wl_connection *connection)
 	char cmsg[CLEN];
 	int len, count, ret;
 
-	if (wl_buffer_size(&connection->in) >= sizeof(connection->in.data)) {
+	/* the buffer is full, but we may not have a whole message yet */
+	if (wl_buffer_size(&connection->in)
+	    >= wl_buffer_capacity(&connection->in)
+	    && wl_buffer_ensure_space(&connection->in, 1) < 0) {
 		errno = EOVERFLOW;
 		return -1;
 	}
@@ -351,10 +505,12 @@ int
 wl_connection_write(struct wl_connection *connection,
 		    const void *data, size_t count)
 {
-	if (connection->out.head - connection->out.tail +
-	    count > ARRAY_LENGTH(connection->out.data)) {
+	/* if the data do not fit, try to make room by flushing.
+	 * If the socket is full, the buffer grows */
+	if (wl_buffer_size(&connection->out) + count
+	    > wl_buffer_capacity(&connection->out)) {
 		connection->want_flush = 1;
-		if (wl_connection_flush(connection) < 0)
+		if (wl_connection_flush(connection) < 0 && errno != EAGAIN)
 			return -1;
 	}
 
@@ -370,10 +526,12 @@ int
 wl_connection_queue(struct wl_connection *connection,
 		    const void *data, size_t count)
 {
-	if (connection->out.head - connection->out.tail +
-	    count > ARRAY_LENGTH(connection->out.data)) {
+	/* if the data do not fit, try to make room by flushing.
+	 * If the socket is full, the buffer grows */
+	if (wl_buffer_size(&connection->out) + count
+	    > wl_buffer_capacity(&connection->out)) {
 		connection->want_flush = 1;
-		if (wl_connection_flush(connection) < 0)
+		if (wl_connection_flush(connection) < 0 && errno != EAGAIN)
 			return -1;
 	}
 
@@ -393,7 +551,7 @@ wl_message_count_arrays(const struct wl_message *message)
 	return arrays;
 }
 
-static int
+int
 wl_connection_put_fd(struct wl_connection *connection, int32_t fd)
 {
 	if (wl_buffer_size(&connection->fds_out) == MAX_FDS_OUT * sizeof fd) {
@@ -413,7 +571,7 @@ int
 wl_connection_copy_fds(struct wl_connection *conn1, struct wl_connection *conn2)
 {
 	uint32_t size = wl_buffer_size(&conn1->fds_in);
-	void *data = conn1->fds_in.data;
+	int32_t fds[FDS_BUFFER_SIZE / sizeof(int32_t)];
 	int ret;
 
 	if (size == 0)
@@ -422,14 +580,14 @@ wl_connection_copy_fds(struct wl_connection *conn1, struct wl_connection *conn2)
 	if (size + wl_buffer_size(&conn2->fds_out)
 		>= MAX_FDS_OUT * sizeof(int32_t)) {
 		conn2->want_flush = 1;
-		if (wl_connection_flush(conn2) < 0)
+		if (wl_connection_flush(conn2) < 0 && errno != EAGAIN)
 			return -1;
 	}
 
 
 	/* copy fds from conn1 to conn2 */
-	ret = wl_buffer_put(&conn2->fds_out,
-			    ((char *) data) + conn1->fds_in.tail, size);
+	wl_buffer_copy(&conn1->fds_in, fds, size);
+	ret = wl_buffer_put(&conn2->fds_out, fds, size);
 
 	/* remove copied fds from conn1 */
 	conn1->fds_in.tail += size;
@@ -437,6 +595,130 @@ wl_connection_copy_fds(struct wl_connection *conn1, struct wl_connection *conn2)
 	return ret;
 }
 
+/*
+ * Get pointer to size bytes of input data that start offset bytes
+ * from the beginning of the input buffer. If the data wrap around
+ * the end of the ring buffer, they are copied into buf, which must
+ * be big enough to hold them.
+ */
+void *
+wl_connection_get_data(struct wl_connection *connection,
+		       size_t offset, size_t size, void *buf)
+{
+	struct wl_buffer *b = &connection->in;
+	uint32_t tail, part;
+
+	tail = wl_buffer_mask(b, b->tail + offset);
+	if (tail + size <= wl_buffer_capacity(b))
+		return b->data + tail;
+
+	part = wl_buffer_capacity(b) - tail;
+	memcpy(buf, b->data + tail, part);
+	memcpy((char *) buf + part, b->data, size - part);
+
+	return buf;
+}
+
+/* move size bytes from input buffer of conn1 to output buffer of conn2 */
+static int
+forward_copy(struct wl_connection *conn1, struct wl_connection *conn2,
+	     size_t size)
+{
+	uint32_t tail, chunk;
+	int ret;
+
+	while (size > 0) {
+		tail = wl_buffer_mask(&conn1->in, conn1->in.tail);
+		chunk = wl_buffer_capacity(&conn1->in) - tail;
+		if (chunk > size)
+			chunk = size;
+
+		if (wl_connection_write(conn2, conn1->in.data + tail, chunk) < 0)
+			return -1;
+
+		conn1->in.tail += chunk;
+		size -= chunk;
+	}
+
+	ret = wl_connection_flush(conn2);
+	/* the rest stays queued until the socket is writable */
+	if (ret < 0 && errno == EAGAIN)
+		return 0;
+
+	return ret;
+}
+
+/*
+ * Send size bytes from the input buffer of conn1 directly to the socket
+ * of conn2 (together with fds queued in conn2), without copying them
+ * into the output buffer of conn2. What the socket does not take
+ * is queued into the output buffer and stays there until the caller
+ * flushes it again (EAGAIN is not an error here).
+ * The data are consumed from conn1.
+ */
+int
+wl_connection_forward(struct wl_connection *conn1,
+		      struct wl_connection *conn2, size_t size)
+{
+	struct iovec iov[2];
+	struct msghdr msg;
+	char cmsg[CLEN];
+	int len, count, clen;
+	uint32_t tail, first;
+
+	/* something is queued already, keep the order of data. The same
+	 * if we have more fds than can go in one message */
+	if (wl_buffer_size(&conn2->out) > 0
+	    || wl_buffer_size(&conn2->fds_out) > MAX_FDS_OUT * sizeof(int32_t))
+		return forward_copy(conn1, conn2, size);
+
+	tail = wl_buffer_mask(&conn1->in, conn1->in.tail);
+	first = wl_buffer_capacity(&conn1->in) - tail;
+
+	iov[0].iov_base = conn1->in.data + tail;
+	if (size <= first) {
+		iov[0].iov_len = size;
+		count = 1;
+	} else {
+		iov[0].iov_len = first;
+		iov[1].iov_base = conn1->in.data;
+		iov[1].iov_len = size - first;
+		count = 2;
+	}
+
+	build_cmsg(&conn2->fds_out, cmsg, &clen);
+
+	msg.msg_name = NULL;
+	msg.msg_namelen = 0;
+	msg.msg_iov = iov;
+	msg.msg_iovlen = count;
+	msg.msg_control = cmsg;
+	msg.msg_controllen = clen;
+	msg.msg_flags = 0;
+
+	do {
+		len = sendmsg(conn2->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+	} while (len == -1 && errno == EINTR);
+
+	if (len == -1) {
+		if (errno != EAGAIN)
+			return -1;
+
+		/* queue everything */
+		len = 0;
+	} else {
+		close_fds(&conn2->fds_out, MAX_FDS_OUT);
+	}
+
+	conn1->in.tail += len;
+
+	/* socket did not take everything */
+	if ((size_t) len < size)
+		return forward_copy(conn1, conn2, size - len);
+
+	return len;
+}
+
 const char *
 get_next_argument(const char *signature, struct argument_details *details)
 {
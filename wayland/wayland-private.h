@@ -86,10 +86,21 @@ int wl_interface_equal(const struct wl_interface *iface1,
 		       const struct wl_interface *iface2);
 
 struct wl_connection *wl_connection_create(int fd);
+int wl_connection_set_buffer_size(struct wl_connection *connection,
+				  size_t size, size_t max_size);
+size_t wl_connection_buffer_size(struct wl_connection *connection);
+size_t wl_connection_round_buffer_size(size_t size);
+size_t wl_connection_pending_output(struct wl_connection *connection);
 void wl_connection_destroy(struct wl_connection *connection);
 void wl_connection_copy(struct wl_connection *connection, void *data, size_t size);
 void wl_connection_consume(struct wl_connection *connection, size_t size);
 int wl_connection_copy_fds(struct wl_connection *conn1, struct wl_connection *conn2);
+int wl_connection_put_fd(struct wl_connection *connection, int32_t fd);
+void wl_connection_close_fds_in(struct wl_connection *connection, int max);
+void *wl_connection_get_data(struct wl_connection *connection,
+			     size_t offset, size_t size, void *buf);
+int wl_connection_forward(struct wl_connection *conn1,
+			  struct wl_connection *conn2, size_t size);
 
 int wl_connection_flush(struct wl_connection *connection);
 int wl_connection_read(struct wl_connection *connection);